@@ -58,6 +58,7 @@ namespace alpha {
 			format.encodingSubstitutionPolicy = encodingSubstitutionPolicy;
 			format.newline = newlines.isLiteral() ? newlines : buffer.textFile().newline();
 			format.unicodeByteOrderMark = writeUnicodeByteOrderMark;
+			format.syncPolicy = ascension::kernel::fileio::DONT_SYNC;
 			buffer.textFile().write(format, 0);
 		}
 	} // namespace @0
@@ -346,6 +347,7 @@ namespace alpha {
 					format.newline = newlines;
 					format.encodingSubstitutionPolicy = encodingSubstitutionPolicy;
 					format.unicodeByteOrderMark = writeUnicodeByteOrderMark;
+					format.syncPolicy = ascension::kernel::fileio::DONT_SYNC;
 					ascension::kernel::fileio::writeRegion(buffer, region, fileName, format, append);
 				}),
 				(boost::python::arg("region"), boost::python::arg("filename"), boost::python::arg("append") = false,
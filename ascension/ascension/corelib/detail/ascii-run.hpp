@@ -0,0 +1,107 @@
+/**
+ * @file ascii-run.hpp
+ * Defines @c detail#decodeAsciiRun and @c detail#encodeAsciiRun functions.
+ * @author agent
+ * @date 2026-10-16 Separated from unicode.cpp.
+ */
+
+#ifndef ASCENSION_ASCII_RUN_HPP
+#define ASCENSION_ASCII_RUN_HPP
+#include <ascension/corelib/basic-types.hpp>	// Byte
+#include <ascension/corelib/text/character.hpp>	// text.Char
+#include <ascension/corelib/detail/simd.hpp>
+#include <algorithm>	// std.copy
+#include <cstdint>
+#include <cstring>		// std.memcpy
+
+namespace ascension {
+	namespace detail {
+		/**
+		 * Converts the leading ASCII bytes into UTF-16. The bytes are widened 32 (AVX2), 16 (SSE2) or 8 (scalar)
+		 * at a time.
+		 * @param from The bytes to convert
+		 * @param to The destination
+		 * @param n The maximum number of the bytes to convert
+		 * @return The number of the converted bytes
+		 */
+		inline std::size_t decodeAsciiRun(const Byte* from, text::Char* to, std::size_t n) BOOST_NOEXCEPT {
+			std::size_t i = 0;
+#ifdef ASCENSION_DETAIL_USES_AVX2
+			for(; i + 32 <= n; i += 32) {
+				const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+				if(_mm256_movemask_epi8(bytes) != 0)
+					break;
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(to + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(to + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+			}
+#endif // ASCENSION_DETAIL_USES_AVX2
+#ifdef ASCENSION_DETAIL_USES_SSE2
+			for(; i + 16 <= n; i += 16) {
+				const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+				if(_mm_movemask_epi8(bytes) != 0)
+					break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(to + i), _mm_unpacklo_epi8(bytes, _mm_setzero_si128()));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(to + i + 8), _mm_unpackhi_epi8(bytes, _mm_setzero_si128()));
+			}
+#else
+			for(; i + 8 <= n; i += 8) {
+				std::uint64_t word;
+				std::memcpy(&word, from + i, sizeof(word));
+				if((word & 0x8080808080808080ull) != 0)
+					break;
+				std::copy(from + i, from + i + 8, to + i);
+			}
+#endif // ASCENSION_DETAIL_USES_SSE2
+			for(; i < n && from[i] < 0x80; ++i)
+				to[i] = from[i];
+			return i;
+		}
+
+		/**
+		 * Converts the leading ASCII characters into bytes. The characters are narrowed 32 (AVX2), 16 (SSE2) or 4
+		 * (scalar) at a time.
+		 * @param from The characters to convert
+		 * @param to The destination
+		 * @param n The maximum number of the characters to convert
+		 * @return The number of the converted characters
+		 */
+		inline std::size_t encodeAsciiRun(const text::Char* from, Byte* to, std::size_t n) BOOST_NOEXCEPT {
+			std::size_t i = 0;
+#ifdef ASCENSION_DETAIL_USES_AVX2
+			for(; i + 32 <= n; i += 32) {
+				const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+				const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i + 16));
+				if(!_mm256_testz_si256(_mm256_or_si256(first, second), _mm256_set1_epi16(static_cast<short>(0xff80u))))
+					break;
+				// _mm256_packus_epi16 packs in each 128-bit lane
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(to + i),
+					_mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xd8));
+			}
+#endif // ASCENSION_DETAIL_USES_AVX2
+#ifdef ASCENSION_DETAIL_USES_SSE2
+			for(; i + 16 <= n; i += 16) {
+				const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+				const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i + 8));
+				const __m128i nonAscii = _mm_and_si128(_mm_or_si128(first, second), _mm_set1_epi16(static_cast<short>(0xff80u)));
+				if(_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, _mm_setzero_si128())) != 0xffff)
+					break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(to + i), _mm_packus_epi16(first, second));
+			}
+#else
+			for(; i + 4 <= n; i += 4) {
+				std::uint64_t word;
+				std::memcpy(&word, from + i, sizeof(word));
+				if((word & 0xff80ff80ff80ff80ull) != 0)
+					break;
+				for(std::size_t j = i; j < i + 4; ++j)
+					to[j] = static_cast<Byte>(from[j]);
+			}
+#endif // ASCENSION_DETAIL_USES_SSE2
+			for(; i < n && from[i] < 0x80; ++i)
+				to[i] = static_cast<Byte>(from[i]);
+			return i;
+		}
+	}
+}
+
+#endif // !ASCENSION_ASCII_RUN_HPP
@@ -0,0 +1,226 @@
+/**
+ * @file fenwick-tree.hpp
+ * Defines @c detail#FenwickTree class template.
+ * @author agent
+ * @date 2026-10-16 Created.
+ */
+
+#ifndef ASCENSION_FENWICK_TREE_HPP
+#define ASCENSION_FENWICK_TREE_HPP
+#include <algorithm>	// std.min
+#include <cassert>
+#include <iterator>		// std.next
+#include <stdexcept>	// std.out_of_range
+#include <vector>
+#include <boost/config.hpp>
+
+namespace ascension {
+	namespace detail {
+		/**
+		 * A sequence of values which answers prefix sums in logarithmic time (a.k.a. binary indexed tree).
+		 * In addition to the classic point update, this supports insertion and erasure of elements. These
+		 * structural changes invalidate the tree only after the changed position, and the invalidated part is
+		 * rebuilt lazily by the next query which needs it, in time linear to the number of the elements after
+		 * the position.
+		 * @tparam T The element type. This must be value-initializable to zero and support @c +, @c += and
+		 *           @c -=. Unsigned integral types are fine because the arithmetic is modular
+		 * @note The const query methods may rebuild the internal tree. This class is not thread-safe even for
+		 *       the concurrent readers
+		 */
+		template<typename T>
+		class FenwickTree {
+		public:
+			typedef T value_type;
+			typedef std::size_t size_type;
+
+			/// Creates an empty sequence.
+			FenwickTree() : tree_(1), validSize_(0) {}
+			/**
+			 * Creates a sequence with the given values.
+			 * @tparam InputIterator The type of @a first and @a last
+			 * @param first The beginning of the values
+			 * @param last The end of the values
+			 */
+			template<typename InputIterator>
+			FenwickTree(InputIterator first, InputIterator last) : values_(first, last), tree_(values_.size() + 1), validSize_(0) {}
+
+			/**
+			 * Returns the value at @a position.
+			 * @param position The position of the value
+			 * @return The value
+			 * @throw std#out_of_range @a position is invalid
+			 */
+			const value_type& at(size_type position) const {
+				return values_.at(position);
+			}
+			/// Returns the value at @a position. This method does not check the bounds.
+			const value_type& operator[](size_type position) const BOOST_NOEXCEPT {
+				return values_[position];
+			}
+			/// Returns @c true if the sequence is empty.
+			bool empty() const BOOST_NOEXCEPT {
+				return values_.empty();
+			}
+			/// Returns the number of the values.
+			size_type size() const BOOST_NOEXCEPT {
+				return values_.size();
+			}
+
+			/**
+			 * Replaces all the values.
+			 * @tparam InputIterator The type of @a first and @a last
+			 * @param first The beginning of the values
+			 * @param last The end of the values
+			 */
+			template<typename InputIterator>
+			void assign(InputIterator first, InputIterator last) {
+				std::vector<value_type> newValues(first, last);
+				tree_.resize(newValues.size() + 1);
+				std::swap(values_, newValues);
+				validSize_ = 0;
+			}
+			/// Removes all the values.
+			void clear() BOOST_NOEXCEPT {
+				values_.clear();
+				tree_.resize(1);
+				validSize_ = 0;
+			}
+			/**
+			 * Removes the values in the given range.
+			 * @param first The position of the first value to remove
+			 * @param last The position of the end of the values to remove
+			 * @throw std#out_of_range @a first or @a last is invalid
+			 */
+			void erase(size_type first, size_type last) {
+				if(first > last || last > size())
+					throw std::out_of_range("first or last");
+				values_.erase(std::next(values_.begin(), first), std::next(values_.begin(), last));
+				tree_.resize(values_.size() + 1);
+				validSize_ = std::min(validSize_, first);
+			}
+			/**
+			 * Inserts the values before the specified position.
+			 * @tparam InputIterator The type of @a first and @a last
+			 * @param position The position to insert
+			 * @param first The beginning of the values to insert
+			 * @param last The end of the values to insert
+			 * @throw std#out_of_range @a position is greater than the size
+			 */
+			template<typename InputIterator>
+			void insert(size_type position, InputIterator first, InputIterator last) {
+				if(position > size())
+					throw std::out_of_range("position");
+				values_.insert(std::next(values_.begin(), position), first, last);
+				tree_.resize(values_.size() + 1);
+				validSize_ = std::min(validSize_, position);
+			}
+			/**
+			 * Inserts the value before the specified position.
+			 * @param position The position to insert
+			 * @param value The value to insert
+			 * @throw std#out_of_range @a position is greater than the size
+			 */
+			void insert(size_type position, const value_type& value) {
+				return insert(position, &value, &value + 1);
+			}
+			/**
+			 * Reserves the storage to avoid the reallocation by the later insertions.
+			 * @param capacity The number of the values to reserve
+			 */
+			void reserve(size_type capacity) {
+				values_.reserve(capacity);
+				tree_.reserve(capacity + 1);
+			}
+			/**
+			 * Replaces the value at @a position.
+			 * @param position The position of the value to replace
+			 * @param value The new value
+			 * @throw std#out_of_range @a position is invalid
+			 */
+			void set(size_type position, const value_type& value) {
+				value_type& target = values_.at(position);
+				for(size_type i = position + 1; i <= validSize_; i += lowestBit(i)) {
+					tree_[i] += value;
+					tree_[i] -= target;
+				}
+				target = value;
+			}
+
+			/**
+			 * Returns the largest @c n such that @a predicate returns @c true for the sum of the first @c n values.
+			 * @tparam Predicate The type of @a predicate
+			 * @param predicate The predicate takes the sum of the first @c n values and @c n. This must be
+			 *                  partitioned, that is, return @c true for all @c n less than some value and @c false
+			 *                  for the rest. The result for zero is assumed to be @c true
+			 * @return The number of the values, in the range [0, size()]
+			 */
+			template<typename Predicate>
+			size_type partitionPoint(Predicate predicate) const {
+				validate(size());
+				size_type step = 1;
+				while(step <= size() / 2)
+					step <<= 1;
+				size_type n = 0;
+				value_type sum = value_type();
+				for(; step != 0; step >>= 1) {
+					if(n + step <= size()) {
+						const value_type candidate(sum + tree_[n + step]);
+						if(predicate(candidate, n + step)) {
+							n += step;
+							sum = candidate;
+						}
+					}
+				}
+				return n;
+			}
+			/**
+			 * Returns the sum of the first @a n values.
+			 * @param n The number of the values to sum
+			 * @return The sum
+			 * @throw std#out_of_range @a n is greater than the size
+			 */
+			value_type prefixSum(size_type n) const {
+				if(n > size())
+					throw std::out_of_range("n");
+				validate(n);
+				value_type sum = value_type();
+				for(; n != 0; n -= lowestBit(n))
+					sum += tree_[n];
+				return sum;
+			}
+			/// Returns the sum of all the values.
+			value_type sum() const {
+				return prefixSum(size());
+			}
+
+		private:
+			static size_type lowestBit(size_type i) BOOST_NOEXCEPT {
+				return i & (~i + 1);
+			}
+			void validate(size_type n) const BOOST_NOEXCEPT {
+				if(n <= validSize_)
+					return;
+				// the nodes in [validSize_ + 1, size()] are broken. rebuild them from 'values_' and the intact nodes
+				const size_type first = validSize_ + 1, last = size() + 1;
+				for(size_type i = first; i < last; ++i)
+					tree_[i] = values_[i - 1];
+				for(size_type i = first - 1; i != 0; i -= lowestBit(i)) {	// the intact nodes whose parents are broken
+					const size_type parent = i + lowestBit(i);
+					if(parent < last)
+						tree_[parent] += tree_[i];
+				}
+				for(size_type i = first; i < last; ++i) {
+					const size_type parent = i + lowestBit(i);
+					if(parent < last)
+						tree_[parent] += tree_[i];
+				}
+				validSize_ = size();
+			}
+			std::vector<value_type> values_;
+			mutable std::vector<value_type> tree_;	// 1-based. tree_[0] is not used
+			mutable size_type validSize_;	// tree_[1..validSize_] are up to date
+		};
+	}
+}
+
+#endif // !ASCENSION_FENWICK_TREE_HPP
@@ -0,0 +1,114 @@
+/**
+ * @file sequence-diff.hpp
+ * Defines @c detail#diffSequences function template.
+ * @author agent
+ * @date 2026-10-16 Created.
+ */
+
+#ifndef ASCENSION_SEQUENCE_DIFF_HPP
+#define ASCENSION_SEQUENCE_DIFF_HPP
+#include <algorithm>	// std.min, std.reverse
+#include <cstddef>		// std.ptrdiff_t, std.size_t
+#include <utility>		// std.pair
+#include <vector>
+
+namespace ascension {
+	namespace detail {
+		/// A hunk of @c diffSequences. The elements [first, last) of the old sequence are replaced with the elements
+		/// [newFirst, newLast) of the new sequence.
+		struct DiffHunk {
+			std::size_t first, last;		///< The replaced elements in the old sequence.
+			std::size_t newFirst, newLast;	///< The replacing elements in the new sequence.
+		};
+
+		/**
+		 * Computes the shortest edit script between the two sequences by Myers' O(ND) algorithm, and returns it as
+		 * the hunks. The common prefix and suffix are trimmed before the search.
+		 *
+		 * The search takes O((n + m) D) time and O(D^2) space, where D is the number of the inserted and erased
+		 * elements. If D exceeds @a maximumDistance, the search is given up and all the elements between the common
+		 * prefix and suffix are returned as one hunk.
+		 * @tparam Equal The type of @a equal
+		 * @param n The number of the elements in the old sequence
+		 * @param m The number of the elements in the new sequence
+		 * @param equal The function takes the indices in the old and the new sequences and returns @c true if the
+		 *              elements are equal
+		 * @param maximumDistance The maximum D to search
+		 * @return The hunks in the ascending order. Empty if the sequences are equal
+		 */
+		template<typename Equal>
+		inline std::vector<DiffHunk> diffSequences(std::size_t n, std::size_t m, Equal equal, std::size_t maximumDistance) {
+			std::size_t prefix = 0, suffix = 0;
+			while(prefix < n && prefix < m && equal(prefix, prefix))
+				++prefix;
+			while(suffix < n - prefix && suffix < m - prefix && equal(n - suffix - 1, m - suffix - 1))
+				++suffix;
+			const std::ptrdiff_t oldLength = n - prefix - suffix, newLength = m - prefix - suffix;
+			std::vector<DiffHunk> hunks;
+			if(oldLength == 0 && newLength == 0)
+				return hunks;
+			const DiffHunk whole = {prefix, n - suffix, prefix, m - suffix};
+			if(oldLength == 0 || newLength == 0) {
+				hunks.push_back(whole);
+				return hunks;
+			}
+
+			// search forward. trace[d] is the furthest x on each diagonal k in [-d, d] before the step d
+			const std::ptrdiff_t maximumD = std::min<std::ptrdiff_t>(oldLength + newLength, maximumDistance);
+			std::vector<std::ptrdiff_t> v(2 * maximumD + 3, 0);
+			const std::ptrdiff_t origin = maximumD + 1;
+			std::vector<std::vector<std::ptrdiff_t>> trace;
+			std::ptrdiff_t d = 0;
+			for(bool reached = false; !reached; ++d) {
+				if(d > maximumD) {
+					hunks.push_back(whole);
+					return hunks;
+				}
+				trace.push_back(std::vector<std::ptrdiff_t>(v.cbegin() + origin - d, v.cbegin() + origin + d + 1));
+				for(std::ptrdiff_t k = -d; k <= d; k += 2) {
+					std::ptrdiff_t x = (k == -d || (k != d && v[origin + k - 1] < v[origin + k + 1])) ? v[origin + k + 1] : v[origin + k - 1] + 1;
+					std::ptrdiff_t y = x - k;
+					while(x < oldLength && y < newLength && equal(prefix + x, prefix + y))
+						++x, ++y;
+					v[origin + k] = x;
+					if(x >= oldLength && y >= newLength) {
+						reached = true;
+						break;
+					}
+				}
+			}
+
+			// trace back the matched elements
+			std::vector<std::pair<std::size_t, std::size_t>> matches;
+			std::ptrdiff_t x = oldLength, y = newLength;
+			while(--d > 0) {
+				const std::vector<std::ptrdiff_t>& previous = trace[d];
+				const std::ptrdiff_t k = x - y;
+				const std::ptrdiff_t previousK = (k == -d || (k != d && previous[k - 1 + d] < previous[k + 1 + d])) ? k + 1 : k - 1;
+				const std::ptrdiff_t previousX = previous[previousK + d], previousY = previousX - previousK;
+				while(x > previousX && y > previousY)
+					matches.push_back(std::make_pair(prefix + --x, prefix + --y));
+				x = previousX;
+				y = previousY;
+			}
+			while(x > 0)	// the snake of d = 0
+				matches.push_back(std::make_pair(prefix + --x, prefix + --y));
+			std::reverse(matches.begin(), matches.end());
+
+			// the gaps between the matches are the hunks
+			std::size_t first = prefix, newFirst = prefix;
+			matches.push_back(std::make_pair(whole.last, whole.newLast));	// sentinel
+			for(const auto& match : matches) {
+				if(match.first > first || match.second > newFirst) {
+					const DiffHunk hunk = {first, match.first, newFirst, match.second};
+					hunks.push_back(hunk);
+				}
+				first = match.first + 1;
+				newFirst = match.second + 1;
+			}
+			return hunks;
+		}
+	}
+}
+
+#endif // !ASCENSION_SEQUENCE_DIFF_HPP
@@ -0,0 +1,42 @@
+/**
+ * @file simd.hpp
+ * Defines @c ASCENSION_DETAIL_USES_SSE2, @c ASCENSION_DETAIL_USES_SSSE3 and @c ASCENSION_DETAIL_USES_AVX2 symbols.
+ * @author agent
+ * @date 2026-10-16 Created.
+ */
+
+#ifndef ASCENSION_SIMD_HPP
+#define ASCENSION_SIMD_HPP
+
+/**
+ * @internal
+ * @def ASCENSION_DETAIL_USES_SSE2
+ * Defined if the target supports SSE2 instructions, and @c <emmintrin.h> is included.
+ */
+/**
+ * @internal
+ * @def ASCENSION_DETAIL_USES_SSSE3
+ * Defined if the target supports SSSE3 instructions, and @c <tmmintrin.h> is included.
+ */
+/**
+ * @internal
+ * @def ASCENSION_DETAIL_USES_AVX2
+ * Defined if the target supports AVX2 instructions, and @c <immintrin.h> is included.
+ */
+
+#ifndef ASCENSION_NO_SIMD
+#	if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		include <emmintrin.h>
+#		define ASCENSION_DETAIL_USES_SSE2
+#	endif
+#	if defined(__SSSE3__) || defined(__AVX__)
+#		include <tmmintrin.h>
+#		define ASCENSION_DETAIL_USES_SSSE3
+#	endif
+#	if defined(__AVX2__)
+#		include <immintrin.h>
+#		define ASCENSION_DETAIL_USES_AVX2
+#	endif
+#endif // !ASCENSION_NO_SIMD
+
+#endif // !ASCENSION_SIMD_HPP
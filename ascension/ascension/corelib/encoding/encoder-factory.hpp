@@ -38,6 +38,13 @@ namespace ascension {
 				boost::ignore_unused(locale);
 				return name();
 			}
+			/**
+			 * Returns @c true if the decoding can start at the beginning of any line of the encoded input. That is,
+			 * the decoder has no shift state carried over a newline, and the bytes encode the newline (LF) can not
+			 * appear in the other characters. Such an input can be split at newlines and decoded in parallel.
+			 * Default implementation returns @c false.
+			 */
+			virtual bool isResynchronizable() const BOOST_NOEXCEPT {return false;}
 			/// Returns the number of bytes represents a UCS character.
 			virtual std::size_t maximumNativeBytes() const BOOST_NOEXCEPT = 0;
 			/// Returns the number of UCS characters represents a native character. Default implementation returns 1.
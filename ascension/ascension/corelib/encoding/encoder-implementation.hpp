@@ -10,9 +10,13 @@
 #define ASCENSION_ENCODER_IMPLEMENTATION_HPP
 #include <ascension/corelib/basic-types.hpp>
 #include <ascension/corelib/encoding/encoder-factory.hpp>
+#include <boost/core/noncopyable.hpp>
+#include <algorithm>	// std.copy_n
 #include <array>
 #include <locale>	// std.locale, std.codecvt
 #include <memory>	// std.unique_ptr
+#include <new>		// std.bad_alloc
+#include <vector>
 
 namespace ascension {
 	namespace encoding {
@@ -59,7 +63,9 @@ namespace ascension {
 			template<typename Code,
 				Code c0, Code c1, Code c2, Code c3, Code c4, Code c5, Code c6, Code c7,
 				Code c8, Code c9, Code cA, Code cB, Code cC, Code cD, Code cE, Code cF>
-			struct CodeLine {static const Code VALUES[16];};
+			struct CodeLine {
+				BOOST_STATIC_CONSTEXPR Code VALUES[16] = {c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, cA, cB, cC, cD, cE, cF};
+			};
 
 			/// Generates 16-character sequence.
 			template<
@@ -71,19 +77,25 @@ namespace ascension {
 			template<Char start, Char step = +1> struct SequentialCharLine : public CharLine<
 				start + step * 0, start + step * 1, start + step * 2, start + step * 3,
 				start + step * 4, start + step * 5, start + step * 6, start + step * 7,
-				start + step * 8, start + step * 8, start + step * 10, start + step * 11,
+				start + step * 8, start + step * 9, start + step * 10, start + step * 11,
 				start + step * 12, start + step * 13, start + step * 14, start + step * 15> {};
 
 			/// Generates an all NUL character sequence.
 			struct EmptyCharLine : public SequentialCharLine<0xfffdu, 0> {};
 
-			/// Generates 16×16-code sequence.
+			/**
+			 * Generates 16×16-code sequence. @c VALUES is the table of the 16 lines, and @c FLAT_VALUES is the flat
+			 * table of the 256 codes which is indexed by a byte directly. Both are initialized at compile time.
+			 */
 			template<typename Code,
 				typename Line0, typename Line1, typename Line2, typename Line3,
 				typename Line4, typename Line5, typename Line6, typename Line7,
 				typename Line8, typename Line9, typename LineA, typename LineB,
 				typename LineC, typename LineD, typename LineE, typename LineF>
-			struct CodeWire {static const Code* VALUES[16];};
+			struct CodeWire {
+				static const Code* VALUES[16];
+				static const Code FLAT_VALUES[256];
+			};
 
 			/// Returns a code corresponds to a byte in the 16×16 wire.
 			/// @see CodeWire
@@ -102,20 +114,27 @@ namespace ascension {
 				/// A substitution byte value in used in Unicode to native mapping table.
 				const Byte UNMAPPABLE_BYTE = 0x00;
 
-				/// Provides bidirectional mapping between a byte and a character.
-				/// @see CharMap
-				class BidirectionalMap {
+				/**
+				 * Provides bidirectional mapping between a byte and a character.
+				 *
+				 * A byte is mapped through the flat 256-entry table given to the constructor. A character is mapped
+				 * through the two-level table which is built from the flat table. The second level consists of the
+				 * 256-entry blocks for only the used high bytes of the characters, and the unused high bytes share
+				 * one all-unmappable block. All the blocks are allocated in one contiguous array.
+				 * @note This class is not intended to be subclassed.
+				 * @see CodeWire#FLAT_VALUES
+				 */
+				class BidirectionalMap : private boost::noncopyable {
 				public:
-					BidirectionalMap(const Char** byteToCharacterWire) BOOST_NOEXCEPT;
-					~BidirectionalMap() BOOST_NOEXCEPT;
+					explicit BidirectionalMap(const Char* byteToCharacterTable);
+					bool isAsciiCompatible() const BOOST_NOEXCEPT;
 					Byte toByte(Char c) const BOOST_NOEXCEPT;
 					Char toCharacter(Byte c) const BOOST_NOEXCEPT;
 				private:
-					void buildUnicodeToByteTable();
-				private:
-					const Char** const byteToUnicode_;
-					std::array<Byte*, 0x100> unicodeToByte_;
-					static const std::array<const Byte, 0x100> UNMAPPABLE_16x16_UNICODE_TABLE;
+					const Char* const byteToUnicode_;
+					std::array<const Byte*, 0x100> unicodeToByte_;
+					std::vector<Byte> unicodeToByteBlocks_;
+					bool asciiCompatible_;
 				};
 
 				/// Generates ISO IR C0 character sequence 0x00 through 0x0F.
@@ -173,10 +192,20 @@ namespace ascension {
 					SingleByteEncoderFactory(const std::string& name, MIBenum mib,
 						const std::string& displayName, const std::string& aliases, Byte substitutionCharacter);
 					virtual ~SingleByteEncoderFactory() BOOST_NOEXCEPT;
+					/// Returns @c true because single byte charsets have no state.
+					bool isResynchronizable() const BOOST_NOEXCEPT override {return true;}
 				private:
 					std::unique_ptr<Encoder> create() const BOOST_NOEXCEPT override;
 				};
 
+				/**
+				 * Returns @c true if the bytes 0x00 through 0x7F are mapped to U+0000 through U+007F. The runs of such
+				 * bytes and characters can be converted without the tables.
+				 */
+				inline bool BidirectionalMap::isAsciiCompatible() const BOOST_NOEXCEPT {
+					return asciiCompatible_;
+				}
+
 				/**
 				 * Returns the byte corresponds to the given character @c c or @c UNMAPPABLE_BYTE if umappable.
 				 * @param c The character to map
@@ -192,7 +221,7 @@ namespace ascension {
 				 * @return The corresponding character or @c REPLACEMENT_CHARACTER
 				 */
 				inline Char BidirectionalMap::toCharacter(Byte c) const BOOST_NOEXCEPT {
-					return wireAt(byteToUnicode_, c);
+					return byteToUnicode_[c];
 				}
 
 				/**
@@ -215,13 +244,23 @@ namespace ascension {
 
 				namespace detail {
 					std::unique_ptr<Encoder> createSingleByteEncoder(
-						const Char** byteToCharacterWire, const EncodingProperties& properties) BOOST_NOEXCEPT;
+						const BidirectionalMap& table, const EncodingProperties& properties) BOOST_NOEXCEPT;
 				}
 
-				/// @see EncoderFactory#create
+				/**
+				 * @see EncoderFactory#create
+				 * @return The encoder, or @c null if the mapping tables could not be allocated. The next call tries to
+				 *         build the tables again
+				 */
 				template<typename MappingTable> std::unique_ptr<Encoder>
 				SingleByteEncoderFactory<MappingTable>::create() const BOOST_NOEXCEPT {
-					return detail::createSingleByteEncoder(MappingTable::VALUES, *this);
+					try {
+						// the tables are shared by all the encoders of the charset
+						static const BidirectionalMap table(MappingTable::FLAT_VALUES);
+						return detail::createSingleByteEncoder(table, *this);
+					} catch(const std::bad_alloc&) {
+						return std::unique_ptr<Encoder>();
+					}
 				}
 			} // namespace sbcs
 
@@ -247,15 +286,93 @@ namespace ascension {
 					typename LineC, typename LineD, typename LineE, typename LineF>
 				class DBCSWire : public CodeWire<std::uint16_t, Line0, Line1, Line2, Line3,
 					Line4, Line5, Line6, Line7, Line8, Line9, LineA, LineB, LineC, LineD, LineE, LineF> {};
+
+				/**
+				 * A flat table maps a pair of a lead byte and a trail byte to a character. A row of 256 characters is
+				 * allocated for each lead byte in the range, so a character is looked up by one load.
+				 * @note This class is not intended to be subclassed.
+				 * @see EncodingTable
+				 */
+				class DecodingTable : private boost::noncopyable {
+				public:
+					template<typename Mapping>
+					DecodingTable(Byte firstLead, Byte lastLead, Mapping mapping);
+					/// Returns the character of @a lead and @a trail. @a lead should be in the range of the table.
+					Char operator()(Byte lead, Byte trail) const BOOST_NOEXCEPT {
+						return characters_[((lead - firstLead_) << 8) | trail];
+					}
+				private:
+					const Byte firstLead_;
+					std::vector<Char> characters_;
+				};
+
+				/**
+				 * A two-level table maps a character to double bytes. The second level consists of the 256-entry
+				 * blocks for the high bytes of the mapped characters, and the other high bytes share one block of
+				 * zeros.
+				 * @note This class is not intended to be subclassed.
+				 * @see DecodingTable
+				 */
+				class EncodingTable : private boost::noncopyable {
+				public:
+					template<typename Mapping>
+					explicit EncodingTable(Mapping mapping);
+					/// Returns the double bytes of @a c, or zero if unmappable.
+					std::uint16_t operator()(Char c) const BOOST_NOEXCEPT {
+						return blocks_[c >> 8][mask8Bit(c)];
+					}
+				private:
+					std::array<const std::uint16_t*, 0x100> blocks_;
+					std::vector<std::uint16_t> values_;
+				};
+
+				/**
+				 * Constructor builds the table.
+				 * @tparam Mapping The type of @a mapping
+				 * @param firstLead The first lead byte of the range
+				 * @param lastLead The last lead byte of the range
+				 * @param mapping The function takes a lead byte and a trail byte, and returns the character
+				 */
+				template<typename Mapping>
+				inline DecodingTable::DecodingTable(Byte firstLead, Byte lastLead, Mapping mapping)
+						: firstLead_(firstLead), characters_((lastLead - firstLead + 1) * 0x100) {
+					for(std::size_t lead = firstLead; lead <= lastLead; ++lead) {
+						for(std::size_t trail = 0x00; trail <= 0xff; ++trail)
+							characters_[((lead - firstLead) << 8) | trail] = mapping(static_cast<Byte>(lead), static_cast<Byte>(trail));
+					}
+				}
+
+				/**
+				 * Constructor builds the table.
+				 * @tparam Mapping The type of @a mapping
+				 * @param mapping The function takes a character in BMP, and returns the double bytes or zero
+				 */
+				template<typename Mapping>
+				inline EncodingTable::EncodingTable(Mapping mapping) {
+					std::vector<std::uint16_t> values(0x10000);
+					std::array<std::size_t, 0x100> blockIndices;
+					blockIndices.fill(0);
+					std::size_t numberOfBlocks = 1;
+					for(std::size_t c = 0x0000; c <= 0xffff; ++c) {
+						if((values[c] = mapping(static_cast<Char>(c))) != 0 && blockIndices[c >> 8] == 0)
+							blockIndices[c >> 8] = numberOfBlocks++;
+					}
+
+					values_.resize(numberOfBlocks * 0x100, 0);
+					for(std::size_t high = 0x00; high <= 0xff; ++high) {
+						if(blockIndices[high] != 0)
+							std::copy_n(values.cbegin() + (high << 8), 0x100, values_.begin() + (blockIndices[high] << 8));
+						blocks_[high] = values_.data() + (blockIndices[high] << 8);
+					}
+				}
 			} // namespace dbcs
 		}
 
 		template<typename Code,
 			Code c0, Code c1, Code c2, Code c3, Code c4, Code c5, Code c6, Code c7,
 			Code c8, Code c9, Code cA, Code cB, Code cC, Code cD, Code cE, Code cF>
-		const Code implementation::CodeLine<Code,
-			c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, cA, cB, cC, cD, cE, cF>::VALUES[16] = {
-			c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, cA, cB, cC, cD, cE, cF};
+		BOOST_CONSTEXPR_OR_CONST Code implementation::CodeLine<Code,
+			c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, cA, cB, cC, cD, cE, cF>::VALUES[16];
 
 		template<typename Code,
 			typename Line0, typename Line1, typename Line2, typename Line3, typename Line4, typename Line5, typename Line6, typename Line7,
@@ -264,6 +381,22 @@ namespace ascension {
 			Line0, Line1, Line2, Line3, Line4, Line5, Line6, Line7, Line8, Line9, LineA, LineB,LineC, LineD, LineE, LineF>::VALUES[16] = {
 			Line0::VALUES, Line1::VALUES, Line2::VALUES, Line3::VALUES, Line4::VALUES, Line5::VALUES, Line6::VALUES, Line7::VALUES,
 			Line8::VALUES, Line9::VALUES, LineA::VALUES, LineB::VALUES, LineC::VALUES, LineD::VALUES, LineE::VALUES, LineF::VALUES};
+
+#define ASCENSION_CODE_WIRE_LINE(line)	\
+	line::VALUES[0x0], line::VALUES[0x1], line::VALUES[0x2], line::VALUES[0x3],	\
+	line::VALUES[0x4], line::VALUES[0x5], line::VALUES[0x6], line::VALUES[0x7],	\
+	line::VALUES[0x8], line::VALUES[0x9], line::VALUES[0xa], line::VALUES[0xb],	\
+	line::VALUES[0xc], line::VALUES[0xd], line::VALUES[0xe], line::VALUES[0xf]
+		template<typename Code,
+			typename Line0, typename Line1, typename Line2, typename Line3, typename Line4, typename Line5, typename Line6, typename Line7,
+			typename Line8, typename Line9, typename LineA, typename LineB, typename LineC, typename LineD, typename LineE, typename LineF>
+		const Code implementation::CodeWire<Code,
+			Line0, Line1, Line2, Line3, Line4, Line5, Line6, Line7, Line8, Line9, LineA, LineB,LineC, LineD, LineE, LineF>::FLAT_VALUES[256] = {
+			ASCENSION_CODE_WIRE_LINE(Line0), ASCENSION_CODE_WIRE_LINE(Line1), ASCENSION_CODE_WIRE_LINE(Line2), ASCENSION_CODE_WIRE_LINE(Line3),
+			ASCENSION_CODE_WIRE_LINE(Line4), ASCENSION_CODE_WIRE_LINE(Line5), ASCENSION_CODE_WIRE_LINE(Line6), ASCENSION_CODE_WIRE_LINE(Line7),
+			ASCENSION_CODE_WIRE_LINE(Line8), ASCENSION_CODE_WIRE_LINE(Line9), ASCENSION_CODE_WIRE_LINE(LineA), ASCENSION_CODE_WIRE_LINE(LineB),
+			ASCENSION_CODE_WIRE_LINE(LineC), ASCENSION_CODE_WIRE_LINE(LineD), ASCENSION_CODE_WIRE_LINE(LineE), ASCENSION_CODE_WIRE_LINE(LineF)};
+#undef ASCENSION_CODE_WIRE_LINE
 	}
 } // namespace ascension.encoding
 
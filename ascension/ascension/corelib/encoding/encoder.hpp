@@ -67,6 +67,33 @@ namespace ascension {
 				BadStateException() : std::invalid_argument("Bad conversion state.") {}
 			};
 
+			/**
+			 * Interface for objects which supply the destination buffers to @c Encoder#toUnicode and receive the
+			 * decoded characters in them. This lets the caller decode the text directly into its final storage.
+			 * @see Encoder#toUnicode(State&, UnicodeSink&, const boost::iterator_range<const Byte*>&, const Byte*&)
+			 */
+			class UnicodeSink {
+			public:
+				/// Destructor.
+				virtual ~UnicodeSink() BOOST_NOEXCEPT {}
+				/**
+				 * Returns the buffer which the encoder writes the next decoded characters into.
+				 * @param minimumLength The minimum length of the buffer. This is large enough to hold at least one
+				 *                      decoded character
+				 * @return The buffer. The length must be @a minimumLength or more
+				 * @throw ... Any exceptions the implementation throws are passed to the caller of
+				 *            @c Encoder#toUnicode
+				 */
+				virtual boost::iterator_range<Char*> buffer(std::size_t minimumLength) = 0;
+				/**
+				 * Receives the characters written into the buffer returned by the last call of @c #buffer.
+				 * @param written The written characters. This begins at the beginning of the buffer, and can be empty
+				 * @throw ... Any exceptions the implementation throws are passed to the caller of
+				 *            @c Encoder#toUnicode
+				 */
+				virtual void commit(const boost::iterator_range<const Char*>& written) = 0;
+			};
+
 		public:
 			virtual ~Encoder() BOOST_NOEXCEPT;
 			static Encoder& defaultInstance() BOOST_NOEXCEPT;
@@ -80,6 +107,7 @@ namespace ascension {
 			std::string fromUnicode(const StringPiece& from);
 			Result toUnicode(State& state,
 				const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext);
+			Result toUnicode(State& state, UnicodeSink& to, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext);
 			String toUnicode(const boost::string_ref& from);
 			/// @}
 
@@ -18,10 +18,50 @@
 
 namespace ascension {
 	namespace encoding {
+		/**
+		 * A state machine which tests if a byte sequence is valid in an encoding. @c EncodingDetector#probe feeds
+		 * the bytes to the probers of the candidate encodings in one pass.
+		 * @see EncodingDetector#probe
+		 */
+		class EncodingProber : private boost::noncopyable {
+		public:
+			virtual ~EncodingProber() BOOST_NOEXCEPT;
+			/// Returns the MIBenum value of the encoding guessed from the bytes read so far.
+			virtual MIBenum mibEnum() const BOOST_NOEXCEPT = 0;
+			/// Returns the name of the encoding guessed from the bytes read so far.
+			virtual std::string name() const = 0;
+			/**
+			 * Returns the number of the characters read so far which distinguish the encoding from the others. For
+			 * example, the non-ASCII characters or the escape sequences.
+			 */
+			virtual std::size_t numberOfSignificantCharacters() const BOOST_NOEXCEPT = 0;
+			/**
+			 * Reads the characters begin in [first, last). The last character may continue after @a last.
+			 * @param first The beginning of the bytes to read. This is the result of the previous call, or the
+			 *              beginning of the sequence at the first call
+			 * @param last The end of the bytes to read
+			 * @param end The end of the whole sequence. A character truncated by @a end is treated as valid
+			 * @return The end of the read characters. If this is less than @a last, the byte at the returned
+			 *         position is invalid and this method is not called again
+			 */
+			virtual const Byte* read(const Byte* first, const Byte* last, const Byte* end) BOOST_NOEXCEPT = 0;
+		};
+
 		class EncodingDetector : private boost::noncopyable {
+		public:
+			/// A candidate encoding reported by @c #detect.
+			struct Candidate {
+				MIBenum mibEnum;				///< The MIBenum value of the encoding.
+				std::string name;				///< The name of the encoding.
+				std::size_t convertibleBytes;	///< The number of the initial bytes valid in the encoding.
+				/// The confidence in [0.0, 1.0]. This is zero if no distinguishing character was found.
+				double confidence;
+			};
 		public:
 			virtual ~EncodingDetector() BOOST_NOEXCEPT;
 			std::tuple<MIBenum, std::string, std::size_t> detect(const boost::iterator_range<const Byte*>& bytes) const;
+			std::tuple<MIBenum, std::string, std::size_t> detect(const boost::iterator_range<const Byte*>& bytes,
+				std::size_t maximumSampleLength, std::vector<Candidate>& candidates) const;
 			const std::string& name() const BOOST_NOEXCEPT;
 
 			/// @name Factory
@@ -36,6 +76,8 @@ namespace ascension {
 
 		protected:
 			explicit EncodingDetector(const boost::string_ref& name);
+			static void probe(const boost::iterator_range<const Byte*>& bytes,
+				const std::vector<EncodingProber*>& probers, std::vector<Candidate>& candidates);
 		private:
 			/**
 			 * Detects the encoding of the given character sequence.
@@ -44,6 +86,8 @@ namespace ascension {
 			 */
 			virtual std::tuple<MIBenum, std::string, std::size_t> doDetect(
 				const boost::iterator_range<const Byte*>& bytes) const BOOST_NOEXCEPT = 0;
+			virtual void doDetectCandidates(
+				const boost::iterator_range<const Byte*>& bytes, std::vector<Candidate>& candidates) const;
 		private:
 			static std::vector<std::shared_ptr<const EncodingDetector>>& registry();
 			const std::string name_;
@@ -2,21 +2,28 @@
  * @file memory.hpp
  * This file provides the following classes:
  * - MemoryPool
+ * - MemoryPool#ThreadCache
  * - FastArenaObject
  * @author exeal
  * @date 2005-2010 (was manah/memory.hpp)
  * @date 2010-10-21
- * @date 2011-2012, 2014
+ * @date 2011-2012, 2014, 2026
  */
 
 #ifndef ASCENSION_MEMORY_HPP
 #define ASCENSION_MEMORY_HPP
+#include <boost/config.hpp>	// BOOST_NO_CXX11_THREAD_LOCAL
 #include <boost/noncopyable.hpp>
-#include <algorithm>	// std.max
+#include <algorithm>	// std.find, std.max, std.upper_bound
+#include <atomic>
 #include <cassert>
-#include <cstddef>		// std.size_t
+#include <cstddef>		// std.max_align_t, std.ptrdiff_t, std.size_t
+#include <functional>	// std.less
+#include <iterator>		// std.begin, std.distance, std.end
 #include <memory>		// std.unique_ptr
+#include <mutex>
 #include <new>			// new[], delete[], std.bad_alloc, std.nothrow
+#include <vector>
 #undef min
 #undef max
 
@@ -76,98 +83,360 @@ namespace ascension {
 	inline void swap(AutoBuffer<T>& left, AutoBuffer<T>& right) {return left.swap(right);}
 #endif // ASCENSION_ABANDONED_AT_VERSION_08
 
-	// Efficient memory pool implementation (from MemoryPool of Efficient C++).
+	/**
+	 * Thread-safe pool of fixed size memory chunks. The chunks are carved from slabs, the contiguous memory blocks
+	 * allocated from the system at once. The freed chunks are kept in the pool, and @c #release returns the slabs
+	 * which have no chunk in use to the system.
+	 *
+	 * Each thread can have a @c ThreadCache, which allocates and deallocates the chunks without locking and
+	 * exchanges them with the pool in batches.
+	 * @see FastArenaObject
+	 */
 	class MemoryPool : private boost::noncopyable {
+	private:
+		struct Chunk {Chunk* next;};
+	public:
+		class ThreadCache;
+		/// Usage statistics of @c MemoryPool.
+		struct Statistics {
+			std::size_t chunkSize;			///< The size of a chunk in bytes.
+			std::size_t numberOfSlabs;		///< The number of the slabs allocated from the system.
+			std::size_t capacity;			///< The number of the chunks in the all slabs.
+			std::size_t numberOfUsedChunks;	///< The number of the chunks in use.
+		};
 	public:
-		MemoryPool(std::size_t chunkSize) BOOST_NOEXCEPT : chunkSize_(std::max(chunkSize, sizeof(Chunk))), chunks_(nullptr) {}
-		~MemoryPool() BOOST_NOEXCEPT {release();}
+		/**
+		 * Constructor does not allocate any slab.
+		 * @param chunkSize The size of a chunk in bytes
+		 * @param alignment The alignment of a chunk. This should not be greater than @c alignof(std::max_align_t)
+		 */
+		explicit MemoryPool(std::size_t chunkSize,
+				std::size_t alignment = alignof(std::max_align_t)) BOOST_NOEXCEPT :
+				chunkSize_(roundUp(std::max(chunkSize, sizeof(Chunk)), std::max<std::size_t>(alignment, alignof(Chunk)))),
+				chunksPerSlab_(std::max<std::size_t>(SLAB_SIZE / chunkSize_, +MINIMUM_CHUNKS_PER_SLAB)),
+				chunks_(nullptr), numberOfFreeChunks_(0), numberOfUsedChunks_(0) {
+			assert(alignment <= alignof(std::max_align_t));
+		}
+		/// Destructor returns the all slabs to the system. The chunks in use become invalid.
+		~MemoryPool() BOOST_NOEXCEPT {
+			assert(caches_.empty());
+			for(std::size_t i = 0; i < slabs_.size(); ++i)
+				::operator delete(slabs_[i]);
+		}
+		/**
+		 * Allocates a chunk.
+		 * @return The allocated chunk
+		 * @throw std#bad_alloc
+		 */
 		void* allocate() {
 			if(void* const chunk = allocate(std::nothrow))
 				return chunk;
 			throw std::bad_alloc();
 		}
-		void* allocate(const std::nothrow_t&) {
-			if(chunks_ == nullptr)
-				expandChunks();
-			if(Chunk* head = chunks_) {
-				chunks_ = head->next;
-				return head;
-			}
-			return nullptr;
+		/**
+		 * Allocates a chunk.
+		 * @return The allocated chunk, or @c null if failed
+		 */
+		void* allocate(const std::nothrow_t&) BOOST_NOEXCEPT {
+			std::lock_guard<std::mutex> lock(mutex_);
+			Chunk* chunk;
+			if(take(chunk, 1) == 0)
+				return nullptr;
+			++numberOfUsedChunks_;
+			return chunk;
 		}
+		/**
+		 * Deallocates the chunk.
+		 * @param doomed The chunk to deallocate, or @c null
+		 */
 		void deallocate(void* doomed) BOOST_NOEXCEPT {
-			if(Chunk* p = static_cast<Chunk*>(doomed)) {
-				p->next = chunks_;
-				chunks_ = p;
+			if(Chunk* const p = static_cast<Chunk*>(doomed)) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				p->next = nullptr;
+				give(p, p, 1);
+				--numberOfUsedChunks_;
 			}
 		}
+		/**
+		 * Returns the slabs which have no chunk in use to the system. The chunks cached by @c ThreadCache are
+		 * considered to be in use. Call @c ThreadCache#flush before to release them.
+		 */
 		void release() BOOST_NOEXCEPT {
-			for(Chunk* next = chunks_; next != nullptr; next = chunks_) {
-				chunks_ = chunks_->next;
-				::operator delete(next);
+			std::lock_guard<std::mutex> lock(mutex_);
+			if(numberOfFreeChunks_ < chunksPerSlab_)
+				return;
+			std::vector<std::size_t> freeChunks;	// for each slab
+			try {
+				freeChunks.resize(slabs_.size(), 0);
+			} catch(const std::bad_alloc&) {
+				return;
 			}
+			for(const Chunk* p = chunks_; p != nullptr; p = p->next)
+				++freeChunks[slabIndex(p)];
+
+			// unlink the chunks in the empty slabs, and free the slabs
+			for(Chunk** link = &chunks_; *link != nullptr; ) {
+				if(freeChunks[slabIndex(*link)] == chunksPerSlab_) {
+					*link = (*link)->next;
+					--numberOfFreeChunks_;
+				} else
+					link = &(*link)->next;
+			}
+			std::size_t n = 0;
+			for(std::size_t i = 0; i < slabs_.size(); ++i) {
+				if(freeChunks[i] == chunksPerSlab_)
+					::operator delete(slabs_[i]);
+				else
+					slabs_[n++] = slabs_[i];
+			}
+			slabs_.resize(n);
 		}
+		Statistics statistics() const;
+
 	private:
-		void expandChunks() BOOST_NOEXCEPT {
-			assert(chunks_ == nullptr);
-			Chunk* p = static_cast<Chunk*>(::operator new(chunkSize_, std::nothrow));
-			if(p == nullptr)
-				return;
-			Chunk* q = p;
-			p->next = nullptr;
-			int i;
-			for(i = 0; i < NUMBER_OF_CHUNKS_TO_EXPAND_AT_ONCE; ++i) {
-				if(nullptr == (p->next = static_cast<Chunk*>(::operator new(chunkSize_, std::nothrow))))
-					break;
-				p = p->next;
-				p->next = nullptr;
+		static std::size_t roundUp(std::size_t n, std::size_t alignment) BOOST_NOEXCEPT {
+			return (n + alignment - 1) / alignment * alignment;
+		}
+		// the following private methods must be called with locking mutex_
+		/// Allocates a new slab and adds the chunks in it to the free list.
+		bool expand() BOOST_NOEXCEPT {
+			try {
+				slabs_.reserve(slabs_.size() + 1);
+			} catch(const std::bad_alloc&) {
+				return false;
 			}
-			if(i != NUMBER_OF_CHUNKS_TO_EXPAND_AT_ONCE) {
-				Chunk* next;
-				do {
-					next = q->next;
-					::operator delete(q);
-					q = next;
-				} while(next != nullptr);
-				return;
+			char* const slab = static_cast<char*>(::operator new(chunkSize_ * chunksPerSlab_, std::nothrow));
+			if(slab == nullptr)
+				return false;
+			slabs_.insert(std::upper_bound(std::begin(slabs_), std::end(slabs_), slab, std::less<char*>()), slab);	// sorted by the address
+			for(std::size_t i = chunksPerSlab_; i > 0; --i) {
+				Chunk* const chunk = reinterpret_cast<Chunk*>(slab + (i - 1) * chunkSize_);
+				chunk->next = chunks_;
+				chunks_ = chunk;
 			}
-			chunks_ = q;
+			numberOfFreeChunks_ += chunksPerSlab_;
+			return true;
+		}
+		/// Adds the list of the chunks to the free list.
+		void give(Chunk* first, Chunk* last, std::size_t n) BOOST_NOEXCEPT {
+			last->next = chunks_;
+			chunks_ = first;
+			numberOfFreeChunks_ += n;
+		}
+		/// Returns the index of the slab contains the given chunk.
+		std::size_t slabIndex(const Chunk* chunk) const BOOST_NOEXCEPT {
+			const auto i(std::upper_bound(std::begin(slabs_), std::end(slabs_),
+				reinterpret_cast<char*>(const_cast<Chunk*>(chunk)), std::less<char*>()));
+			assert(i != std::begin(slabs_));
+			return std::distance(std::begin(slabs_), i) - 1;
+		}
+		/// Removes at most @a n chunks from the free list, and returns the number of them.
+		std::size_t take(Chunk*& first, std::size_t n) BOOST_NOEXCEPT {
+			assert(n > 0);
+			if(chunks_ == nullptr && !expand())
+				return 0;
+			first = chunks_;
+			Chunk* last = first;
+			std::size_t taken = 1;
+			for(; taken < n && last->next != nullptr; ++taken)
+				last = last->next;
+			chunks_ = last->next;
+			last->next = nullptr;
+			numberOfFreeChunks_ -= taken;
+			return taken;
 		}
 	private:
-		struct Chunk {Chunk* next;};
-		static const int NUMBER_OF_CHUNKS_TO_EXPAND_AT_ONCE = 32;
-		const std::size_t chunkSize_;
+		static const std::size_t SLAB_SIZE = 0x10000, MINIMUM_CHUNKS_PER_SLAB = 16;
+		const std::size_t chunkSize_, chunksPerSlab_;
+		mutable std::mutex mutex_;
+		Chunk* chunks_;	// the free list
+		std::size_t numberOfFreeChunks_;
+		std::vector<char*> slabs_;
+		std::vector<const ThreadCache*> caches_;
+		std::ptrdiff_t numberOfUsedChunks_;	// except ones counted by caches_
+	};
+
+	/**
+	 * Per-thread front end of @c MemoryPool. A cache allocates and deallocates the chunks without locking, and
+	 * exchanges them with the pool in batches. A cache must be used only by one thread.
+	 */
+	class MemoryPool::ThreadCache : private boost::noncopyable {
+	public:
+		/**
+		 * Constructor registers the cache to the pool.
+		 * @param pool The memory pool
+		 * @throw std#bad_alloc
+		 */
+		explicit ThreadCache(MemoryPool& pool) : pool_(pool), chunks_(nullptr), numberOfChunks_(0), numberOfUsedChunks_(0) {
+			std::lock_guard<std::mutex> lock(pool_.mutex_);
+			pool_.caches_.push_back(this);
+		}
+		/// Destructor returns the cached chunks to the pool.
+		~ThreadCache() BOOST_NOEXCEPT {
+			flush();
+			std::lock_guard<std::mutex> lock(pool_.mutex_);
+			pool_.caches_.erase(std::find(std::begin(pool_.caches_), std::end(pool_.caches_), this));
+			pool_.numberOfUsedChunks_ += numberOfUsedChunks_.load(std::memory_order_relaxed);
+		}
+		/**
+		 * Allocates a chunk.
+		 * @return The allocated chunk, or @c null if failed
+		 */
+		void* allocate(const std::nothrow_t&) BOOST_NOEXCEPT {
+			if(chunks_ == nullptr) {
+				std::lock_guard<std::mutex> lock(pool_.mutex_);
+				if((numberOfChunks_ = pool_.take(chunks_, BATCH_SIZE)) == 0)
+					return nullptr;
+			}
+			Chunk* const chunk = chunks_;
+			chunks_ = chunk->next;
+			--numberOfChunks_;
+			countUsedChunks(+1);
+			return chunk;
+		}
+		/**
+		 * Deallocates the chunk. The chunk may be allocated by the other thread.
+		 * @param doomed The chunk to deallocate, or @c null
+		 */
+		void deallocate(void* doomed) BOOST_NOEXCEPT {
+			if(Chunk* const p = static_cast<Chunk*>(doomed)) {
+				p->next = chunks_;
+				chunks_ = p;
+				++numberOfChunks_;
+				countUsedChunks(-1);
+				if(numberOfChunks_ >= BATCH_SIZE * 2) {
+					// return the chunks except the recently freed ones
+					Chunk* q = chunks_;
+					for(std::size_t i = 1; i < BATCH_SIZE; ++i)
+						q = q->next;
+					Chunk* const first = q->next;
+					q->next = nullptr;
+					for(q = first; q->next != nullptr; )
+						q = q->next;
+					std::lock_guard<std::mutex> lock(pool_.mutex_);
+					pool_.give(first, q, numberOfChunks_ - BATCH_SIZE);
+					numberOfChunks_ = BATCH_SIZE;
+				}
+			}
+		}
+		/// Returns the all cached chunks to the pool.
+		void flush() BOOST_NOEXCEPT {
+			if(chunks_ != nullptr) {
+				Chunk* last = chunks_;
+				while(last->next != nullptr)
+					last = last->next;
+				std::lock_guard<std::mutex> lock(pool_.mutex_);
+				pool_.give(chunks_, last, numberOfChunks_);
+				chunks_ = nullptr;
+				numberOfChunks_ = 0;
+			}
+		}
+	private:
+		void countUsedChunks(std::ptrdiff_t delta) BOOST_NOEXCEPT {
+			// only this thread writes, so does not need the atomic read-modify-write
+			numberOfUsedChunks_.store(numberOfUsedChunks_.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+		}
+		static const std::size_t BATCH_SIZE = 32;
+		MemoryPool& pool_;
 		Chunk* chunks_;
+		std::size_t numberOfChunks_;
+		std::atomic<std::ptrdiff_t> numberOfUsedChunks_;	// read by MemoryPool.statistics
+		friend class MemoryPool;
 	};
 
-	// Base class for types whose new and delete are fast.
+	/// Returns the usage statistics.
+	inline MemoryPool::Statistics MemoryPool::statistics() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::ptrdiff_t used = numberOfUsedChunks_;
+		for(std::size_t i = 0; i < caches_.size(); ++i)
+			used += caches_[i]->numberOfUsedChunks_.load(std::memory_order_relaxed);
+		const Statistics result = {chunkSize_, slabs_.size(), slabs_.size() * chunksPerSlab_, static_cast<std::size_t>(used)};
+		return result;
+	}
+
+	/**
+	 * Base class for types whose new and delete are fast. The objects are allocated from the @c MemoryPool for
+	 * @a T, through the @c MemoryPool#ThreadCache of the calling thread.
+	 * @tparam T The derived type, which should not be subclassed
+	 */
 	template<typename T> /* final */ class FastArenaObject {
 	public:
 		static void* operator new(std::size_t bytes) /*throw(std::bad_alloc)*/ {
-			if(pool_.get() == nullptr) {
-				pool_.reset(new(std::nothrow) MemoryPool(std::max(sizeof(T), bytes)));
-				if(pool_.get() == nullptr)
-					throw std::bad_alloc();
-			}
-			if(void* p = pool_->allocate())
+			if(void* const p = operator new(bytes, std::nothrow))
 				return p;
 			throw std::bad_alloc();
 		}
-		static void* operator new(std::size_t, const std::nothrow_t&) BOOST_NOEXCEPT {
-			if(pool_.get() == nullptr)
-				pool_.reset(new(std::nothrow) MemoryPool(sizeof(T)));
-			return (pool_.get() != nullptr) ? pool_->allocate(std::nothrow) : nullptr;
+		static void* operator new(std::size_t bytes, const std::nothrow_t&) BOOST_NOEXCEPT {
+			if(bytes != sizeof(T))
+				return ::operator new(bytes, std::nothrow);	// a subclass of T
+			if(MemoryPool::ThreadCache* const cache = threadCache())
+				return cache->allocate(std::nothrow);
+			else if(MemoryPool* const p = pool())
+				return p->allocate(std::nothrow);
+			return nullptr;
 		}
 		static void* operator new(std::size_t bytes, void* where) BOOST_NOEXCEPT {return ::operator new(bytes, where);}
-		static void operator delete(void* p) BOOST_NOEXCEPT {if(pool_.get() != nullptr) pool_->deallocate(p);}
-		static void operator delete(void* p, const std::nothrow_t&) BOOST_NOEXCEPT {return operator delete(p);}
+		static void operator delete(void* p, std::size_t bytes) BOOST_NOEXCEPT {
+			if(bytes != sizeof(T))
+				::operator delete(p);
+			else if(p != nullptr) {
+				if(MemoryPool::ThreadCache* const cache = threadCache())
+					cache->deallocate(p);
+				else
+					pool()->deallocate(p);
+			}
+		}
+		/// @note This assumes that the subclasses of @a T are not allocated by nothrow new.
+		static void operator delete(void* p, const std::nothrow_t&) BOOST_NOEXCEPT {return operator delete(p, sizeof(T));}
 		static void operator delete(void* p, void* where) BOOST_NOEXCEPT {return ::operator delete(p, where);}
+
+		/// Returns the usage statistics of the memory for @a T.
+		static MemoryPool::Statistics memoryStatistics() {
+			if(const MemoryPool* const p = pool())
+				return p->statistics();
+			const MemoryPool::Statistics empty = {sizeof(T), 0, 0, 0};
+			return empty;
+		}
+		/**
+		 * Returns the memory which is not used by the objects of @a T to the system. Call this after many objects
+		 * were deleted at once, for example, a document was closed. The chunks cached by the other threads are
+		 * not released.
+		 */
+		static void releaseUnusedMemory() BOOST_NOEXCEPT {
+			if(MemoryPool::ThreadCache* const cache = threadCache())
+				cache->flush();
+			if(MemoryPool* const p = pool())
+				p->release();
+		}
+
 	private:
-		static std::unique_ptr<MemoryPool> pool_;
+		static MemoryPool* pool() BOOST_NOEXCEPT {
+			// never destroyed, because the objects may be deleted during the destruction of the static objects
+			static MemoryPool* const instance = new(std::nothrow) MemoryPool(sizeof(T), alignof(T));
+			return instance;
+		}
+		static MemoryPool::ThreadCache* threadCache() BOOST_NOEXCEPT {
+#ifndef BOOST_NO_CXX11_THREAD_LOCAL
+			static thread_local bool destroyed = false;
+			struct Holder {
+				explicit Holder(MemoryPool& pool) : cache(pool) {}
+				~Holder() BOOST_NOEXCEPT {destroyed = true;}
+				MemoryPool::ThreadCache cache;
+			};
+			if(destroyed || pool() == nullptr)
+				return nullptr;	// the thread is exiting
+			try {
+				static thread_local Holder holder(*pool());
+				return &holder.cache;
+			} catch(...) {
+				return nullptr;
+			}
+#else
+			return nullptr;
+#endif
+		}
 	};
 
-	template<typename T> std::unique_ptr<MemoryPool> FastArenaObject<T>::pool_;
-
 } // namespace ascension
 
 #endif // !ASCENSION_MEMORY_HPP
@@ -20,6 +20,7 @@
 #include <boost/operators.hpp>	// boost.equality_comparable
 #include <boost/optional.hpp>
 #include <boost/range/algorithm/find_first_of.hpp>
+#include <vector>
 
 namespace ascension {
 	namespace text {
@@ -160,6 +161,15 @@ namespace ascension {
 		inline boost::optional<Newline> eatNewline(const SinglePassReadableRange& range) {
 			return eatNewline(boost::const_begin(range), boost::const_end(range));
 		}
+
+		/// @defgroup newline_scanning Newline Scanning
+		/// Finds the newlines in UTF-16 text or in bytes, examining a vector register at a time if possible.
+		/// @{
+		const Char* findNewline(const Char* first, const Char* last) BOOST_NOEXCEPT;
+		void findNewlines(const Char* first, const Char* last, std::vector<const Char*>& newlines);
+		const Byte* findNewlineByte(const Byte* first, const Byte* last) BOOST_NOEXCEPT;
+		void findNewlineBytes(const Byte* first, const Byte* last, std::vector<const Byte*>& newlines);
+		/// @}
 	}
 } // namespace ascension.text
 
@@ -165,7 +165,7 @@ namespace ascension {
 				};
 
 			public:
-				TextLayout(const String& textString, const presentation::ComputedTextToplevelStyle& toplevelStyle,
+				TextLayout(String textString, const presentation::ComputedTextToplevelStyle& toplevelStyle,
 					const presentation::ComputedTextLineStyle& lineStyle,
 					std::unique_ptr<presentation::ComputedStyledTextRunIterator> textRunStyles,
 					const presentation::ComputedTextRunStyle& defaultRunStyle,
@@ -309,7 +309,7 @@ namespace ascension {
 				void wrap(const RenderingContext2D& context, const TabSize& tabSize,
 					const presentation::styles::Length::Context& lengthContext, Scalar measure) BOOST_NOEXCEPT;
 			private:
-				const String& textString_;
+				const String textString_;
 				struct Styles {
 					const presentation::ComputedTextToplevelStyle& forToplevel;
 					const presentation::ComputedTextLineStyle& forLine;
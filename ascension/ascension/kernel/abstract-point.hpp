@@ -65,15 +65,19 @@ namespace ascension {
 			SignalConnector<DestructionSignal> destructionSignal() BOOST_NOEXCEPT;
 			/// @}
 
+		protected:
+			void positionChanged();
 		private:
 			virtual void adaptationLevelChanged() BOOST_NOEXCEPT;
 			virtual void contentReset() = 0;
 			virtual void documentAboutToBeChanged(const DocumentChange& change) = 0;
 			virtual void documentChanged(const DocumentChange& change) = 0;
 			void documentDisposed() BOOST_NOEXCEPT;
+			virtual Index indexedLine() const BOOST_NOEXCEPT = 0;
 			friend class Document;
 		private:
 			Document* document_;	// weak reference
+			Index line_;	// the line by which the document indexes this point. see positionChanged
 			boost::optional<AdaptationLevel> adaptationLevel_;
 			Direction gravity_;
 			DestructionSignal destructionSignal_;
@@ -10,10 +10,10 @@
 #ifndef ASCENSION_BOOKMARKER_HPP
 #define ASCENSION_BOOKMARKER_HPP
 #include <ascension/direction.hpp>
-#include <ascension/corelib/detail/gap-vector.hpp>
 #include <ascension/corelib/detail/listeners.hpp>
 #include <ascension/kernel/document-exceptions.hpp>
 #include <ascension/kernel/document-observers.hpp>
+#include <ascension/kernel/marker-tree.hpp>
 #include <boost/core/noncopyable.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/optional.hpp>
@@ -39,6 +39,9 @@ namespace ascension {
 
 		/**
 		 * A @c Bookmarker manages bookmarks of the document.
+		 *
+		 * A bookmark is held as an empty marker at the beginning of the line in a @c MarkerTree, so the bookmarks
+		 * follow the change of the document without rewriting all of them.
 		 * @note This class is not intended to be subclassed.
 		 * @see Document#bookmarker, locations#nextBookmark
 		 */
@@ -48,15 +51,14 @@ namespace ascension {
 			class Iterator : public boost::iterators::iterator_facade<
 				Iterator, Index, boost::bidirectional_traversal_tag, Index, std::ptrdiff_t> {
 			private:
-				Iterator(ascension::detail::GapVector<Index>::const_iterator impl) : impl_(impl) {}
-				ascension::detail::GapVector<Index>::const_iterator impl_;
+				Iterator(MarkerTree::Iterator impl) : impl_(impl) {}
+				MarkerTree::Iterator impl_;
 				// boost.iterators.iterator_facade requirements
 				friend class boost::iterators::iterator_core_access;
 				void decrement() {--impl_;}
-				value_type dereference() const {return *impl_;}
+				value_type dereference() const {return line(*boost::const_begin(impl_->region()));}
 				bool equal(const Iterator& other) const {return impl_ == other.impl_;}
 				void increment() {++impl_;}
-//				bool less(const Iterator& other) const {return impl_ < other.impl_;}
 				friend class Bookmarker;
 			};
 
@@ -86,14 +88,15 @@ namespace ascension {
 			/// @}
 
 		private:
-			ascension::detail::GapVector<Index>::iterator find(Index line) const BOOST_NOEXCEPT;
+			void bringBackToLineStart(const Position& position);
+			std::size_t find(Index line) const BOOST_NOEXCEPT;
 			// DocumentListener
 			void documentAboutToBeChanged(const Document& document, const DocumentChange& change) override;
 			void documentChanged(const Document& document, const DocumentChange& change) override;
 		private:
-			explicit Bookmarker(Document& document) BOOST_NOEXCEPT;
+			explicit Bookmarker(Document& document);
 			Document& document_;
-			ascension::detail::GapVector<Index> markedLines_;
+			MarkerTree markers_;	// has only the empty markers at the beginnings of the marked lines
 			ascension::detail::Listeners<BookmarkListener> listeners_;
 			friend class Document;
 		};
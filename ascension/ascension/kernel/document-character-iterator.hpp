@@ -41,10 +41,17 @@ namespace ascension {
 			const Position& tell() const BOOST_NOEXCEPT;
 			/// @}
 
+			/// @name Chunked Access
+			/// @{
+			DocumentCharacterIterator& advanceInChunk(Index length);
+			StringPiece chunk(String& buffer) const;
+			DocumentCharacterIterator& seekInChunks(Index offset);
+			/// @}
+
 			/// @name Other Document-Related Attributes
 			/// @{
 			const Document& document() const BOOST_NOEXCEPT;
-			const String& lineString() const BOOST_NOEXCEPT;
+			String lineString() const;
 			const Region& region() const BOOST_NOEXCEPT;
 			void setRegion(const Region& newRegion);
 			/// @}
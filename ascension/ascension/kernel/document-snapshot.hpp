@@ -0,0 +1,61 @@
+/**
+ * @file document-snapshot.hpp
+ * Defines @c DocumentSnapshot class.
+ * @author agent
+ * @date 2026-10-16 Created.
+ */
+
+#ifndef ASCENSION_DOCUMENT_SNAPSHOT_HPP
+#define ASCENSION_DOCUMENT_SNAPSHOT_HPP
+#include <ascension/kernel/document.hpp>
+#include <boost/core/noncopyable.hpp>
+#include <memory>
+#include <vector>
+
+namespace ascension {
+	namespace kernel {
+		/**
+		 * An immutable copy of the content of a @c Document at a revision.
+		 *
+		 * A snapshot is made by the thread which owns the document, and then can be read by any thread while the
+		 * document is changed. The lines which have not been changed since @c Document#loadContent share the loaded
+		 * text with the document, and only the texts of the changed lines are copied. So making a snapshot costs
+		 * proportional to the number of the lines, not to the length of the document. The constructor reads the lines
+		 * without changing them (see @c Document#Line#text), and the snapshot does not refer to the lines of the
+		 * document after that.
+		 *
+		 * If the document is lazy (see @c Document#isLazy), the snapshot shares the @c DocumentLineSource with the
+		 * document. In this case, @c DocumentLineSource#readLine should be safe to call from the other threads.
+		 *
+		 * Because this class implements @c DocumentLineSource, a snapshot can also be loaded into the other
+		 * document.
+		 * @note This class is not intended to be subclassed.
+		 */
+		class DocumentSnapshot : public DocumentLineSource, private boost::noncopyable {
+		public:
+			explicit DocumentSnapshot(const Document& document);
+			std::size_t revisionNumber() const BOOST_NOEXCEPT;
+			// DocumentLineSource
+			Index numberOfLines() const BOOST_NOEXCEPT override;
+			void readLine(Index line, String& text, text::Newline& newline) const override;
+
+		private:
+			struct Line {
+				StringPiece text;	// refers to originalContents_ or copiedText_
+				text::Newline newline;
+			};
+			std::vector<Line> lines_;	// empty if lazySource_ is not null
+			String copiedText_;	// the texts of the lines changed after loaded
+			std::vector<std::shared_ptr<const String>> originalContents_;
+			std::shared_ptr<const DocumentLineSource> lazySource_;
+			const std::size_t revisionNumber_;
+		};
+
+		/// Returns the revision number of the document when the snapshot was made.
+		inline std::size_t DocumentSnapshot::revisionNumber() const BOOST_NOEXCEPT {
+			return revisionNumber_;
+		}
+	}
+}
+
+#endif // !ASCENSION_DOCUMENT_SNAPSHOT_HPP
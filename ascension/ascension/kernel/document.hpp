@@ -10,6 +10,7 @@
 #include <ascension/config.hpp>				// ASCENSION_DEFAULT_NEWLINE
 #include <ascension/direction.hpp>
 #include <ascension/corelib/basic-exceptions.hpp>
+#include <ascension/corelib/detail/fenwick-tree.hpp>
 #include <ascension/corelib/detail/gap-vector.hpp>
 #include <ascension/corelib/detail/listeners.hpp>
 #include <ascension/corelib/detail/scope-guard.hpp>
@@ -24,14 +25,20 @@
 #	include <sys/stat.h>	// for POSIX environment
 #endif
 #include <boost/core/noncopyable.hpp>
+#include <boost/operators.hpp>
+#include <boost/optional.hpp>
 #include <boost/range/begin.hpp>
 #include <boost/range/end.hpp>
+#include <boost/variant.hpp>
 #include <iosfwd>
 #include <list>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace ascension {
 	namespace text {
@@ -45,6 +52,8 @@ namespace ascension {
 			public:
 				/// Adds the newly created point.
 				virtual void addNewPoint(PointType& point) = 0;
+				/// Moves the point in the index to @a line, before @a point records the new line. May throw @c std#bad_alloc.
+				virtual void movePoint(PointType& point, Index line) = 0;
 				/// Deletes the point about to be destroyed (@a point is in its destructor call).
 				virtual void removePoint(PointType& point) = 0;
 			};
@@ -72,9 +81,12 @@ namespace ascension {
 			 * @return The normalized inserted region in the change, or empty if no string was inserted
 			 */
 			const Region& insertedRegion() const BOOST_NOEXCEPT {return insertedRegion_;}
+			const std::vector<std::pair<Region, Region>>& replacements() const BOOST_NOEXCEPT;
 		private:
-			explicit DocumentChange(const Region& erasedRegion, const Region& insertedRegion) BOOST_NOEXCEPT;
+			explicit DocumentChange(const Region& erasedRegion, const Region& insertedRegion,
+				const std::vector<std::pair<Region, Region>>* replacements = nullptr) BOOST_NOEXCEPT;
 			const Region erasedRegion_, insertedRegion_;
+			const std::vector<std::pair<Region, Region>>* const replacements_;
 			friend class Document;
 		};
 
@@ -84,6 +96,52 @@ namespace ascension {
 		 */
 		class DocumentPropertyKey : private boost::noncopyable {};
 
+		/**
+		 * Interface for objects which supply the lines of a read-only document on demand.
+		 * @see Document#loadContent(std::shared_ptr<const DocumentLineSource>, std::size_t)
+		 */
+		class DocumentLineSource {
+		public:
+			/// Destructor.
+			virtual ~DocumentLineSource() BOOST_NOEXCEPT {}
+			/// Returns the number of the lines. This must be one or more, and must not change.
+			virtual Index numberOfLines() const BOOST_NOEXCEPT = 0;
+			/**
+			 * Reads the specified line.
+			 * @param line The line number
+			 * @param[out] text The text of the line, without the line break
+			 * @param[out] newline The newline terminates the line. This must be a literal value
+			 * @throw std#bad_alloc The internal memory allocation failed. Implementation should not throw the
+			 *                      other exceptions because @c Document calls this from @c BOOST_NOEXCEPT methods
+			 *                      such as @c Document#region
+			 */
+			virtual void readLine(Index line, String& text, text::Newline& newline) const = 0;
+			/**
+			 * Returns the length of the specified line. @c Document calls this to index the lines. The default
+			 * implementation calls @c #readLine. Implementation can override this to measure the line without
+			 * building the text.
+			 * @param line The line number
+			 * @param[out] newline The newline terminates the line. This must be a literal value
+			 * @return The number of the UTF-16 code units of the text, without the line break
+			 * @throw std#bad_alloc The internal memory allocation failed
+			 */
+			virtual Index lineLength(Index line, text::Newline& newline) const {
+				String text;
+				readLine(line, text, newline);
+				return text.length();
+			}
+		};
+
+		/**
+		 * A line of the text given to @c Document#loadContent, which the caller has already split at the newlines.
+		 * @see Document#loadContent(const std::vector<std::shared_ptr<const String>>&,
+		 *      const std::vector<DocumentContentLine>&)
+		 */
+		struct DocumentContentLine {
+			StringPiece text;		///< The text of the line without the line break.
+			text::Newline newline;	///< The newline terminates the line. Not used for the last line.
+		};
+
 		// the documentation is at document.cpp
 		class Document : public detail::PointCollection<AbstractPoint>,
 			public texteditor::detail::SessionElement, private boost::noncopyable {
@@ -97,20 +155,51 @@ namespace ascension {
 			 */
 			class Line : public FastArenaObject<Line> {
 			public:
+				/**
+				 * Returns @c true if the text of the line is stored in one byte per character. See
+				 * @c #latin1Text.
+				 */
+				bool isLatin1() const BOOST_NOEXCEPT {return boost::get<std::string>(&text_) != nullptr;}
+				/**
+				 * Returns the text of the line stored in one byte per character, or an empty string if
+				 * @c #isLatin1 returns @c false. Each byte is the value of the UTF-16 code unit.
+				 * @see #textPiece
+				 */
+				boost::string_ref latin1Text() const BOOST_NOEXCEPT {
+					const std::string* const latin1 = boost::get<std::string>(&text_);
+					return (latin1 != nullptr) ? boost::string_ref(*latin1) : boost::string_ref();
+				}
+				/// Returns the length of the line. The line break is not included.
+				Index length() const BOOST_NOEXCEPT {
+					if(original_.cbegin() != nullptr)
+						return original_.length();
+					const std::string* const latin1 = boost::get<std::string>(&text_);
+					return (latin1 != nullptr) ? latin1->length() : boost::get<String>(text_).length();
+				}
 				/// Returns the newline of the line.
 				text::Newline newline() const BOOST_NOEXCEPT {return newline_;}
 				/// Returns the revision number when this last was changed previously.
 				std::size_t revisionNumber() const BOOST_NOEXCEPT {return revisionNumber_;}
-				/// Returns the text of the line.
-				const String& text() const BOOST_NOEXCEPT {return text_;}
+				String text() const;
+				StringPiece textPiece() const BOOST_NOEXCEPT;
+				StringPiece textPiece(String& buffer) const;
 			private:
 				explicit Line(std::size_t revisionNumber) BOOST_NOEXCEPT;
 				Line(std::size_t revisionNumber, const String& text,
 					const text::Newline& newline = ASCENSION_DEFAULT_NEWLINE);
-				String text_;
+				Line(std::size_t revisionNumber, const StringPiece& original, const text::Newline& newline) BOOST_NOEXCEPT;
+				void appendText(String& out, Index first, Index last) const;
+				void assign(String& text) BOOST_NOEXCEPT;
+				void compact() BOOST_NOEXCEPT;
+				String& mutableText();
+				void replace(Index first, Index last, const StringPiece& text);
+				// std.string if all the code units are less than U+0100 (see isLatin1), otherwise UTF-16
+				boost::variant<String, std::string> text_;
+				StringPiece original_;	// refers to Document.originalContents_ until the line is materialized
 				text::Newline newline_;
 				std::size_t revisionNumber_;
 				friend class Document;
+				friend class DocumentSnapshot;
 			};
 			typedef ascension::detail::GapVector<Line*> LineList;	///< List of lines.
 
@@ -154,12 +243,19 @@ namespace ascension {
 			/// @name Contents
 			/// @{
 			Region accessibleRegion() const BOOST_NOEXCEPT;
-			Index length(const text::Newline& newline = text::Newline::USE_INTRINSIC_VALUE) const BOOST_NOEXCEPT;
+			Index length(const text::Newline& newline = text::Newline::USE_INTRINSIC_VALUE) const;
+			bool isLazy() const BOOST_NOEXCEPT;
+			Index lineAt(Index offset, const text::Newline& newline = text::Newline::USE_INTRINSIC_VALUE) const;
 			const Line& lineContent(Index line) const;
 			Index lineLength(Index line) const;
 			Index lineOffset(Index line, const text::Newline& newline = text::Newline::USE_INTRINSIC_VALUE) const;
-			const String& lineString(Index line) const;
+			String lineString(Index line) const;
+			void loadContent(std::shared_ptr<const String> content);
+			void loadContent(const std::vector<std::shared_ptr<const String>>& batches);
+			void loadContent(const std::vector<std::shared_ptr<const String>>& batches, const std::vector<DocumentContentLine>& lines);
+			void loadContent(std::shared_ptr<const DocumentLineSource> source, std::size_t numberOfCachedLines);
 			Index numberOfLines() const BOOST_NOEXCEPT;
+			std::shared_ptr<const Line> pinLine(Index line) const;
 			Region region() const BOOST_NOEXCEPT;
 			std::size_t revisionNumber() const BOOST_NOEXCEPT;
 			/// @}
@@ -174,6 +270,7 @@ namespace ascension {
 			/// @{
 			bool isChanging() const BOOST_NOEXCEPT;
 			Position replace(const Region& region, const StringPiece& text);
+			void replace(const std::vector<std::pair<Region, StringPiece>>& replacements);
 			template<typename InputIterator>
 			Position replace(const Region& region, InputIterator first, InputIterator last);
 			template<typename SinglePassReadableRange>
@@ -203,7 +300,10 @@ namespace ascension {
 			std::size_t numberOfRedoableChanges() const BOOST_NOEXCEPT;
 			void recordChanges(bool record) BOOST_NOEXCEPT;
 			bool redo(std::size_t n = 1);
+			void setUndoBufferLimit(const boost::optional<std::size_t>& limit) BOOST_NOEXCEPT;
 			bool undo(std::size_t n = 1);
+			boost::optional<std::size_t> undoBufferLimit() const BOOST_NOEXCEPT;
+			std::size_t undoBufferSize() const BOOST_NOEXCEPT;
 			/// @}
 
 			/// @name Narrowing
@@ -230,16 +330,19 @@ namespace ascension {
 			virtual void doResetContent();
 
 		private:
+			void collectPointsToUpdate(Index firstLine) BOOST_NOEXCEPT;
 //			void doSetModified(bool modified) BOOST_NOEXCEPT;
 			void fireDocumentAboutToBeChanged(const DocumentChange& c, bool updateAllPoints = true) BOOST_NOEXCEPT;
 			void fireDocumentChanged(const DocumentChange& c, bool updateAllPoints = true) BOOST_NOEXCEPT;
 			void initialize();
+			const std::shared_ptr<Line>& lazyLine(Index line) const;
 			void partitioningChanged(const Region& changedRegion) BOOST_NOEXCEPT;
 			// detail.SessionElement
 			void setSession(texteditor::Session& session) BOOST_NOEXCEPT override {session_ = &session;}
 			// detail.PointCollection<AbstractPoint>
-			void addNewPoint(AbstractPoint& point) override {points_.insert(&point);}
-			void removePoint(AbstractPoint& point) override {points_.erase(&point);}
+			void addNewPoint(AbstractPoint& point) override;
+			void movePoint(AbstractPoint& point, Index line) override;
+			void removePoint(AbstractPoint& point) override;
 
 		private:
 			class UndoManager;
@@ -251,6 +354,35 @@ namespace ascension {
 			private:
 				text::IdentifierSyntax* syntax_;	// use a pointer to brake dependency
 			};
+			/// Lengths of a line, summed up by @c #lineIndex_.
+			struct LineLength : private boost::additive<LineLength> {
+				Index text;		///< The length of the text, same as @c Line#length().
+				Index newline;	///< The length of the newline.
+				LineLength() BOOST_NOEXCEPT : text(0), newline(0) {}
+				explicit LineLength(const Line& line) BOOST_NOEXCEPT;
+				LineLength& operator+=(const LineLength& other) BOOST_NOEXCEPT {
+					text += other.text;
+					newline += other.newline;
+					return *this;
+				}
+				LineLength& operator-=(const LineLength& other) BOOST_NOEXCEPT {
+					text -= other.text;
+					newline -= other.newline;
+					return *this;
+				}
+			};
+			/// The lines of the document in lazy mode. See @c #loadContent.
+			struct LazyLines {
+				typedef std::list<std::pair<Index, std::shared_ptr<Line>>> Cache;	// shared with pinLine
+				std::shared_ptr<const DocumentLineSource> source;
+				std::size_t capacity;
+				Index lastLineLength;	// for region(), which can't read the line
+				Cache cache;	// the most recently used first
+				std::unordered_map<Index, Cache::iterator> cachedLines;
+				ascension::detail::FenwickTree<LineLength> index;	// built by the first query needs it
+			};
+			const ascension::detail::FenwickTree<LineLength>& lineIndex() const;
+			void updateLineIndex(Index firstLine, Index numberOfErasedLines, Index numberOfInsertedLines);
 
 			texteditor::Session* session_;
 			std::weak_ptr<DocumentInput> input_;
@@ -259,9 +391,13 @@ namespace ascension {
 			std::unique_ptr<ContentTypeInformationProvider> contentTypeInformationProvider_;
 			bool readOnly_;
 			LineList lines_;
-			Index length_;
+			ascension::detail::FenwickTree<LineLength> lineIndex_;	// parallel to lines_
+			std::unique_ptr<LazyLines> lazyLines_;	// not null in lazy mode, where lines_ is empty
+			std::vector<std::shared_ptr<const String>> originalContents_;
 			std::size_t revisionNumber_, lastUnmodifiedRevisionNumber_;
-			std::set<AbstractPoint*> points_;
+			std::map<Index, std::vector<AbstractPoint*>> points_;	// bucketed by AbstractPoint#indexedLine
+			std::size_t numberOfPoints_;
+			std::vector<AbstractPoint*> pointsToUpdate_;	// see collectPointsToUpdate
 			std::unique_ptr<UndoManager> undoManager_;
 			std::map<const DocumentPropertyKey*, std::unique_ptr<String>> properties_;
 			bool onceUndoBufferCleared_, recordingChanges_, changing_, rollbacking_;
@@ -278,6 +414,7 @@ namespace ascension {
 			ReadOnlySignChangedSignal readOnlySignChangedSignal_;
 
 			friend class DocumentPartitioner;
+			friend class DocumentSnapshot;
 		};
 
 		// the documentation is document.cpp
@@ -420,6 +557,13 @@ namespace ascension {
 			return revisionNumber() != lastUnmodifiedRevisionNumber_;
 		}
 		
+		/**
+		 * Returns @c true if the document is in lazy mode, where the lines are supplied by a
+		 * @c DocumentLineSource on demand.
+		 * @see #loadContent
+		 */
+		inline bool Document::isLazy() const BOOST_NOEXCEPT {return lazyLines_.get() != nullptr;}
+
 		/**
 		 * Returns @c true if the document is narrowed.
 		 * @see #narrowToRegion, #widen
@@ -443,13 +587,15 @@ namespace ascension {
 		/**
 		 * Returns the @c Document#Line value of the specified line.
 		 * @param line The line
-		 * @return The content of @a line
+		 * @return The content of @a line. In lazy mode, this is invalidated when the line is evicted from the
+		 *         cache of the decoded lines. Use @c #pinLine to keep the line
 		 * @throw BadPostionException @a line is outside of the document
+		 * @throw ... Any exceptions @c DocumentLineSource#readLine throws in lazy mode
 		 */
 		inline const Document::Line& Document::lineContent(Index line) const {
-			if(line >= lines_.size())
+			if(line >= numberOfLines())
 				throw BadPositionException(Position::bol(line));
-			return *lines_[line];
+			return !isLazy() ? *lines_[line] : *lazyLine(line);
 		}
 
 		/**
@@ -458,21 +604,86 @@ namespace ascension {
 		 * @return the length of @a line
 		 * @throw BadLocationException @a line is outside of the document
 		 */
-		inline Index Document::lineLength(Index line) const {return lineString(line).length();}
+		inline Index Document::lineLength(Index line) const {return lineContent(line).length();}
 		
 		/**
-		 * Returns the text string of the specified line.
+		 * Returns a copy of the text string of the specified line.
 		 * @param line the line
 		 * @return the text
 		 * @throw BadPostionException @a line is outside of the document
+		 * @throw std#bad_alloc The copy failed
+		 * @see Line#text, Line#textPiece
 		 */
-		inline const String& Document::lineString(Index line) const {return lineContent(line).text_;}
+		inline String Document::lineString(Index line) const {return lineContent(line).text();}
 #if 0
 		/// Returns the object locks the document or @c null if the document is not locked.
 		inline const void* Document::locker() const BOOST_NOEXCEPT {return locker_;}
 #endif
+		/**
+		 * Returns a copy of the text of the line in UTF-16. This method does not change the line, even if the line
+		 * refers to the original content given by @c Document#loadContent or is stored in one byte per character.
+		 * @return The text of the line
+		 * @throw std#bad_alloc The copy failed
+		 * @see #textPiece
+		 */
+		inline String Document::Line::text() const {
+			String buffer;
+			const StringPiece piece(textPiece(buffer));
+			if(piece.cbegin() != buffer.data())	// not widened into the buffer
+				buffer.assign(piece.cbegin(), piece.length());
+			return buffer;
+		}
+
+		/**
+		 * Returns the UTF-16 text of the line without copying.
+		 * @return The text of the line, or a null string if the line is stored in one byte per character (see
+		 *         @c #isLatin1 and @c #latin1Text). This is invalidated by any change of the document
+		 * @see #text, #textPiece(String&)
+		 */
+		inline StringPiece Document::Line::textPiece() const BOOST_NOEXCEPT {
+			if(original_.cbegin() != nullptr)
+				return original_;
+			const String* const wide = boost::get<String>(&text_);
+			return (wide != nullptr) ? StringPiece(*wide) : StringPiece();
+		}
+
+		/**
+		 * Returns the text of the line without copying the original content and without widening the line.
+		 * @param buffer The buffer used to widen the text if the line is stored in one byte per character
+		 * @return The text of the line. This is invalidated by any change of the document or @a buffer
+		 * @throw std#bad_alloc Widening the text failed
+		 * @see #latin1Text, #text
+		 */
+		inline StringPiece Document::Line::textPiece(String& buffer) const {
+			if(original_.cbegin() != nullptr)
+				return original_;
+			const std::string* const latin1 = boost::get<std::string>(&text_);
+			if(latin1 == nullptr)
+				return boost::get<String>(text_);
+			buffer.resize(latin1->length());
+			for(std::size_t i = 0, n = latin1->length(); i < n; ++i)
+				buffer[i] = static_cast<Byte>((*latin1)[i]);
+			return buffer;
+		}
+
+		/**
+		 * Returns the text of the line for modification. The line will not refer to the original content and will
+		 * not be stored in one byte per character anymore.
+		 * @throw std#bad_alloc
+		 */
+		inline String& Document::Line::mutableText() {
+			if(original_.cbegin() != nullptr || isLatin1()) {
+				String wide(text());
+				text_ = std::move(wide);	// releases the narrow text
+				original_ = StringPiece();
+			}
+			return boost::get<String>(text_);
+		}
+
 		/// Returns the number of lines in the document.
-		inline Index Document::numberOfLines() const BOOST_NOEXCEPT {return lines_.size();}
+		inline Index Document::numberOfLines() const BOOST_NOEXCEPT {
+			return !isLazy() ? lines_.size() : lazyLines_->source->numberOfLines();
+		}
 		
 		/// Returns the document partitioner of the document.
 		inline const DocumentPartitioner& Document::partitioner() const BOOST_NOEXCEPT {
@@ -506,7 +717,8 @@ namespace ascension {
 		/// Returns the entire region of the document. The returned region is normalized.
 		/// @see #accessibleRegion
 		inline Region Document::region() const BOOST_NOEXCEPT {
-			return Region(Position::zero(), Position(numberOfLines() - 1, lineLength(numberOfLines() - 1)));
+			const Index lastLine = numberOfLines() - 1;
+			return Region(Position::zero(), Position(lastLine, !isLazy() ? lines_[lastLine]->length() : lazyLines_->lastLineLength));
 		}
 		
 		/// Returns the revision number.
@@ -12,7 +12,10 @@
 #include <ascension/kernel/document.hpp>
 #include <ascension/kernel/document-input.hpp>
 #include <ascension/corelib/encoding/encoder.hpp>
+#include <ascension/kernel/fileio/text-file-stream-buffer.hpp>	// fileio.SyncPolicy
 #include <boost/filesystem/path.hpp>
+#include <atomic>
+#include <cstdint>	// std.uintmax_t
 
 namespace ascension {
 	namespace kernel {
@@ -29,6 +32,11 @@ namespace ascension {
 				/// Set @c true to write a UTF byte order signature. This member is ignored if the encoding was not
 				/// Unicode.
 				bool unicodeByteOrderMark;
+				/// How the written file is flushed to the storage device.
+				SyncPolicy syncPolicy;
+				/// Default constructor does not substitute, does not write a byte order mark and does not sync.
+				WritingFormat() : encodingSubstitutionPolicy(encoding::Encoder::DONT_SUBSTITUTE),
+					unicodeByteOrderMark(false), syncPolicy(DONT_SYNC) {}
 			};
 
 			class TextFileDocumentInput;
@@ -67,26 +75,29 @@ namespace ascension {
 				virtual bool queryAboutUnexpectedDocumentFileTimeStamp(Document& document, Context context) BOOST_NOEXCEPT = 0;
 				friend class TextFileDocumentInput;
 			};
-#if 0
 			/// Interface for objects which are interested in getting informed about progression of file IO.
 			class FileIOProgressMonitor {
 			public:
-				enum ProcessType {};
+				/// Types of the process.
+				enum ProcessType {
+					WRITING	///< Writing the document into the file. The amounts are in lines.
+				};
 			private:
 				/**
-				 * This method will be called when 
+				 * This method will be called when the process made progress. This is called by the thread which
+				 * performs the process.
 				 * @param type the type of the precess
 				 * @param processedAmount the amount of the data had processed
 				 * @param totalAmount the total amount of the data to process
 				 */
-				virtual void onProgress(ProcessType type, ULONGLONG processedAmount, ULONGLONG totalAmount) = 0;
-				/// Returns the internal number of lines.
+				virtual void onProgress(ProcessType type, std::uintmax_t processedAmount, std::uintmax_t totalAmount) = 0;
+				/// Returns the interval number of lines.
 				virtual Index queryIntervalLineCount() const = 0;
-				/// Releases the object.
+				/// Releases the object. This is called when the process finished, regardless of the result.
 				virtual void release() = 0;
-				friend class Document;
+				friend class TextFileDocumentInput;
 			};
-#endif
+
 			class TextFileDocumentInput : public DocumentInput, private boost::noncopyable {
 			public:
 				/// Lock types for opened file.
@@ -116,16 +127,40 @@ namespace ascension {
 				void removeListener(FilePropertyListener& listener);
 				/// @}
 
+				/// @name Signals
+				/// @{
+				/**
+				 * The signal invoked when the bound file may have been changed by the other process. This is invoked
+				 * by the thread monitors the files, not by the thread owns the document. See the documentation of
+				 * @c TextFileDocumentInput.
+				 * @param textFile The input
+				 */
+				typedef boost::signals2::signal<void(const TextFileDocumentInput& textFile)> FileChangedSignal;
+				SignalConnector<FileChangedSignal> fileChangedSignal() BOOST_NOEXCEPT;
+				/// @}
+
 				/// @name Bound File
 				/// @{
+				bool beginWrite(const WritingFormat& format, FileIOProgressMonitor* monitor = nullptr);
 				void bind(const boost::filesystem::path& fileName);
+				bool endWrite(bool wait = true);
 				boost::filesystem::path fileName() const BOOST_NOEXCEPT;
+				bool follow(const std::string& encoding,
+					encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy,
+					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector = nullptr);
 				bool isBoundToFile() const BOOST_NOEXCEPT;
+				bool isFollowing() const BOOST_NOEXCEPT;
+				bool isWriting() const BOOST_NOEXCEPT;
 				void lockFile(const LockMode& mode);
 				LockType lockType() const BOOST_NOEXCEPT;
+				void reload(const std::string& encoding,
+					encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy,
+					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector = nullptr);
 				void revert(const std::string& encoding,
 					encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy,
 					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector = nullptr);
+				void revertLazily(const std::string& encoding, std::size_t numberOfCachedLines = 4096,
+					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector = nullptr);
 				void unbind() BOOST_NOEXCEPT;
 				void unlockFile();
 				void write(const WritingFormat& format, const WritingOption* options = nullptr);
@@ -138,6 +173,13 @@ namespace ascension {
 				TextFileDocumentInput& setUnicodeByteOrderMark(bool set) BOOST_NOEXCEPT;
 				/// @}
 
+				/// @name Change Journal
+				/// @{
+				void flushJournal();
+				TextFileDocumentInput& writeJournal(bool write = true);
+				bool writesJournal() const BOOST_NOEXCEPT;
+				/// @}
+
 				// DocumentInput
 				std::string encoding() const BOOST_NOEXCEPT override;
 				static_assert(std::is_same<DocumentInput::LocationType, boost::filesystem::path::string_type>::value, "");
@@ -145,8 +187,18 @@ namespace ascension {
 				text::Newline newline() const BOOST_NOEXCEPT override;
 				bool unicodeByteOrderMark() const BOOST_NOEXCEPT override;
 			private:
+				struct BackgroundWriting;
+				void cancelWrite() BOOST_NOEXCEPT;
 				void documentModificationSignChanged(const Document& document);
+				void fileChanged() BOOST_NOEXCEPT;
+				bool prepareWrite(const WritingFormat& format);
+				void replaceContent(const std::vector<DocumentContentLine>& lines, const std::string& encoding,
+					bool unicodeByteOrderMark, UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector);
+				void replaceFile(const boost::filesystem::path& tempFileName);
+				void reverted(UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector);
 				bool verifyTimeStamp(bool internal, std::time_t& newTimeStamp) BOOST_NOEXCEPT;
+				static void writeSnapshot(BackgroundWriting& writing);
+				void written(std::size_t revisionNumber);
 				// DocumentInput
 				bool isChangeable(const Document& document) const BOOST_NOEXCEPT override;
 				void postFirstDocumentChange(const Document& document) BOOST_NOEXCEPT override;
@@ -154,6 +206,18 @@ namespace ascension {
 				std::shared_ptr<TextFileDocumentInput> weakSelf_;	// for Document.setInput call
 				class FileLocker;
 				std::unique_ptr<FileLocker> fileLocker_;
+				class Journal;
+				std::unique_ptr<Journal> journal_;
+				class FileChangeMonitor;
+				std::atomic<bool> watchedByMonitor_;	// true if FileChangeMonitor reports the changes of the file
+				std::atomic<std::size_t> numberOfFileChanges_;	// counted by FileChangeMonitor
+				std::size_t numberOfInternallyVerifiedFileChanges_, numberOfUserVerifiedFileChanges_;
+				FileChangedSignal fileChangedSignal_;
+				bool writesJournal_;
+				bool contentFromFile_;	// true if the content was read from or written into the bound file
+				std::unique_ptr<BackgroundWriting> backgroundWriting_;
+				struct Following;
+				std::unique_ptr<Following> following_;	// null if not following the file
 				Document& document_;
 				boost::signals2::scoped_connection documentModificationSignChangedConnection_;
 				boost::filesystem::path fileName_;
@@ -201,6 +265,12 @@ namespace ascension {
 				return !fileName_.empty();
 			}
 
+			/// Returns @c true if @c #follow is following the bound file. The methods replace the whole content or
+			/// write the file, such as @c #reload and @c #write, stop following.
+			inline bool TextFileDocumentInput::isFollowing() const BOOST_NOEXCEPT {
+				return following_.get() != nullptr;
+			}
+
 			/// @see DocumentInput#newline, #setNewline
 			inline text::Newline TextFileDocumentInput::newline() const BOOST_NOEXCEPT {
 				return newline_;
@@ -215,6 +285,15 @@ namespace ascension {
 			inline bool TextFileDocumentInput::unicodeByteOrderMark() const BOOST_NOEXCEPT {
 				return unicodeByteOrderMark_;
 			}
+
+			/**
+			 * Returns @c true if the changes of the document are recorded in the journal file. The default value is
+			 * @c false.
+			 * @see #writeJournal
+			 */
+			inline bool TextFileDocumentInput::writesJournal() const BOOST_NOEXCEPT {
+				return writesJournal_;
+			}
 		}
 	}
 }	// namespace ascension.kernel.fileio
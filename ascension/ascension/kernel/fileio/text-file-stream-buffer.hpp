@@ -16,6 +16,9 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/range/const_iterator.hpp>
 #include <array>
+#include <future>
+#include <memory>
+#include <vector>
 
 namespace ascension {
 	namespace kernel {
@@ -29,8 +32,25 @@ namespace ascension {
 				UnmappableCharacterException();
 			};
 
+			/**
+			 * Specifies how @c TextFileStreamBuffer#close flushes the written data to the storage device.
+			 * @see TextFileStreamBuffer#setSyncPolicy, WritingFormat#syncPolicy
+			 */
+			enum SyncPolicy {
+				/// Leaves the written data in the cache of the operating system.
+				DONT_SYNC,
+				/// Flushes the data and the metadata needed to read it back, like fdatasync(2).
+				SYNC_DATA,
+				/// Flushes the data and all the metadata, like fsync(2).
+				SYNC_ALL
+			};
+
 			/**
 			 * @c std#basic_streambuf implementation of the text file with encoding conversion.
+			 *
+			 * The output is encoded into the large segments and the segments are written by one writev(2) call at
+			 * once. If @c #setOutputOverlapped was called with @c true, the segments are written by another thread
+			 * while the following output is encoded.
 			 * @note This class is not intended to be subclassed.
 			 */
 			class TextFileStreamBuffer : public std::basic_streambuf<Char>, private boost::noncopyable {
@@ -45,19 +65,40 @@ namespace ascension {
 				std::string encoding() const BOOST_NOEXCEPT;
 				const boost::filesystem::path& fileName() const BOOST_NOEXCEPT;
 				bool isOpen() const BOOST_NOEXCEPT;
+				bool isOutputOverlapped() const BOOST_NOEXCEPT;
+				const boost::iterator_range<const Byte*>& mappedInput() const BOOST_NOEXCEPT;
 				std::ios_base::openmode mode() const BOOST_NOEXCEPT;
+				TextFileStreamBuffer& setOutputOverlapped(bool overlap);
+				TextFileStreamBuffer& setSyncPolicy(SyncPolicy policy);
+				SyncPolicy syncPolicy() const BOOST_NOEXCEPT;
 				bool unicodeByteOrderMark() const BOOST_NOEXCEPT;
 			private:
+				struct OutputSegment {
+					std::unique_ptr<Byte[]> bytes;
+					std::size_t length;
+				};
+				struct OutputBatch {
+					std::vector<OutputSegment> segments;	// allocated lazily and reused
+					std::size_t numberOfSegments;	// the number of the used segments
+					OutputBatch() BOOST_NOEXCEPT : numberOfSegments(0) {}
+				};
 				void buildEncoder(const std::string& encoding, bool detectEncoding);
 				void buildInputMapping();
 				TextFileStreamBuffer* closeFile() BOOST_NOEXCEPT;
+				void encodeOutput(const Char* first, const Char* last);
+				void encodePutArea();
+				void nextOutputSegment();
 				void openForReading(const std::string& encoding);
 				void openForWriting(const std::string& encoding, bool writeUnicodeByteOrderMark);
+				void submitOutput();
+				void waitForOutput();
+				void writeOutputBatch(OutputBatch& batch) const;
 				// std.basic_streambuf
 				int_type overflow(int_type c /* = traits_type::eof() */) override;
 				int_type pbackfail(int_type c /* = traits_type::eof() */) override;
 				int sync();
 				int_type underflow();
+				std::streamsize xsputn(const char_type* s, std::streamsize n) override;
 			private:
 				typedef std::basic_streambuf<Char> Base;
 #if BOOST_OS_WINDOWS
@@ -80,6 +121,10 @@ namespace ascension {
 				std::unique_ptr<encoding::Encoder> encoder_;
 				encoding::Encoder::State encodingState_, decodingState_;
 				std::array<Char, 8192> ucsBuffer_;
+				std::array<OutputBatch, 2> outputBatches_;	// the front is being filled, the back is being written
+				std::future<void> outputWriting_;	// of the back of outputBatches_
+				bool outputOverlapped_;
+				SyncPolicy syncPolicy_;
 			};
 
 			/// Returns the file name.
@@ -87,11 +132,35 @@ namespace ascension {
 				return fileName_;
 			}
 
+			/**
+			 * Returns @c true if the output is written by another thread while the following output is encoded.
+			 * @see #setOutputOverlapped
+			 */
+			inline bool TextFileStreamBuffer::isOutputOverlapped() const BOOST_NOEXCEPT {
+				return outputOverlapped_;
+			}
+
+			/**
+			 * Returns the memory-mapped content of the input file, including the Unicode byte order mark if any.
+			 * This is valid until the file is closed. Empty if the file is open only for writing.
+			 */
+			inline const boost::iterator_range<const Byte*>& TextFileStreamBuffer::mappedInput() const BOOST_NOEXCEPT {
+				return inputMapping_.buffer;
+			}
+
 			/// Returns the open mode.
 			inline std::ios_base::openmode TextFileStreamBuffer::mode() const BOOST_NOEXCEPT {
 				return mode_;
 			}
 
+			/**
+			 * Returns how @c #close flushes the written data to the storage device.
+			 * @see #setSyncPolicy
+			 */
+			inline SyncPolicy TextFileStreamBuffer::syncPolicy() const BOOST_NOEXCEPT {
+				return syncPolicy_;
+			}
+
 			namespace detail {
 				boost::filesystem::filesystem_error makeGenericFileSystemError(
 					const std::string& what, const boost::filesystem::path& path, boost::system::errc::errc_t value);
@@ -0,0 +1,151 @@
+/**
+ * @file marker-tree.hpp
+ * Defines @c MarkerTree class.
+ * @author agent
+ * @date 2026-10-16 Created.
+ */
+
+#ifndef ASCENSION_MARKER_TREE_HPP
+#define ASCENSION_MARKER_TREE_HPP
+#include <ascension/corelib/memory.hpp>	// FastArenaObject
+#include <ascension/kernel/document-observers.hpp>
+#include <ascension/kernel/region.hpp>
+#include <boost/core/noncopyable.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/range/irange.hpp>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace ascension {
+	namespace kernel {
+		class Document;
+
+		/**
+		 * A @c MarkerTree holds the markers on the document. A marker is a region of the document with a kind and a
+		 * payload defined by the client. The markers follow the change of the document like @c Point.
+		 *
+		 * The markers are kept in an interval tree ordered by their beginnings. Updating the markers for a change of
+		 * the document takes O(log n + k) time, where k is the number of the markers which overlap the changed
+		 * lines, and the markers after the changed lines are moved at once. @c #find enumerates the markers
+		 * overlapping the given lines in O(log n + k) time, where k is the number of the found markers.
+		 *
+		 * The text inserted at the beginning or at the end of a marker is not included in the marker. A marker is
+		 * never removed by the change of the document. If all the text of the marker was erased, the marker becomes
+		 * empty at the erased position.
+		 *
+		 * A @c MarkerTree is usually owned by a feature which marks the document. For example, @c Bookmarker uses a
+		 * @c MarkerTree to hold the bookmarks.
+		 * @note This class is not intended to be subclassed.
+		 * @see Bookmarker
+		 */
+		class MarkerTree : private DocumentListener, private boost::noncopyable {
+		public:
+			/// The type of the kind of a marker. The meaning is defined by the client.
+			typedef std::uint32_t Kind;
+			class Iterator;
+
+			/**
+			 * A marker in @c MarkerTree. An object of this class is valid until removed from the tree.
+			 * @note This class is not intended to be subclassed.
+			 */
+			class Marker : public FastArenaObject<Marker>, private boost::noncopyable {
+			public:
+				/// Returns the kind of the marker.
+				Kind kind() const BOOST_NOEXCEPT {return kind_;}
+				/// Returns the payload of the marker.
+				std::uintptr_t payload() const BOOST_NOEXCEPT {return payload_;}
+				Region region() const BOOST_NOEXCEPT;
+			private:
+				Marker(const Region& region, Kind kind, std::uintptr_t payload, std::uint32_t priority) BOOST_NOEXCEPT;
+				Position beginning_, end_, maximumEnd_;	// the lines do not include lineShift_ of the ancestors
+				std::ptrdiff_t lineShift_;	// not applied to this subtree yet
+				std::size_t size_;	// the number of the markers in this subtree
+				const std::uint32_t priority_;
+				Marker* parent_;
+				Marker* left_;
+				Marker* right_;
+				const Kind kind_;
+				const std::uintptr_t payload_;
+				friend class MarkerTree;
+				friend class Iterator;
+			};
+
+			/// A bidirectional iterator enumerates the markers in the order of the beginnings.
+			class Iterator : public boost::iterators::iterator_facade<
+				Iterator, const Marker, boost::iterators::bidirectional_traversal_tag> {
+			public:
+				/// Default constructor makes an invalid iterator object.
+				Iterator() BOOST_NOEXCEPT : tree_(nullptr), current_(nullptr) {}
+			private:
+				Iterator(const MarkerTree& tree, const Marker* current) BOOST_NOEXCEPT : tree_(&tree), current_(current) {}
+				// boost.iterators.iterator_facade requirements
+				friend class boost::iterators::iterator_core_access;
+				void decrement() BOOST_NOEXCEPT;
+				const Marker& dereference() const BOOST_NOEXCEPT {return *current_;}
+				bool equal(const Iterator& other) const BOOST_NOEXCEPT {return tree_ == other.tree_ && current_ == other.current_;}
+				void increment() BOOST_NOEXCEPT;
+				const MarkerTree* tree_;
+				const Marker* current_;	// null at the end
+				friend class MarkerTree;
+			};
+
+		public:
+			explicit MarkerTree(Document& document);
+			~MarkerTree() BOOST_NOEXCEPT;
+			const Document& document() const BOOST_NOEXCEPT;
+
+			/// @name Markers
+			/// @{
+			const Marker& add(const Region& region, Kind kind = 0, std::uintptr_t payload = 0);
+			void clear() BOOST_NOEXCEPT;
+			bool empty() const BOOST_NOEXCEPT;
+			void remove(const Marker& marker) BOOST_NOEXCEPT;
+			std::size_t size() const BOOST_NOEXCEPT;
+			/// @}
+
+			/// @name Queries
+			/// @{
+			const Marker& at(std::size_t index) const;
+			Iterator begin() const BOOST_NOEXCEPT;
+			Iterator end() const BOOST_NOEXCEPT;
+			void find(const boost::integer_range<Index>& lines, std::vector<const Marker*>& markers) const;
+			std::size_t lowerBound(const Position& position) const BOOST_NOEXCEPT;
+			/// @}
+
+		private:
+			static void applyLineShift(Marker& marker) BOOST_NOEXCEPT;
+			static void destroy(Marker* marker) BOOST_NOEXCEPT;
+			static void find(const Marker* marker, std::ptrdiff_t lineShift,
+				const boost::integer_range<Index>& lines, std::vector<const Marker*>& markers);
+			static Marker* merge(Marker* left, Marker* right) BOOST_NOEXCEPT;
+			static void split(Marker* marker, const Position& at, Marker*& left, Marker*& right) BOOST_NOEXCEPT;
+			static void update(Marker& marker) BOOST_NOEXCEPT;
+			void updateMarkers(const Region& erasedRegion, const Region& insertedRegion) BOOST_NOEXCEPT;
+			// DocumentListener
+			void documentAboutToBeChanged(const Document& document, const DocumentChange& change) override;
+			void documentChanged(const Document& document, const DocumentChange& change) override;
+		private:
+			Document& document_;
+			Marker* root_;
+			std::minstd_rand priorityGenerator_;
+		};
+
+		/// Returns the document.
+		inline const Document& MarkerTree::document() const BOOST_NOEXCEPT {
+			return document_;
+		}
+
+		/// Returns @c true if the tree has no marker.
+		inline bool MarkerTree::empty() const BOOST_NOEXCEPT {
+			return root_ == nullptr;
+		}
+
+		/// Returns the number of the markers.
+		inline std::size_t MarkerTree::size() const BOOST_NOEXCEPT {
+			return (root_ != nullptr) ? root_->size_ : 0;
+		}
+	}
+} // namespace ascension.kernel
+
+#endif // !ASCENSION_MARKER_TREE_HPP
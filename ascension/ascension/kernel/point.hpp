@@ -33,7 +33,7 @@ namespace ascension {
 			/// @}
 
 		protected:
-			Point& operator=(const Position& other) BOOST_NOEXCEPT;
+			Point& operator=(const Position& other);
 			virtual void aboutToMove(Position& to);
 			virtual void moved(const Position& from) BOOST_NOEXCEPT;
 		private:
@@ -42,6 +42,7 @@ namespace ascension {
 			void contentReset() override;
 			void documentAboutToBeChanged(const DocumentChange& change) override;
 			void documentChanged(const DocumentChange& change) override;
+			Index indexedLine() const BOOST_NOEXCEPT override;
 		private:
 			Position position_;
 			boost::optional<Position> destination_;
@@ -71,10 +72,12 @@ namespace ascension {
 
 		/**
 		 * Protected assignment operator moves the point to @a other.
+		 * @throw std#bad_alloc The document failed to update the index of the points
 		 * @see #moveTo
 		 */
-		inline Point& Point::operator=(const Position& other) BOOST_NOEXCEPT {
+		inline Point& Point::operator=(const Position& other) {
 			position_ = other;
+			positionChanged();
 			return *this;
 		}
 
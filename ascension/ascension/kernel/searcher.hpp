@@ -384,8 +384,10 @@ namespace ascension {
 				CharacterIterator& matchedFirst, CharacterIterator& matchedLast) const {
 			text::detail::CharacterIterator b, e;
 			const bool found = search(text::detail::CharacterIterator(target), direction, b, e);
-			matchedFirst = boost::type_erasure::any_cast<CharacterIterator>(b);
-			matchedLast = boost::type_erasure::any_cast<CharacterIterator>(e);
+			if(found) {	// b and e are empty otherwise
+				matchedFirst = boost::type_erasure::any_cast<CharacterIterator>(b);
+				matchedLast = boost::type_erasure::any_cast<CharacterIterator>(e);
+			}
 			return found;
 		}
 
@@ -8,11 +8,15 @@
 
 #ifndef ASCENSION_LEXICAL_TOKEN_SCANNER_HPP
 #define ASCENSION_LEXICAL_TOKEN_SCANNER_HPP
+#include <ascension/kernel/document.hpp>
 #include <ascension/kernel/document-character-iterator.hpp>
 #include <ascension/kernel/partition.hpp>
 #include <ascension/rules/token-scanner.hpp>
 #include <boost/core/noncopyable.hpp>
+#include <boost/optional.hpp>
 #include <forward_list>
+#include <memory>
+#include <utility>
 
 namespace ascension {
 	namespace rules {
@@ -40,11 +44,16 @@ namespace ascension {
 			void parse(const kernel::Document& document, const kernel::Region& region) override;
 			kernel::Position position() const override;
 
+		private:
+			StringPiece currentLine();
 		private:
 			kernel::ContentType contentType_;
 			std::forward_list<std::unique_ptr<const TokenRule>> rules_;
 			std::forward_list<std::unique_ptr<const WordTokenRule>> wordRules_;
 			kernel::DocumentCharacterIterator current_;
+			std::shared_ptr<const kernel::Document::Line> lineContent_;	// pinned while scanning the line
+			String lineBuffer_;	// the current line widened if it is stored in one byte per character
+			boost::optional<std::pair<std::size_t, Index>> bufferedLine_;	// the document revision and the line
 		};
 	}
 } // namespace ascension.rules
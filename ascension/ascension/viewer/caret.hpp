@@ -191,6 +191,7 @@ namespace ascension {
 			void updateVisualAttributes();
 			// VisualPoint
 			void aboutToMove(TextHit& to) override;
+			Index indexedLine() const BOOST_NOEXCEPT override;
 			void moved(const TextHit& from) BOOST_NOEXCEPT override;
 #if ASCENSION_SELECTS_WINDOW_SYSTEM(WIN32)
 			LRESULT handleInputEvent(UINT message, WPARAM wp, LPARAM lp, bool& consumed);
@@ -242,6 +243,7 @@ namespace ascension {
 				boost::optional<std::pair<kernel::Position, kernel::Position>> matchBrackets;	// matched brackets' positions. boost.none for none
 				Context() BOOST_NOEXCEPT;
 			} context_;
+			mutable String surroundingText_;	// the line querySurroundingText returned
 		};
 
 		/// @defgroup functions_related_to_selection Free Functions Related-to Selection of @c Caret
@@ -110,6 +110,7 @@ namespace ascension {
 			virtual void contentReset() override;
 			virtual void documentAboutToBeChanged(const kernel::DocumentChange& change) override;
 			virtual void documentChanged(const kernel::DocumentChange& change) override;
+			virtual Index indexedLine() const BOOST_NOEXCEPT override;
 		private:
 			void buildVisualLineCaches();
 			void rememberPositionInVisualLine();
@@ -100,24 +100,24 @@ namespace ascension {
 					kernel::line(caret) - MAXIMUM_BACKTRACKING_LINES : 0, 0), *boost::const_begin(replacementRegion)));
 			kernel::DocumentPartition currentPartition;
 			std::set<String> identifiers;
+			String buffer;
 			bool followingNIDs = false;
 			document.partitioner().partition(i.tell(), currentPartition);
 			while(i.hasNext()) {
 				if(currentPartition.contentType != contentType_)
 					i.seek(*boost::const_end(currentPartition.region));
 				if(i.tell() >= *boost::const_end(currentPartition.region)) {
-					if(kernel::offsetInLine(i.tell()) == i.lineString().length())
+					if(kernel::offsetInLine(i.tell()) == document.lineLength(kernel::line(i.tell())))
 						++i;
 					document.partitioner().partition(i.tell(), currentPartition);
 					continue;
 				}
 				if(!followingNIDs) {
-					const Char* const bol = i.lineString().data();
-					const Char* const s = bol + kernel::offsetInLine(i.tell());
-					const Char* e = syntax_.eatIdentifier(s, bol + i.lineString().length());
-					if(e > s) {
-						identifiers.insert(String(s, e));	// automatically merged
-						i.seek(kernel::Position(kernel::line(i.tell()), e - bol));
+					const StringPiece chunk(i.chunk(buffer));	// does not widen a Latin-1 line
+					const StringPiece::const_iterator e(syntax_.eatIdentifier(chunk.cbegin(), chunk.cend()));
+					if(e > chunk.cbegin()) {
+						identifiers.insert(String(chunk.cbegin(), e));	// automatically merged
+						i.advanceInChunk(e - chunk.cbegin());
 					} else {
 						if(syntax_.isIdentifierContinueCharacter(*i))
 							followingNIDs = true;
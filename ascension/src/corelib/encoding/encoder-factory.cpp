@@ -142,6 +142,7 @@ namespace ascension {
 				BasicLatinEncoderFactory(const std::string& name, MIBenum mib, const std::string& displayName,
 					const std::string& aliases, std::uint32_t mask) : implementation::EncoderFactoryImpl(name, mib, displayName, 1, 1, aliases), mask_(mask) {}
 				virtual ~BasicLatinEncoderFactory() BOOST_NOEXCEPT {}
+				bool isResynchronizable() const BOOST_NOEXCEPT override {return true;}
 				std::unique_ptr<Encoder> create() const BOOST_NOEXCEPT override {
 					return std::unique_ptr<Encoder>(new InternalEncoder(mask_, *this));
 				}
@@ -6,9 +6,11 @@
  * @date 2016-09-24 Separated from encoder.cpp.
  */
 
+#include <ascension/corelib/detail/ascii-run.hpp>
 #include <ascension/corelib/encoding/encoder.hpp>
 #include <ascension/corelib/encoding/encoder-implementation.hpp>
-#include <algorithm>	// std.fill_n
+#include <algorithm>	// std.min
+#include <iterator>		// std.advance
 
 
 namespace ascension {
@@ -73,52 +75,44 @@ namespace ascension {
 			}
 
 			namespace sbcs {
-				const std::array<const Byte, 0x100> BidirectionalMap::UNMAPPABLE_16x16_UNICODE_TABLE = {{
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-					0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-				}};
-
 				/**
-				 * Constructor.
-				 * @param byteToCharacterWire The table defines byte-to-character mapping consists of 16~16-characters
+				 * Constructor builds the character-to-byte table.
+				 * @param byteToCharacterTable The table defines byte-to-character mapping consists of 256 characters.
+				 *                             This object does not copy the table
 				 */
-				BidirectionalMap::BidirectionalMap(const Char** byteToCharacterWire) BOOST_NOEXCEPT : byteToUnicode_(byteToCharacterWire) {
-					unicodeToByte_.fill(nullptr);
-					buildUnicodeToByteTable();	// eager?
-				}
+				BidirectionalMap::BidirectionalMap(const Char* byteToCharacterTable) : byteToUnicode_(byteToCharacterTable) {
+					// assign the blocks to the used high bytes. the first block is the all-unmappable one
+					std::array<std::size_t, 0x100> blockIndices;
+					blockIndices.fill(0);
+					std::size_t numberOfBlocks = 1;
+					for(std::size_t i = 0x00; i <= 0xff; ++i) {
+						std::size_t& block = blockIndices[byteToUnicode_[i] >> 8];
+						if(block == 0 && byteToUnicode_[i] != text::REPLACEMENT_CHARACTER)
+							block = numberOfBlocks++;
+					}
 
-				/// Destructor.
-				BidirectionalMap::~BidirectionalMap() BOOST_NOEXCEPT {
-					for(std::size_t i = 0; i < std::tuple_size<decltype(unicodeToByte_)>::value; ++i) {
-						if(unicodeToByte_[i] != UNMAPPABLE_16x16_UNICODE_TABLE.data())
-							delete[] unicodeToByte_[i];
+					unicodeToByteBlocks_.resize(numberOfBlocks * 0x100, UNMAPPABLE_BYTE);
+					for(std::size_t i = 0x00; i <= 0xff; ++i)
+						unicodeToByte_[i] = unicodeToByteBlocks_.data() + blockIndices[i] * 0x100;
+					for(std::size_t i = 0x00; i <= 0xff; ++i) {
+						const Char ucs = byteToUnicode_[i];
+						if(ucs != text::REPLACEMENT_CHARACTER)	// the unmapped bytes
+							unicodeToByteBlocks_[blockIndices[ucs >> 8] * 0x100 + mask8Bit(ucs)] = static_cast<Byte>(i);
 					}
-				}
 
-				void sbcs::BidirectionalMap::buildUnicodeToByteTable() {
-					assert(unicodeToByte_[0] == 0);
-					unicodeToByte_.fill(const_cast<Byte*>(UNMAPPABLE_16x16_UNICODE_TABLE.data()));
-					for(int i = 0x00; i < 0xff; ++i) {
-						const Char ucs = wireAt(byteToUnicode_, static_cast<Byte>(i));
-						Byte*& p = unicodeToByte_[ucs >> 8];
-						if(p == UNMAPPABLE_16x16_UNICODE_TABLE.data()) {
-							p = new Byte[0x100];
-							std::fill_n(p, 0x100, UNMAPPABLE_BYTE);
+					asciiCompatible_ = true;
+					for(std::size_t i = 0x00; i < 0x80; ++i) {
+						if(byteToUnicode_[i] != i) {
+							asciiCompatible_ = false;
+							break;
 						}
-						p[mask8Bit(ucs)] = static_cast<Byte>(i);
 					}
 				}
 
 				namespace {
 					class SingleByteEncoder : public Encoder {
 					public:
-						explicit SingleByteEncoder(const Char** byteToCharacterWire, const EncodingProperties& properties) BOOST_NOEXCEPT;
+						explicit SingleByteEncoder(const BidirectionalMap& table, const EncodingProperties& properties) BOOST_NOEXCEPT;
 					private:
 						// Encoder
 						Result doFromUnicode(State& state,
@@ -129,28 +123,39 @@ namespace ascension {
 							const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) override;
 						const EncodingProperties& properties() const BOOST_NOEXCEPT override {return props_;}
 					private:
-						const sbcs::BidirectionalMap table_;
+						const sbcs::BidirectionalMap& table_;
 						const EncodingProperties& props_;
 					};
 
-					SingleByteEncoder::SingleByteEncoder(const Char** byteToCharacterWire,
-							const EncodingProperties& properties) BOOST_NOEXCEPT : table_(byteToCharacterWire), props_(properties) {
+					SingleByteEncoder::SingleByteEncoder(const BidirectionalMap& table,
+							const EncodingProperties& properties) BOOST_NOEXCEPT : table_(table), props_(properties) {
 					}
 
 					Encoder::Result SingleByteEncoder::doFromUnicode(State& state,
 							const boost::iterator_range<Byte*>& to, Byte*& toNext, const boost::iterator_range<const Char*>& from, const Char*& fromNext) {
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
-						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
-							*toNext = table_.toByte(*fromNext);
-							if(*toNext == sbcs::UNMAPPABLE_BYTE && *fromNext != sbcs::UNMAPPABLE_BYTE) {
-								if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
-									--toNext;
-								else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
+						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
+							if(*fromNext < 0x80 && table_.isAsciiCompatible()) {
+								const std::size_t n = ascension::detail::encodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+								continue;
+							}
+							const Byte c = table_.toByte(*fromNext);
+							if(c == sbcs::UNMAPPABLE_BYTE && *fromNext != sbcs::UNMAPPABLE_BYTE) {
+								if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS) {
+									++fromNext;
+									continue;
+								} else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
 									*toNext = properties().substitutionCharacter();
 								else
 									return UNMAPPABLE_CHARACTER;
-							}
+							} else
+								*toNext = c;
+							++toNext;
+							++fromNext;
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 					}
@@ -159,14 +164,24 @@ namespace ascension {
 							const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
-						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
+						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
+							if(*fromNext < 0x80 && table_.isAsciiCompatible()) {
+								const std::size_t n = ascension::detail::decodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+								continue;
+							}
 							*toNext = table_.toCharacter(*fromNext);
 							if(*toNext == text::REPLACEMENT_CHARACTER) {
-								if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
-									--toNext;
-								else if(substitutionPolicy() != REPLACE_UNMAPPABLE_CHARACTERS)
+								if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS) {
+									++fromNext;
+									continue;
+								} else if(substitutionPolicy() != REPLACE_UNMAPPABLE_CHARACTERS)
 									return UNMAPPABLE_CHARACTER;
 							}
+							++toNext;
+							++fromNext;
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 					}
@@ -174,8 +189,8 @@ namespace ascension {
 
 				namespace detail {
 					std::unique_ptr<encoding::Encoder> createSingleByteEncoder(
-							const Char** byteToCharacterWire, const encoding::EncodingProperties& properties) BOOST_NOEXCEPT {
-						return std::unique_ptr<encoding::Encoder>(new encoding::implementation::sbcs::SingleByteEncoder(byteToCharacterWire, properties));
+							const BidirectionalMap& table, const encoding::EncodingProperties& properties) BOOST_NOEXCEPT {
+						return std::unique_ptr<encoding::Encoder>(new encoding::implementation::sbcs::SingleByteEncoder(table, properties));
 					}
 				}
 			}
@@ -8,6 +8,7 @@
 #include <ascension/corelib/encoding/encoder-factory.hpp>
 #include <ascension/corelib/basic-exceptions.hpp>
 #include <ascension/corelib/text/utf.hpp>	// text.isScalarValue, text.utf.encode
+#include <algorithm>						// std.max, std.min
 #include <memory>							// std.unique_ptr
 #include <boost/foreach.hpp>
 
@@ -261,6 +262,47 @@ namespace ascension {
 			}
 		}
 
+		/**
+		 * Converts the given string from the native encoding into UTF-16, and writes the result into the buffers
+		 * supplied by the given sink. Unlike the other overloads, the destination is not limited, so this method
+		 * never returns @c INSUFFICIENT_BUFFER. The sink receives the characters converted by each call of
+		 * @c #doToUnicode, at most as many as the length of the buffer it supplied, even if this method failed
+		 * later.
+		 * @param[in,out] state The conversion state
+		 * @param[out] to The sink receives the converted characters
+		 * @param[in] from The buffer to be converted
+		 * @param[in] fromNext Points to the first unconverted character after the conversion
+		 * @return The result of the conversion. @c MALFORMED_INPUT if the encoder can't write a character even into
+		 *         a buffer of 4096 characters
+		 * @throw BadStateException @a state is invalid
+		 * @throw NullPointerException @a from or the buffer @a to supplied is @c null
+		 * @throw std#invalid_argument @a from or the buffer @a to supplied is not ordered, or the buffer is shorter
+		 *                             than requested
+		 * @throw ... Any exceptions @a to throws
+		 */
+		Encoder::Result Encoder::toUnicode(State& state, UnicodeSink& to, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
+			// the length of the buffer requested to the sink grows only while a character does not fit, so bounds it
+			// not to allocate without limit for an encoder which never writes anything
+			static const std::size_t MAXIMUM_SINK_BUFFER_LENGTH = 0x1000;
+			std::size_t minimumLength = std::max<std::size_t>(properties().maximumUCSLength(), 2);
+			for(fromNext = boost::const_begin(from); ; ) {
+				const boost::iterator_range<Char*> buffer(to.buffer(minimumLength));
+				if(static_cast<std::size_t>(boost::size(buffer)) < minimumLength)
+					throw std::invalid_argument("the buffer is shorter than requested");
+				const Byte* const previousFromNext = fromNext;
+				Char* toNext;
+				const auto result = toUnicode(state, buffer, toNext, boost::make_iterator_range(fromNext, boost::const_end(from)), fromNext);
+				to.commit(boost::make_iterator_range<const Char*>(boost::const_begin(buffer), toNext));
+				if(result != INSUFFICIENT_BUFFER)
+					return result;
+				else if(toNext == boost::const_begin(buffer) && fromNext == previousFromNext) {	// a character did not fit
+					if(minimumLength >= MAXIMUM_SINK_BUFFER_LENGTH)
+						return MALFORMED_INPUT;
+					minimumLength = std::min(minimumLength * 2, MAXIMUM_SINK_BUFFER_LENGTH);
+				}
+			}
+		}
+
 		/**
 		 * Converts the given string from the native encoding into UTF-16.
 		 * @param from The string to be converted
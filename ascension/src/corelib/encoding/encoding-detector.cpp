@@ -13,6 +13,7 @@
 #include <ascension/corelib/text/utf.hpp>	// text.isScalarValue, text.utf.encode
 #include <algorithm>
 #include <memory>							// std.unique_ptr
+#include <numeric>							// std.iota
 #include <boost/foreach.hpp>
 
 
@@ -46,6 +47,50 @@ namespace ascension {
 			return doDetect(bytes);
 		}
 
+		/**
+		 * Detects the encoding of the initial bytes of the string buffer, and reports the candidate encodings with
+		 * their confidences.
+		 * @param bytes The byte character sequence to test
+		 * @param maximumSampleLength The maximum number of the initial bytes of @a bytes to test
+		 * @param[out] candidates The candidate encodings in the descending order of the likelihood. Not empty
+		 * @return The first element of @a candidates. See @c #detect
+		 * @throw NullPointerException @a bytes is @c null
+		 * @throw std#invalid_argument @a bytes is not ordered, or @a maximumSampleLength is zero
+		 */
+		std::tuple<MIBenum, std::string, std::size_t> EncodingDetector::detect(const boost::iterator_range<const Byte*>& bytes,
+				std::size_t maximumSampleLength, std::vector<Candidate>& candidates) const {
+			if(boost::const_begin(bytes) == nullptr || boost::const_end(bytes) == nullptr)
+				throw NullPointerException("bytes");
+			else if(boost::const_begin(bytes) > boost::const_end(bytes))
+				throw std::invalid_argument("bytes is not ordered.");
+			else if(maximumSampleLength == 0)
+				throw std::invalid_argument("maximumSampleLength");
+			candidates.clear();
+			doDetectCandidates(boost::make_iterator_range_n(boost::const_begin(bytes),
+				std::min<std::size_t>(boost::size(bytes), maximumSampleLength)), candidates);
+			assert(!candidates.empty());
+			const Candidate& best = candidates.front();
+			return std::make_tuple(best.mibEnum, best.name, best.convertibleBytes);
+		}
+
+		/**
+		 * Detects the encoding of the given character sequence, and reports the candidate encodings. The default
+		 * implementation reports only the result of @c #doDetect, and the confidence is the ratio of the
+		 * convertible bytes.
+		 * @param bytes The byte character sequence to test
+		 * @param[out] candidates The empty vector receives the candidate encodings in the descending order of the
+		 *                        likelihood. Should not be empty at return
+		 * @see #detect
+		 */
+		void EncodingDetector::doDetectCandidates(const boost::iterator_range<const Byte*>& bytes, std::vector<Candidate>& candidates) const {
+			const auto result(doDetect(bytes));
+			const Candidate candidate = {
+				std::get<0>(result), std::get<1>(result), std::get<2>(result),
+				!bytes.empty() ? static_cast<double>(std::get<2>(result)) / boost::size(bytes) : 0.0
+			};
+			candidates.push_back(candidate);
+		}
+
 		/**
 		 * Returns the encoding detector which matches the given name.
 		 * @param name The name
@@ -80,6 +125,71 @@ namespace ascension {
 		}
 #endif // BOOST_OS_WINDOWS
 
+		/**
+		 * Feeds the bytes to the probers in one pass, and reports the probers as the candidates. The bytes are
+		 * read block by block, and each block is read by all the probers which have not rejected the bytes yet. If
+		 * all the probers but one rejected the bytes and the survivor read enough significant characters, the rest
+		 * of the bytes are not read and the survivor is reported as if it accepted all the bytes.
+		 *
+		 * The candidates are ordered by the number of the convertible bytes in the descending order. Among the
+		 * candidates which converted the same bytes, the ones read any significant character precede, and the ties
+		 * are broken by the order of @a probers. The confidence of a candidate is (the ratio of the convertible bytes) * n / (n + 1), where n is the number of
+		 * the significant characters.
+		 * @param bytes The byte character sequence to test
+		 * @param probers The probers of the candidate encodings. Should not be empty
+		 * @param[out] candidates The vector to receive the candidates
+		 * @see EncodingProber
+		 */
+		void EncodingDetector::probe(const boost::iterator_range<const Byte*>& bytes,
+				const std::vector<EncodingProber*>& probers, std::vector<Candidate>& candidates) {
+			static const std::size_t BLOCK_SIZE = 0x1000;
+			static const std::size_t DECISIVE_NUMBER_OF_SIGNIFICANT_CHARACTERS = 32;
+			assert(!probers.empty());
+			const Byte* const first = boost::const_begin(bytes);
+			const Byte* const last = boost::const_end(bytes);
+			std::vector<const Byte*> positions(probers.size(), first);
+			std::vector<bool> rejected(probers.size(), false);
+			std::size_t numberOfSurvivors = probers.size();
+			for(const Byte* block = first; block < last && numberOfSurvivors > 0; ) {
+				const Byte* const blockEnd = (static_cast<std::size_t>(last - block) > BLOCK_SIZE) ? block + BLOCK_SIZE : last;
+				for(std::size_t i = 0; i < probers.size(); ++i) {
+					if(!rejected[i] && positions[i] < blockEnd) {	// the previous character may have straddled the block
+						positions[i] = probers[i]->read(positions[i], blockEnd, last);
+						if(positions[i] < blockEnd) {
+							rejected[i] = true;
+							--numberOfSurvivors;
+						}
+					}
+				}
+				block = blockEnd;
+
+				// stop if a candidate is decisively ahead
+				if(numberOfSurvivors == 1 && probers.size() > 1 && block < last) {
+					const std::size_t survivor = std::find(std::begin(rejected), std::end(rejected), false) - std::begin(rejected);
+					if(probers[survivor]->numberOfSignificantCharacters() >= DECISIVE_NUMBER_OF_SIGNIFICANT_CHARACTERS) {
+						positions[survivor] = last;
+						break;
+					}
+				}
+			}
+
+			std::vector<std::size_t> order(probers.size());
+			std::iota(std::begin(order), std::end(order), 0);
+			std::stable_sort(std::begin(order), std::end(order), [&positions, &probers](std::size_t lhs, std::size_t rhs) {
+				if(positions[lhs] != positions[rhs])
+					return positions[lhs] > positions[rhs];
+				return probers[lhs]->numberOfSignificantCharacters() > 0 && probers[rhs]->numberOfSignificantCharacters() == 0;
+			});
+			BOOST_FOREACH(std::size_t i, order) {
+				const std::size_t n = probers[i]->numberOfSignificantCharacters();
+				const Candidate candidate = {
+					probers[i]->mibEnum(), probers[i]->name(), static_cast<std::size_t>(positions[i] - first),
+					!bytes.empty() ? static_cast<double>(positions[i] - first) / boost::size(bytes) * n / (n + 1) : 0.0
+				};
+				candidates.push_back(candidate);
+			}
+		}
+
 		std::vector<std::shared_ptr<const EncodingDetector>>& EncodingDetector::registry() {
 			static std::vector<std::shared_ptr<const EncodingDetector>> singleton;
 			return singleton;
@@ -97,6 +207,13 @@ namespace ascension {
 		}
 
 
+		// EncodingProber /////////////////////////////////////////////////////////////////////////////////////////////
+
+		/// Destructor.
+		EncodingProber::~EncodingProber() BOOST_NOEXCEPT {
+		}
+
+
 		// UniversalDetector //////////////////////////////////////////////////////////////////////////////////////////
 
 		namespace {
@@ -105,6 +222,7 @@ namespace ascension {
 				UniversalDetector() : EncodingDetector("UniversalAutoDetect") {}
 			private:
 				std::tuple<MIBenum, std::string, std::size_t> doDetect(const boost::iterator_range<const Byte*>& bytes) const BOOST_NOEXCEPT override;
+				void doDetectCandidates(const boost::iterator_range<const Byte*>& bytes, std::vector<Candidate>& candidates) const override;
 			};
 //			ASCENSION_DEFINE_ENCODING_DETECTOR(SystemLocaleBasedDetector, "SystemLocaleAutoDetect");
 //			ASCENSION_DEFINE_ENCODING_DETECTOR(UserLocaleBasedDetector, "UserLocaleAutoDetect");
@@ -141,5 +259,31 @@ namespace ascension {
 
 			return result;
 		}
+
+		/// @see EncodingDetector#doDetectCandidates
+		void UniversalDetector::doDetectCandidates(const boost::iterator_range<const Byte*>& bytes, std::vector<Candidate>& candidates) const {
+			// merge the candidates of all detectors
+			std::vector<std::string> names;
+			availableNames(std::back_inserter(names));
+			std::vector<Candidate> detected;
+			BOOST_FOREACH(const std::string& name, names) {
+				if(const std::shared_ptr<const EncodingDetector> detector = forName(name)) {
+					if(detector.get() == this)
+						continue;
+					detector->detect(bytes, std::max<std::size_t>(boost::size(bytes), 1), detected);
+					candidates.insert(std::end(candidates), std::begin(detected), std::end(detected));
+				}
+			}
+			std::stable_sort(std::begin(candidates), std::end(candidates), [](const Candidate& lhs, const Candidate& rhs) {
+				if(lhs.convertibleBytes != rhs.convertibleBytes)
+					return lhs.convertibleBytes > rhs.convertibleBytes;
+				return lhs.confidence > rhs.confidence;
+			});
+			if(candidates.empty()) {
+				const Candidate candidate = {
+					Encoder::defaultInstance().properties().mibEnum(), Encoder::defaultInstance().properties().name(), 0, 0.0};
+				candidates.push_back(candidate);
+			}
+		}
 	}
 }
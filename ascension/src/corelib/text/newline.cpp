@@ -7,10 +7,147 @@
  * @date 2016-07-26 Separated from kernel/document.cpp.
  */
 
+#include <ascension/corelib/detail/simd.hpp>
 #include <ascension/corelib/text/newline.hpp>
+#include <cstdint>
+#include <cstring>	// std.memcpy
 
 namespace ascension {
 	namespace text {
+		namespace {
+			inline bool isNewlineCharacter(Char c) BOOST_NOEXCEPT {
+				// LINE_SEPARATOR | 1 == PARAGRAPH_SEPARATOR
+				return c == LINE_FEED || c == CARRIAGE_RETURN || c == NEXT_LINE || (c | 1) == PARAGRAPH_SEPARATOR;
+			}
+
+			inline bool isNewlineByte(Byte b) BOOST_NOEXCEPT {
+				return b == 0x0a || b == 0x0d;
+			}
+		}
+
+		/**
+		 * Returns the first newline character (one of @c NEWLINE_CHARACTERS) in the given UTF-16 text.
+		 * @param first The beginning of the text
+		 * @param last The end of the text
+		 * @return The found newline, or @a last if not found
+		 * @see eatNewline, findNewlines
+		 */
+		const Char* findNewline(const Char* first, const Char* last) BOOST_NOEXCEPT {
+#ifdef ASCENSION_DETAIL_USES_AVX2
+			{
+				const __m256i lf = _mm256_set1_epi16(LINE_FEED), cr = _mm256_set1_epi16(CARRIAGE_RETURN);
+				const __m256i nel = _mm256_set1_epi16(NEXT_LINE), separator = _mm256_set1_epi16(static_cast<short>(LINE_SEPARATOR));
+				const __m256i notOne = _mm256_set1_epi16(static_cast<short>(0xfffeu));
+				for(; last - first >= 16; first += 16) {
+					const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					const __m256i found = _mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi16(v, lf), _mm256_cmpeq_epi16(v, cr)),
+						_mm256_or_si256(_mm256_cmpeq_epi16(v, nel), _mm256_cmpeq_epi16(_mm256_and_si256(v, notOne), separator)));
+					if(_mm256_movemask_epi8(found) != 0)
+						break;
+				}
+			}
+#endif // ASCENSION_DETAIL_USES_AVX2
+#ifdef ASCENSION_DETAIL_USES_SSE2
+			{
+				const __m128i lf = _mm_set1_epi16(LINE_FEED), cr = _mm_set1_epi16(CARRIAGE_RETURN);
+				const __m128i nel = _mm_set1_epi16(NEXT_LINE), separator = _mm_set1_epi16(static_cast<short>(LINE_SEPARATOR));
+				const __m128i notOne = _mm_set1_epi16(static_cast<short>(0xfffeu));
+				for(; last - first >= 8; first += 8) {
+					const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+					const __m128i found = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi16(v, lf), _mm_cmpeq_epi16(v, cr)),
+						_mm_or_si128(_mm_cmpeq_epi16(v, nel), _mm_cmpeq_epi16(_mm_and_si128(v, notOne), separator)));
+					if(_mm_movemask_epi8(found) != 0)
+						break;
+				}
+			}
+#endif // ASCENSION_DETAIL_USES_SSE2
+			for(; first != last; ++first) {
+				if(isNewlineCharacter(*first))
+					break;
+			}
+			return first;
+		}
+
+		/**
+		 * Finds all newlines in the given UTF-16 text in one pass. CR+LF is reported once, at CR.
+		 * @param first The beginning of the text
+		 * @param last The end of the text
+		 * @param[out] newlines The beginnings of the found newlines are appended to this, in order
+		 * @throw std#bad_alloc
+		 * @see findNewline
+		 */
+		void findNewlines(const Char* first, const Char* last, std::vector<const Char*>& newlines) {
+			for(const Char* p = first; (p = findNewline(p, last)) != last; ) {
+				newlines.push_back(p);
+				p = (*p == CARRIAGE_RETURN && std::next(p) != last && p[1] == LINE_FEED) ? p + 2 : p + 1;
+			}
+		}
+
+		/**
+		 * Returns the first CR or LF byte in the given bytes. This is useful for the encodings compatible with
+		 * ASCII.
+		 * @param first The beginning of the bytes
+		 * @param last The end of the bytes
+		 * @return The found byte, or @a last if not found
+		 * @see findNewlineBytes
+		 */
+		const Byte* findNewlineByte(const Byte* first, const Byte* last) BOOST_NOEXCEPT {
+#ifdef ASCENSION_DETAIL_USES_AVX2
+			{
+				const __m256i lf = _mm256_set1_epi8(0x0a), cr = _mm256_set1_epi8(0x0d);
+				for(; last - first >= 32; first += 32) {
+					const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+					if(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr))) != 0)
+						break;
+				}
+			}
+#endif // ASCENSION_DETAIL_USES_AVX2
+#ifdef ASCENSION_DETAIL_USES_SSE2
+			{
+				const __m128i lf = _mm_set1_epi8(0x0a), cr = _mm_set1_epi8(0x0d);
+				for(; last - first >= 16; first += 16) {
+					const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+					if(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr))) != 0)
+						break;
+				}
+			}
+#else
+			// test the bytes word by word
+			typedef std::uint64_t Word;
+			static const Word ONES = 0x0101010101010101ull, HIGHS = 0x8080808080808080ull;
+			static const Word LFS = ONES * 0x0a, CRS = ONES * 0x0d;
+			for(; last - first >= static_cast<std::ptrdiff_t>(sizeof(Word)); first += sizeof(Word)) {
+				Word word;
+				std::memcpy(&word, first, sizeof(Word));
+				const Word lf = word ^ LFS, cr = word ^ CRS;
+				if((((lf - ONES) & ~lf) | ((cr - ONES) & ~cr)) & HIGHS)	// has a zero byte
+					break;
+			}
+#endif // ASCENSION_DETAIL_USES_SSE2
+			for(; first != last; ++first) {
+				if(isNewlineByte(*first))
+					break;
+			}
+			return first;
+		}
+
+		/**
+		 * Finds all CR, LF and CR+LF in the given bytes in one pass. CR+LF is reported once, at CR.
+		 * @param first The beginning of the bytes
+		 * @param last The end of the bytes
+		 * @param[out] newlines The beginnings of the found newlines are appended to this, in order
+		 * @throw std#bad_alloc
+		 * @see findNewlineByte
+		 */
+		void findNewlineBytes(const Byte* first, const Byte* last, std::vector<const Byte*>& newlines) {
+			for(const Byte* p = first; (p = findNewlineByte(p, last)) != last; ) {
+				newlines.push_back(p);
+				p = (*p == 0x0d && std::next(p) != last && p[1] == 0x0a) ? p + 2 : p + 1;
+			}
+		}
+
 		/// Line feed. Standard of Unix (Lf, U+000A).
 		const Newline Newline::LINE_FEED(text::LINE_FEED);
 
@@ -67,7 +67,7 @@ namespace ascension {
 					0x0534, 0x0564, 0x0535, 0x0565, 0x0536, 0x0566, 0x0537, 0x0567,
 					0x0538, 0x0568, 0x0539, 0x0569, 0x053a, 0x056a, 0x053b, 0x056b,	// 0x40
 					0x053c, 0x056c, 0x053d, 0x056d, 0x053e, 0x056e, 0x053f, 0x056f,
-					0x053f, 0x056f, 0x0540, 0x0570, 0x0541, 0x0571, 0x0542, 0x0572,	// 0x50
+					0x0540, 0x0570, 0x0541, 0x0571, 0x0542, 0x0572, 0x0543, 0x0573,	// 0x50
 					0x0544, 0x0574, 0x0545, 0x0575, 0x0546, 0x0576, 0x0547, 0x0577,
 					0x0548, 0x0578, 0x0549, 0x0579, 0x054a, 0x057a, 0x054b, 0x057b,	// 0x60
 					0x054c, 0x057c, 0x054d, 0x057d, 0x054e, 0x057e, 0x054f, 0x057f,
@@ -110,7 +110,7 @@ namespace ascension {
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
 				const Char ARMSCII8AtoUCS_20[] = {
 					0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x055b,	// 0x20
-					0x0028, 0x0029, 0x0030, 0x0031, 0x002c, 0x2014, 0x002e, 0x0032,
+					0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x2014, 0x002e, 0x002f,
 					0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,	// 0x30
 					0x0038, 0x0039, 0x0589, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
 					0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,	// 0x40
@@ -137,7 +137,7 @@ namespace ascension {
 				};
 
 				const Byte UCStoARMSCII8A_00A8[] = {
-					N_A_, N_A_, 0xae, N_A_, N_A_, N_A_, N_A_, N_A_,
+					N_A_, N_A_, N_A_, 0xae, N_A_, N_A_, N_A_, N_A_,
 					N_A_, N_A_, N_A_, N_A_, N_A_, N_A_, N_A_, N_A_,	// U+00B0
 					N_A_, N_A_, N_A_, 0xaf
 				};
@@ -152,8 +152,8 @@ namespace ascension {
 					0x8f, 0x91, 0x93, 0x95, 0x97, 0x99, 0x9b, 0x9d,
 					0x9f, 0xa1, 0xa3, 0xa5, 0xa7, 0xa9, 0xab, 0xad,	// U+0570
 					0xe1, 0xe3, 0xe5, 0xe7, 0xe9, 0xeb, 0xed, 0xef,
-					0xf1, 0xf3, 0xf5, 0xf7, 0xf9, 0xfb, 0xfd, 0x3a,	// U+0580
-					N_A_, N_A_, 0xdd
+					0xf1, 0xf3, 0xf5, 0xf7, 0xf9, 0xfb, 0xfd, N_A_,	// U+0580
+					N_A_, 0x3a, 0xdd
 				};
 				const Byte UCStoARMSCII8A_2010[] = {
 					N_A_, N_A_, N_A_, N_A_, 0x2d, N_A_, N_A_, N_A_,	// U+2010
@@ -191,33 +191,34 @@ namespace ascension {
 					toNext = boost::begin(to);
 					fromNext = boost::const_begin(from);
 					for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
-						if(*fromNext < 0x0028) {
+						if(*fromNext < 0x0028 || (*fromNext >= 0x0030 && *fromNext < 0x00a0)) {
 							*toNext = mask8Bit(*fromNext);
 							continue;
-						} else if(*fromNext < 0x0028 + std::extent<decltype(UCStoARMSCII8_0028)>::value)
-							*toNext = UCStoARMSCII8_0028[*fromNext - 0x0028];
-						else if(*fromNext < 0x00a0 + std::extent<decltype(UCStoARMSCII78_00A0)>::value)
+						} else if(*fromNext < 0x0028 + std::extent<decltype(UCStoARMSCII8_0028)>::value) {
+							*toNext = UCStoARMSCII8_0028[*fromNext - 0x0028];	// already 8-bit
+							continue;
+						} else if(*fromNext >= 0x00a0 && *fromNext < 0x00a0 + std::extent<decltype(UCStoARMSCII78_00A0)>::value)
 							*toNext = UCStoARMSCII78_00A0[*fromNext - 0x00a0];
-						else if(*fromNext < 0x0530 + std::extent<decltype(UCStoARMSCII78_0530)>::value)
-							*toNext = UCStoARMSCII78_0530[*fromNext - 0x0530];
-						else if(*fromNext < 0x2010 + std::extent<decltype(UCStoARMSCII78_2010)>::value)
-							*toNext = UCStoARMSCII78_2010[*fromNext - 0x2010];
 						else if(const Char* decomposed = decomposeArmenianLigature(*fromNext)) {
-							if(toNext + 1 < boost::end(to))
-								return INSUFFICIENT_BUFFER;
+							if(toNext + 1 >= boost::end(to))
+								break;	// INSUFFICIENT_BUFFER
 							*toNext = UCStoARMSCII78_0530[decomposed[0] - 0x0530] + 0x80;
 							*++toNext = UCStoARMSCII78_0530[decomposed[1] - 0x0530] + 0x80;
 							assert(toNext[-1] != 0x80 && toNext[0] != 0x80);
 							continue;
-						} else
+						} else if(*fromNext >= 0x0530 && *fromNext < 0x0530 + std::extent<decltype(UCStoARMSCII78_0530)>::value)
+							*toNext = UCStoARMSCII78_0530[*fromNext - 0x0530];
+						else if(*fromNext >= 0x2010 && *fromNext < 0x2010 + std::extent<decltype(UCStoARMSCII78_2010)>::value)
+							*toNext = UCStoARMSCII78_2010[*fromNext - 0x2010];
+						else
 							*toNext = props_.substitutionCharacter();
 
 						if(*toNext == props_.substitutionCharacter()) {
-							if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS) {
+							if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
 								--toNext;
-								continue;
-							} else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
+							else if(substitutionPolicy() != REPLACE_UNMAPPABLE_CHARACTERS)
 								return UNMAPPABLE_CHARACTER;
+							continue;
 						}
 						*toNext += 0x80;
 					}
@@ -237,6 +238,8 @@ namespace ascension {
 							--toNext;
 						else if(substitutionPolicy() == DONT_SUBSTITUTE)
 							return UNMAPPABLE_CHARACTER;
+						else
+							*toNext = text::REPLACEMENT_CHARACTER;
 					}
 					return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 				}
@@ -254,25 +257,25 @@ namespace ascension {
 					toNext = boost::begin(to);
 					fromNext = boost::const_begin(from);
 					for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
-						if(*fromNext < 0x0028) {
+						if(*fromNext < 0x0021 || *fromNext == 0x007f) {	// controls and space
 							*toNext = mask8Bit(*fromNext);
 							continue;
-						} else if(*fromNext < 0x0028 + std::extent<decltype(UCStoARMSCII7_0028)>::value)
+						} else if(*fromNext >= 0x0028 && *fromNext < 0x0028 + std::extent<decltype(UCStoARMSCII7_0028)>::value)
 							*toNext = UCStoARMSCII7_0028[*fromNext - 0x0028];
-						else if(*fromNext < 0x00a0 + std::extent<decltype(UCStoARMSCII78_00A0)>::value)
+						else if(*fromNext >= 0x00a0 && *fromNext < 0x00a0 + std::extent<decltype(UCStoARMSCII78_00A0)>::value)
 							*toNext = UCStoARMSCII78_00A0[*fromNext - 0x00a0];
-						else if(*fromNext < 0x0530 + std::extent<decltype(UCStoARMSCII78_0530)>::value)
-							*toNext = UCStoARMSCII78_0530[*fromNext - 0x0530];
-						else if(*fromNext < 0x2010 + std::extent<decltype(UCStoARMSCII78_2010)>::value)
-							*toNext = UCStoARMSCII78_2010[*fromNext - 0x2010];
 						else if(const Char* const decomposed = decomposeArmenianLigature(*fromNext)) {
-							if(toNext + 1 < boost::end(to))
-								return INSUFFICIENT_BUFFER;
+							if(toNext + 1 >= boost::end(to))
+								break;	// INSUFFICIENT_BUFFER
 							*toNext = UCStoARMSCII78_0530[decomposed[0] - 0x0530];
 							*++toNext = UCStoARMSCII78_0530[decomposed[1] - 0x0530];
 							assert(toNext[-1] != props_.substitutionCharacter() && toNext[0] != props_.substitutionCharacter());
 							continue;
-						} else
+						} else if(*fromNext >= 0x0530 && *fromNext < 0x0530 + std::extent<decltype(UCStoARMSCII78_0530)>::value)
+							*toNext = UCStoARMSCII78_0530[*fromNext - 0x0530];
+						else if(*fromNext >= 0x2010 && *fromNext < 0x2010 + std::extent<decltype(UCStoARMSCII78_2010)>::value)
+							*toNext = UCStoARMSCII78_2010[*fromNext - 0x2010];
+						else
 							*toNext = props_.substitutionCharacter();
 
 						if(*toNext == props_.substitutionCharacter()) {
@@ -299,6 +302,8 @@ namespace ascension {
 							--toNext;
 						else if(substitutionPolicy() == DONT_SUBSTITUTE)
 							return UNMAPPABLE_CHARACTER;
+						else
+							*toNext = text::REPLACEMENT_CHARACTER;
 					}
 					return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 				}
@@ -315,30 +320,34 @@ namespace ascension {
 					fromNext = boost::const_begin(from);
 					for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
 						if(*fromNext < 0x80) {
+							// these bytes are used for the Armenian punctuations, and the hyphen-minus moves to 0x5F
 							static const Char invChars[] = {0x0027, 0x003a, 0x005f, 0x0060, 0x007e};
-							*toNext = boost::binary_search(invChars, *fromNext) ? mask8Bit(*fromNext) : props_.substitutionCharacter();
+							if(*fromNext == 0x002d)
+								*toNext = 0x5f;
+							else
+								*toNext = boost::binary_search(invChars, *fromNext) ? props_.substitutionCharacter() : mask8Bit(*fromNext);
 						} else if(*fromNext < 0x00a8)
 							*toNext = props_.substitutionCharacter();
 						else if(*fromNext < 0x00a8 + std::extent<decltype(UCStoARMSCII8A_00A8)>::value)
 							*toNext = UCStoARMSCII8A_00A8[*fromNext - 0x00a8];
-						else if(*fromNext < 0x0530 + std::extent<decltype(UCStoARMSCII8A_0530)>::value)
-							*toNext = UCStoARMSCII8A_0530[*fromNext - 0x0530];
-						else if(*fromNext < 0x2010 + std::extent<decltype(UCStoARMSCII8A_2010)>::value)
-							*toNext = UCStoARMSCII8A_2010[*fromNext - 0x2010];
 						else if(const Char* const decomposed = decomposeArmenianLigature(*fromNext)) {
-							if(toNext + 1 < boost::end(to))
-								return INSUFFICIENT_BUFFER;
-							*toNext = UCStoARMSCII8A_0530[decomposed[0] - 0x0530] + 0x80;
-							*++toNext = UCStoARMSCII8A_0530[decomposed[1] - 0x0530] + 0x80;
-							assert(toNext[-1] != 0x80 && toNext[0] != 0x80);
+							if(toNext + 1 >= boost::end(to))
+								break;	// INSUFFICIENT_BUFFER
+							*toNext = UCStoARMSCII8A_0530[decomposed[0] - 0x0530];
+							*++toNext = UCStoARMSCII8A_0530[decomposed[1] - 0x0530];
+							assert(toNext[-1] != props_.substitutionCharacter() && toNext[0] != props_.substitutionCharacter());
 							continue;
-						} else
+						} else if(*fromNext >= 0x0530 && *fromNext < 0x0530 + std::extent<decltype(UCStoARMSCII8A_0530)>::value)
+							*toNext = UCStoARMSCII8A_0530[*fromNext - 0x0530];
+						else if(*fromNext >= 0x2010 && *fromNext < 0x2010 + std::extent<decltype(UCStoARMSCII8A_2010)>::value)
+							*toNext = UCStoARMSCII8A_2010[*fromNext - 0x2010];
+						else
 							*toNext = props_.substitutionCharacter();
 
 						if(*toNext == props_.substitutionCharacter()) {
 							if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
 								--toNext;
-							else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
+							else if(substitutionPolicy() != REPLACE_UNMAPPABLE_CHARACTERS)
 								return UNMAPPABLE_CHARACTER;
 						}
 					}
@@ -354,8 +363,10 @@ namespace ascension {
 							*toNext = *fromNext;
 						else if(*fromNext < 0x20 + std::extent<decltype(ARMSCII8AtoUCS_20)>::value)
 							*toNext = ARMSCII8AtoUCS_20[*fromNext - 0x20];
-						else
+						else if(*fromNext >= 0xd8)
 							*toNext = ARMSCII8AtoUCS_D8[*fromNext - 0xd8];
+						else
+							*toNext = text::REPLACEMENT_CHARACTER;
 						if(*toNext == text::REPLACEMENT_CHARACTER) {
 							if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
 								--toNext;
@@ -76,12 +76,15 @@
 
 #ifndef ASCENSION_NO_STANDARD_ENCODINGS
 
+#include <ascension/corelib/detail/ascii-run.hpp>
 #include <ascension/corelib/encoding/encoder.hpp>
 #include <ascension/corelib/encoding/encoder-implementation.hpp>
 #include <ascension/corelib/encoding/encoding-detector.hpp>
 #include <ascension/corelib/text/utf.hpp>
+#include <algorithm>	// std.find_if, std.min
 #include <cassert>
 #include <cstring>		// std.memcpy
+#include <iterator>		// std.advance, std.next
 #include <map>
 #include <boost/range/algorithm/binary_search.hpp>
 
@@ -223,6 +226,7 @@ namespace ascension {
 						JisAutoDetector() : EncodingDetector("JISAutoDetect") {}
 					private:
 						std::tuple<MIBenum, std::string, std::size_t> doDetect(const boost::iterator_range<const Byte*>& bytes) const BOOST_NOEXCEPT override;
+						void doDetectCandidates(const boost::iterator_range<const Byte*>& bytes, std::vector<Candidate>& candidates) const override;
 					};
 
 					struct Installer {
@@ -1047,59 +1051,100 @@ namespace ascension {
 					}
 
 
+					// flat tables of JIS X 0208 in Shift_JIS and EUC-JP, built at the first use
+					const DecodingTable& shiftJisToUcsTable() {
+						// U+0000 means that the trail byte is invalid
+						static const DecodingTable table(0x80, 0xff, [](Byte lead, Byte trail) -> Char {
+							if(trail < 0x40 || trail > 0xfc || trail == 0x7f)
+								return 0x0000u;
+							const Byte dbcs[2] = {lead, trail};
+							return convertX0208toUCS(unshiftCodeX0208(dbcs));
+						});
+						return table;
+					}
+					const DecodingTable& eucJpToUcsTable() {
+						static const DecodingTable table(0x80, 0xff, [](Byte lead, Byte trail) {
+							return convertX0208toUCS(static_cast<std::uint16_t>(((lead << 8) | trail) - 0x8080));
+						});
+						return table;
+					}
+					const EncodingTable& ucsToShiftJisTable() {
+						static const EncodingTable table([](Char c) -> std::uint16_t {
+							Byte dbcs[2];
+							if(const std::uint16_t jis = convertUCStoX0208(c)) {
+								shiftCode(jis, dbcs, false);
+								return (dbcs[0] << 8) | dbcs[1];
+							}
+							return 0x0000;
+						});
+						return table;
+					}
+					const EncodingTable& ucsToX0208Table() {
+						static const EncodingTable table(&convertUCStoX0208);
+						return table;
+					}
+
 					// Shift_JIS //////////////////////////////////////////////////////////////////////////////////////
 
 					template<> Encoder::Result InternalEncoder<ShiftJis>::doFromUnicode(State&,
 							const boost::iterator_range<Byte*>& to, Byte*& toNext, const boost::iterator_range<const Char*>& from, const Char*& fromNext) {
+						const EncodingTable& table = ucsToShiftJisTable();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
-						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
-							if(*fromNext < 0x80)
-								*toNext = mask8Bit(*fromNext);
-							else {
-								std::uint16_t jis = convertUCStoX0208(*fromNext);	// try JIS X 0208
-								if(jis == 0x00) {
-									if(const Byte kana = convertUCStoKANA(*fromNext)) {	// try JIS X 0201 kana
-										*toNext = kana;
-										continue;
-									} else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
-										*toNext = properties().substitutionCharacter();
-									else if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
-										--toNext;
-									else
-										return UNMAPPABLE_CHARACTER;
-								} else if(toNext + 1 >= boost::end(to))
+						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
+							if(*fromNext < 0x80) {	// ASCII run
+								const std::size_t n = ascension::detail::encodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+							} else if(const std::uint16_t dbcs = table(*fromNext)) {	// JIS X 0208
+								if(toNext + 1 >= boost::end(to))
 									break;	// INSUFFICIENT_BUFFER
-								shiftCode(jis, toNext, false);
-								++toNext;	// DBCS			
-							}
+								*(toNext++) = mask8Bit(dbcs >> 8);
+								*(toNext++) = mask8Bit(dbcs);
+								++fromNext;
+							} else if(const Byte kana = convertUCStoKANA(*fromNext)) {	// JIS X 0201 kana
+								*(toNext++) = kana;
+								++fromNext;
+							} else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS) {
+								*(toNext++) = properties().substitutionCharacter();
+								++fromNext;
+							} else if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
+								++fromNext;
+							else
+								return UNMAPPABLE_CHARACTER;
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 					}
 
 					template<> Encoder::Result InternalEncoder<ShiftJis>::doToUnicode(State&,
 							const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
+						const DecodingTable& table = shiftJisToUcsTable();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
-						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
-							if(*fromNext < 0x80)	// ascii
-								*toNext = *fromNext;
-							else if(*fromNext >= 0xa1 && *fromNext <= 0xdf)	// 1-byte kana
-								*toNext = convertKANAtoUCS(*fromNext);
-							else if(*fromNext == 0xa0)
+						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
+							if(*fromNext < 0x80) {	// ASCII run
+								const std::size_t n = ascension::detail::decodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+							} else if(*fromNext >= 0xa1 && *fromNext <= 0xdf) {	// 1-byte kana run
+								do {
+									*(toNext++) = convertKANAtoUCS(*(fromNext++));
+								} while(toNext < boost::end(to) && fromNext < boost::const_end(from) && *fromNext >= 0xa1 && *fromNext <= 0xdf);
+							} else if(*fromNext == 0xa0)
 								return MALFORMED_INPUT;
-							else {	// DBCS leading byte
-								if(fromNext + 1 < boost::const_end(from) && fromNext[1] >= 0x40 && fromNext[1] <= 0xfc && fromNext[1] != 0x7f) {
-									*toNext = convertX0208toUCS(unshiftCodeX0208(fromNext));
-									if(*toNext == text::REPLACEMENT_CHARACTER) {
-										if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
-											--toNext;
-										else if(substitutionPolicy() != REPLACE_UNMAPPABLE_CHARACTERS)
-											return UNMAPPABLE_CHARACTER;
-									}
-									++fromNext;
-								} else
-									return (fromNext + 1 == boost::const_end(from) && eob(*this)) ? COMPLETED : MALFORMED_INPUT;
+							else if(fromNext + 1 == boost::const_end(from))	// remaining lead byte
+								return eob(*this) ? COMPLETED : MALFORMED_INPUT;
+							else {	// DBCS
+								const Char c = table(fromNext[0], fromNext[1]);
+								if(c == 0x0000u)	// invalid trail byte
+									return MALFORMED_INPUT;
+								else if(c != text::REPLACEMENT_CHARACTER || substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
+									*(toNext++) = c;
+								else if(substitutionPolicy() != IGNORE_UNMAPPABLE_CHARACTERS)
+									return UNMAPPABLE_CHARACTER;
+								std::advance(fromNext, 2);
 							}
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
@@ -1195,7 +1240,7 @@ namespace ascension {
 										Char* temp = toNext++;
 										text::utf::encode(ucs, temp);
 									} else {
-										if(toNext > boost::begin(to) && (toNext[-1] == 0x02e9u && ucs == 0x02e5u) || (toNext[-1] == 0x02e5u && ucs == 0x02e9u)) {
+										if(toNext > boost::begin(to) && ((toNext[-1] == 0x02e9u && ucs == 0x02e5u) || (toNext[-1] == 0x02e5u && ucs == 0x02e9u))) {
 											if(toNext + 1 >= boost::end(to))
 												break;	// INSUFFICIENT_BUFFER
 											*(toNext++) = text::ZERO_WIDTH_NON_JOINER;
@@ -1215,80 +1260,76 @@ namespace ascension {
 
 					template<> Encoder::Result InternalEncoder<EucJp>::doFromUnicode(State&,
 							const boost::iterator_range<Byte*>& to, Byte*& toNext, const boost::iterator_range<const Char*>& from, const Char*& fromNext) {
+						const EncodingTable& x0208 = ucsToX0208Table();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
-						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
-							if(*fromNext < 0x0080) {	// ASCII
-								*toNext = mask8Bit(*fromNext);
+						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
+							if(*fromNext < 0x0080) {	// ASCII run
+								const std::size_t n = ascension::detail::encodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
 								continue;
 							}
 
-							bool x0212 = false;
-							std::uint16_t jis = convertUCStoX0208(*fromNext);
-							if(jis == 0x00) {
-								if((jis = convertUCStoX0212(*fromNext)) != 0x00)
-									// JIS X 0212
-									x0212 = true;
-								else if(const Byte kana = convertUCStoKANA(*fromNext)) {
-									// JIS X 0201 Kana
-									if(toNext + 1 >= boost::end(to))
-										return INSUFFICIENT_BUFFER;
-									*toNext = SS2_8BIT;
-									*++toNext = kana;
-									continue;
-								} else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
-									*toNext = properties().substitutionCharacter();
-								else if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
-									--toNext;
-								else
-									return UNMAPPABLE_CHARACTER;
-							} else if(toNext + 1 >= boost::end(to))
-								return INSUFFICIENT_BUFFER;
-
-							jis |= 0x8080;	// jis -> euc-jp
-							if(!x0212) {	// JIS X 0208
-								*toNext = mask8Bit(jis >> 8);
-								*++toNext = mask8Bit(jis);
-							} else if(toNext + 2 >= boost::end(to))
-								return INSUFFICIENT_BUFFER;
-							else {	// JIS X 0212
-								*toNext = SS3_8BIT;
-								*++toNext = mask8Bit(jis >> 8);
-								*++toNext = mask8Bit(jis);
-							}
+							std::uint16_t jis;
+							if((jis = x0208(*fromNext)) != 0x00) {	// JIS X 0208
+								if(toNext + 1 >= boost::end(to))
+									return INSUFFICIENT_BUFFER;
+								jis |= 0x8080;	// jis -> euc-jp
+								*(toNext++) = mask8Bit(jis >> 8);
+								*(toNext++) = mask8Bit(jis);
+							} else if((jis = convertUCStoX0212(*fromNext)) != 0x00) {	// JIS X 0212
+								if(toNext + 2 >= boost::end(to))
+									return INSUFFICIENT_BUFFER;
+								jis |= 0x8080;
+								*(toNext++) = SS3_8BIT;
+								*(toNext++) = mask8Bit(jis >> 8);
+								*(toNext++) = mask8Bit(jis);
+							} else if(const Byte kana = convertUCStoKANA(*fromNext)) {	// JIS X 0201 Kana
+								if(toNext + 1 >= boost::end(to))
+									return INSUFFICIENT_BUFFER;
+								*(toNext++) = SS2_8BIT;
+								*(toNext++) = kana;
+							} else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
+								*(toNext++) = properties().substitutionCharacter();
+							else if(substitutionPolicy() != IGNORE_UNMAPPABLE_CHARACTERS)
+								return UNMAPPABLE_CHARACTER;
+							++fromNext;
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 					}
 
 					template<> Encoder::Result InternalEncoder<EucJp>::doToUnicode(State&,
 							const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
+						const DecodingTable& x0208 = eucJpToUcsTable();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
-						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++toNext, ++fromNext) {
-							if(*fromNext < 0x80)
-								*toNext = *fromNext;
-							else {
-								const std::size_t bytes = (*fromNext != SS3_8BIT) ? 2 : 3;
-								if(std::next(fromNext, bytes) > boost::const_end(from))
-									return MALFORMED_INPUT;
-								else if(*fromNext == SS2_8BIT)	// SS2 -> JIS X 0201 Kana
-									*toNext = convertKANAtoUCS(fromNext[1]);
-								else if(*fromNext == SS3_8BIT) {	// SS3 -> JIS X 0212
-									const std::uint16_t jis = ((fromNext[1] << 8) | fromNext[2]) - 0x8080;
-									*toNext = convertX0212toUCS(jis);
-								} else {	// JIS X 0208
-									const std::uint16_t jis = ((*fromNext << 8) | fromNext[1]) - 0x8080;
-									*toNext = convertX0208toUCS(jis);
-								}
-
-								if(*toNext == text::REPLACEMENT_CHARACTER) {	// unmappable
-									if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
-										--toNext;
-									else if(substitutionPolicy() != REPLACE_UNMAPPABLE_CHARACTERS)
-										return UNMAPPABLE_CHARACTER;
-								}
-								fromNext += bytes - 1;
+						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
+							if(*fromNext < 0x80) {	// ASCII run
+								const std::size_t n = ascension::detail::decodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+								continue;
 							}
+
+							const std::size_t bytes = (*fromNext != SS3_8BIT) ? 2 : 3;
+							if(std::next(fromNext, bytes) > boost::const_end(from))
+								return MALFORMED_INPUT;
+							Char c;
+							if(*fromNext == SS2_8BIT)	// SS2 -> JIS X 0201 Kana
+								c = convertKANAtoUCS(fromNext[1]);
+							else if(*fromNext == SS3_8BIT)	// SS3 -> JIS X 0212
+								c = convertX0212toUCS(static_cast<std::uint16_t>(((fromNext[1] << 8) | fromNext[2]) - 0x8080));
+							else	// JIS X 0208
+								c = x0208(fromNext[0], fromNext[1]);
+
+							if(c != text::REPLACEMENT_CHARACTER || substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
+								*(toNext++) = c;
+							else if(substitutionPolicy() != IGNORE_UNMAPPABLE_CHARACTERS)
+								return UNMAPPABLE_CHARACTER;
+							std::advance(fromNext, bytes);
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 					}
@@ -1479,247 +1520,326 @@ namespace ascension {
 
 					// JisAutoDetector ////////////////////////////////////////////////////////////////////////////////
 
-					inline std::shared_ptr<const EncodingProperties> detectShiftJis(const boost::iterator_range<const Byte*>& bytes, std::size_t& convertibleBytes, bool& foundKana) {
-						bool jis2004 = false;
-						foundKana = false;
-						auto p(boost::const_begin(bytes));
-						for(; p < boost::const_end(bytes); ++p) {
-							if(*p == ESC)	// Shift_JIS can't have an ESC
-								break;
-							else if(*p < 0x80)	// ASCII is ok
-								continue;
-							else if(*p >= 0xa1 && *p <= 0xdf)	// JIS X 0201 kana
-								foundKana = true;
-							else if(p < boost::const_end(bytes) - 1) {	// 2-byte character?
-								if(*p < 0x81 || *p > 0xfc || (*p > 0x9f && *p < 0xe0))
+					/// Tests if the bytes are valid UTF-8. Tested with the Japanese encodings in one pass.
+					class Utf8Prober : public EncodingProber {
+					public:
+						Utf8Prober() BOOST_NOEXCEPT : numberOfSignificantCharacters_(0) {}
+						MIBenum mibEnum() const BOOST_NOEXCEPT override {return fundamental::UTF_8;}
+						std::string name() const override {return "UTF-8";}
+						std::size_t numberOfSignificantCharacters() const BOOST_NOEXCEPT override {return numberOfSignificantCharacters_;}
+						const Byte* read(const Byte* first, const Byte* last, const Byte* end) BOOST_NOEXCEPT override {
+							const Byte* p = first;
+							for(; p < last; ++p) {
+								if(*p < 0x80)	// ASCII is ok
+									continue;
+								std::ptrdiff_t length;
+								Byte minimumSecond = 0x80, maximumSecond = 0xbf;
+								if(*p >= 0xc2 && *p <= 0xdf)
+									length = 2;
+								else if(*p >= 0xe0 && *p <= 0xef) {
+									length = 3;
+									if(*p == 0xe0)
+										minimumSecond = 0xa0;	// overlong
+									else if(*p == 0xed)
+										maximumSecond = 0x9f;	// surrogate
+								} else if(*p >= 0xf0 && *p <= 0xf4) {
+									length = 4;
+									if(*p == 0xf0)
+										minimumSecond = 0x90;	// overlong
+									else if(*p == 0xf4)
+										maximumSecond = 0x8f;	// out of the code space
+								} else
 									break;	// illegal lead byte
-								else if(p[1] < 0x40 || p[1] > 0xfc || p[1] == 0x7f)
+								const Byte* const sequenceEnd = p + std::min(length, end - p);
+								if(sequenceEnd - p > 1 && (p[1] < minimumSecond || p[1] > maximumSecond))
+									break;	// illegal second byte
+								if(std::find_if(std::min(p + 2, sequenceEnd), sequenceEnd,
+										[](Byte trail) {return trail < 0x80 || trail > 0xbf;}) != sequenceEnd)
 									break;	// illegal trail byte
+								if(sequenceEnd - p < length)
+									return end;	// truncated by the end
+								++numberOfSignificantCharacters_;
+								p += length - 1;
+							}
+							return p;
+						}
+					private:
+						std::size_t numberOfSignificantCharacters_;
+					};
 
-								bool plane2;
-								if(!jis2004) {
-									if(convertX0208toUCS(unshiftCodeX0208(p)) == text::REPLACEMENT_CHARACTER) {
-										const std::uint16_t jis = unshiftCodeX0213(p, plane2);
-										if(!plane2 && convertX0213Plane1toUCS(jis) == text::REPLACEMENT_CHARACTER)
-											break;	// unmappable
-										jis2004 = true;
+					class ShiftJisProber : public EncodingProber {
+					public:
+						ShiftJisProber() BOOST_NOEXCEPT : jis2004_(false), numberOfSignificantCharacters_(0) {}
+						MIBenum mibEnum() const BOOST_NOEXCEPT override {return properties().mibEnum();}
+						std::string name() const override {return properties().name();}
+						std::size_t numberOfSignificantCharacters() const BOOST_NOEXCEPT override {return numberOfSignificantCharacters_;}
+						const Byte* read(const Byte* first, const Byte* last, const Byte* end) BOOST_NOEXCEPT override {
+							const Byte* p = first;
+							for(; p < last; ++p) {
+								if(*p == ESC)	// Shift_JIS can't have an ESC
+									break;
+								else if(*p < 0x80)	// ASCII is ok
+									continue;
+								else if(*p >= 0xa1 && *p <= 0xdf)	// JIS X 0201 kana
+									++numberOfSignificantCharacters_;
+								else if(*p < 0x81 || *p > 0xfc || (*p > 0x9f && *p < 0xe0))
+									break;	// illegal lead byte
+								else if(p < end - 1) {	// 2-byte character
+									if(p[1] < 0x40 || p[1] > 0xfc || p[1] == 0x7f)
+										break;	// illegal trail byte
+
+									bool plane2;
+									if(!jis2004_) {
+										if(convertX0208toUCS(unshiftCodeX0208(p)) == text::REPLACEMENT_CHARACTER) {
+											const std::uint16_t jis = unshiftCodeX0213(p, plane2);
+											if(!plane2 && convertX0213Plane1toUCS(jis) == text::REPLACEMENT_CHARACTER)
+												break;	// unmappable
+											jis2004_ = true;
+										}
+									} else {	// Shift_JIS-2004
+										if(unshiftCodeX0213(p, plane2) == 0x00)
+											break;
 									}
-								} else {	// Shift_JIS-2004
-									if(unshiftCodeX0213(p, plane2) == 0x00)
-										break;
-								}
-								++p;
-							} else
-								break;
+									++numberOfSignificantCharacters_;
+									++p;
+								} else
+									return end;	// truncated by the end
+							}
+							return p;
 						}
-						convertibleBytes = std::distance(boost::const_begin(bytes), p);
-						if(jis2004)
-							return installer.SHIFT_JIS_2004;
-						else
-							return installer.SHIFT_JIS;
-					}
+					private:
+						const EncodingProperties& properties() const BOOST_NOEXCEPT {
+							if(jis2004_)
+								return *installer.SHIFT_JIS_2004;
+							else
+								return *installer.SHIFT_JIS;
+						}
+						bool jis2004_;
+						std::size_t numberOfSignificantCharacters_;
+					};
 
-					inline std::shared_ptr<const EncodingProperties> detectEucJp(const boost::iterator_range<const Byte*>& bytes, std::size_t& convertibleBytes, bool& foundKana) {
-						bool jis2004 = false;
-						foundKana = false;
-						auto p(boost::const_begin(bytes));
-						for(; p < boost::const_end(bytes); ++p) {
-							if(*p == ESC)	// EUC-JP can't have an ESC
-								break;
-							else if(*p < 0x80)	// ASCII is ok
-								continue;
-							else if(*p == SS2_8BIT) {	// SS2 introduces JIS X 0201 kana
-								if(p + 1 >= boost::const_end(bytes) || p[1] < 0xa0 || p[1] > 0xe0)
-									break;
-								foundKana = true;
-								++p;
-							} else if(*p == SS3_8BIT) {	// SS3 introduces JIS X 0212 or JIS X 0213 plane2
-								if(p + 2 >= boost::const_end(bytes))
+					class EucJpProber : public EncodingProber {
+					public:
+						EucJpProber() BOOST_NOEXCEPT : jis2004_(false), numberOfSignificantCharacters_(0) {}
+						MIBenum mibEnum() const BOOST_NOEXCEPT override {return properties().mibEnum();}
+						std::string name() const override {return properties().name();}
+						std::size_t numberOfSignificantCharacters() const BOOST_NOEXCEPT override {return numberOfSignificantCharacters_;}
+						const Byte* read(const Byte* first, const Byte* last, const Byte* end) BOOST_NOEXCEPT override {
+							const Byte* p = first;
+							for(; p < last; ++p) {
+								if(*p == ESC)	// EUC-JP can't have an ESC
 									break;
-								std::uint16_t jis = p[1] << 8 | p[2];
-								if(jis < 0x8080)
-									break;	// unmappable
-								jis -= 0x8080;
-								if(convertX0212toUCS(jis) != text::REPLACEMENT_CHARACTER) {
-									if(jis2004)
-										break;
-//									cp = CPEX_JAPANESE_EUC;
-								} else if(convertX0213Plane2toUCS(jis) != text::REPLACEMENT_CHARACTER) {
-									if(!jis2004)
+								else if(*p < 0x80)	// ASCII is ok
+									continue;
+								else if(*p == SS2_8BIT) {	// SS2 introduces JIS X 0201 kana
+									if(p + 1 >= end)
+										return end;	// truncated by the end
+									else if(p[1] < 0xa0 || p[1] > 0xe0)
 										break;
-									jis2004 = true;
-								} else
-									break;
-								p += 2;
-							} else if(p < boost::const_end(bytes) - 1) {	// 2-byte character
-								std::uint16_t jis = *p << 8 | p[1];
-								if(jis <= 0x8080)
-									break;
-								jis -= 0x8080;
-								if(convertX0208toUCS(jis) == text::REPLACEMENT_CHARACTER) {
-									if(convertX0213Plane1toUCS(jis) != text::REPLACEMENT_CHARACTER) {
-//										if(cp == CPEX_JAPANESE_EUC)
-//											break;
-										jis2004 = true;
+									++p;
+								} else if(*p == SS3_8BIT) {	// SS3 introduces JIS X 0212 or JIS X 0213 plane2
+									if(p + 2 >= end)
+										return end;	// truncated by the end
+									std::uint16_t jis = p[1] << 8 | p[2];
+									if(jis < 0x8080)
+										break;	// unmappable
+									jis -= 0x8080;
+									if(convertX0212toUCS(jis) != text::REPLACEMENT_CHARACTER) {
+										if(jis2004_)
+											break;
+//										cp = CPEX_JAPANESE_EUC;
+									} else if(convertX0213Plane2toUCS(jis) != text::REPLACEMENT_CHARACTER) {
+										if(!jis2004_)
+											break;
+										jis2004_ = true;
 									} else
 										break;
-								}
-								++p;
-							} else
-								break;
+									p += 2;
+								} else if(p < end - 1) {	// 2-byte character
+									std::uint16_t jis = *p << 8 | p[1];
+									if(jis <= 0x8080)
+										break;
+									jis -= 0x8080;
+									if(convertX0208toUCS(jis) == text::REPLACEMENT_CHARACTER) {
+										if(convertX0213Plane1toUCS(jis) != text::REPLACEMENT_CHARACTER) {
+//											if(cp == CPEX_JAPANESE_EUC)
+//												break;
+											jis2004_ = true;
+										} else
+											break;
+									}
+									++p;
+								} else if(*p >= 0xa1)
+									return end;	// truncated by the end
+								else
+									break;
+								++numberOfSignificantCharacters_;
+							}
+							return p;
 						}
-						convertibleBytes = std::distance(boost::const_begin(bytes), p);
-						if(jis2004)
-							return installer.EUC_JIS_2004;
-						else
-							return installer.EUC_JP;
-					}
+					private:
+						const EncodingProperties& properties() const BOOST_NOEXCEPT {
+							if(jis2004_)
+								return *installer.EUC_JIS_2004;
+							else
+								return *installer.EUC_JP;
+						}
+						bool jis2004_;
+						std::size_t numberOfSignificantCharacters_;
+					};
 
-					inline std::shared_ptr<const EncodingProperties> detectIso2022Jp(const boost::iterator_range<const Byte*>& bytes, std::size_t& convertibleBytes, bool& foundKana) {
-						char x = '0';	// ISO-2022-JP-X
+					class Iso2022JpProber : public EncodingProber {
+					public:
+						Iso2022JpProber() BOOST_NOEXCEPT : x_('0'),
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
-						bool x0208 = false;
+							x0208_(false),
 #endif // !ASCENSION_NO_MINORITY_ENCODINGS
-						foundKana = false;
-						auto p(boost::const_begin(bytes));
-						for(; p < boost::const_end(bytes); ++p) {
-							if(*p >= 0x80)	// 8-bit
-								break;
-							else if(*p == ESC) {
-								if(p + 2 >= boost::const_end(bytes))
+							numberOfSignificantCharacters_(0) {}
+						MIBenum mibEnum() const BOOST_NOEXCEPT override {return properties().mibEnum();}
+						std::string name() const override {return properties().name();}
+						std::size_t numberOfSignificantCharacters() const BOOST_NOEXCEPT override {return numberOfSignificantCharacters_;}
+						const Byte* read(const Byte* first, const Byte* last, const Byte* end) BOOST_NOEXCEPT override {
+							const Byte* p = first;
+							for(; p < last; ++p) {
+								if(*p >= 0x80)	// 8-bit
 									break;
-								if(std::memcmp(p + 1, "(J", 2) == 0 || std::memcmp(p + 1, "(I", 2) == 0) {	// JIS X 0201
-									p += 2;
-									foundKana = true;
-								} else if(std::memcmp(p + 1, "$@", 2) == 0 || std::memcmp(p + 1, "$B", 2) == 0) {	// JIS X 0208
-									p += 2;
+								else if(*p == ESC) {
+									if(p + 2 >= end)
+										return end;	// truncated by the end
+									if(std::memcmp(p + 1, "(J", 2) == 0 || std::memcmp(p + 1, "(I", 2) == 0) {	// JIS X 0201
+										p += 2;
+									} else if(std::memcmp(p + 1, "$@", 2) == 0 || std::memcmp(p + 1, "$B", 2) == 0) {	// JIS X 0208
+										p += 2;
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
-									x0208 = true;
-									if(x == '4')
-										x = 'c';
+										x0208_ = true;
+										if(x_ == '4')
+											x_ = 'c';
 #endif // !ASCENSION_NO_MINORITY_ENCODINGS
-								} else if(std::memcmp(p + 1, "$A", 2) == 0		// GB2312
-										|| std::memcmp(p + 1, ".A", 2) == 0		// ISO-8859-1
-										|| std::memcmp(p + 1, ".F", 2) == 0) {	// ISO-8859-7
-									if(x == '4'
+									} else if(std::memcmp(p + 1, "$A", 2) == 0		// GB2312
+											|| std::memcmp(p + 1, ".A", 2) == 0		// ISO-8859-1
+											|| std::memcmp(p + 1, ".F", 2) == 0) {	// ISO-8859-7
+										if(x_ == '4'
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
-											|| x == 'c'
-#endif // !ASCENSION_NO_MINORITY_ENCODINGS
-										)
-										break;
-									x = '2';
-									p += 2;
-								} else if(p + 3 < boost::const_end(bytes)) {
-									if(std::memcmp(p + 1, "$(D", 3) == 0) {	// JIS X 0212
-										if(x == '4'
-#ifndef ASCENSION_NO_MINORITY_ENCODINGS
-												|| x == 'c'
+												|| x_ == 'c'
 #endif // !ASCENSION_NO_MINORITY_ENCODINGS
 											)
 											break;
-										else if(x != '2')
-											x =
+										x_ = '2';
+										p += 2;
+									} else if(p + 3 < end) {
+										if(std::memcmp(p + 1, "$(D", 3) == 0) {	// JIS X 0212
+											if(x_ == '4'
+#ifndef ASCENSION_NO_MINORITY_ENCODINGS
+													|| x_ == 'c'
+#endif // !ASCENSION_NO_MINORITY_ENCODINGS
+												)
+												break;
+											else if(x_ != '2')
+												x_ =
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
-												'1'
+													'1'
 #else
-												'2'
+													'2'
 #endif // !ASCENSION_NO_MINORITY_ENCODINGS
-												;
-										p += 3;
-									} else if(std::memcmp(p + 1, "$(C", 3) == 0) {	// KS C 5601
-										if(x == '4'
+													;
+											p += 3;
+										} else if(std::memcmp(p + 1, "$(C", 3) == 0) {	// KS C 5601
+											if(x_ == '4'
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
-												|| x == 'c'
+													|| x_ == 'c'
 #endif // !ASCENSION_NO_MINORITY_ENCODINGS
-											)
-											break;
-										x = '2';
-										p += 3;
-									} else if(std::memcmp(p + 1, "$(", 2) == 0
-											&& (p[3] == 'O'		// JIS X 0213:2000 plane1
-											|| p[3] == 'P'		// JIS X 0213:2000 plane2
-											|| p[3] == 'Q')) {	// JIS X 0213:2004 plane1
-										if(x == '2')
-											break;
+												)
+												break;
+											x_ = '2';
+											p += 3;
+										} else if(std::memcmp(p + 1, "$(", 2) == 0
+												&& (p[3] == 'O'		// JIS X 0213:2000 plane1
+												|| p[3] == 'P'		// JIS X 0213:2000 plane2
+												|| p[3] == 'Q')) {	// JIS X 0213:2004 plane1
+											if(x_ == '2')
+												break;
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
-										if(x == '1')
-											break;
-										else if(x0208)
-											x = 'c';
-										else
+											if(x_ == '1')
+												break;
+											else if(x0208_)
+												x_ = 'c';
+											else
 #endif // !ASCENSION_NO_MINORITY_ENCODINGS
-											x = '4';
-										p += 3;
-									}
-								} else
-									break;
+												x_ = '4';
+											p += 3;
+										} else
+											continue;	// unknown escape sequence
+									} else
+										return end;	// truncated by the end
+									++numberOfSignificantCharacters_;
+								}
 							}
+							return p;
 						}
-
-						convertibleBytes = std::distance(boost::const_begin(bytes), p);
-						std::shared_ptr<const EncodingProperties> result;
-						switch(x) {
-							case '0':
-								result = installer.ISO_2022_JP;
-								break;
-							case '2':
-								result = installer.ISO_2022_JP_2;
-								break;
-							case '4':
-								result = installer.ISO_2022_JP_2004;
-								break;
+					private:
+						const EncodingProperties& properties() const BOOST_NOEXCEPT {
+							switch(x_) {
+								case '2':
+									return *installer.ISO_2022_JP_2;
+								case '4':
+									return *installer.ISO_2022_JP_2004;
 #ifndef ASCENSION_NO_MINORITY_ENCODINGS
-							case '1':
-								result = installer.ISO_2022_JP_1;
-								break;
-							case 'c':
-								result = installer.ISO_2022_JP_2004_COMPATIBLE;
-								break;
+								case '1':
+									return *installer.ISO_2022_JP_1;
+								case 'c':
+									return *installer.ISO_2022_JP_2004_COMPATIBLE;
 #endif // !ASCENSION_NO_MINORITY_ENCODINGS
+								default:
+									assert(x_ == '0');
+									return *installer.ISO_2022_JP;
+							}
 						}
-						assert(result.get() != nullptr);
-						return result;
-					}
+						char x_;	// ISO-2022-JP-X
+#ifndef ASCENSION_NO_MINORITY_ENCODINGS
+						bool x0208_;
+#endif // !ASCENSION_NO_MINORITY_ENCODINGS
+						std::size_t numberOfSignificantCharacters_;
+					};
 
 					/// @see EncodingDetector#doDetector
 					std::tuple<MIBenum, std::string, std::size_t> JisAutoDetector::doDetect(const boost::iterator_range<const Byte*>& bytes) const BOOST_NOEXCEPT {
-						MIBenum mib = fundamental::UTF_8;
-						std::string name("UTF-8");
-						std::size_t score = 0;
-
-						// first, test Unicode
-						if(const std::shared_ptr<const EncodingDetector> unicodeDetector = EncodingDetector::forName("UnicodeAutoDetect")) {
-							std::tie(mib, name, score) = unicodeDetector->detect(bytes);
-							if(score == boost::size(bytes))
-								return std::make_tuple(mib, name, score);
+						try {
+							std::vector<Candidate> candidates;
+							doDetectCandidates(bytes, candidates);
+							const Candidate& best = candidates.front();
+							return std::make_tuple(best.mibEnum, best.name, best.convertibleBytes);
+						} catch(const std::bad_alloc&) {
+							return std::make_tuple(fundamental::UTF_8, std::string("UTF-8"), static_cast<std::size_t>(0));
 						}
+					}
 
-						bool foundKana;
-						std::size_t score2;
-						std::shared_ptr<const EncodingProperties> result2(detectShiftJis(bytes, score2, foundKana));
-						if(score2 > score) {
-							mib = result2->mibEnum();
-							name = result2->name();
-							score = score2;
-						}
-						if(score < boost::size(bytes) || foundKana) {
-							result2 = detectEucJp(bytes, score2, foundKana);
-							if(score2 > score) {
-								mib = result2->mibEnum();
-								name = result2->name();
-								score = score2;
-							}
-							if(score < boost::size(bytes) || foundKana) {
-								result2 = detectIso2022Jp(bytes, score2, foundKana);
-								if(score2 > score) {
-									mib = result2->mibEnum();
-									name = result2->name();
-									score = score2;
-								}
+					/**
+					 * Tests UTF-8 and the Japanese encodings in one pass by @c EncodingDetector#probe.
+					 * @see EncodingDetector#doDetectCandidates
+					 */
+					void JisAutoDetector::doDetectCandidates(const boost::iterator_range<const Byte*>& bytes, std::vector<Candidate>& candidates) const {
+						// first, test the byte order marks of UTF-16 and UTF-32. UTF-8 is tested by the prober
+						if(const std::shared_ptr<const EncodingDetector> unicodeDetector = EncodingDetector::forName("UnicodeAutoDetect")) {
+							const auto bom(unicodeDetector->detect(
+								boost::make_iterator_range_n(boost::const_begin(bytes), std::min<std::size_t>(boost::size(bytes), 4))));
+							if(std::get<0>(bom) != fundamental::UTF_8) {
+								const Candidate candidate = {std::get<0>(bom), std::get<1>(bom), boost::size(bytes), 1.0};
+								candidates.push_back(candidate);
+								return;
 							}
 						}
 
-						return std::make_tuple(mib, name, score);
+						// the order breaks the ties
+						Utf8Prober utf8;
+						ShiftJisProber shiftJis;
+						EucJpProber eucJp;
+						Iso2022JpProber iso2022Jp;
+						std::vector<EncodingProber*> probers;
+						probers.push_back(&utf8);
+						probers.push_back(&shiftJis);
+						probers.push_back(&eucJp);
+						probers.push_back(&iso2022Jp);
+						probe(bytes, probers, candidates);
 					}
 				}
 			}
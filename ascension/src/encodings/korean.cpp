@@ -9,10 +9,13 @@
  * @date 2007-2012, 2014
  */
 
+#include <ascension/corelib/detail/ascii-run.hpp>
 #include <ascension/corelib/encoding/encoder.hpp>
 #include <ascension/corelib/encoding/encoder-implementation.hpp>
 #include <ascension/corelib/text/character.hpp>	// text.REPLACEMENT_CHARACTER
+#include <algorithm>							// std.min
 #include <cstring>								// std.memcmp, std.memcpy
+#include <iterator>							// std.advance
 
 namespace ascension {
 	namespace encoding {
@@ -26,6 +29,24 @@ namespace ascension {
 #include "generated/windows-949-to-ucs.dat"
 					};
 
+					// flat tables of UHC, built at the first use
+					const DecodingTable& uhcToUcsTable() {
+						static const DecodingTable table(0x80, 0xff, [](Byte lead, Byte trail) -> Char {
+							const std::uint16_t** const wire = UHC_TO_UCS[lead];
+							return (wire != nullptr) ? wireAt(wire, trail) : text::REPLACEMENT_CHARACTER;
+						});
+						return table;
+					}
+					const EncodingTable& ucsToUhcTable() {
+						static const EncodingTable table([](Char c) -> std::uint16_t {
+							// the empty lines in the wires are filled with U+FFFD, which is not a valid UHC code
+							const Char** const wire = UCS_TO_UHC[mask8Bit(c >> 8)];
+							const Char dbcs = (wire != nullptr) ? wireAt(wire, mask8Bit(c)) : 0;
+							return (dbcs != text::REPLACEMENT_CHARACTER) ? dbcs : 0;
+						});
+						return table;
+					}
+
 					inline bool eob(const Encoder& encoder) BOOST_NOEXCEPT {
 #if 0
 						return encoder.options().test(Encoder::END_OF_BUFFER);
@@ -96,55 +117,52 @@ namespace ascension {
 
 					template<> Encoder::Result InternalEncoder<Uhc>::doFromUnicode(State& state,
 							const boost::iterator_range<Byte*>& to, Byte*& toNext, const boost::iterator_range<const Char*>& from, const Char*& fromNext) {
+						const EncodingTable& table = ucsToUhcTable();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
-						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++fromNext) {
-							if(*fromNext < 0x80)
-								*(toNext++) = mask8Bit(*fromNext);
-							else {	// double byte character
-								if(const Char** const wire = UCS_TO_UHC[mask8Bit(*fromNext >> 8)]) {
-									if(const std::uint16_t dbcs = wireAt(wire, mask8Bit(*fromNext))) {
-										if(toNext + 1 >= boost::end(to))
-											break;	// the destnation buffer is insufficient
-										*(toNext++) = mask8Bit(dbcs >> 8);
-										*(toNext++) = mask8Bit(dbcs >> 0);
-										continue;
-									}
-								}
-								if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
-									*(toNext++) = properties().substitutionCharacter();
-								else if(substitutionPolicy() != IGNORE_UNMAPPABLE_CHARACTERS)
-									return UNMAPPABLE_CHARACTER;
-							}
+						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
+							if(*fromNext < 0x80) {	// ASCII run
+								const std::size_t n = ascension::detail::encodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+							} else if(const std::uint16_t dbcs = table(*fromNext)) {	// double byte character
+								if(toNext + 1 >= boost::end(to))
+									break;	// the destnation buffer is insufficient
+								*(toNext++) = mask8Bit(dbcs >> 8);
+								*(toNext++) = mask8Bit(dbcs >> 0);
+								++fromNext;
+							} else if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS) {
+								*(toNext++) = properties().substitutionCharacter();
+								++fromNext;
+							} else if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
+								++fromNext;
+							else
+								return UNMAPPABLE_CHARACTER;
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 					}
 		
 					template<> Encoder::Result InternalEncoder<Uhc>::doToUnicode(State& state,
 							const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
+						const DecodingTable& table = uhcToUcsTable();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
 						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
-							if(*fromNext < 0x80)
-								*(toNext++) = *(fromNext++);
-							else if(fromNext + 1 >= boost::const_end(from))	// remaining lead byte
+							if(*fromNext < 0x80) {	// ASCII run
+								const std::size_t n = ascension::detail::decodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+							} else if(fromNext + 1 >= boost::const_end(from))	// remaining lead byte
 								return eob(*this) ? MALFORMED_INPUT : COMPLETED;
 							else {	// double byte character
-								if(const std::uint16_t** const wire = UHC_TO_UCS[mask8Bit(*fromNext)]) {
-									const Char ucs = wireAt(wire, mask8Bit(fromNext[1]));
-									if(ucs != text::REPLACEMENT_CHARACTER) {
-										*(toNext++) = ucs;
-										fromNext += 2;
-										continue;
-									}
-								}
-								if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS) {
-									*(toNext++) = text::REPLACEMENT_CHARACTER;
-									fromNext += 2;
-								} else if(substitutionPolicy() == IGNORE_UNMAPPABLE_CHARACTERS)
-									fromNext += 2;
-								else
+								const Char ucs = table(fromNext[0], fromNext[1]);
+								if(ucs != text::REPLACEMENT_CHARACTER || substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
+									*(toNext++) = ucs;
+								else if(substitutionPolicy() != IGNORE_UNMAPPABLE_CHARACTERS)
 									return UNMAPPABLE_CHARACTER;
+								fromNext += 2;
 							}
 						}
 						return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
@@ -155,23 +173,25 @@ namespace ascension {
 
 					template<> Encoder::Result InternalEncoder<EucKr>::doFromUnicode(State& state,
 							const boost::iterator_range<Byte*>& to, Byte*& toNext, const boost::iterator_range<const Char*>& from, const Char*& fromNext) {
+						const EncodingTable& table = ucsToUhcTable();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
 						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++fromNext) {
-							if(*fromNext < 0x80)
-								*(toNext++) = mask8Bit(*fromNext);
-							else {	// double byte character
-								if(const Char** const wire = UCS_TO_UHC[mask8Bit(*fromNext >> 8)]) {
-									if(const std::uint16_t dbcs = wireAt(wire, mask8Bit(*fromNext))) {
-										const Byte lead = mask8Bit(dbcs >> 8), trail = mask8Bit(dbcs);
-										if(lead - 0xa1u < 0x5e && trail - 0xa1 < 0x5e) {
+							if(*fromNext < 0x80) {	// ASCII run
+								const std::size_t n = ascension::detail::encodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n - 1);
+								std::advance(toNext, n);
+							} else {	// double byte character
+								if(const std::uint16_t dbcs = table(*fromNext)) {
+									const Byte lead = mask8Bit(dbcs >> 8), trail = mask8Bit(dbcs);
+									if(lead - 0xa1u < 0x5e && trail - 0xa1u < 0x5e) {
 //									if(lead >= 0xa1 && lead <= 0xfe && trail >= 0xa1 && trail <= 0xfe) {
-											if(toNext + 1 >= boost::end(to))
-												break;	// the destnation buffer is insufficient
-											*(toNext++) = lead;
-											*(toNext++) = trail;
-											continue;
-										}
+										if(toNext + 1 >= boost::end(to))
+											break;	// the destnation buffer is insufficient
+										*(toNext++) = lead;
+										*(toNext++) = trail;
+										continue;
 									}
 								}
 								if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS)
@@ -185,19 +205,23 @@ namespace ascension {
 		
 					template<> Encoder::Result InternalEncoder<EucKr>::doToUnicode(State& state,
 							const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
+						const DecodingTable& table = uhcToUcsTable();
 						toNext = boost::begin(to);
 						fromNext = boost::const_begin(from);
 						while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
-							if(*fromNext < 0x80)
-								*(toNext++) = *(fromNext++);
-							else if(fromNext + 1 >= boost::const_end(from))	// remaining lead byte
+							if(*fromNext < 0x80) {	// ASCII run
+								const std::size_t n = ascension::detail::decodeAsciiRun(fromNext, toNext,
+									std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+								std::advance(fromNext, n);
+								std::advance(toNext, n);
+							} else if(fromNext + 1 >= boost::const_end(from))	// remaining lead byte
 								return eob(*this) ? MALFORMED_INPUT : COMPLETED;
 							else {	// double byte character
 								if(fromNext[0] - 0xa1u > 0x5du || fromNext[1] - 0xa1u > 0x5du)
 //								if(!(fromNext[0] >= 0xa1 && fromNext[0] <= 0xfe) || !(fromNext[1] >= 0xa1 && fromNext[1] <= 0xfe))
 									return MALFORMED_INPUT;
-								else if(const std::uint16_t** const wire = UHC_TO_UCS[mask8Bit(*fromNext)]) {
-									const Char ucs = wireAt(wire, mask8Bit(fromNext[1]));
+								else {
+									const Char ucs = table(fromNext[0], fromNext[1]);
 									if(ucs != text::REPLACEMENT_CHARACTER) {
 										*(toNext++) = ucs;
 										fromNext += 2;
@@ -226,6 +250,8 @@ namespace ascension {
 
 					template<> Encoder::Result InternalEncoder<Iso2022Kr>::doFromUnicode(State& state,
 							const boost::iterator_range<Byte*>& to, Byte*& toNext, const boost::iterator_range<const Char*>& from, const Char*& fromNext) {
+						toNext = boost::begin(to);
+						fromNext = boost::const_begin(from);
 						if(state.empty()) {
 							// write an escape sequence
 							if(std::next(toNext, 3) >= boost::end(to))
@@ -237,8 +263,6 @@ namespace ascension {
 							throw BadStateException();
 
 						ConversionState& conversionState = boost::any_cast<ConversionState&>(state);
-						toNext = boost::begin(to);
-						fromNext = boost::const_begin(from);
 						for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++fromNext) {
 							if(*fromNext < 0x80) {
 								if(conversionState == KS_C_5601) {
@@ -260,7 +284,7 @@ namespace ascension {
 								if(const Char** const wire = UCS_TO_UHC[mask8Bit(*fromNext >> 8)]) {
 									if(const std::uint16_t dbcs = wireAt(wire, mask8Bit(*fromNext))) {
 										const Byte lead = mask8Bit(dbcs >> 8), trail = mask8Bit(dbcs);
-										if(lead - 0xa1u < 0x5e && trail - 0xa1 < 0x5e) {
+										if(lead - 0xa1u < 0x5e && trail - 0xa1u < 0x5e) {
 //										if(lead >= 0xa1 && lead <= 0xfe && trail >= 0xa1 && trail <= 0xfe) {
 											if(toNext + 1 >= boost::end(to))
 												break;	// the destnation buffer is insufficient
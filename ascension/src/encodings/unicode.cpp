@@ -20,14 +20,18 @@
  * @date 2003-2012, 2014
  */
 
+#include <ascension/corelib/detail/ascii-run.hpp>
+#include <ascension/corelib/detail/simd.hpp>
 #include <ascension/corelib/encoding/encoder.hpp>
 #include <ascension/corelib/encoding/encoder-implementation.hpp>
 #include <ascension/corelib/encoding/encoding-detector.hpp>
 #include <ascension/corelib/text/utf.hpp>
 #include <boost/range/algorithm/copy.hpp>
 #include <boost/range/algorithm/equal.hpp>
+#include <algorithm>	// std.copy, std.min
 #include <array>
 #include <cassert>
+#include <cstring>		// std.memcpy
 #include <type_traits>	// std.is_same
 
 namespace ascension {
@@ -69,6 +73,9 @@ namespace ascension {
 					std::unique_ptr<Encoder> create() const BOOST_NOEXCEPT override {
 						return std::unique_ptr<Encoder>(new InternalEncoder<Utf8>(*this));
 					}
+					bool isResynchronizable() const BOOST_NOEXCEPT override {
+						return true;
+					}
 				};
 				const std::array<Byte, 3> Utf8::BYTE_ORDER_MARK = {{0xef, 0xbb, 0xbf}};
 
@@ -98,6 +105,9 @@ namespace ascension {
 					std::unique_ptr<Encoder> create() const BOOST_NOEXCEPT override {
 						return std::unique_ptr<Encoder>(new InternalEncoder<Utf16BigEndian>(*this));
 					}
+					bool isResynchronizable() const BOOST_NOEXCEPT override {
+						return true;
+					}
 				};
 
 				class Utf16LittleEndian : public EncoderFactoryImpl {
@@ -107,6 +117,9 @@ namespace ascension {
 					std::unique_ptr<Encoder> create() const BOOST_NOEXCEPT override {
 						return std::unique_ptr<Encoder>(new InternalEncoder<Utf16LittleEndian>(*this));
 					}
+					bool isResynchronizable() const BOOST_NOEXCEPT override {
+						return true;
+					}
 				};
 
 #ifndef ASCENSION_NO_STANDARD_ENCODINGS
@@ -147,6 +160,9 @@ namespace ascension {
 					std::unique_ptr<Encoder> create() const BOOST_NOEXCEPT override {
 						return std::unique_ptr<Encoder>(new InternalEncoder<Utf32BigEndian>(*this));
 					}
+					bool isResynchronizable() const BOOST_NOEXCEPT override {
+						return true;
+					}
 				};
 
 				class Utf32LittleEndian : public EncoderFactoryImpl {
@@ -156,6 +172,9 @@ namespace ascension {
 					std::unique_ptr<Encoder> create() const BOOST_NOEXCEPT override {
 						return std::unique_ptr<Encoder>(new InternalEncoder<Utf32LittleEndian>(*this));
 					}
+					bool isResynchronizable() const BOOST_NOEXCEPT override {
+						return true;
+					}
 				};
 #endif // !ASCENSION_NO_STANDARD_ENCODINGS
 
@@ -337,6 +356,124 @@ namespace ascension {
 					0x46, 0x47, 0x47, 0x47, 0x48, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09	// 0xF0
 				};
 
+				/*
+					Block-wise helpers of UTF-8 conversion. ASCII runs are converted 32 (AVX2), 16 (SSE2) or 8
+					(scalar) bytes at a time. A block of 16 bytes which contains non-ASCII bytes is validated at once
+					by the lookup-shuffle method (needs SSSE3), which classifies every pair of adjacent bytes with
+					three 16-entry tables indexed by the nibbles, and checks the continuation bytes of the 3 and
+					4-byte sequences by the saturated subtractions. See "Validating UTF-8 In Less Than One Instruction
+					Per Byte" (Keiser and Lemire, 2021).
+				 */
+				using ascension::detail::decodeAsciiRun;
+				using ascension::detail::encodeAsciiRun;
+
+#ifdef ASCENSION_DETAIL_USES_SSSE3
+				const std::size_t UTF8_BLOCK_SIZE = 16;
+
+				/**
+				 * Returns @c true if the 16 bytes are well-formed UTF-8, assuming that the first byte begins a
+				 * sequence. The sequence truncated at the end of the block is not checked.
+				 * @param p The beginning of the block
+				 */
+				inline bool isWellFormedUtf8Block(const Byte* p) BOOST_NOEXCEPT {
+					// error bits. TWO_CONTINUATIONS must be 0x80, see the last step
+					static const char TOO_SHORT = 1 << 0;	// 11xxxxxx 0xxxxxxx, 11xxxxxx 11xxxxxx
+					static const char TOO_LONG = 1 << 1;	// 0xxxxxxx 10xxxxxx
+					static const char OVERLONG_3 = 1 << 2;	// 11100000 100xxxxx
+					static const char TOO_LARGE = 1 << 3;	// 11110100 1001xxxx, 11110100 101xxxxx, 11110101 1001xxxx, ...
+					static const char SURROGATE = 1 << 4;	// 11101101 101xxxxx
+					static const char OVERLONG_2 = 1 << 5;	// 1100000x 10xxxxxx
+					static const char TOO_LARGE_1000 = 1 << 6;	// 11110101 1000xxxx, 1111011x 1000xxxx, 11111xxx 1000xxxx
+					static const char OVERLONG_4 = 1 << 6;	// 11110000 1000xxxx
+					static const char TWO_CONTINUATIONS = static_cast<char>(1 << 7);	// 10xxxxxx 10xxxxxx
+					static const char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTINUATIONS;
+
+					const __m128i zero = _mm_setzero_si128(), lowNibbleMask = _mm_set1_epi8(0x0f);
+					const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+					// the preceding bytes are regarded as ASCII
+					const __m128i previous1 = _mm_alignr_epi8(input, zero, 15);
+					const __m128i previous2 = _mm_alignr_epi8(input, zero, 14);
+					const __m128i previous3 = _mm_alignr_epi8(input, zero, 13);
+
+					// classify the pair of (previous1, input)
+					const __m128i byte1High = _mm_shuffle_epi8(_mm_setr_epi8(
+						TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,	// 0xxxxxxx
+						TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS,	// 10xxxxxx
+						TOO_SHORT | OVERLONG_2,	// 1100xxxx
+						TOO_SHORT,	// 1101xxxx
+						TOO_SHORT | OVERLONG_3 | SURROGATE,	// 1110xxxx
+						TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4),	// 1111xxxx
+						_mm_and_si128(_mm_srli_epi16(previous1, 4), lowNibbleMask));
+					const __m128i byte1Low = _mm_shuffle_epi8(_mm_setr_epi8(
+						CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,	// xxxx0000
+						CARRY | OVERLONG_2,	// xxxx0001
+						CARRY, CARRY,	// xxxx001x
+						CARRY | TOO_LARGE,	// xxxx0100
+						CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+						CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+						CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+						CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,	// xxxx1101
+						CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000),
+						_mm_and_si128(previous1, lowNibbleMask));
+					const __m128i byte2High = _mm_shuffle_epi8(_mm_setr_epi8(
+						TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,	// 0xxxxxxx
+						TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,	// 1000xxxx
+						TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE,	// 1001xxxx
+						TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE,	// 101xxxxx
+						TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE,
+						TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT),	// 11xxxxxx
+						_mm_and_si128(_mm_srli_epi16(input, 4), lowNibbleMask));
+					const __m128i specialCases = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+					// the third and the fourth bytes must be continuations, which have TWO_CONTINUATIONS in specialCases
+					const __m128i isThirdByte = _mm_subs_epu8(previous2, _mm_set1_epi8(static_cast<char>(0xe0u - 0x80u)));
+					const __m128i isFourthByte = _mm_subs_epu8(previous3, _mm_set1_epi8(static_cast<char>(0xf0u - 0x80u)));
+					const __m128i mustBeContinuation = _mm_and_si128(
+						_mm_or_si128(isThirdByte, isFourthByte), _mm_set1_epi8(TWO_CONTINUATIONS));
+					const __m128i error = _mm_xor_si128(mustBeContinuation, specialCases);
+					return _mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) == 0xffff;
+				}
+
+				/**
+				 * Converts the sequences in the well-formed block into UTF-16. The sequence truncated at the end of the
+				 * block is not converted.
+				 * @param block The beginning of the block which was checked by @c isWellFormedUtf8Block
+				 * @param to The destination
+				 * @param[in,out] fromNext The beginning of the bytes to convert, in @a block
+				 * @param[in,out] toNext The beginning of the destination
+				 */
+				inline void decodeWellFormedUtf8Block(const Byte* block,
+						const boost::iterator_range<Char*>& to, const Byte*& fromNext, Char*& toNext) BOOST_NOEXCEPT {
+					const Byte* const last = block + UTF8_BLOCK_SIZE;
+					while(fromNext < last && toNext < boost::end(to)) {
+						const Byte lead = *fromNext;
+						if(lead < 0x80) {
+							*(toNext++) = *(fromNext++);
+							continue;
+						}
+						const std::ptrdiff_t bytes = (lead >= 0xf0) ? 4 : ((lead >= 0xe0) ? 3 : 2);
+						if(last - fromNext < bytes)
+							break;
+						switch(bytes) {
+							case 2:
+								*(toNext++) = static_cast<Char>(((lead & 0x1f) << 6) | (fromNext[1] & 0x3f));
+								break;
+							case 3:
+								*(toNext++) = static_cast<Char>(((lead & 0x0f) << 12) | ((fromNext[1] & 0x3f) << 6) | (fromNext[2] & 0x3f));
+								break;
+							case 4:
+								if(boost::end(to) - toNext < 2)
+									return;
+								text::utf::encode(((lead & 0x07) << 18) | ((fromNext[1] & 0x3f) << 12)
+									| ((fromNext[2] & 0x3f) << 6) | (fromNext[3] & 0x3f), toNext);
+								toNext += 2;
+								break;
+						}
+						fromNext += bytes;
+					}
+				}
+#endif // ASCENSION_DETAIL_USES_SSSE3
+
 				inline Byte* writeSurrogatePair(const boost::iterator_range<Byte*>& to, Char high, Char low) {
 					if(boost::size(to) < 4)
 						return nullptr;
@@ -368,9 +505,13 @@ namespace ascension {
 					}
 
 					for(; toNext < boost::end(to) && fromNext < boost::const_end(from); ++fromNext) {
-						if(*fromNext < 0x0080u)	// 0000 0000  0zzz zzzz -> 0zzz zzzz
-							(*toNext++) = mask8Bit(*fromNext);
-						else if(*fromNext < 0x0800u) {	// 0000 0yyy  yyzz zzzz -> 110y yyyy  10zz zzzz
+						if(*fromNext < 0x0080u) {	// 0000 0000  0zzz zzzz -> 0zzz zzzz
+							const std::size_t n = encodeAsciiRun(fromNext, toNext,
+								std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+							assert(n > 0);
+							std::advance(toNext, n);
+							std::advance(fromNext, n - 1);
+						} else if(*fromNext < 0x0800u) {	// 0000 0yyy  yyzz zzzz -> 110y yyyy  10zz zzzz
 							if(toNext + 1 >= boost::end(to))
 								break;
 							(*toNext++) = 0xc0 | mask8Bit(*fromNext >> 6);
@@ -438,8 +579,20 @@ namespace ascension {
 					}
 
 					while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
-						if(*fromNext < 0x80)
-							*(toNext++) = *(fromNext++);
+						if(*fromNext < 0x80) {
+							const std::size_t n = decodeAsciiRun(fromNext, toNext,
+								std::min<std::size_t>(boost::const_end(from) - fromNext, boost::end(to) - toNext));
+							std::advance(fromNext, n);
+							std::advance(toNext, n);
+						}
+#ifdef ASCENSION_DETAIL_USES_SSSE3
+						else if(boost::const_end(from) - fromNext >= static_cast<std::ptrdiff_t>(UTF8_BLOCK_SIZE) && isWellFormedUtf8Block(fromNext)) {
+							const Byte* const block = fromNext;
+							decodeWellFormedUtf8Block(block, to, fromNext, toNext);
+							if(fromNext == block)	// a supplemental character does not fit
+								return INSUFFICIENT_BUFFER;
+						}
+#endif // ASCENSION_DETAIL_USES_SSSE3
 						else {
 							const Byte v = UTF8_WELL_FORMED_FIRST_BYTES[*fromNext - 0x80];
 							// check the source buffer length
@@ -452,23 +605,23 @@ namespace ascension {
 								case 3:
 								case 5:
 								case 7:
-									if(fromNext[1] < 0x80 || from[1] > 0xbf)
+									if(fromNext[1] < 0x80 || fromNext[1] > 0xbf)
 										bytes = 0;
 									break;
 								case 2:
-									if(fromNext[1] < 0xa0 || from[1] > 0xbf)
+									if(fromNext[1] < 0xa0 || fromNext[1] > 0xbf)
 										bytes = 0;
 									break;
 								case 4:
-									if(fromNext[1] < 0x80 || from[1] > 0x9f)
+									if(fromNext[1] < 0x80 || fromNext[1] > 0x9f)
 										bytes = 0;
 									break;
 								case 6:
-									if(fromNext[1] < 0x90 || from[1] > 0xbf)
+									if(fromNext[1] < 0x90 || fromNext[1] > 0xbf)
 										bytes = 0;
 									break;
 								case 8:
-									if(fromNext[1] < 0x80 || from[1] > 0x8f)
+									if(fromNext[1] < 0x80 || fromNext[1] > 0x8f)
 										bytes = 0;
 									break;
 							}
@@ -532,7 +685,7 @@ namespace ascension {
 
 				Encoder::Result Utf16::toUnicode(const Encoder&, bool bigEndian,
 						const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
-					static const std::array<int, 2> BIG_ENDIAN_SHIFTS = {{0, 8}}, LITTLE_ENDIAN_SHIFTS = {{8, 0}};
+					static const std::array<int, 2> BIG_ENDIAN_SHIFTS = {{8, 0}}, LITTLE_ENDIAN_SHIFTS = {{0, 8}};
 					const auto& shifts = bigEndian ? BIG_ENDIAN_SHIFTS : LITTLE_ENDIAN_SHIFTS;
 					toNext = boost::begin(to);
 					fromNext = boost::const_begin(from);
@@ -652,7 +805,7 @@ namespace ascension {
 						const CodePoint c =
 							(fromNext[0] << std::get<0>(shifts)) + (fromNext[1] << std::get<1>(shifts))
 							+ (fromNext[2] << std::get<2>(shifts)) + (fromNext[3] << std::get<3>(shifts));
-						if(text::isValidCodePoint(c)) {
+						if(!text::isValidCodePoint(c)) {
 							if(encoder.substitutionPolicy() == Encoder::REPLACE_UNMAPPABLE_CHARACTERS)
 								*(toNext++) = text::REPLACEMENT_CHARACTER;
 							else if(encoder.substitutionPolicy() != Encoder::IGNORE_UNMAPPABLE_CHARACTERS)
@@ -827,8 +980,10 @@ namespace ascension {
 							std::advance(fromNext, encodables - 1);
 						}
 					}
-					if(fromNext == boost::const_end(from) && eob(*this) && toNext != boost::end(to))
+					if(base64 && fromNext == boost::const_end(from) && eob(*this) && toNext != boost::end(to)) {
 						*(toNext++) = '-';
+						base64 = false;
+					}
 					if(base64)
 						state = Utf7::BASE64;
 					else
@@ -839,15 +994,15 @@ namespace ascension {
 				template<> Encoder::Result InternalEncoder<Utf7>::doToUnicode(State& state,
 						const boost::iterator_range<Char*>& to, Char*& toNext, const boost::iterator_range<const Byte*>& from, const Byte*& fromNext) {
 					static const Byte SET_B[0x80] = {
-						// 1 : in set B, 2 : '+', 3 : directly appearable in BASE64, 4 : '-', 0 : otherwise
+						// 1 : in set B, 2 : '+', 3 : direct character not in set B, 4 : '-', 0 : otherwise
 						0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3, 0, 0, 3, 0, 0,	// 0x00
 						0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x10
-						3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 4, 0, 1,	// 0x20
-						1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,	// 0x30
-						0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,	// 0x40
-						1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,	// 0x50
-						0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,	// 0x60
-						1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0	// 0x70
+						3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 3, 4, 3, 1,	// 0x20
+						1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3,	// 0x30
+						3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,	// 0x40
+						1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 0, 3, 3, 3,	// 0x50
+						3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,	// 0x60
+						1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 0, 0	// 0x70
 					};
 					static const Byte BASE64[0x80] = {
 						0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,	// <00>
@@ -885,22 +1040,21 @@ namespace ascension {
 								base64 = true;	// introduce modified BASE64 sequence
 								++fromNext;
 							}
-						} else if(klass == 3) {
+						} else if(klass == 3 || (klass == 1 && !base64)) {
 							(*toNext++) = (*fromNext++);
 							base64 = false;	// terminate modified BASE64 implicitly
 						} else if(klass == 4) {
 							// '-'
 							if(base64)
-								base64 = false;
+								base64 = false;	// absorbed by the modified BASE64 sequence
 							else
-								return MALFORMED_INPUT;	// '-' can't appear here
-								// ...this can't handle '-' appeared at the exact beginning of the input buffer
+								*(toNext++) = L'-';
 							++fromNext;
 						} else {
 							// first, determine how many bytes can be decoded
 							std::ptrdiff_t decodables = 1;
 							for(const std::ptrdiff_t minimum = std::min<std::ptrdiff_t>(std::distance(fromNext, boost::const_end(from)), 8); decodables < minimum; ++decodables) {
-								if(BASE64[fromNext[decodables]] == 0xff)
+								if(fromNext[decodables] >= 0x80 || BASE64[fromNext[decodables]] == 0xff)
 									break;
 							}
 							// check the size of the destination buffer
@@ -924,6 +1078,10 @@ namespace ascension {
 							std::advance(fromNext, decodables);			
 						}
 					}
+					if(base64)
+						state = Utf7::BASE64;
+					else
+						state = boost::any();
 					return (fromNext == boost::const_end(from)) ? COMPLETED : INSUFFICIENT_BUFFER;
 				}
 
@@ -1051,7 +1209,7 @@ namespace ascension {
 					fromNext = boost::const_begin(from);
 					while(toNext < boost::end(to) && fromNext < boost::const_end(from)) {
 						e = decodeUtf5Character(boost::make_iterator_range(fromNext, boost::const_end(from)), cp);
-						if(e == fromNext)
+						if(e == nullptr)
 							return MALFORMED_INPUT;
 						else if(!text::isValidCodePoint(cp)) {
 							if(substitutionPolicy() == REPLACE_UNMAPPABLE_CHARACTERS) {
@@ -57,7 +57,7 @@ namespace ascension {
 					public:
 						VIQREncoder() BOOST_NOEXCEPT {
 							if(table_.get() == nullptr)
-								table_.reset(new BidirectionalMap(VISCII_BYTE_TABLE::VALUES));
+								table_.reset(new BidirectionalMap(VISCII_BYTE_TABLE::FLAT_VALUES));
 						}
 					private:
 						Result doFromUnicode(State& state,
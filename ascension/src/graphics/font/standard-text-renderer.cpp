@@ -39,13 +39,17 @@ namespace ascension {
 
 			/// @internal
 			std::unique_ptr<const TextLayout> StandardTextRenderer::createLineLayout(boost::optional<Index> line) const {
-				static const String emptyString;
 //				const std::unique_ptr<const RenderingContext2D> renderingContext(widgetapi::createRenderingContext(textArea_.textViewer()));
 				const std::unique_ptr<const RenderingContext2D> renderingContext(strategy().renderingContext());
 				auto styles(buildStylesForLineLayout(line, *renderingContext));
+				String text;	// the layout owns the copy, not to widen the line stored in one byte per character
+				if(line != boost::none) {
+					const StringPiece s(layouts().document().lineContent(boost::get(line)).textPiece(text));
+					if(s.cbegin() != text.data())	// not widened into the buffer
+						text.assign(s.cbegin(), s.length());
+				}
 				return std::unique_ptr<const TextLayout>(
-					new TextLayout(
-						(line == boost::none) ? emptyString : layouts().document().lineString(boost::get(line)),
+					new TextLayout(std::move(text),
 						std::get<0>(styles), std::get<1>(styles), std::move(std::get<2>(styles)), std::get<3>(styles),
 						presentation::styles::Length::Context(*renderingContext, strategy().lengthContextViewport()),
 						strategy().parentContentArea(), strategy().fontCollection(), renderingContext->fontRenderContext()));
@@ -49,7 +49,7 @@ namespace ascension {
 
 			/**
 			 * Constructor.
-			 * @param textString The text string to display
+			 * @param textString The text string to display. The layout owns this
 			 * @param toplevelStyle The computed text toplevel style
 			 * @param lineStyle The computed text line style
 			 * @param textRunStyles The computed text runs styles
@@ -59,7 +59,7 @@ namespace ascension {
 			 * @param fontCollection The font collection
 			 * @param fontRenderContext Information about a graphics device which is needed to measure the text correctly
 			 */
-			TextLayout::TextLayout(const String& textString, 
+			TextLayout::TextLayout(String textString, 
 					const presentation::ComputedTextToplevelStyle& toplevelStyle,
 					const presentation::ComputedTextLineStyle& lineStyle,
 					std::unique_ptr<presentation::ComputedStyledTextRunIterator> textRunStyles,
@@ -67,7 +67,7 @@ namespace ascension {
 					const presentation::styles::Length::Context& lengthContext,
 					const Dimension& parentContentArea,
 					const FontCollection& fontCollection, const FontRenderContext& fontRenderContext)
-					: textString_(textString), styles_(toplevelStyle, lineStyle, defaultRunStyle), numberOfLines_(0) {
+					: textString_(std::move(textString)), styles_(toplevelStyle, lineStyle, defaultRunStyle), numberOfLines_(0) {
 				initialize(std::move(textRunStyles), lengthContext, parentContentArea, fontCollection, fontRenderContext);
 			}
 
@@ -514,7 +514,8 @@ namespace ascension {
 					if(hitInLine.characterIndex() != 0 && snapPolicy != kernel::locations::UTF16_CODE_UNIT) {
 						using namespace text;
 						const kernel::Document& document = textRenderer->layouts().document();
-						const String& s = document.lineString(line);
+						String buffer;
+						const StringPiece s(document.lineContent(line).textPiece(buffer));
 						const bool interveningSurrogates =
 							surrogates::isLowSurrogate(s[hitInLine.characterIndex()]) && surrogates::isHighSurrogate(s[hitInLine.characterIndex() - 1]);
 						const Scalar ipd = horizontal ? lineLocalPoint.x() : lineLocalPoint.y();
@@ -18,7 +18,7 @@ namespace ascension {
 		 * @post #adaptationLevel() == #ADAPT_TO_DOCUMENT
 		 * @post #gravity() == Direction#forward()
 		 */
-		AbstractPoint::AbstractPoint(Document& document) : document_(&document), adaptationLevel_(ADAPT_TO_DOCUMENT), gravity_(Direction::forward()) {
+		AbstractPoint::AbstractPoint(Document& document) : document_(&document), line_(0), adaptationLevel_(ADAPT_TO_DOCUMENT), gravity_(Direction::forward()) {
 			static_cast<detail::PointCollection<AbstractPoint>*>(document_)->addNewPoint(*this);
 		}
 
@@ -30,7 +30,7 @@ namespace ascension {
 		 * @post #adaptationLevel() == other.adaptationLevel()
 		 * @post #gravity() == other.gravity()
 		 */
-		AbstractPoint::AbstractPoint(const AbstractPoint& other) : document_(other.document_), adaptationLevel_(other.adaptationLevel()), gravity_(other.gravity()) {
+		AbstractPoint::AbstractPoint(const AbstractPoint& other) : document_(other.document_), line_(0), adaptationLevel_(other.adaptationLevel()), gravity_(other.gravity()) {
 			if(document_ == nullptr)
 				throw DocumentDisposedException();
 			static_cast<detail::PointCollection<AbstractPoint>*>(document_)->addNewPoint(*this);
@@ -76,6 +76,30 @@ namespace ascension {
 			document_ = nullptr;
 		}
 
+		/**
+		 * @fn ascension::kernel::AbstractPoint::indexedLine
+		 * Returns the line by which the document indexes this point. The document notifies a change only to the
+		 * points indexed by the lines at or after the changed line. So this should return the smallest line of the
+		 * positions this point has to update on the change.
+		 * @see #positionChanged
+		 */
+
+		/**
+		 * Derived classes must call this method after the value @c #indexedLine returns was changed, including in
+		 * their constructors. Then the document updates the index of the points.
+		 * @throw std#bad_alloc The document failed to update the index
+		 * @see #indexedLine
+		 */
+		void AbstractPoint::positionChanged() {
+			if(document_ != nullptr) {
+				const Index newLine = indexedLine();
+				if(newLine != line_) {
+					static_cast<detail::PointCollection<AbstractPoint>*>(document_)->movePoint(*this, newLine);
+					line_ = newLine;
+				}
+			}
+		}
+
 		/**
 		 * Sets the adaptation level.
 		 * @param level The new adaptation level
@@ -11,7 +11,6 @@
 #include <ascension/kernel/document.hpp>
 #include <boost/range/begin.hpp>
 #include <boost/range/end.hpp>
-#include <boost/range/algorithm/lower_bound.hpp>
 
 
 namespace ascension {
@@ -20,7 +19,7 @@ namespace ascension {
 		 * Private constructor.
 		 * @param document The document
 		 */
-		Bookmarker::Bookmarker(Document& document) BOOST_NOEXCEPT : document_(document) {
+		Bookmarker::Bookmarker(Document& document) : document_(document), markers_(document) {
 			document.addListener(*this);
 		}
 
@@ -43,55 +42,62 @@ namespace ascension {
 		 * @see #end, #next
 		 */
 		Bookmarker::Iterator Bookmarker::begin() const {
-			return Iterator(std::begin(markedLines_));
+			return Iterator(markers_.begin());
+		}
+
+		/// @internal Moves the mark at @a position to the beginning of the line, if @a position is not at the beginning.
+		void Bookmarker::bringBackToLineStart(const Position& position) {
+			if(offsetInLine(position) > 0) {
+				const std::size_t i = find(line(position));
+				if(i < numberOfMarks() && *boost::const_begin(markers_.at(i).region()) == position) {
+					markers_.remove(markers_.at(i));
+					markers_.add(Region::makeEmpty(Position::bol(line(position))));
+				}
+			}
 		}
 
 		/// Deletes all bookmarks.
 		void Bookmarker::clear() BOOST_NOEXCEPT {
-			if(!boost::empty(markedLines_)) {
-				markedLines_.clear();
+			if(!markers_.empty()) {
+				markers_.clear();
 				listeners_.notify(&BookmarkListener::bookmarkCleared);
 			}
 		}
 
 		/// @see DocumentListener#documentAboutToBeChanged
-		void Bookmarker::documentAboutToBeChanged(const Document&, const DocumentChange&) {
-			// do nothing
+		void Bookmarker::documentAboutToBeChanged(const Document& document, const DocumentChange& change) {
+			// remove the marks on the lines to be erased. markers_ moves the rest after the change
+			if(&document_ != &document || markers_.empty())
+				return;
+			const std::pair<Region, Region> single(change.erasedRegion(), change.insertedRegion());
+			const auto& replacements = change.replacements();
+			const auto* const first = replacements.empty() ? &single : replacements.data();
+			const auto* const last = replacements.empty() ? &single + 1 : replacements.data() + replacements.size();
+			std::vector<const MarkerTree::Marker*> erasedMarks;
+			for(const auto* replacement = first; replacement != last; ++replacement) {
+				const Region& region = replacement->first;
+				if(boost::size(region.lines()) > 1) {
+					Index firstLine = line(*boost::const_begin(region));
+					if(offsetInLine(*boost::const_begin(region)) > 0)
+						++firstLine;
+					markers_.find(boost::irange(firstLine, line(*boost::const_end(region)) + 1), erasedMarks);
+				}
+			}
+			for(const MarkerTree::Marker* mark : erasedMarks)
+				markers_.remove(*mark);
 		}
 
 		/// @see DocumentListener#documentChanged
 		void Bookmarker::documentChanged(const Document& document, const DocumentChange& change) {
-			// update markedLines_ based on the change
-			if(&document_ != &document || markedLines_.empty())
+			// markers_ has been updated as a prenotified listener. a mark at the beginning of the line where the text
+			// was inserted was moved to the end of the inserted text, so return it to the beginning of the line
+			if(&document_ != &document || markers_.empty())
 				return;
-			if(boost::size(change.erasedRegion().lines()) > 1) {
-				const auto& region = change.erasedRegion();
-				Index firstLine = line(*boost::const_begin(region));
-				if(offsetInLine(*boost::const_begin(region)) > 0)
-					++firstLine;
-				const auto firstMarkedLine(boost::lower_bound(markedLines_, firstLine));
-				const auto e(boost::const_end(markedLines_));
-				if(firstMarkedLine != e) {
-					const Index lastLine = line(*boost::const_end(region)) + 1;
-					const auto lastMarkedLine(boost::lower_bound(markedLines_, lastLine));
-					// slide the marks on lines after the erased
-					const auto nlines = boost::size(change.erasedRegion().lines()) - 1;
-					for(auto i(lastMarkedLine); i != e; ++i)
-						*i -= nlines;
-					// remove the marks on erased lines
-					markedLines_.erase(firstMarkedLine, lastMarkedLine);
-				}
-			}
-			if(boost::size(change.insertedRegion().lines()) > 1) {
-				const Index lines = boost::size(change.insertedRegion().lines()) - 1;
-				auto i(find(line(*boost::const_begin(change.insertedRegion()))));
-				if(i != std::end(markedLines_)) {
-					if(*i == line(*boost::const_begin(change.insertedRegion())) && offsetInLine(*boost::const_begin(change.insertedRegion())) != 0)
-						++i;
-					for(const auto e(std::end(markedLines_)); i != e; ++i)
-						*i += lines;	// ??? - C4267@MSVC9
-				}
-			}
+			const auto& replacements = change.replacements();
+			if(replacements.empty())
+				return bringBackToLineStart(*boost::const_end(change.insertedRegion()));
+			for(const auto& replacement : replacements)
+				bringBackToLineStart(*boost::const_end(replacement.second));
 		}
 
 		/**
@@ -99,13 +105,12 @@ namespace ascension {
 		 * @see #begin, #next
 		 */
 		Bookmarker::Iterator Bookmarker::end() const {
-			return Iterator(std::end(markedLines_));
+			return Iterator(markers_.end());
 		}
 
-		inline ascension::detail::GapVector<Index>::iterator Bookmarker::find(Index line) const BOOST_NOEXCEPT {
-			// TODO: can write faster implementation (and design) by internal.searchBound().
-			Bookmarker& self = const_cast<Bookmarker&>(*this);
-			return boost::lower_bound(self.markedLines_, line);
+		/// Returns the index of the first mark on or after @a line.
+		inline std::size_t Bookmarker::find(Index line) const BOOST_NOEXCEPT {
+			return markers_.lowerBound(Position::bol(line));
 		}
 
 		/**
@@ -116,8 +121,8 @@ namespace ascension {
 		bool Bookmarker::isMarked(Index line) const {
 			if(line >= document_.numberOfLines())
 				throw BadPositionException(Position::bol(line));
-			const auto i(find(line));
-			return i != std::end(markedLines_) && *i == line;
+			const std::size_t i = find(line);
+			return i < numberOfMarks() && kernel::line(*boost::const_begin(markers_.at(i).region())) == line;
 		}
 
 		/**
@@ -129,15 +134,14 @@ namespace ascension {
 		void Bookmarker::mark(Index line, bool set) {
 			if(line >= document_.numberOfLines())
 				throw BadPositionException(Position::bol(line));
-			const auto i(find(line));
-			if(i != std::end(markedLines_) && *i == line) {
+			if(isMarked(line)) {
 				if(!set) {
-					markedLines_.erase(i);
+					markers_.remove(markers_.at(find(line)));
 					listeners_.notify<Index>(&BookmarkListener::bookmarkChanged, line);
 				}
 			} else {
 				if(set) {
-					markedLines_.insert(i, line);
+					markers_.add(Region::makeEmpty(Position::bol(line)));
 					listeners_.notify<Index>(&BookmarkListener::bookmarkChanged, line);
 				}
 			}
@@ -160,7 +164,7 @@ namespace ascension {
 			// this code is tested by 'test/document-test.cpp'
 			if(from >= document_.numberOfLines())
 				throw BadPositionException(Position::bol(from));
-			else if(boost::empty(markedLines_))
+			else if(markers_.empty())
 				return boost::none;
 			else if(marks == 0u)
 				return isMarked(from) ? boost::make_optional(from) : boost::none;
@@ -173,14 +177,17 @@ namespace ascension {
 					marks = numberOfMarks();
 			}
 
-			std::size_t i = static_cast<ascension::detail::GapVector<Index>::const_iterator>(find(from)) - std::begin(markedLines_);
+			const auto markedLine = [this](std::size_t i) {
+				return line(*boost::const_begin(markers_.at(i).region()));
+			};
+			std::size_t i = find(from);
 			if(direction == Direction::forward()) {
 				if(i == numberOfMarks()) {
 					if(!wrapAround)
 						return boost::none;
 					i = 0;
 					--marks;
-				} else if(markedLines_[i] != from)
+				} else if(markedLine(i) != from)
 					--marks;
 				if((i += marks) >= numberOfMarks()) {
 					if(wrapAround)
@@ -197,12 +204,12 @@ namespace ascension {
 				}
 				i -= marks;
 			}
-			return markedLines_[i];
+			return markedLine(i);
 		}
 
 		/// Returns the number of the lines bookmarked.
 		std::size_t Bookmarker::numberOfMarks() const BOOST_NOEXCEPT {
-			return boost::size(markedLines_);
+			return markers_.size();
 		}
 
 		/**
@@ -222,11 +229,10 @@ namespace ascension {
 		void Bookmarker::toggle(Index line) {
 			if(line >= document_.numberOfLines())
 				throw BadPositionException(Position::bol(line));
-			const auto i(find(line));
-			if(i == std::end(markedLines_) || *i != line)
-				markedLines_.insert(i, line);
+			if(!isMarked(line))
+				markers_.add(Region::makeEmpty(Position::bol(line)));
 			else
-				markedLines_.erase(i);
+				markers_.remove(markers_.at(find(line)));
 			listeners_.notify<Index>(&BookmarkListener::bookmarkChanged, line);
 		}
 	}
@@ -23,6 +23,23 @@ namespace ascension {
 		 * This class can't detect any change of the document. When the document changed, the existing iterators may be
 		 * invalid.
 		 *
+		 * In addition to the character-by-character iteration, the iterator can read the document in chunks. A chunk is
+		 * a contiguous UTF-16 text from the current position to the end of the line (or of the @c #region), or a
+		 * newline represented by one @c text#LINE_SEPARATOR. Algorithms which can process a string at once should
+		 * use @c #chunk and @c #advanceInChunk instead of @c #operator* and @c #operator++:
+		 *
+		 * @code
+		 * String buffer;
+		 * for(DocumentCharacterIterator i(document, region); i.hasNext(); ) {
+		 *   const StringPiece chunk(i.chunk(buffer));
+		 *   // process chunk...
+		 *   i.advanceInChunk(chunk.length());
+		 * }
+		 * @endcode
+		 *
+		 * The chunks of the @c #region form a stream of UTF-16 code units, in which each newline is one code unit.
+		 * @c #seekInChunks moves the iterator by an offset in the stream.
+		 *
 		 * @note This class is not intended to be subclassed.
 		 */
 		
@@ -131,6 +148,79 @@ namespace ascension {
 				: document_(other.document_), region_(other.region_), position_(other.position_) {
 		}
 
+		/**
+		 * Moves forward in the current chunk. See @c #chunk.
+		 * @param length The number of the UTF-16 code units to skip. If this is equal to the length of the chunk, the
+		 *               iterator moves to the beginning of the next chunk
+		 * @return This iterator
+		 * @throw NoSuchElementException @a length is greater than the length of the current chunk
+		 * @note The offset is changed in UTF-32 code units, as @c #operator++ does.
+		 */
+		DocumentCharacterIterator& DocumentCharacterIterator::advanceInChunk(Index length) {
+			if(length == 0)
+				return *this;
+			else if(!hasNext())
+				throw NoSuchElementException("the iterator is at the last.");
+			const Document::Line& lineContent = document().lineContent(line(*this));
+			if(offsetInLine(tell()) == lineContent.length()) {	// the chunk is a newline
+				if(length > 1)
+					throw NoSuchElementException("the chunk is a newline.");
+				++position_.line;
+				position_.offsetInLine = 0;
+				++offset_;
+				return *this;
+			}
+
+			const Index first = offsetInLine(tell());
+			const Index last = (line(tell()) == line(*boost::const_end(region()))) ? offsetInLine(*boost::const_end(region())) : lineContent.length();
+			if(length > last - first)
+				throw NoSuchElementException("the length is greater than the chunk.");
+			position_.offsetInLine += length;
+			if(lineContent.isLatin1())	// a Latin-1 line has no surrogates
+				boost::get(offset_) += length;
+			else {
+				// count the characters begin in the skipped code units. the chunk may begin in a surrogate pair
+				const StringPiece s(lineContent.textPiece());
+				std::ptrdiff_t n = length;
+				for(Index i = std::max<Index>(first, 1); i < first + length; ++i) {
+					if(text::surrogates::isLowSurrogate(s[i]) && text::surrogates::isHighSurrogate(s[i - 1]))
+						--n;
+				}
+				boost::get(offset_) += n;
+			}
+			return *this;
+		}
+
+		/**
+		 * Returns the current chunk. This does not move the iterator.
+		 * @param buffer The buffer used if the line is stored in one byte per character. See
+		 *               @c Document#Line#textPiece(String&)
+		 * @return The text from the current position to the end of the line or of the @c #region. If the iterator is
+		 *         at the end of the line, a string contains only @c text#LINE_SEPARATOR. If the iterator is at the end
+		 *         of the @c #region, an empty string. This is invalidated by any change of the document or @a buffer
+		 * @throw std#bad_alloc Widening the text failed
+		 * @see #advanceInChunk
+		 */
+		StringPiece DocumentCharacterIterator::chunk(String& buffer) const {
+			static const Char NEWLINE = text::LINE_SEPARATOR;
+			if(document_ == nullptr || !hasNext())
+				return StringPiece();
+			const Document::Line& lineContent = document().lineContent(line(*this));
+			const Index first = offsetInLine(tell());
+			if(first == lineContent.length())
+				return StringPiece(&NEWLINE, 1);
+			const Index last = (line(tell()) == line(*boost::const_end(region()))) ? offsetInLine(*boost::const_end(region())) : lineContent.length();
+			if(!lineContent.isLatin1())
+				return lineContent.textPiece().substr(first, last - first);
+
+			// widen only the part of the line
+			const boost::string_ref latin1(lineContent.latin1Text().substr(first, last - first));
+			buffer.resize(latin1.length());
+			for(std::size_t i = 0, n = latin1.length(); i < n; ++i)
+				buffer[i] = static_cast<Byte>(latin1[i]);
+			return buffer;
+		}
+
 		/**
 		 * Implements @c #operator--.
 		 * Moves to the backward character in UTF-32 code units. This method treats any eol as one character.
@@ -145,11 +235,14 @@ namespace ascension {
 #endif
 			if(offsetInLine(*this) == 0) {
 				--position_.line;
-				position_.offsetInLine = lineString().length();
+				position_.offsetInLine = document().lineLength(line(*this));
 			} else if(--position_.offsetInLine > 0 && hasPrevious()) {
-				const String& s = lineString();
-				if(text::surrogates::isLowSurrogate(s[offsetInLine(tell())]) && text::surrogates::isHighSurrogate(s[offsetInLine(tell()) - 1]))
-					--position_.offsetInLine;
+				const Document::Line& lineContent = document().lineContent(line(*this));
+				if(!lineContent.isLatin1()) {	// a Latin-1 line has no surrogates
+					const StringPiece s(lineContent.textPiece());
+					if(text::surrogates::isLowSurrogate(s[offsetInLine(tell())]) && text::surrogates::isHighSurrogate(s[offsetInLine(tell()) - 1]))
+						--position_.offsetInLine;
+				}
 			}
 			--offset_;
 		}
@@ -165,11 +258,13 @@ namespace ascension {
 		CodePoint DocumentCharacterIterator::dereference() const BOOST_NOEXCEPT {
 			if(document_ == nullptr || tell() == *boost::const_end(region()))
 				return text::INVALID_CODE_POINT;
-			const String& s = lineString();
-			if(kernel::offsetInLine(tell()) == s.length())
+			const Document::Line& lineContent = document().lineContent(line(*this));
+			if(kernel::offsetInLine(tell()) == lineContent.length())
 				return text::LINE_SEPARATOR;
-			else
-				return text::utf::decodeFirst(std::begin(s) + offsetInLine(tell()), std::end(s));
+			else if(lineContent.isLatin1())	// read without widening the line
+				return static_cast<Byte>(lineContent.latin1Text()[offsetInLine(tell())]);
+			const StringPiece s(lineContent.textPiece());
+			return text::utf::decodeFirst(std::next(s.cbegin(), offsetInLine(tell())), s.cend());
 		}
 
 		/**
@@ -196,20 +291,24 @@ namespace ascension {
 #else
 				return;
 #endif
-			const String& s = lineString();
-			if(offsetInLine(tell()) == s.length()) {
+			const Document::Line& lineContent = document().lineContent(line(*this));
+			if(offsetInLine(tell()) == lineContent.length()) {
 				++position_.line;
 				position_.offsetInLine = 0;
-			} else if(++position_.offsetInLine < s.length()
-					&& hasNext()
-					&& text::surrogates::isLowSurrogate(s[offsetInLine(tell())])
-					&& text::surrogates::isHighSurrogate(s[offsetInLine(tell()) - 1]))
-				++position_.offsetInLine;
+			} else if(++position_.offsetInLine < lineContent.length() && !lineContent.isLatin1() && hasNext()) {
+				const StringPiece s(lineContent.textPiece());
+				if(text::surrogates::isLowSurrogate(s[offsetInLine(tell())]) && text::surrogates::isHighSurrogate(s[offsetInLine(tell()) - 1]))
+					++position_.offsetInLine;
+			}
 			++offset_;
 		}
 		
-		/// Returns the line text string.
-		const String& DocumentCharacterIterator::lineString() const BOOST_NOEXCEPT {
+		/**
+		 * Returns a copy of the line text string.
+		 * @throw std#bad_alloc
+		 * @see Document#lineString
+		 */
+		String DocumentCharacterIterator::lineString() const {
 			return document().lineString(line(*this));
 		}
 		
@@ -227,6 +326,25 @@ namespace ascension {
 			return *this;
 		}
 
+		/**
+		 * Moves to the specified offset in the chunks. See @c #chunk.
+		 * @param offset The offset from the beginning of the @c #region, in UTF-16 code units. A newline is
+		 *               counted as one code unit, as @c #chunk returns
+		 * @return This iterator
+		 * @throw IndexOutOfBoundsException @a offset is greater than the length of the @c #region
+		 * @note The offset is not change.
+		 */
+		DocumentCharacterIterator& DocumentCharacterIterator::seekInChunks(Index offset) {
+			static const text::Newline& NEWLINE = text::Newline::LINE_SEPARATOR;
+			const Position first(*boost::const_begin(region()));
+			const Position last(*boost::const_end(region()));
+			const Index base = document().lineOffset(line(first), NEWLINE) + offsetInLine(first);
+			if(offset > document().lineOffset(line(last), NEWLINE) + offsetInLine(last) - base)
+				throw IndexOutOfBoundsException("offset");
+			const Index destination = document().lineAt(base + offset, NEWLINE);
+			return seek(Position(destination, base + offset - document().lineOffset(destination, NEWLINE)));
+		}
+
 		/**
 		 * Sets the region of the iterator. The current position will adjusted.
 		 * @param newRegion The new region to set
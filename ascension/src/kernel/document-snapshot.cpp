@@ -0,0 +1,66 @@
+/**
+ * @file document-snapshot.cpp
+ * Implements @c DocumentSnapshot class.
+ * @author agent
+ * @date 2026-10-16 Created.
+ */
+
+#include <ascension/kernel/document-snapshot.hpp>
+
+namespace ascension {
+	namespace kernel {
+		/**
+		 * Makes a snapshot of the current content of the document. This should be called by the thread which owns
+		 * the document.
+		 * @param document The document
+		 * @throw std#bad_alloc
+		 */
+		DocumentSnapshot::DocumentSnapshot(const Document& document) : revisionNumber_(document.revisionNumber()) {
+			if(document.isLazy()) {
+				lazySource_ = document.lazyLines_->source;
+				return;
+			}
+
+			const Index n = document.lines_.size();
+			Index copiedLength = 0;
+			for(Index i = 0; i < n; ++i) {
+				const Document::Line& line = *document.lines_[i];
+				if(line.original_.cbegin() == nullptr)
+					copiedLength += line.length();
+			}
+			copiedText_.reserve(copiedLength);	// the pieces never be invalidated by reallocation
+
+			originalContents_ = document.originalContents_;
+			lines_.reserve(n);
+			for(Index i = 0; i < n; ++i) {
+				const Document::Line& line = *document.lines_[i];
+				Line copy = {line.original_, line.newline()};
+				if(line.original_.cbegin() == nullptr) {
+					const Char* const p = copiedText_.data() + copiedText_.length();
+					line.appendText(copiedText_, 0, line.length());	// widens a Latin-1 line
+					copy.text = StringPiece(p, line.length());
+				}
+				lines_.push_back(copy);
+			}
+		}
+
+		/// @see DocumentLineSource#numberOfLines
+		Index DocumentSnapshot::numberOfLines() const BOOST_NOEXCEPT {
+			return (lazySource_.get() == nullptr) ? lines_.size() : lazySource_->numberOfLines();
+		}
+
+		/**
+		 * @see DocumentLineSource#readLine
+		 * @throw BadPositionException @a line is outside of the snapshot
+		 */
+		void DocumentSnapshot::readLine(Index line, String& text, text::Newline& newline) const {
+			if(line >= numberOfLines())
+				throw BadPositionException(Position::bol(line));
+			if(lazySource_.get() != nullptr)
+				return lazySource_->readLine(line, text, newline);
+			const Line& l = lines_[line];
+			text.assign(l.text.cbegin(), l.text.cend());
+			newline = l.newline;
+		}
+	}
+}
@@ -5,6 +5,7 @@
  * @date 2006-2016
  */
 
+#include <ascension/corelib/utility.hpp>	// detail.ValueSaver
 #include <ascension/kernel/bookmarker.hpp>
 #include <ascension/kernel/document.hpp>
 #include <ascension/kernel/document-character-iterator.hpp>
@@ -12,7 +13,9 @@
 #include <ascension/kernel/point.hpp>
 #include <ascension/corelib/text/identifier-syntax.hpp>
 #include <boost/foreach.hpp>
+#include <boost/iterator/transform_iterator.hpp>
 #include <boost/range/algorithm/find.hpp>
+#include <boost/range/algorithm/find_first_of.hpp>
 #include <algorithm>
 #include <limits>	// std.numeric_limits
 
@@ -20,6 +23,19 @@
 namespace ascension {
 	namespace kernel {
 		namespace {
+			inline bool isLatin1Only(const StringPiece& text) BOOST_NOEXCEPT {
+				Char bits = 0;
+				for(StringPiece::const_iterator i(text.cbegin()), e(text.cend()); i != e; ++i)
+					bits |= *i;	// this loop is vectorized by the compiler
+				return bits < 0x100;
+			}
+
+			inline void narrow(const StringPiece& text, char* out) BOOST_NOEXCEPT {
+				assert(isLatin1Only(text));
+				for(StringPiece::const_iterator i(text.cbegin()), e(text.cend()); i != e; ++i)
+					*out++ = static_cast<char>(*i);
+			}
+
 			inline text::Newline resolveNewline(const Document& document, const text::Newline& newline) {
 				if(newline == text::Newline::USE_DOCUMENT_INPUT) {
 					// fallback
@@ -59,17 +75,20 @@ namespace ascension {
 			if(line(beginning) == line(end)) {	// shortcut for single-line
 				if(out) {
 					// TODO: this cast may be danger.
-					out.write(document.lineString(line(end)).data() + offsetInLine(beginning), static_cast<std::streamsize>(offsetInLine(end) - offsetInLine(beginning)));
+					String buffer;
+					out.write(document.lineContent(line(end)).textPiece(buffer).data() + offsetInLine(beginning), static_cast<std::streamsize>(offsetInLine(end) - offsetInLine(beginning)));
 				}
 			} else {
 				const text::Newline resolvedNewline(resolveNewline(document, newline));
 				const String eol(resolvedNewline.isLiteral() ? resolvedNewline.asString() : String());
 				assert(!eol.empty() || resolvedNewline == text::Newline::USE_INTRINSIC_VALUE);
+				String buffer;
 				for(Index i = beginning.line; out; ++i) {
 					const Document::Line& lineContent = document.lineContent(i);
+					const StringPiece text(lineContent.textPiece(buffer));	// don't materialize the original content
 					const Index first = (i == line(beginning)) ? offsetInLine(beginning) : 0;
-					const Index last = (i == line(end)) ? offsetInLine(end) : lineContent.text().length();
-					out.write(lineContent.text().data() + first, static_cast<std::streamsize>(last - first));
+					const Index last = (i == line(end)) ? offsetInLine(end) : text.length();
+					out.write(text.data() + first, static_cast<std::streamsize>(last - first));
 					if(i == line(end))
 						break;
 					if(resolvedNewline == text::Newline::USE_INTRINSIC_VALUE) {
@@ -135,9 +154,27 @@ namespace ascension {
 		 * Private constructor.
 		 * @param erasedRegion The erased region in the change
 		 * @param insertedRegion The inserted region in the change
+		 * @param replacements The individual replacements, or @c null. See @c #replacements
+		 */
+		DocumentChange::DocumentChange(const Region& erasedRegion, const Region& insertedRegion,
+				const std::vector<std::pair<Region, Region>>* replacements /* = nullptr */) BOOST_NOEXCEPT
+				: erasedRegion_(erasedRegion), insertedRegion_(insertedRegion), replacements_(replacements) {
+		}
+
+		/**
+		 * Returns the individual replacements if the change was made by
+		 * @c Document#replace(const std::vector<std::pair<Region, StringPiece>>&).
+		 *
+		 * In this case, @c #erasedRegion and @c #insertedRegion span from the first replacement to the last, and the
+		 * text between the replacements is not changed actually. Each element is a pair of the erased region in the
+		 * positions before the change and the inserted region in the positions after the change. The elements are
+		 * sorted by the positions.
+		 * @return The replacements, or an empty vector if the change is a single replacement
+		 * @see locations#updatePosition
 		 */
-		DocumentChange::DocumentChange(const Region& erasedRegion, const Region& insertedRegion)
-				BOOST_NOEXCEPT : erasedRegion_(erasedRegion), insertedRegion_(insertedRegion) {
+		const std::vector<std::pair<Region, Region>>& DocumentChange::replacements() const BOOST_NOEXCEPT {
+			static const std::vector<std::pair<Region, Region>> none;
+			return (replacements_ != nullptr) ? *replacements_ : none;
 		}
 
 
@@ -283,6 +320,13 @@ namespace ascension {
 			listeners_.push_back(&listener);
 		}
 
+		/// @see detail#PointCollection#addNewPoint
+		void Document::addNewPoint(AbstractPoint& point) {
+			pointsToUpdate_.reserve(numberOfPoints_ + 1);	// collectPointsToUpdate never allocates
+			points_[point.line_].push_back(&point);
+			++numberOfPoints_;
+		}
+
 		/**
 		 * Registers the document partitioning listener with the document.
 		 * @param listener The listener to be registered
@@ -314,22 +358,46 @@ namespace ascension {
 			rollbackListeners_.add(listener);
 		}
 
+		/**
+		 * @internal Collects the points indexed by @a firstLine or the following lines into @c #pointsToUpdate_. A
+		 * change which begins at @a firstLine does not move the points before the line.
+		 * @param firstLine The first line to collect the points
+		 */
+		void Document::collectPointsToUpdate(Index firstLine) BOOST_NOEXCEPT {
+			pointsToUpdate_.clear();
+			for(auto i(points_.lower_bound(firstLine)), e(std::end(points_)); i != e; ++i)
+				pointsToUpdate_.insert(std::end(pointsToUpdate_), std::begin(i->second), std::end(i->second));
+		}
+
 		/// @c #resetContent invokes this method finally. Default implementation does nothing.
 		void Document::doResetContent() {
 		}
 
 		namespace {
+			inline void erasePoint(std::map<Index, std::vector<AbstractPoint*>>& points, Index line, AbstractPoint& point) BOOST_NOEXCEPT {
+				const auto bucket(points.find(line));
+				assert(bucket != std::end(points));
+				const auto i(boost::range::find(bucket->second, &point));
+				assert(i != std::end(bucket->second));
+				bucket->second.erase(i);
+				if(bucket->second.empty())
+					points.erase(bucket);
+			}
+
 			template<typename PartitionerMethod, typename ListenerMethod, typename PointMethod>
 			inline void fireDocumentListeners(
 					const Document& document, const DocumentChange& change,
-					std::unique_ptr<DocumentPartitioner>& partitioner, std::list<DocumentListener*>& prenotifiedListeners, std::list<DocumentListener*>& listeners, std::set<AbstractPoint*>& points,
+					std::unique_ptr<DocumentPartitioner>& partitioner, std::list<DocumentListener*>& prenotifiedListeners, std::list<DocumentListener*>& listeners, const std::vector<AbstractPoint*>& points,
 					PartitionerMethod partitionerMethod, ListenerMethod listenerMethod, PointMethod pointMethod) {
 				if(partitioner.get() != nullptr)
 					(partitioner.get()->*partitionerMethod)(change);
 				if(pointMethod != nullptr) {
-					BOOST_FOREACH(AbstractPoint* p, points) {
-						if(p->adaptationLevel() != boost::none)
-							(p->*pointMethod)(change);
+					// a point can be destroyed by another during the iteration. see Document.removePoint
+					for(std::size_t i = 0; i < points.size(); ++i) {
+						if(AbstractPoint* const p = points[i]) {
+							if(p->adaptationLevel() != boost::none)
+								(p->*pointMethod)(change);
+						}
 					}
 				}
 				BOOST_FOREACH(DocumentListener* listener, prenotifiedListeners)
@@ -340,31 +408,130 @@ namespace ascension {
 		}
 
 		void Document::fireDocumentAboutToBeChanged(const DocumentChange& c, bool updateAllPoints /* = true */) BOOST_NOEXCEPT {
-			fireDocumentListeners(*this, c, partitioner_, prenotifiedListeners_, listeners_, points_,
+			if(updateAllPoints)
+				collectPointsToUpdate(kernel::line(*boost::const_begin(c.erasedRegion())));
+			else
+				pointsToUpdate_.clear();
+			fireDocumentListeners(*this, c, partitioner_, prenotifiedListeners_, listeners_, pointsToUpdate_,
 				&DocumentPartitioner::documentAboutToBeChanged, &DocumentListener::documentAboutToBeChanged, updateAllPoints ? &AbstractPoint::documentAboutToBeChanged : nullptr);
 		}
 
 		void Document::fireDocumentChanged(const DocumentChange& c, bool updateAllPoints /* = true */) BOOST_NOEXCEPT {
-			fireDocumentListeners(*this, c, partitioner_, prenotifiedListeners_, listeners_, points_,
+			// notifies the points collected by fireDocumentAboutToBeChanged
+			fireDocumentListeners(*this, c, partitioner_, prenotifiedListeners_, listeners_, pointsToUpdate_,
 				&DocumentPartitioner::documentChanged, &DocumentListener::documentChanged, updateAllPoints ? &AbstractPoint::documentChanged : nullptr);
+			pointsToUpdate_.clear();
 		}
 
 		/**
 		 * Returns the number of characters (UTF-16 code units) in the document.
 		 * @param newline The method to count newlines
 		 * @return The number of characters
+		 * @throw ... Any exceptions @c DocumentLineSource#lineLength throws, at the first call in lazy mode
 		 */
-		Index Document::length(const text::Newline& newline /* = Newline::USE_INTRINSIC_VALUE */) const BOOST_NOEXCEPT {
+		Index Document::length(const text::Newline& newline /* = Newline::USE_INTRINSIC_VALUE */) const {
 			const text::Newline resolvedNewline(resolveNewline(*this, newline));
+			const LineLength total(lineIndex().sum());
 			if(resolvedNewline.isLiteral())
-				return length_ + (numberOfLines() - 1) * ((resolvedNewline != text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED) ? 1 : 2);
+				return total.text + (numberOfLines() - 1) * ((resolvedNewline != text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED) ? 1 : 2);
 			assert(resolvedNewline == text::Newline::USE_INTRINSIC_VALUE);
-			Index len = length_;
-			const Index lines = numberOfLines();
-			assert(lines > 0);
-			for(Index i = 0; i < lines - 1; ++i)
-				len += lines_[i]->newline_.asString().length();
-			return len;
+			assert(!lineIndex().empty());
+			return total.text + total.newline - lineIndex()[lineIndex().size() - 1].newline;	// the last newline is not a content
+		}
+
+		/**
+		 * Returns the line which contains the specified character offset. This is the inverse of
+		 * @c #lineOffset.
+		 * @param offset The offset from the beginning of the document. If this addresses a newline, the
+		 *               result is the line which ends with the newline
+		 * @param newline The line representation policy for character counting
+		 * @return The line number
+		 * @throw IndexOutOfBoundsException @a offset is greater than the length of the document
+		 * @see #length, #lineOffset
+		 */
+		Index Document::lineAt(Index offset, const text::Newline& newline /* = Newline::USE_INTRINSIC_VALUE */) const {
+			if(offset > length(newline))
+				throw IndexOutOfBoundsException("offset");
+			const text::Newline resolvedNewline(resolveNewline(*this, newline));
+			const Index eolLength = resolvedNewline.isLiteral() ? resolvedNewline.asString().length() : 0;
+			assert(eolLength != 0 || resolvedNewline == text::Newline::USE_INTRINSIC_VALUE);
+			return lineIndex().partitionPoint([offset, eolLength](const LineLength& sum, Index lines) {
+				return sum.text + ((eolLength != 0) ? lines * eolLength : sum.newline) <= offset;
+			});
+		}
+
+		/**
+		 * @internal Returns the line length index. In lazy mode, the first call measures all the lines by
+		 * @c DocumentLineSource#lineLength, without caching them, to build the index.
+		 * @throw ... Any exceptions @c DocumentLineSource#lineLength throws
+		 */
+		const ascension::detail::FenwickTree<Document::LineLength>& Document::lineIndex() const {
+			if(!isLazy())
+				return lineIndex_;
+			LazyLines& lazy = *lazyLines_;
+			if(lazy.index.size() != numberOfLines()) {
+				std::vector<LineLength> lengths;
+				lengths.reserve(numberOfLines());
+				text::Newline newline;
+				for(Index line = 0, c = numberOfLines(); line < c; ++line) {
+					const Index length = lazy.source->lineLength(line, newline);
+					assert(newline.isLiteral());
+					lengths.push_back(LineLength());
+					lengths.back().text = length;
+					lengths.back().newline = (newline != text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED) ? 1 : 2;
+				}
+				lazy.index.assign(std::begin(lengths), std::end(lengths));
+			}
+			return lazy.index;
+		}
+
+		/**
+		 * @internal Returns the line in lazy mode, reading it through the @c DocumentLineSource if the line is not
+		 * cached. The least recently used line is evicted when the cache is full. The evicted line is recycled
+		 * unless it is pinned by @c #pinLine.
+		 * @param line The line number
+		 * @return The line
+		 * @throw ... Any exceptions @c DocumentLineSource#readLine throws
+		 */
+		const std::shared_ptr<Document::Line>& Document::lazyLine(Index line) const {
+			assert(isLazy());
+			assert(line < numberOfLines());
+			LazyLines& lazy = *lazyLines_;
+			const auto cached(lazy.cachedLines.find(line));
+			if(cached != std::end(lazy.cachedLines)) {
+				lazy.cache.splice(std::begin(lazy.cache), lazy.cache, std::get<1>(*cached));
+				return std::get<1>(lazy.cache.front());
+			}
+
+			String text;
+			text::Newline newline(ASCENSION_DEFAULT_NEWLINE);
+			lazy.source->readLine(line, text, newline);
+			assert(newline.isLiteral());
+			if(lazy.cache.size() < lazy.capacity)
+				lazy.cache.push_front(std::make_pair(line, std::shared_ptr<Line>(new Line(revisionNumber_, text, newline))));
+			else {
+				// evict the least recently used line. the line is recycled unless pinned by pinLine
+				std::shared_ptr<Line> fresh;
+				if(!std::get<1>(lazy.cache.back()).unique())
+					fresh.reset(new Line(revisionNumber_, text, newline));
+				lazy.cache.splice(std::begin(lazy.cache), lazy.cache, std::prev(std::end(lazy.cache)));
+				lazy.cachedLines.erase(std::get<0>(lazy.cache.front()));
+				std::get<0>(lazy.cache.front()) = line;
+				if(fresh.get() != nullptr)
+					std::get<1>(lazy.cache.front()).swap(fresh);	// the pinned line is left to the owners
+				else {
+					Line& recycled = *std::get<1>(lazy.cache.front());
+					recycled.assign(text);
+					recycled.newline_ = newline;
+				}
+			}
+			try {
+				lazy.cachedLines.insert(std::make_pair(line, std::begin(lazy.cache)));
+			} catch(...) {
+				lazy.cache.pop_front();
+				throw;
+			}
+			return std::get<1>(lazy.cache.front());
 		}
 
 		/**
@@ -378,17 +545,10 @@ namespace ascension {
 				throw BadPositionException(Position::bol(line));
 		
 			const text::Newline resolvedNewline(resolveNewline(*this, newline));
-			Index offset = 0, eolLength = resolvedNewline.isLiteral() ? resolvedNewline.asString().length() : 0;
+			const Index eolLength = resolvedNewline.isLiteral() ? resolvedNewline.asString().length() : 0;
 			assert(eolLength != 0 || resolvedNewline == text::Newline::USE_INTRINSIC_VALUE);
-			for(Index i = 0; i < line; ++i) {
-				const Line& ln = *lines_[i];
-				offset += ln.text_.length();
-				if(newline == text::Newline::USE_INTRINSIC_VALUE)
-					offset += ln.newline_.asString().length();
-				else
-					offset += eolLength;
-			}
-			return offset;
+			const LineLength preceding(lineIndex().prefixSum(line));
+			return preceding.text + ((eolLength != 0) ? line * eolLength : preceding.newline);
 		}
 #if 0
 		/**
@@ -413,6 +573,269 @@ namespace ascension {
 			return true;
 		}
 #endif
+		/**
+		 * Replaces the entire content of the document with the given text without copying it.
+		 * @param content The text to load. The newlines in this text are recognized as the line breaks
+		 * @throw NullPointerException @a content is @c null
+		 * @throw ... Any exceptions the other overload throws
+		 */
+		void Document::loadContent(std::shared_ptr<const String> content) {
+			if(content.get() == nullptr)
+				throw NullPointerException("content");
+			return loadContent(std::vector<std::shared_ptr<const String>>(1, content));
+		}
+
+		/**
+		 * Replaces the entire content of the document with the concatenation of the given batches of text
+		 * without copying them.
+		 *
+		 * The lines of the document refer to @a batches directly, and each line copies its text only when it is
+		 * changed or @c Line#text is called. So loading a large text costs only the allocations of @c Line objects,
+		 * and the lines not touched never allocate their own strings. Only the lines straddle the boundaries of
+		 * the batches are copied at loading. A newline also can straddle (CR at the end of a batch and LF at the
+		 * beginning of the next). The batches are shared by the document until the content is reset or loaded
+		 * again.
+		 *
+		 * Unlike @c #replace, this method does not record the change for undo, and clears the undo/redo history.
+		 * The narrowing is revoked. The listeners are notified once as a replacement of the entire document,
+		 * regardless of the number of the batches.
+		 * @param batches The text to load. The newlines in this text are recognized as the line breaks
+		 * @throw NullPointerException An element of @a batches is @c null
+		 * @throw ReadOnlyDocumentException The document is read only
+		 * @throw IllegalStateException The method was called in @c DocumentListener's notification
+		 * @throw std#bad_alloc The internal memory allocation failed
+		 * @note This method does not call @c DocumentInput#isChangeable for rejection.
+		 * @see #replace, #resetContent, fileio#TextFileDocumentInput#revert
+		 */
+		void Document::loadContent(const std::vector<std::shared_ptr<const String>>& batches) {
+			if(boost::find(batches, std::shared_ptr<const String>()) != boost::end(batches))
+				throw NullPointerException("batches");
+			else if(changing_)
+				throw IllegalStateException("called in DocumentListeners' notification.");
+			else if(isReadOnly())
+				throw ReadOnlyDocumentException();
+
+			// build the new lines refer to the batches
+			LineList newLines;
+			ascension::detail::FenwickTree<LineLength> newLineIndex;
+			try {
+				String carried;		// the beginning of the current line in the preceding batches
+				StringPiece rest;	// the end of the current line in the last batch
+				bool lineFeedContinues = false;	// the last batch ended with CR and the next begins with LF
+				for(auto batch(std::begin(batches)), e(std::end(batches)); batch != e; ++batch) {
+					const StringPiece text(**batch);
+					StringPiece::const_iterator p(text.cbegin());
+					if(p == text.cend())
+						continue;
+					else if(lineFeedContinues) {
+						assert(*p == text::LINE_FEED);
+						++p;
+						lineFeedContinues = false;
+					}
+					carried.append(rest.cbegin(), rest.cend());
+					rest = StringPiece();
+					while(true) {
+						const StringPiece::const_iterator nextNewline(text::findNewline(p, text.cend()));
+						if(nextNewline == text.cend()) {
+							rest = makeStringPiece(p, nextNewline);
+							break;
+						}
+						text::Newline newline(*text::eatNewline(nextNewline, text.cend()));
+						const StringPiece::const_iterator nextLine(std::next(nextNewline, newline.asString().length()));
+						if(newline == text::Newline::CARRIAGE_RETURN && nextLine == text.cend()) {
+							const auto nextBatch(std::find_if(std::next(batch), e, [](const std::shared_ptr<const String>& b) {
+								return !b->empty();
+							}));
+							if(nextBatch != e && (*nextBatch)->front() == text::LINE_FEED) {
+								newline = text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED;
+								lineFeedContinues = true;
+							}
+						}
+						if(carried.empty())
+							newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1, makeStringPiece(p, nextNewline), newline));
+						else {
+							carried.append(p, nextNewline);
+							newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1, carried, newline));
+							carried.clear();
+						}
+						p = nextLine;
+					}
+				}
+				if(!carried.empty()) {
+					carried.append(rest.cbegin(), rest.cend());
+					newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1, carried));
+				} else if(!rest.empty())
+					newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1, rest, ASCENSION_DEFAULT_NEWLINE));
+				else
+					newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1));
+				const auto lineLength([](const Line* line) {return LineLength(*line);});
+				newLineIndex.assign(
+					boost::make_transform_iterator(std::begin(newLines), lineLength),
+					boost::make_transform_iterator(std::end(newLines), lineLength));
+			} catch(...) {
+				for(std::size_t i = 0, c = newLines.size(); i < c; ++i)
+					delete newLines[i];
+				throw;
+			}
+
+			// replace the content. these can't throw
+			widen();
+			ascension::detail::ValueSaver<bool> writeLock(changing_);
+			changing_ = true;
+			const Region erasedRegion(region());
+			const Region insertedRegion(Position::zero(), Position(newLines.size() - 1, newLines[newLines.size() - 1]->length()));
+			fireDocumentAboutToBeChanged(DocumentChange(erasedRegion, insertedRegion));
+			for(std::size_t i = 0, c = lines_.size(); i < c; ++i)
+				delete lines_[i];
+			std::swap(lines_, newLines);
+			std::swap(lineIndex_, newLineIndex);
+			originalContents_ = batches;
+			const bool modified = isModified();
+			++revisionNumber_;
+			clearUndoBuffer();
+			fireDocumentChanged(DocumentChange(erasedRegion, insertedRegion));
+			if(!modified)
+				modificationSignChangedSignal_(*this);
+		}
+
+		/**
+		 * Replaces the entire content of the document with the given lines without copying them. This is same as
+		 * the above overload, but the caller has already split the text into the lines. So this method does not
+		 * scan the text for the newlines, and no line is copied at loading even if it straddles the batches.
+		 * @c fileio#TextFileDocumentInput uses this to load the text which was split while decoding.
+		 * @param batches The text the lines refer to. The document shares these until the content is reset or
+		 *                loaded again
+		 * @param lines The lines. Each line must refer to the text in @a batches, otherwise the behavior is
+		 *              undefined. The newline of the last line is ignored
+		 * @throw NullPointerException An element of @a batches is @c null
+		 * @throw std#invalid_argument @a lines is empty
+		 * @throw ReadOnlyDocumentException The document is read only
+		 * @throw IllegalStateException The method was called in @c DocumentListener's notification
+		 * @throw std#bad_alloc The internal memory allocation failed
+		 * @note This method does not call @c DocumentInput#isChangeable for rejection.
+		 * @see encoding#Encoder#UnicodeSink
+		 */
+		void Document::loadContent(const std::vector<std::shared_ptr<const String>>& batches, const std::vector<DocumentContentLine>& lines) {
+			if(boost::find(batches, std::shared_ptr<const String>()) != boost::end(batches))
+				throw NullPointerException("batches");
+			else if(lines.empty())
+				throw std::invalid_argument("lines");
+			else if(changing_)
+				throw IllegalStateException("called in DocumentListeners' notification.");
+			else if(isReadOnly())
+				throw ReadOnlyDocumentException();
+
+			// build the new lines refer to the batches
+			LineList newLines;
+			ascension::detail::FenwickTree<LineLength> newLineIndex;
+			try {
+				newLines.reserve(lines.size());
+				for(std::size_t i = 0, c = lines.size() - 1; i < c; ++i)
+					newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1, lines[i].text, lines[i].newline));
+				if(!lines.back().text.empty())
+					newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1, lines.back().text, ASCENSION_DEFAULT_NEWLINE));
+				else
+					newLines.insert(std::end(newLines), new Line(revisionNumber_ + 1));
+				const auto lineLength([](const Line* line) {return LineLength(*line);});
+				newLineIndex.assign(
+					boost::make_transform_iterator(std::begin(newLines), lineLength),
+					boost::make_transform_iterator(std::end(newLines), lineLength));
+			} catch(...) {
+				for(std::size_t i = 0, c = newLines.size(); i < c; ++i)
+					delete newLines[i];
+				throw;
+			}
+
+			// replace the content. these can't throw
+			widen();
+			ascension::detail::ValueSaver<bool> writeLock(changing_);
+			changing_ = true;
+			const Region erasedRegion(region());
+			const Region insertedRegion(Position::zero(), Position(newLines.size() - 1, newLines[newLines.size() - 1]->length()));
+			fireDocumentAboutToBeChanged(DocumentChange(erasedRegion, insertedRegion));
+			for(std::size_t i = 0, c = lines_.size(); i < c; ++i)
+				delete lines_[i];
+			std::swap(lines_, newLines);
+			std::swap(lineIndex_, newLineIndex);
+			originalContents_ = batches;
+			const bool modified = isModified();
+			++revisionNumber_;
+			clearUndoBuffer();
+			fireDocumentChanged(DocumentChange(erasedRegion, insertedRegion));
+			if(!modified)
+				modificationSignChangedSignal_(*this);
+		}
+
+		/**
+		 * Replaces the entire content of the document with the lines supplied by the given source, and enters
+		 * lazy mode.
+		 *
+		 * In lazy mode, the document does not hold all the lines. A line is read through @a source when
+		 * @c #lineContent or @c #lineString is called for it, and is kept in a cache of the most recently used
+		 * lines. So the memory usage and the time to load scale with the lines actually accessed, not with the
+		 * size of the content. This is intended to view huge files such as logs. Note the following:
+		 * - The document is read only while in lazy mode. @c #setReadOnly can't make it writable. Call
+		 *   @c #resetContent to leave lazy mode.
+		 * - A reference returned by @c #lineContent is invalidated when the line is evicted
+		 *   from the cache, that is, after @a numberOfCachedLines other lines were accessed. Use @c #pinLine to
+		 *   keep a line while the other lines are read.
+		 * - @c #length, @c #lineAt and @c #lineOffset read all the lines once at the first call, to build the
+		 *   index of the line lengths.
+		 *
+		 * Like the other overloads, this method does not record the change for undo, clears the undo/redo history
+		 * and revokes the narrowing. The listeners are notified once as a replacement of the entire document.
+		 * @param source The source of the lines
+		 * @param numberOfCachedLines The maximum number of the lines to cache
+		 * @throw NullPointerException @a source is @c null
+		 * @throw std#invalid_argument @a numberOfCachedLines is zero
+		 * @throw ReadOnlyDocumentException The document is read only
+		 * @throw IllegalStateException The method was called in @c DocumentListener's notification
+		 * @throw ... Any exceptions @c DocumentLineSource#readLine throws
+		 * @note This method does not call @c DocumentInput#isChangeable for rejection.
+		 * @see #isLazy, fileio#TextFileDocumentInput#revertLazily
+		 */
+		void Document::loadContent(std::shared_ptr<const DocumentLineSource> source, std::size_t numberOfCachedLines) {
+			if(source.get() == nullptr)
+				throw NullPointerException("source");
+			else if(numberOfCachedLines == 0)
+				throw std::invalid_argument("numberOfCachedLines");
+			else if(changing_)
+				throw IllegalStateException("called in DocumentListeners' notification.");
+			else if(isReadOnly())
+				throw ReadOnlyDocumentException();
+
+			std::unique_ptr<LazyLines> newLazyLines(new LazyLines);
+			newLazyLines->capacity = numberOfCachedLines;
+			newLazyLines->cachedLines.reserve(numberOfCachedLines);
+			const Index lastLine = source->numberOfLines() - 1;
+			String lastLineText;
+			text::Newline lastNewline;
+			source->readLine(lastLine, lastLineText, lastNewline);
+			newLazyLines->source = std::move(source);
+			newLazyLines->lastLineLength = lastLineText.length();
+
+			// replace the content. these can't throw
+			widen();
+			ascension::detail::ValueSaver<bool> writeLock(changing_);
+			changing_ = true;
+			const Region erasedRegion(region());
+			const Region insertedRegion(Position::zero(), Position(lastLine, lastLineText.length()));
+			fireDocumentAboutToBeChanged(DocumentChange(erasedRegion, insertedRegion));
+			for(std::size_t i = 0, c = lines_.size(); i < c; ++i)
+				delete lines_[i];
+			lines_.clear();
+			lineIndex_.clear();
+			originalContents_.clear();
+			lazyLines_ = std::move(newLazyLines);
+			const bool modified = isModified();
+			++revisionNumber_;
+			clearUndoBuffer();
+			fireDocumentChanged(DocumentChange(erasedRegion, insertedRegion));
+			if(!modified)
+				modificationSignChangedSignal_(*this);
+			setReadOnly(true);
+		}
+
 		/**
 		 * Marks the document unmodified at the current revision.
 		 * For details about modification signature, see the documentation of @c Document class.
@@ -430,6 +853,12 @@ namespace ascension {
 			return makeSignalConnector(modificationSignChangedSignal_);
 		}
 
+		/// @see detail#PointCollection#movePoint
+		void Document::movePoint(AbstractPoint& point, Index line) {
+			points_[line].push_back(&point);
+			erasePoint(points_, point.line_, point);
+		}
+
 		/**
 		 * Narrows the accessible area to the specified region.
 		 * If the document is already narrowed, the accessible region will just change to @a region. In this case,
@@ -456,6 +885,24 @@ namespace ascension {
 			accessibleRegionChangedSignal_(*this);
 		}
 
+		/**
+		 * Returns the content of the specified line, which is kept while the returned pointer is alive. In lazy
+		 * mode (see @c #loadContent), unlike the reference @c #lineContent returns, the line is not invalidated
+		 * by the eviction from the cache. Otherwise this is same as @c #lineContent, and the pointer does not own
+		 * the line.
+		 * @param line The line
+		 * @return The content of @a line
+		 * @throw BadPostionException @a line is outside of the document
+		 * @throw ... Any exceptions @c DocumentLineSource#readLine throws in lazy mode
+		 */
+		std::shared_ptr<const Document::Line> Document::pinLine(Index line) const {
+			if(line >= numberOfLines())
+				throw BadPositionException(Position::bol(line));
+			else if(!isLazy())
+				return std::shared_ptr<const Line>(std::shared_ptr<const Line>(), lines_[line]);
+			return lazyLine(line);
+		}
+
 		/// Returns the @c PropertyChangedSignal signal connector.
 		SignalConnector<Document::PropertyChangedSignal> Document::propertyChangedSignal() BOOST_NOEXCEPT {
 			return makeSignalConnector(propertyChangedSignal_);
@@ -487,6 +934,13 @@ namespace ascension {
 			partitioningListeners_.remove(listener);
 		}
 
+		/// @see detail#PointCollection#removePoint
+		void Document::removePoint(AbstractPoint& point) {
+			erasePoint(points_, point.line_, point);
+			--numberOfPoints_;
+			std::replace(std::begin(pointsToUpdate_), std::end(pointsToUpdate_), &point, static_cast<AbstractPoint*>(nullptr));
+		}
+
 		/**
 		 * Removes the pre-notified document listener from the document.
 		 * @internal This method is not for public use.
@@ -523,25 +977,32 @@ namespace ascension {
 		 * @see #doResetContent
 		 */
 		void Document::resetContent() {
-			if(lines_.empty())	// called by constructor
+			if(lines_.empty() && !isLazy()) {	// called by constructor
 				lines_.insert(std::begin(lines_), new Line(0));
-			else {
+				lineIndex_.insert(0, LineLength(*lines_[0]));
+			} else {
 				widen();
-				BOOST_FOREACH(AbstractPoint* p, points_) {
-					if(p->adaptationLevel() != boost::none)
-						p->contentReset();
+				collectPointsToUpdate(0);	// the points move while the iteration
+				for(std::size_t i = 0; i < pointsToUpdate_.size(); ++i) {
+					if(AbstractPoint* const p = pointsToUpdate_[i]) {
+						if(p->adaptationLevel() != boost::none)
+							p->contentReset();
+					}
 				}
 				bookmarker_->clear();
 
 				const DocumentChange c(region(), Region::makeEmpty(*boost::const_begin(region())));
 				fireDocumentAboutToBeChanged(c, false);
-				if(length_ != 0) {
-					assert(!lines_.empty());
+				if(isLazy() || lines_.size() > 1 || lines_[0]->length() != 0) {
+					assert(isLazy() || !lines_.empty());
 					for(std::size_t i = 0, c = lines_.size(); i < c; ++i)
 						delete lines_[i];
 					lines_.clear();
+					lazyLines_.reset();
 					lines_.insert(std::begin(lines_), new Line(revisionNumber_ + 1));
-					length_ = 0;
+					lineIndex_.clear();
+					lineIndex_.insert(0, LineLength(*lines_[0]));
+					originalContents_.clear();
 					++revisionNumber_;
 				}
 				fireDocumentChanged(c, false);
@@ -601,11 +1062,11 @@ namespace ascension {
 		}
 
 		/**
-		 * Makes the document read only or not.
-		 * @see ReadOnlyDocumentException, #isReadOnly, #ReadOnlySignChangedSignal
+		 * Makes the document read only or not. The document in lazy mode can't be made writable.
+		 * @see ReadOnlyDocumentException, #isLazy, #isReadOnly, #ReadOnlySignChangedSignal
 		 */
 		void Document::setReadOnly(bool readOnly /* = true */) BOOST_NOEXCEPT {
-			if(readOnly != isReadOnly()) {
+			if(readOnly != isReadOnly() && (readOnly || !isLazy())) {
 				readOnly_ = readOnly;
 				readOnlySignChangedSignal_(*this);
 			}
@@ -641,6 +1102,28 @@ namespace ascension {
 			}
 		}
 
+		/**
+		 * @internal Synchronizes @c #lineIndex_ with @c #lines_ after the lines were replaced.
+		 * @param firstLine The first line replaced
+		 * @param numberOfErasedLines The number of the lines previously in the place
+		 * @param numberOfInsertedLines The number of the lines now in the place
+		 * @throw std#bad_alloc This does not throw if @c #lineIndex_ reserved the storage for the lines
+		 */
+		void Document::updateLineIndex(Index firstLine, Index numberOfErasedLines, Index numberOfInsertedLines) {
+			const Index n = std::min(numberOfErasedLines, numberOfInsertedLines);
+			for(Index i = firstLine; i < firstLine + n; ++i)
+				lineIndex_.set(i, LineLength(*lines_[i]));
+			if(numberOfErasedLines > n)
+				lineIndex_.erase(firstLine + n, firstLine + numberOfErasedLines);
+			else if(numberOfInsertedLines > n) {
+				const auto lineLength([](const Line* line) {return LineLength(*line);});
+				const auto first(std::next(std::begin(lines_), firstLine + n));
+				lineIndex_.insert(firstLine + n,
+					boost::make_transform_iterator(first, lineLength),
+					boost::make_transform_iterator(std::next(first, numberOfInsertedLines - n), lineLength));
+			}
+		}
+
 
 		// Document.Line //////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -648,7 +1131,95 @@ namespace ascension {
 		}
 
 		Document::Line::Line(std::size_t revisionNumber, const String& text,
-				const text::Newline& newline /* = ASCENSION_DEFAULT_NEWLINE */) : text_(text), newline_(newline), revisionNumber_(revisionNumber) {
+				const text::Newline& newline /* = ASCENSION_DEFAULT_NEWLINE */) : newline_(newline), revisionNumber_(revisionNumber) {
+			if(!isLatin1Only(text))
+				text_ = text;
+			else if(!text.empty()) {
+				std::string latin1(text.length(), '\0');
+				narrow(text, &latin1[0]);
+				text_ = std::move(latin1);
+			}
+		}
+
+		Document::Line::Line(std::size_t revisionNumber, const StringPiece& original,
+				const text::Newline& newline) BOOST_NOEXCEPT : original_(original), newline_(newline), revisionNumber_(revisionNumber) {
+			assert(original_.cbegin() != nullptr);
+		}
+
+		/**
+		 * Appends the part of the text of the line to the given string, without materializing or widening the line.
+		 * @param[out] out The string to append to
+		 * @param first The beginning of the part
+		 * @param last The end of the part
+		 * @throw std#bad_alloc
+		 */
+		void Document::Line::appendText(String& out, Index first, Index last) const {
+			assert(first <= last && last <= length());
+			if(const std::string* const latin1 = boost::get<std::string>(&text_)) {
+				const Index n = out.length();
+				out.resize(n + last - first);
+				for(Index i = first; i < last; ++i)
+					out[n + i - first] = static_cast<Byte>((*latin1)[i]);
+			} else
+				out.append(textPiece().data() + first, last - first);
+		}
+
+		/// Replaces the text of the line with @a text, which is swapped and becomes empty.
+		void Document::Line::assign(String& text) BOOST_NOEXCEPT {
+			original_ = StringPiece();
+			text_ = String();
+			boost::get<String>(text_).swap(text);
+			compact();
+		}
+
+		/// Stores the text of the line in one byte per character if possible. This does nothing if failed.
+		void Document::Line::compact() BOOST_NOEXCEPT {
+			const String* const wide = boost::get<String>(&text_);
+			if(original_.cbegin() != nullptr || wide == nullptr || wide->empty() || !isLatin1Only(*wide))
+				return;
+			std::string latin1;
+			try {
+				latin1.resize(wide->length());
+			} catch(const std::bad_alloc&) {
+				return;
+			}
+			narrow(*wide, &latin1[0]);
+			text_ = std::move(latin1);	// releases the wide text
+		}
+
+		/**
+		 * Replaces the part of the text of the line. If both the line and @a text can be stored in one byte per
+		 * character, this edits the narrow text directly. Otherwise the line is widened, and is narrowed again if
+		 * possible.
+		 * @param first The beginning of the part to replace
+		 * @param last The end of the part to replace
+		 * @param text The text to insert
+		 * @throw std#bad_alloc
+		 */
+		void Document::Line::replace(Index first, Index last, const StringPiece& text) {
+			assert(first <= last && last <= length());
+			const bool textIsLatin1 = isLatin1Only(text);
+			if(textIsLatin1 && original_.cbegin() == nullptr && length() == 0 && !isLatin1())
+				text_ = std::string();
+			if(std::string* const latin1 = textIsLatin1 ? boost::get<std::string>(&text_) : nullptr) {
+				latin1->replace(first, last - first, text.length(), '\0');
+				if(!text.empty())
+					narrow(text, &(*latin1)[first]);
+				return;
+			}
+			const bool mayBeLatin1 = textIsLatin1 && !isLatin1()
+				&& (original_.cbegin() != nullptr || !isLatin1Only(StringPiece(boost::get<String>(text_)).substr(first, last - first)));	// erasing the wide characters
+			mutableText().replace(first, last - first, text.cbegin(), text.length());
+			if(mayBeLatin1)
+				compact();
+		}
+
+
+		// Document.LineLength ////////////////////////////////////////////////////////////////////////////////////////
+
+		Document::LineLength::LineLength(const Line& line) BOOST_NOEXCEPT : text(line.length()),
+				newline((line.newline() != text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED) ? 1 : 2) {
+			assert(line.newline().isLiteral());
 		}
 
 
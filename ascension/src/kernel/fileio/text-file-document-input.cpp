@@ -6,17 +6,40 @@
  * @date 2016-09-21 Separated from fileio.cpp.
  */
 
+#include <ascension/corelib/detail/sequence-diff.hpp>
 #include <ascension/corelib/encoding/encoder-factory.hpp>
+#include <ascension/kernel/document-snapshot.hpp>
 #include <ascension/kernel/fileio/text-file-document-input.hpp>
 #include <ascension/kernel/fileio/text-file-stream-buffer.hpp>
 #include <boost/core/null_deleter.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>	// boost.hash_combine
+#include <boost/optional.hpp>
 #include <boost/range/algorithm/copy.hpp>
+#include <boost/range/numeric.hpp>	// boost.accumulate
+#include <algorithm>	// std.max
+#include <array>
+#include <atomic>
+#include <chrono>		// std.chrono.seconds
+#include <cstdint>
+#include <cstring>		// std.memchr, std.memcmp
+#include <future>		// std.async
+#include <limits>		// std.numeric_limits
+#include <map>
+#include <mutex>
+#include <sstream>		// std.basic_ostringstream
+#include <thread>		// std.thread.hardware_concurrency
 #if ASCENSION_OS_POSIX
 #	include <cstdio>		// std.tempnam
 #	include <fcntl.h>		// fcntl
 #	include <unistd.h>		// fcntl
 #endif // !ASCENSION_OS_POSIX
+#if BOOST_OS_LINUX
+#	include <poll.h>		// poll
+#	include <sys/inotify.h>
+#endif
 #if BOOST_OS_WINDOWS
 #	include <ascension/win32/windows.hpp>
 #	include <cwctype>
@@ -54,6 +77,673 @@ namespace ascension {
 					throw makePlatformError();
 				}
 
+				/// The decoded text split into the lines, built by @c LineBuilder.
+				struct DecodedLines {
+					std::vector<std::shared_ptr<const String>> batches;	// the text
+					std::vector<DocumentContentLine> lines;	// refer to the batches. not empty
+				};
+
+				/**
+				 * @c encoding#Encoder#UnicodeSink which builds the batches and the lines for
+				 * @c Document#loadContent. The encoder writes the characters directly into the batches, and the
+				 * newlines are searched in each piece just after it was decoded, while the piece is still in the
+				 * cache. A line never straddles the batches, because the unfinished line is moved to the next batch
+				 * when a batch becomes full. So the text is not copied after the decoding, except such lines.
+				 */
+				class LineBuilder : public encoding::Encoder::UnicodeSink {
+				public:
+					LineBuilder(std::size_t expectedLength, std::size_t expectedNumberOfLines);
+					DecodedLines finish();
+					// encoding.Encoder.UnicodeSink
+					boost::iterator_range<Char*> buffer(std::size_t minimumLength) override;
+					void commit(const boost::iterator_range<const Char*>& written) override;
+				private:
+					void retireBatch();
+					static const std::size_t MINIMUM_BATCH_LENGTH = 0x100000;
+					static const std::size_t WINDOW_LENGTH = 0x4000;	// the characters passed to the encoder at once
+					const std::size_t expectedLength_;
+					DecodedLines result_;
+					std::shared_ptr<String> batch_;	// the last batch, not in result_.batches yet
+					std::size_t length_;	// the length of the decoded text in batch_
+					std::size_t lineStart_;	// the beginning of the unfinished line in batch_
+					std::size_t scanned_;	// the end of the text in batch_ searched for the newlines
+					std::size_t firstLineInBatch_;	// the first line in result_.lines refers to batch_
+				};
+
+				const std::size_t LineBuilder::MINIMUM_BATCH_LENGTH;
+				const std::size_t LineBuilder::WINDOW_LENGTH;
+
+				/**
+				 * Constructor.
+				 * @param expectedLength The expected length of the entire text. The first batch is allocated in this
+				 *                       length, so the text usually fits in one batch
+				 * @param expectedNumberOfLines The expected number of the lines
+				 * @throw std#bad_alloc
+				 */
+				LineBuilder::LineBuilder(std::size_t expectedLength, std::size_t expectedNumberOfLines) : expectedLength_(expectedLength),
+						length_(0), lineStart_(0), scanned_(0), firstLineInBatch_(0) {
+					result_.lines.reserve(expectedNumberOfLines);
+				}
+
+				/// @see encoding#Encoder#UnicodeSink#buffer
+				boost::iterator_range<Char*> LineBuilder::buffer(std::size_t minimumLength) {
+					if(batch_.get() == nullptr || batch_->length() - length_ < minimumLength) {
+						const std::size_t pending = length_ - lineStart_;
+						const std::shared_ptr<String> newBatch(std::make_shared<String>((batch_.get() == nullptr) ?
+							expectedLength_ + minimumLength : std::max(MINIMUM_BATCH_LENGTH, (pending + minimumLength) * 2), Char()));
+						if(pending != 0)
+							std::copy(batch_->data() + lineStart_, batch_->data() + length_, &(*newBatch)[0]);
+						if(batch_.get() != nullptr) {
+							batch_->resize(lineStart_);	// does not reallocate, so the lines are still valid
+							retireBatch();
+						}
+						batch_ = newBatch;
+						scanned_ -= lineStart_;
+						length_ = pending;
+						lineStart_ = 0;
+						firstLineInBatch_ = result_.lines.size();
+					}
+					Char* const first = &(*batch_)[0] + length_;
+					return boost::make_iterator_range(first, first + std::min(batch_->length() - length_, std::max(minimumLength, WINDOW_LENGTH)));
+				}
+
+				/// @see encoding#Encoder#UnicodeSink#commit
+				void LineBuilder::commit(const boost::iterator_range<const Char*>& written) {
+					assert(boost::const_begin(written) == batch_->data() + length_);
+					length_ += boost::size(written);
+					const Char* const first = batch_->data();
+					const Char* const last = first + length_;
+					for(const Char* p = first + scanned_; ; ) {
+						const Char* const eol = text::findNewline(p, last);
+						if(eol == last || (*eol == text::CARRIAGE_RETURN && std::next(eol) == last)) {
+							scanned_ = eol - first;	// CRLF may straddle the pieces
+							break;
+						}
+						const DocumentContentLine line = {
+							StringPiece(first + lineStart_, eol - (first + lineStart_)), boost::get(text::eatNewline(eol, last))};
+						result_.lines.push_back(line);
+						p = eol + ((line.newline == text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED) ? 2 : 1);
+						lineStart_ = p - first;
+					}
+				}
+
+				/**
+				 * Finishes the building. The object can't be used after this call.
+				 * @return The batches and the lines. The last line has no newline
+				 */
+				DecodedLines LineBuilder::finish() {
+					if(batch_.get() != nullptr) {
+						if(scanned_ < length_) {	// CR at the end
+							const DocumentContentLine line = {
+								StringPiece(batch_->data() + lineStart_, scanned_ - lineStart_), text::Newline::CARRIAGE_RETURN};
+							result_.lines.push_back(line);
+							lineStart_ = length_;
+						}
+						const DocumentContentLine lastLine = {StringPiece(batch_->data() + lineStart_, length_ - lineStart_), text::Newline()};
+						result_.lines.push_back(lastLine);
+						batch_->resize(length_);
+						retireBatch();
+					} else {
+						const DocumentContentLine lastLine = {StringPiece(), text::Newline()};
+						result_.lines.push_back(lastLine);
+					}
+					return std::move(result_);
+				}
+
+				/// Moves @c #batch_ into the result. Shrinks the batch if more than half of it is not used.
+				void LineBuilder::retireBatch() {
+					if(batch_->empty())
+						return;
+					else if(batch_->capacity() / 2 > batch_->length()) {
+						// the lines refer to the old storage are moved to the new one
+						const std::shared_ptr<String> shrunk(std::make_shared<String>(*batch_));
+						for(std::size_t i = firstLineInBatch_, c = result_.lines.size(); i < c; ++i) {
+							StringPiece& text = result_.lines[i].text;
+							text = StringPiece(shrunk->data() + (text.data() - batch_->data()), text.length());
+						}
+						batch_ = shrunk;
+					}
+					result_.batches.push_back(batch_);
+				}
+
+				/**
+				 * Decodes the given bytes into the batches and the lines by @c LineBuilder. The bytes should not end
+				 * in the middle of a character, except at the end of the file. Such truncated bytes are ignored as
+				 * @c TextFileStreamBuffer does.
+				 * @param encoder The encoder
+				 * @param state The conversion state
+				 * @param bytes The bytes to decode
+				 * @param[out] decodedEnd If not @c null, receives the end of the decoded bytes. If an exception is
+				 *                        thrown, this addresses the character could not be decoded
+				 * @return The batches and the lines
+				 * @throw UnmappableCharacterException
+				 * @throw text#MalformedInputException
+				 */
+				DecodedLines decodeLines(encoding::Encoder& encoder, encoding::Encoder::State& state,
+						const boost::iterator_range<const Byte*>& bytes, const Byte** decodedEnd = nullptr) {
+					static const std::size_t SAMPLE_BYTES = 0x10000;
+					const std::size_t n = boost::size(bytes);
+					std::size_t expectedLength = n, expectedNumberOfLines = 1;
+					if(n > 0) {
+						// decode the beginning to estimate the length and the number of the lines of the entire text
+						std::vector<Char> sample(std::min(n, SAMPLE_BYTES) * encoder.properties().maximumUCSLength());
+						encoding::Encoder::State sampleState(state);
+						Char* toNext;
+						const Byte* fromNext;
+						encoder.toUnicode(sampleState, boost::make_iterator_range(sample.data(), sample.data() + sample.size()), toNext,
+							boost::make_iterator_range(boost::const_begin(bytes), boost::const_begin(bytes) + std::min(n, SAMPLE_BYTES)), fromNext);
+						if(const std::size_t sampleBytes = fromNext - boost::const_begin(bytes)) {
+							std::vector<const Char*> newlines;
+							text::findNewlines(sample.data(), toNext, newlines);
+							const double scale = static_cast<double>(n) / sampleBytes * 1.0625;	// with some margin
+							expectedLength = static_cast<std::size_t>((toNext - sample.data()) * scale) + 16;
+							expectedNumberOfLines = static_cast<std::size_t>(newlines.size() * scale) + 1;
+						}
+					}
+
+					LineBuilder builder(expectedLength, expectedNumberOfLines);
+					const Byte* fromNext = boost::const_begin(bytes);
+					if(!bytes.empty()) {
+						const auto result = encoder.toUnicode(state, builder, bytes, fromNext);
+						if(decodedEnd != nullptr)
+							*decodedEnd = fromNext;
+						if(result == encoding::Encoder::UNMAPPABLE_CHARACTER)
+							throw UnmappableCharacterException();
+						else if(result == encoding::Encoder::MALFORMED_INPUT)
+							throw text::MalformedInputException<Byte>(*fromNext);
+					} else if(decodedEnd != nullptr)
+						*decodedEnd = fromNext;
+					return builder.finish();
+				}
+
+				/**
+				 * Decodes the given bytes into a batch of text. The bytes should not end in the middle of a character,
+				 * except at the end of the file. Such truncated bytes are ignored as @c TextFileStreamBuffer does.
+				 * @param encoder The encoder
+				 * @param state The conversion state
+				 * @param bytes The bytes to decode
+				 * @param[out] decodedEnd If not @c null, receives the end of the decoded bytes. If an exception is
+				 *                        thrown, this addresses the character could not be decoded
+				 * @return The batch
+				 * @throw UnmappableCharacterException
+				 * @throw text#MalformedInputException
+				 */
+				std::shared_ptr<const String> decodeChunk(encoding::Encoder& encoder, encoding::Encoder::State& state,
+						const boost::iterator_range<const Byte*>& bytes, const Byte** decodedEnd = nullptr) {
+					if(decodedEnd != nullptr)
+						*decodedEnd = boost::const_begin(bytes);
+					if(bytes.empty())
+						return std::make_shared<const String>();
+					const std::shared_ptr<String> batch(std::make_shared<String>(
+						boost::size(bytes) * encoder.properties().maximumUCSLength(), Char()));
+					String::size_type length = 0;
+					for(const Byte* fromNext = boost::const_begin(bytes); ; ) {
+						Char* const to = &(*batch)[0];
+						Char* toNext;
+						const auto result = encoder.toUnicode(state,
+							boost::make_iterator_range(to + length, to + batch->length()), toNext,
+							boost::make_iterator_range(fromNext, boost::const_end(bytes)), fromNext);
+						length = toNext - to;
+						if(decodedEnd != nullptr)
+							*decodedEnd = fromNext;
+						if(result == encoding::Encoder::UNMAPPABLE_CHARACTER)
+							throw UnmappableCharacterException();
+						else if(result == encoding::Encoder::MALFORMED_INPUT)
+							throw text::MalformedInputException<Byte>(*fromNext);
+						else if(result != encoding::Encoder::INSUFFICIENT_BUFFER)
+							break;
+						batch->resize(batch->length() * 2);
+					}
+					batch->resize(length);
+					if(batch->capacity() / 2 > batch->length())
+						batch->shrink_to_fit();
+					return batch;
+				}
+
+				/**
+				 * Decodes the bytes of a file which may be being written by the other process. Some encoders report
+				 * the character truncated at the end of the bytes as malformed input or an unmappable character,
+				 * instead of leaving it undecoded. If @a decode throws for the bytes at the end shorter than
+				 * @c EncodingProperties#maximumNativeBytes, they are assumed to be such a character, and only the
+				 * bytes before them are decoded. A bad character at the end is also left undecoded in this way.
+				 * @tparam Result The return type of @a decode
+				 * @param encoder The encoder
+				 * @param state The conversion state
+				 * @param bytes The bytes to decode
+				 * @param[out] decodedEnd Receives the end of the decoded bytes
+				 * @param decode The decoding function, @c decodeLines or @c decodeChunk
+				 * @return The result of @a decode
+				 * @throw ... Any exceptions @a decode throws
+				 */
+				template<typename Result>
+				Result decodeCompleteCharacters(encoding::Encoder& encoder, encoding::Encoder::State& state,
+						const boost::iterator_range<const Byte*>& bytes, const Byte*& decodedEnd,
+						Result(*decode)(encoding::Encoder&, encoding::Encoder::State&, const boost::iterator_range<const Byte*>&, const Byte**)) {
+					const encoding::Encoder::State initialState(state);
+					const auto truncated = [&bytes, &decodedEnd, &encoder]() {
+						return static_cast<std::size_t>(boost::const_end(bytes) - decodedEnd) < encoder.properties().maximumNativeBytes();
+					};
+					try {
+						return (*decode)(encoder, state, bytes, &decodedEnd);
+					} catch(const UnmappableCharacterException&) {
+						if(!truncated())
+							throw;
+					} catch(const text::MalformedInputException<Byte>&) {
+						if(!truncated())
+							throw;
+					}
+					state = initialState;
+					return (*decode)(encoder, state, boost::make_iterator_range(boost::const_begin(bytes), decodedEnd), &decodedEnd);
+				}
+
+				/**
+				 * Splits the bytes into at most @a n chunks. Each chunk but the last one ends with @a newline, which is
+				 * searched only at the offsets aligned to the length of @a newline.
+				 * @param bytes The bytes to split
+				 * @param newline The encoded bytes of LF
+				 * @param n The maximum number of the chunks
+				 * @return The boundaries of the chunks, includes the both ends of @a bytes
+				 */
+				std::vector<const Byte*> splitAtNewlines(
+						const boost::iterator_range<const Byte*>& bytes, const std::string& newline, std::size_t n) {
+					assert(!newline.empty() && n > 0);
+					const Byte* const first = boost::const_begin(bytes);
+					const Byte* const last = boost::const_end(bytes);
+					const std::size_t unit = newline.length();
+					std::vector<const Byte*> boundaries(1, first);
+					for(std::size_t i = 1; i < n; ++i) {
+						const Byte* p = first + (boost::size(bytes) / n * i) / unit * unit;
+						if(p < boundaries.back())
+							p = boundaries.back();
+						if(unit == 1) {
+							p = static_cast<const Byte*>(std::memchr(p, static_cast<Byte>(newline[0]), last - p));
+							p = (p != nullptr) ? p + 1 : last;
+						} else {
+							for(; last - p >= static_cast<std::ptrdiff_t>(unit); p += unit) {
+								if(std::memcmp(p, newline.data(), unit) == 0)
+									break;
+							}
+							p = (last - p >= static_cast<std::ptrdiff_t>(unit)) ? p + unit : last;
+						}
+						if(p == last)
+							break;
+						boundaries.push_back(p);
+					}
+					boundaries.push_back(last);
+					return boundaries;
+				}
+
+				/**
+				 * Decodes the memory-mapped input of the stream buffer on the worker threads. The input is split at
+				 * LFs, each chunk is decoded into the lines by its own encoder, and the lines are returned in the
+				 * order of the input. This is done only if the encoding is resynchronizable and the input is large
+				 * enough.
+				 * @param sb The stream buffer open for reading
+				 * @param encodingSubstitutionPolicy The substitution policy used in encoding conversion
+				 * @return A pair of the lines and the boolean value means if the input contained Unicode byte order
+				 *         mark, or @c boost#none if the input should be decoded sequentially
+				 * @throw UnmappableCharacterException
+				 * @throw text#MalformedInputException
+				 * @see encoding#EncodingProperties#isResynchronizable
+				 */
+				boost::optional<std::pair<DecodedLines, bool>> readBatchesInParallel(
+						const TextFileStreamBuffer& sb, encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy) {
+					static const std::size_t MINIMUM_CHUNK_BYTES = 0x100000;
+					const boost::iterator_range<const Byte*>& input = sb.mappedInput();
+					const std::size_t numberOfChunks = std::min<std::size_t>(
+						std::max(std::thread::hardware_concurrency(), 1u), boost::size(input) / MINIMUM_CHUNK_BYTES);
+					if(numberOfChunks < 2)
+						return boost::none;
+					std::unique_ptr<encoding::Encoder> encoder(encoding::EncoderRegistry::instance().forName(sb.encoding()));
+					if(encoder.get() == nullptr || !encoder->properties().isResynchronizable())
+						return boost::none;
+					const std::string newline(encoder->fromUnicode(String(1, text::LINE_FEED)));
+					if(newline.empty())
+						return boost::none;
+
+					const std::vector<const Byte*> boundaries(splitAtNewlines(input, newline, numberOfChunks));
+					if(boundaries.size() < 3)
+						return boost::none;	// too few lines to split
+					std::vector<std::unique_ptr<encoding::Encoder>> encoders;
+					std::vector<encoding::Encoder::State> states(boundaries.size() - 1);
+					encoders.push_back(std::move(encoder));
+					for(std::size_t i = 1; i < states.size(); ++i) {
+						encoders.push_back(encoding::EncoderRegistry::instance().forName(sb.encoding()));
+						// consume the newline which precedes the chunk, then the chunk is not treated as the beginning
+						// of the file (which may start with the byte order mark)
+						std::array<Char, 2> ucs;
+						Char* toNext;
+						const Byte* fromNext;
+						encoders.back()->toUnicode(states[i], boost::make_iterator_range(ucs.data(), ucs.data() + ucs.size()), toNext,
+							boost::make_iterator_range(boundaries[i] - newline.length(), boundaries[i]), fromNext);
+					}
+					BOOST_FOREACH(const std::unique_ptr<encoding::Encoder>& e, encoders)
+						e->setSubstitutionPolicy(encodingSubstitutionPolicy);
+
+					// the first chunk is decoded by the calling thread
+					std::vector<std::future<DecodedLines>> workers;
+					for(std::size_t i = 1; i < states.size(); ++i) {
+						encoding::Encoder* const e = encoders[i].get();
+						encoding::Encoder::State* const state = &states[i];
+						const auto chunk(boost::make_iterator_range(boundaries[i], boundaries[i + 1]));
+						workers.push_back(std::async(std::launch::async, [e, state, chunk]() {
+							return decodeLines(*e, *state, chunk);
+						}));
+					}
+					DecodedLines decoded(decodeLines(*encoders.front(), states.front(), boost::make_iterator_range(boundaries[0], boundaries[1])));
+					BOOST_FOREACH(std::future<DecodedLines>& worker, workers) {
+						DecodedLines chunk(worker.get());	// rethrows the exception of the worker in the order of the input
+						// the preceding chunk ended with LF, so its last line is empty
+						assert(decoded.lines.back().text.empty());
+						decoded.lines.pop_back();
+						decoded.batches.insert(std::end(decoded.batches), std::begin(chunk.batches), std::end(chunk.batches));
+						decoded.lines.insert(std::end(decoded.lines), std::begin(chunk.lines), std::end(chunk.lines));
+					}
+					return std::make_pair(std::move(decoded), encoders.front()->isByteOrderMarkEncountered(states.front()));
+				}
+
+				/**
+				 * Reads the entire contents of the file into the lines. The memory-mapped input of the file is
+				 * decoded directly into the batches of the lines by @c decodeLines, and the stream buffer is used only
+				 * to open the file and to resolve the encoding. If the encoding is resynchronizable, the large file is
+				 * decoded on the worker threads by @c readBatchesInParallel.
+				 * @param fileName The file name
+				 * @param encoding The character encoding of the input file or auto detection name
+				 * @param encodingSubstitutionPolicy The substitution policy used in encoding conversion
+				 * @return A tuple consists of three values: (0) the lines of the read text, (1) the encoding used to
+				 *         convert and (2) the boolean value means if the input contained Unicode byte order mark
+				 * @throw UnmappableCharacterException
+				 * @throw text#MalformedInputException
+				 * @throw ... Any exceptions @c TextFileStreamBuffer#TextFileStreamBuffer throws
+				 * @see Document#loadContent
+				 */
+				std::tuple<DecodedLines, std::string, bool> readFileContents(
+						const boost::filesystem::path& fileName, const std::string& encoding,
+						encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy) {
+					TextFileStreamBuffer sb(fileName, std::ios_base::in, encoding, encodingSubstitutionPolicy, false);
+					if(auto decoded = readBatchesInParallel(sb, encodingSubstitutionPolicy)) {
+						auto result(std::make_tuple(std::move(decoded->first), sb.encoding(), decoded->second));
+						sb.close();
+						return result;
+					}
+					std::unique_ptr<encoding::Encoder> encoder(encoding::EncoderRegistry::instance().forName(sb.encoding()));
+					if(encoder.get() == nullptr)
+						throw encoding::UnsupportedEncodingException(sb.encoding());
+					encoder->setSubstitutionPolicy(encodingSubstitutionPolicy);
+					encoding::Encoder::State state;
+					DecodedLines decoded(decodeLines(*encoder, state, sb.mappedInput()));
+					auto result(std::make_tuple(std::move(decoded), sb.encoding(), encoder->isByteOrderMarkEncountered(state)));
+					sb.close();
+					return result;
+				}
+
+				/// Returns the hash value of the text of the line in the document. @a buffer is used to widen.
+				std::size_t hashLine(const Document::Line& line, String& buffer) {
+					std::size_t seed = 0;
+					if(line.isLatin1()) {
+						BOOST_FOREACH(char c, line.latin1Text())
+							boost::hash_combine(seed, static_cast<Char>(static_cast<unsigned char>(c)));
+					} else {
+						BOOST_FOREACH(Char c, line.textPiece(buffer))
+							boost::hash_combine(seed, c);
+					}
+					return seed;
+				}
+
+				/// Returns the hash value of the text of the line read from a file.
+				std::size_t hashLine(const DocumentContentLine& line) {
+					std::size_t seed = 0;
+					BOOST_FOREACH(Char c, line.text)
+						boost::hash_combine(seed, c);
+					return seed;
+				}
+
+				/**
+				 * Replaces the lines of the document which differ from the given lines, by one @c Document#replace
+				 * call. The differences are computed by @c detail#diffSequences with the hash values of the lines,
+				 * so the unchanged lines are not touched and the points, the bookmarks and the caches on them survive.
+				 * @param document The document
+				 * @param lines The new lines
+				 * @throw ... Any exceptions @c Document#replace throws
+				 */
+				void replaceChangedLines(Document& document, const std::vector<DocumentContentLine>& lines) {
+					// the search gives up if the lines differ more than this, and replaces all the different lines
+					static const std::size_t MAXIMUM_EDIT_DISTANCE = 1024;
+					const Index n = document.numberOfLines(), m = lines.size();
+					std::vector<std::size_t> hashes, newHashes;
+					hashes.reserve(n);
+					newHashes.reserve(m);
+					String buffer;
+					for(Index i = 0; i < n; ++i)
+						hashes.push_back(hashLine(document.lineContent(i), buffer));
+					BOOST_FOREACH(const DocumentContentLine& line, lines)
+						newHashes.push_back(hashLine(line));
+
+					// the last lines have no newline, and are compared only with each other
+					const auto equal = [&](std::size_t i, std::size_t j) -> bool {
+						if(hashes[i] != newHashes[j] || (i == n - 1) != (j == m - 1))
+							return false;
+						const Document::Line& line = document.lineContent(i);
+						if(i != n - 1 && line.newline() != lines[j].newline)
+							return false;
+						else if(!line.isLatin1())
+							return line.textPiece(buffer) == lines[j].text;
+						const boost::string_ref latin1(line.latin1Text());
+						return latin1.length() == lines[j].text.length()
+							&& std::equal(latin1.cbegin(), latin1.cend(), lines[j].text.cbegin(),
+								[](char c, Char d) {return static_cast<unsigned char>(c) == d;});
+					};
+					const std::vector<ascension::detail::DiffHunk> hunks(ascension::detail::diffSequences(n, m, equal, MAXIMUM_EDIT_DISTANCE));
+					if(hunks.empty())
+						return;
+
+					std::vector<String> texts;
+					texts.reserve(hunks.size());
+					BOOST_FOREACH(const ascension::detail::DiffHunk& hunk, hunks) {
+						String text;
+						for(std::size_t j = hunk.newFirst; j < hunk.newLast; ++j) {
+							text.append(lines[j].text.cbegin(), lines[j].text.cend());
+							if(j != m - 1)
+								text.append(lines[j].newline.asString());
+						}
+						texts.push_back(std::move(text));
+					}
+					std::vector<std::pair<Region, StringPiece>> replacements;
+					replacements.reserve(hunks.size());
+					for(std::size_t i = 0; i < hunks.size(); ++i) {
+						// a hunk contains the last line of the document only if it contains the last line of the file
+						const Position end((hunks[i].last < n) ? Position::bol(hunks[i].last) : *boost::const_end(document.region()));
+						replacements.push_back(std::make_pair(Region(Position::bol(hunks[i].first), end), StringPiece(texts[i])));
+					}
+					document.replace(replacements);
+				}
+
+				/**
+				 * Returns @c true if a line of the encoding can be decoded alone, starting with the initial conversion
+				 * state. The stateful encodings are not, because a shift state or a BASE64 sequence can continue
+				 * across the line breaks.
+				 */
+				inline bool isResynchronizable(const encoding::EncodingProperties& properties) {
+					const std::string name(properties.name());
+					return name.compare(0, 9, "ISO-2022-") != 0 && name != "UTF-7";
+				}
+
+				/// Returns the beginning of the next line of the line break @a lineBreak addresses.
+				inline const Byte* skipLineBreakBytes(const Byte* lineBreak, const Byte* last) BOOST_NOEXCEPT {
+					assert(lineBreak != last);
+					if(*lineBreak == 0x0d && std::next(lineBreak) != last && *std::next(lineBreak) == 0x0a)
+						++lineBreak;
+					return ++lineBreak;
+				}
+
+				/**
+				 * @c DocumentLineSource which decodes the lines of a memory-mapped text file on demand.
+				 *
+				 * The constructor scans the line breaks (CR, LF and CRLF) in the bytes of the file once, and records
+				 * only the beginning of every @c ANCHOR_INTERVAL-th line. @c #readLine seeks the line from the
+				 * nearest preceding record and decodes the line alone, with the initial conversion state.
+				 * NEL, LS and PS are not recognized as line breaks. @c #lineLength counts the bytes of a line without
+				 * decoding, if the line consists of ASCII bytes and the encoding decodes them as they are.
+				 *
+				 * Malformed input and unmappable bytes are decoded into @c text#REPLACEMENT_CHARACTER, because
+				 * @c DocumentLineSource#readLine should not throw them.
+				 *
+				 * The document and its snapshots share one line source, so @c #readLine can be called from several
+				 * threads at once. The calls of the encoder, which is not thread-safe, are serialized.
+				 * @see TextFileDocumentInput#revertLazily
+				 */
+				class MappedTextFileLineSource : public DocumentLineSource {
+				public:
+					static std::shared_ptr<const MappedTextFileLineSource> open(
+						const boost::filesystem::path& fileName, const std::string& encoding);
+					/// Returns the encoding used to decode.
+					std::string encoding() const BOOST_NOEXCEPT {return encoder_->properties().name();}
+					/// Returns @c true if the file begins with Unicode byte order mark.
+					bool unicodeByteOrderMark() const BOOST_NOEXCEPT {return unicodeByteOrderMark_;}
+					// DocumentLineSource
+					Index lineLength(Index line, text::Newline& newline) const override;
+					Index numberOfLines() const BOOST_NOEXCEPT override {return numberOfLines_;}
+					void readLine(Index line, String& text, text::Newline& newline) const override;
+				private:
+					MappedTextFileLineSource(std::unique_ptr<TextFileStreamBuffer> file, std::unique_ptr<encoding::Encoder> encoder);
+					void decode(const boost::iterator_range<const Byte*>& bytes, String& text) const;
+					const Byte* lineBeginning(Index line) const BOOST_NOEXCEPT;
+					boost::iterator_range<const Byte*> lineBytes(Index line, text::Newline& newline) const BOOST_NOEXCEPT;
+					static const Index ANCHOR_INTERVAL = 64;
+					const std::unique_ptr<TextFileStreamBuffer> file_;	// owns the mapping
+					const std::unique_ptr<encoding::Encoder> encoder_;
+					mutable std::mutex encoderMutex_;	// guards encoder_
+					std::vector<std::size_t> anchors_;	// byte offsets of the lines 0, ANCHOR_INTERVAL, 2 * ANCHOR_INTERVAL, ...
+					Index numberOfLines_;
+					bool asciiTransparent_;	// true if the encoder decodes the ASCII bytes into the same code points
+					bool unicodeByteOrderMark_;
+				};
+
+				MappedTextFileLineSource::MappedTextFileLineSource(std::unique_ptr<TextFileStreamBuffer> file,
+						std::unique_ptr<encoding::Encoder> encoder) : file_(std::move(file)), encoder_(std::move(encoder)), numberOfLines_(1) {
+					const Byte* const first = std::begin(file_->mappedInput());
+					const Byte* const last = std::end(file_->mappedInput());
+					anchors_.push_back(0);
+					for(const Byte* p = text::findNewlineByte(first, last); p != last; p = text::findNewlineByte(p, last)) {
+						p = skipLineBreakBytes(p, last);
+						if(numberOfLines_ % ANCHOR_INTERVAL == 0)
+							anchors_.push_back(p - first);
+						++numberOfLines_;
+					}
+
+					// the byte order mark is at the beginning of the first line
+					encoding::Encoder::State state;
+					std::array<Char, 8> ucs;
+					Char* toNext;
+					const Byte* fromNext;
+					encoder_->toUnicode(state, boost::make_iterator_range(ucs.data(), ucs.data() + ucs.size()), toNext,
+						boost::make_iterator_range(first, std::min(first + 4, last)), fromNext);	// the result does not matter
+					unicodeByteOrderMark_ = encoder_->isByteOrderMarkEncountered(state);
+
+					std::array<Byte, 0x80> ascii;
+					for(std::size_t i = 0; i < ascii.size(); ++i)
+						ascii[i] = static_cast<Byte>(i);
+					String decodedAscii;
+					decode(boost::make_iterator_range(ascii.data(), ascii.data() + ascii.size()), decodedAscii);
+					asciiTransparent_ = decodedAscii.length() == ascii.size()
+						&& std::equal(std::begin(ascii), std::end(ascii), std::begin(decodedAscii));
+				}
+
+				/**
+				 * Opens the file and builds the index of the lines.
+				 * @param fileName The file name
+				 * @param encoding The character encoding of the file or auto detection name
+				 * @return The line source, or @c null if CR and LF are not single bytes in the encoding, or the encoding
+				 *         is stateful
+				 * @throw ... Any exceptions @c TextFileStreamBuffer#TextFileStreamBuffer throws
+				 */
+				std::shared_ptr<const MappedTextFileLineSource> MappedTextFileLineSource::open(
+						const boost::filesystem::path& fileName, const std::string& encoding) {
+					std::unique_ptr<TextFileStreamBuffer> file(new TextFileStreamBuffer(
+						fileName, std::ios_base::in, encoding, encoding::Encoder::REPLACE_UNMAPPABLE_CHARACTERS, false));
+					std::unique_ptr<encoding::Encoder> encoder(encoding::EncoderRegistry::instance().forName(file->encoding()));
+					if(encoder.get() == nullptr || !isResynchronizable(encoder->properties())
+							|| encoder->fromUnicode(String(1, text::LINE_FEED)) != "\n"
+							|| encoder->fromUnicode(String(1, text::CARRIAGE_RETURN)) != "\r")
+						return std::shared_ptr<const MappedTextFileLineSource>();
+					encoder->setSubstitutionPolicy(encoding::Encoder::REPLACE_UNMAPPABLE_CHARACTERS);
+					return std::shared_ptr<const MappedTextFileLineSource>(new MappedTextFileLineSource(std::move(file), std::move(encoder)));
+				}
+
+				/**
+				 * Decodes the bytes of a line.
+				 * @param bytes The bytes of the line, without the line break
+				 * @param[out] text The decoded text
+				 */
+				void MappedTextFileLineSource::decode(const boost::iterator_range<const Byte*>& bytes, String& text) const {
+					const Byte* const first = boost::const_begin(bytes);
+					const Byte* const last = boost::const_end(bytes);
+					text.resize((last - first) * encoder_->properties().maximumUCSLength());
+					Char* const to = (first != last) ? &text[0] : nullptr;
+					Char* toNext = to;
+					std::lock_guard<std::mutex> lock(encoderMutex_);
+					for(const Byte* fromNext = first; fromNext != last; ) {
+						encoding::Encoder::State state;
+						const auto result = encoder_->toUnicode(state,
+							boost::make_iterator_range(toNext, to + text.length()), toNext,
+							boost::make_iterator_range(fromNext, last), fromNext);
+						assert(result != encoding::Encoder::INSUFFICIENT_BUFFER);
+						if(result == encoding::Encoder::COMPLETED && fromNext == last)
+							break;
+						// malformed, unmappable or truncated at the end of the line
+						*toNext++ = text::REPLACEMENT_CHARACTER;
+						++fromNext;
+					}
+					text.resize(toNext - to);
+				}
+
+				/// Returns the beginning of the bytes of the specified line.
+				const Byte* MappedTextFileLineSource::lineBeginning(Index line) const BOOST_NOEXCEPT {
+					assert(line < numberOfLines());
+					const Byte* const last = std::end(file_->mappedInput());
+					const Byte* p = std::begin(file_->mappedInput()) + anchors_[line / ANCHOR_INTERVAL];
+					for(Index n = line % ANCHOR_INTERVAL; n != 0; --n)
+						p = skipLineBreakBytes(text::findNewlineByte(p, last), last);
+					return p;
+				}
+
+				/**
+				 * Returns the bytes of the specified line.
+				 * @param line The line number
+				 * @param[out] newline The newline terminates the line
+				 * @return The bytes of the line, without the line break
+				 */
+				boost::iterator_range<const Byte*> MappedTextFileLineSource::lineBytes(Index line, text::Newline& newline) const BOOST_NOEXCEPT {
+					const Byte* const eof = std::end(file_->mappedInput());
+					const Byte* const first = lineBeginning(line);
+					const Byte* const last = text::findNewlineByte(first, eof);
+					if(last == eof)
+						newline = ASCENSION_DEFAULT_NEWLINE;
+					else if(*last == 0x0a)
+						newline = text::Newline::LINE_FEED;
+					else if(std::next(last) != eof && *std::next(last) == 0x0a)
+						newline = text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED;
+					else
+						newline = text::Newline::CARRIAGE_RETURN;
+					return boost::make_iterator_range(first, last);
+				}
+
+				/// @see DocumentLineSource#lineLength
+				Index MappedTextFileLineSource::lineLength(Index line, text::Newline& newline) const {
+					const boost::iterator_range<const Byte*> bytes(lineBytes(line, newline));
+					if(asciiTransparent_ && std::find_if(boost::const_begin(bytes), boost::const_end(bytes),
+							[](Byte b) {return b >= 0x80;}) == boost::const_end(bytes))
+						return boost::size(bytes);
+					String text;
+					decode(bytes, text);
+					return text.length();
+				}
+
+				/// @see DocumentLineSource#readLine
+				void MappedTextFileLineSource::readLine(Index line, String& text, text::Newline& newline) const {
+					decode(lineBytes(line, newline), text);
+				}
+
 				/**
 				 * Verifies if the newline is allowed in the given character encoding.
 				 * @param encoding The character encoding
@@ -195,12 +885,24 @@ namespace ascension {
 			std::tuple<std::string, bool, Position> insertFileContents(
 					Document& document, const Position& at, const boost::filesystem::path& fileName,
 					const std::string& encoding, encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy) {
-				TextFileStreamBuffer sb(fileName, std::ios_base::in, encoding, encodingSubstitutionPolicy, false);
-				std::istreambuf_iterator<Char> i(&sb);
-				const auto eos(insert(document, at, i, std::istreambuf_iterator<Char>()));
-				const auto realEncoding(sb.encoding());
-				const auto unicodeByteOrderMark(sb.unicodeByteOrderMark());
-				sb.close();
+				DecodedLines decoded;
+				std::string realEncoding;
+				bool unicodeByteOrderMark;
+				std::tie(decoded, realEncoding, unicodeByteOrderMark) = readFileContents(fileName, encoding, encodingSubstitutionPolicy);
+				const std::vector<std::shared_ptr<const String>>& batches = decoded.batches;
+
+				// insert at once, then the document records only one change
+				Position eos(at);
+				if(batches.size() == 1)
+					eos = insert(document, at, StringPiece(*batches.front()));
+				else if(!batches.empty()) {
+					String text;
+					text.reserve(boost::accumulate(batches, static_cast<String::size_type>(0),
+						[](String::size_type n, const std::shared_ptr<const String>& batch) {return n + batch->length();}));
+					BOOST_FOREACH(const std::shared_ptr<const String>& batch, batches)
+						text.append(*batch);
+					eos = insert(document, at, StringPiece(text));
+				}
 				return std::make_tuple(realEncoding, unicodeByteOrderMark, eos);
 			}
 
@@ -248,6 +950,7 @@ namespace ascension {
 					append ? (std::ios_base::out | std::ios_base::app) : std::ios_base::out,
 					format.encoding, format.encodingSubstitutionPolicy, format.unicodeByteOrderMark);
 				try {
+					sb.setOutputOverlapped(true).setSyncPolicy(format.syncPolicy);
 					std::basic_ostream<Char> out(&sb);
 					out.exceptions(std::ios_base::badbit);
 					// write into file
@@ -413,134 +1116,1022 @@ private:
 			}
 
 
-			// TextFileDocumentInput //////////////////////////////////////////////////////////////////////////////////
+			// TextFileDocumentInput.Journal //////////////////////////////////////////////////////////////////////////
 
-			/**
-			 * @class ascension::kernel::fileio::TextFileDocumentInput
-			 * @c DocumentInput implementation which initializes a document with the content of the text file.
-			 *
-			 * @note This class is not intended to be subclassed.
-			 *
-			 * @c TextFileDocumentInput uses @c TextFileStreamBuffer class to read/write the text file. @c #bind opens
-			 * a text file and binds the document to the file. @c #write writes the content of the document into the
-			 * specified file.
-			 *
-			 * @code
-			 * extern Document d;
-			 * TextFileDocumentInput in(d);
-			 * in.bind(...);  // bind the document to a file
-			 * in.revert(...);
-			 *
-			 * // .. edit the document ..
-			 *
-			 * in.save(...);  // write the file
-			 * in.unbind();
-			 * @endcode
-			 *
-			 * <h3>Encoding and newline of the file</h3>
-			 *
-			 * The encoding and newline of the opened file can be obtained by @c #encoding and @c #newline methods.
-			 *
-			 * <h3>Locking the opened file</h3>
-			 *
-			 * You can lock the opened file to guard from other processes' changing. @c LockMode parameter of @c #bind
-			 * method specifies the mode of locking.
-			 *
-			 * <h3>When the other process modified the opened file</h3>
-			 *
-			 * You can detect any modification by other process using @c IUnexpectedFileTimeStampDirector.
+			namespace {
+				const std::array<Byte, 8> JOURNAL_SIGNATURE = {{'A', 's', 'c', 'J', 'r', 'n', 'l', 1}};
+				const Byte REPLACEMENT_RECORD = 0, CONTENT_RECORD = 1;
+				const std::size_t RECORD_HEADER_LENGTH = 1 + 8 * 4;	// the type and the region
+
+				inline void appendUnsigned(std::vector<Byte>& out, std::uint64_t value, std::size_t bytes) {
+					for(std::size_t i = 0; i < bytes; ++i, value >>= 8)
+						out.push_back(static_cast<Byte>(value & 0xff));
+				}
+
+				inline bool readUnsigned(const Byte*& p, const Byte* last, std::size_t bytes, std::uint64_t& value) BOOST_NOEXCEPT {
+					if(static_cast<std::size_t>(last - p) < bytes)
+						return false;
+					value = 0;
+					for(std::size_t i = 0; i < bytes; ++i)
+						value |= static_cast<std::uint64_t>(p[i]) << (i * 8);
+					p += bytes;
+					return true;
+				}
+
+				/// Returns the 32-bit FNV-1a hash of the given bytes.
+				std::uint32_t checksum(const Byte* first, const Byte* last) BOOST_NOEXCEPT {
+					std::uint32_t hash = 0x811c9dc5u;
+					for(; first != last; ++first)
+						hash = (hash ^ *first) * 0x01000193u;
+					return hash;
+				}
+
+				/// Returns the name of the journal file of the given file.
+				boost::filesystem::path journalFileName(const boost::filesystem::path& fileName) {
+					boost::filesystem::path result(fileName);
+					return result += ".journal";
+				}
+
+				/**
+				 * Returns the header of the journal file, which identifies the version of the file the journal applies
+				 * to by its size and last write time.
+				 * @throw boost#filesystem#filesystem_error
+				 */
+				std::vector<Byte> makeJournalHeader(const boost::filesystem::path& fileName) {
+					std::vector<Byte> header(std::begin(JOURNAL_SIGNATURE), std::end(JOURNAL_SIGNATURE));
+					appendUnsigned(header, boost::filesystem::file_size(fileName), 8);
+					appendUnsigned(header, static_cast<std::uint64_t>(boost::filesystem::last_write_time(fileName)), 8);
+					return header;
+				}
+			}
+
+			/*
+			 * The journal file consists of the header and the records. Each record is the length of the payload (8
+			 * bytes), the payload and the checksum of the payload (4 bytes). The payload is the type (1 byte), the
+			 * erased region (4 x 8 bytes) and the inserted text in UTF-16LE. All integers are little endian. A record
+			 * truncated by a crash is detected by the length or the checksum, and ignored with the following ones.
 			 */
+			class TextFileDocumentInput::Journal : public DocumentListener, private boost::noncopyable {
+			public:
+				Journal(Document& document, const boost::filesystem::path& fileName, bool replay);
+				~Journal() BOOST_NOEXCEPT;
+				void flush();
+				void mark();
+				void rebase(std::size_t revisionNumber);
+				void restart();
+				void unmark() BOOST_NOEXCEPT;
+			private:
+				void append(Byte type, const Region& region, const String& text);
+				void close() BOOST_NOEXCEPT;
+				void open(std::uint64_t length, bool recordContent = true);
+				std::uint64_t replay();
+				// DocumentListener
+				void documentAboutToBeChanged(const Document& document, const DocumentChange& change) override;
+				void documentChanged(const Document& document, const DocumentChange& change) override;
+			private:
+				static const std::size_t FLUSH_THRESHOLD = 0x10000;	// in bytes
+				Document& document_;
+				const boost::filesystem::path fileName_, journalFileName_;
+				std::vector<Byte> buffer_;	// the records not written yet
+				boost::optional<std::size_t> markedRevision_;	// the revision passed to mark(), or none
+				std::vector<Byte> recordsSinceMark_;	// the records appended after mark()
+				bool broken_;	// true if a change could not be recorded
+#if BOOST_OS_WINDOWS
+				HANDLE file_;
+#else // ASCENSION_OS_POSIX
+				int file_;
+#endif
+			};
 
 			/**
-			 * Constructor.
+			 * Constructor opens the journal file of the given file and starts recording the changes of the document.
 			 * @param document The document
+			 * @param fileName The name of the bound file
+			 * @param replay Set @c true to replay the existing journal on the document which has just been read from
+			 *               @a fileName. If @c false, or the journal is missing or not of the current version of the
+			 *               file, the journal is recreated. If the document has been modified, the whole content is
+			 *               recorded
+			 * @throw boost#filesystem#filesystem_error
 			 */
-			TextFileDocumentInput::TextFileDocumentInput(Document& document) :
-					fileLocker_(new FileLocker), document_(document), encoding_(encoding::Encoder::defaultInstance().properties().name()),
-					unicodeByteOrderMark_(false), newline_(ASCENSION_DEFAULT_NEWLINE), savedDocumentRevision_(0), timeStampDirector_(nullptr) {
-				desiredLockMode_.type = NO_LOCK;
-				desiredLockMode_.onlyAsEditing = false;
-				documentModificationSignChangedConnection_ =
-					document_.modificationSignChangedSignal().connect(
-						std::bind(&TextFileDocumentInput::documentModificationSignChanged, this, std::placeholders::_1));
-				document.setProperty(Document::TITLE_PROPERTY, String());
+			TextFileDocumentInput::Journal::Journal(Document& document, const boost::filesystem::path& fileName, bool replay) :
+					document_(document), fileName_(fileName), journalFileName_(journalFileName(fileName)), broken_(false),
+#if BOOST_OS_WINDOWS
+					file_(INVALID_HANDLE_VALUE) {
+#else // ASCENSION_OS_POSIX
+					file_(-1) {
+#endif
+				open(replay ? this->replay() : 0);
+				document_.addListener(*this);
 			}
 
-			/// Destructor.
-			TextFileDocumentInput::~TextFileDocumentInput() BOOST_NOEXCEPT {
-				unbind();
+			/// Destructor closes and removes the journal file.
+			TextFileDocumentInput::Journal::~Journal() BOOST_NOEXCEPT {
+				document_.removeListener(*this);
+				close();
+				boost::system::error_code ignored;
+				boost::filesystem::remove(journalFileName_, ignored);
 			}
 
 			/**
-			 * Registers the file property listener.
-			 * @param listener The listener to be registered
-			 * @throw std#invalid_argument @a listener is already registered
+			 * Appends a record to the buffer.
+			 * @param type The type of the record
+			 * @param region The erased region
+			 * @param text The inserted text
 			 */
-			void TextFileDocumentInput::addListener(FilePropertyListener& listener) {
-				listeners_.add(listener);
+			void TextFileDocumentInput::Journal::append(Byte type, const Region& region, const String& text) {
+				const std::size_t first = buffer_.size();
+				appendUnsigned(buffer_, 0, 8);	// the length of the payload, filled later
+				buffer_.push_back(type);
+				appendUnsigned(buffer_, kernel::line(*boost::const_begin(region)), 8);
+				appendUnsigned(buffer_, kernel::offsetInLine(*boost::const_begin(region)), 8);
+				appendUnsigned(buffer_, kernel::line(*boost::const_end(region)), 8);
+				appendUnsigned(buffer_, kernel::offsetInLine(*boost::const_end(region)), 8);
+				buffer_.reserve(buffer_.size() + text.length() * 2 + 4);
+				BOOST_FOREACH(Char c, text)
+					appendUnsigned(buffer_, c, 2);
+				std::uint64_t payloadLength = buffer_.size() - first - 8;
+				for(std::size_t i = 0; i < 8; ++i, payloadLength >>= 8)
+					buffer_[first + i] = static_cast<Byte>(payloadLength & 0xff);
+				appendUnsigned(buffer_, checksum(buffer_.data() + first + 8, buffer_.data() + buffer_.size()), 4);
+				if(markedRevision_)
+					recordsSinceMark_.insert(std::end(recordsSinceMark_), std::begin(buffer_) + first, std::end(buffer_));
 			}
 
-			/**
-			 *
-			 * @param fileName
-			 */
-			void TextFileDocumentInput::bind(const boost::filesystem::path& fileName) {
-//				sanityCheckPathName(fileName, "fileName");
-				if(fileName.empty())
-					return unbind();
-
-				const boost::filesystem::path realName(canonicalizePathName(fileName));
-				if(!boost::filesystem::exists(realName))
-					throw detail::makeGenericFileSystemError("ascension.fileio.TextFileDocumentInput.bind", fileName, boost::system::errc::no_such_file_or_directory);
-				if(fileLocker_->hasLock()) {
-					assert(fileLocker_->type() == desiredLockMode_.type);
-					if(desiredLockMode_.onlyAsEditing)
-						assert(!document().isModified());
-//						assert(savedDocumentRevision_ != document().revisionNumber());
-					fileLocker_->lock(realName, fileLocker_->type() == SHARED_LOCK);
+			/// Closes the journal file without writing the buffer.
+			void TextFileDocumentInput::Journal::close() BOOST_NOEXCEPT {
+#if BOOST_OS_WINDOWS
+				if(file_ != INVALID_HANDLE_VALUE) {
+					::CloseHandle(file_);
+					file_ = INVALID_HANDLE_VALUE;
+				}
+#else // ASCENSION_OS_POSIX
+				if(file_ != -1) {
+					::close(file_);
+					file_ = -1;
 				}
+#endif
+				buffer_.clear();
+			}
 
-				if(weakSelf_.get() == nullptr)
-					weakSelf_.reset(this, boost::null_deleter());
-				document_.setInput(std::weak_ptr<DocumentInput>(weakSelf_));
-				fileName_ = realName;
-				listeners_.notify<const TextFileDocumentInput&>(&FilePropertyListener::fileNameChanged, *this);
-				document_.setModified();
+			/// @see DocumentListener#documentAboutToBeChanged
+			void TextFileDocumentInput::Journal::documentAboutToBeChanged(const Document&, const DocumentChange&) {
 			}
 
-			/**
-			 * Checks the last modified date/time of the bound file and verifies if the other modified the
-			 * file. If the file is modified, the listener's
-			 * @c IUnexpectedFileTimeStampDerector#queryAboutUnexpectedDocumentFileTimeStamp will be called.
-			 * @return The value which the listener returned or @c true if the listener is not set
-			 */
-			bool TextFileDocumentInput::checkTimeStamp() {
-				std::time_t newTimeStamp;
-				if(!verifyTimeStamp(false, newTimeStamp)) {
-					const boost::optional<std::time_t> original(userLastWriteTime_);
-					userLastWriteTime_ = boost::none;
-					if(timeStampDirector_ == nullptr
-							|| timeStampDirector_->queryAboutUnexpectedDocumentFileTimeStamp(
-								document_, UnexpectedFileTimeStampDirector::CLIENT_INVOCATION)) {
-						userLastWriteTime_ = newTimeStamp;
-						return true;
+			/// @see DocumentListener#documentChanged
+			void TextFileDocumentInput::Journal::documentChanged(const Document& document, const DocumentChange& change) {
+				if(broken_)
+					return;
+				try {
+					std::basic_ostringstream<Char> text;
+					writeDocumentToStream(text, document, change.insertedRegion());
+					append(REPLACEMENT_RECORD, change.erasedRegion(), text.str());
+				} catch(...) {
+					// a lost record makes the rest of the journal meaningless
+					broken_ = true;
+					close();
+					boost::system::error_code ignored;
+					boost::filesystem::remove(journalFileName_, ignored);
+					return;
+				}
+				if(buffer_.size() >= FLUSH_THRESHOLD) {
+					try {
+						flush();
+					} catch(...) {
+						// the records remain in the buffer and will be written by the next flush
 					}
-					userLastWriteTime_ = original;
-					return false;
 				}
-				return true;
 			}
 
-			/// @see Document#ModificationSignChangedSignal
-			void TextFileDocumentInput::documentModificationSignChanged(const Document&) {
-				if(isBoundToFile() && desiredLockMode_.onlyAsEditing) {
-					if(!document().isModified())
+			/**
+			 * Writes the buffered records into the journal file and flushes the file to the disk.
+			 * @throw boost#filesystem#filesystem_error
+			 */
+			void TextFileDocumentInput::Journal::flush() {
+				if(buffer_.empty() || broken_)
+					return;
+				std::size_t written = 0;
+				try {
+#if BOOST_OS_WINDOWS
+					while(written < buffer_.size()) {
+						DWORD n;
+						if(!win32::boole(::WriteFile(file_, buffer_.data() + written,
+								static_cast<DWORD>(std::min<std::size_t>(buffer_.size() - written, 0x40000000u)), &n, nullptr)))
+							throw detail::makeFileSystemError("WriteFile() returned FALSE.", journalFileName_);
+						written += n;
+					}
+					if(!win32::boole(::FlushFileBuffers(file_)))
+						throw detail::makeFileSystemError("FlushFileBuffers() returned FALSE.", journalFileName_);
+#else // ASCENSION_OS_POSIX
+					while(written < buffer_.size()) {
+						const ssize_t n = ::write(file_, buffer_.data() + written, buffer_.size() - written);
+						if(n == -1) {
+							if(errno == EINTR)
+								continue;
+							throw detail::makeFileSystemError("write(2) returned -1.", journalFileName_);
+						}
+						written += static_cast<std::size_t>(n);
+					}
+					if(::fsync(file_) == -1)
+						throw detail::makeFileSystemError("fsync(2) returned -1.", journalFileName_);
+#endif
+				} catch(...) {
+					buffer_.erase(std::begin(buffer_), std::begin(buffer_) + written);	// not to write twice
+					throw;
+				}
+				buffer_.clear();
+			}
+
+			/**
+			 * Starts keeping the records of the changes made after the current revision of the document, for
+			 * @c #rebase. This is called when the snapshot to be written into the file is taken.
+			 */
+			void TextFileDocumentInput::Journal::mark() {
+				unmark();
+				markedRevision_ = document_.revisionNumber();
+			}
+
+			/**
+			 * Opens the journal file for appending.
+			 * @param length The length of the valid part of the existing journal file. If this is zero, the file is
+			 *               recreated with the new header, followed by the whole content if the document has been
+			 *               modified and @a recordContent is @c true
+			 * @param recordContent Set @c false not to record the whole content into the recreated file
+			 * @throw boost#filesystem#filesystem_error
+			 */
+			void TextFileDocumentInput::Journal::open(std::uint64_t length, bool recordContent /* = true */) {
+				close();
+				unmark();
+				if(length != 0)
+					boost::filesystem::resize_file(journalFileName_, length);	// discard the truncated record
+#if BOOST_OS_WINDOWS
+				file_ = ::CreateFileW(journalFileName_.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ,
+					nullptr, (length != 0) ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if(file_ == INVALID_HANDLE_VALUE)
+					throw detail::makeFileSystemError("CreateFileW() returned INVALID_HANDLE_VALUE.", journalFileName_);
+#else // ASCENSION_OS_POSIX
+				file_ = ::open(journalFileName_.c_str(), O_WRONLY | O_APPEND | O_CREAT | ((length != 0) ? 0 : O_TRUNC), 0600);
+				if(file_ == -1)
+					throw detail::makeFileSystemError("open(2) returned -1.", journalFileName_);
+#endif
+				broken_ = false;
+				if(length == 0) {
+					buffer_ = makeJournalHeader(fileName_);
+					if(recordContent && document_.isModified()) {
+						std::basic_ostringstream<Char> text;
+						writeDocumentToStream(text, document_, document_.region());
+						append(CONTENT_RECORD, document_.region(), text.str());
+					}
+					flush();
+				}
+			}
+
+			/**
+			 * Restarts the journal for the file which has just been written with the given revision of the
+			 * document. If the revision was marked by @c #mark, only the records of the changes made after it are
+			 * kept. Otherwise the whole content is recorded if the document has been modified, as @c #restart does.
+			 * @param revisionNumber The revision number of the written document
+			 * @throw boost#filesystem#filesystem_error
+			 */
+			void TextFileDocumentInput::Journal::rebase(std::size_t revisionNumber) {
+				if(broken_ || markedRevision_ != revisionNumber)
+					return restart();
+				std::vector<Byte> records;
+				records.swap(recordsSinceMark_);
+				open(0, false);
+				buffer_ = std::move(records);
+				flush();
+			}
+
+			/**
+			 * Replays the existing journal file on the document.
+			 * @return The length of the replayed part of the journal file, or zero if the journal was not replayed
+			 * @throw ... Any exceptions @c Document#replace throws except @c BadRegionException
+			 */
+			std::uint64_t TextFileDocumentInput::Journal::replay() {
+				boost::system::error_code error;
+				const std::uint64_t fileSize = boost::filesystem::file_size(journalFileName_, error);
+				std::vector<Byte> header;
+				try {
+					header = makeJournalHeader(fileName_);
+				} catch(const boost::filesystem::filesystem_error&) {
+					return 0;
+				}
+				if(error || fileSize <= header.size() || fileSize > std::numeric_limits<std::size_t>::max())
+					return 0;
+				std::vector<Byte> bytes(static_cast<std::size_t>(fileSize));
+				{
+					boost::filesystem::ifstream in(journalFileName_, std::ios_base::binary);
+					if(!in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+						return 0;
+				}
+				if(!std::equal(std::begin(header), std::end(header), std::begin(bytes)))
+					return 0;	// for the other version of the file
+
+				const Byte* p = bytes.data() + header.size();
+				const Byte* const last = bytes.data() + bytes.size();
+				while(p != last) {
+					const Byte* next = p;
+					std::uint64_t payloadLength, sum;
+					if(!readUnsigned(next, last, 8, payloadLength) || payloadLength < RECORD_HEADER_LENGTH
+							|| (payloadLength - RECORD_HEADER_LENGTH) % 2 != 0 || static_cast<std::uint64_t>(last - next) < payloadLength + 4)
+						break;
+					const Byte* const payload = next;
+					next += payloadLength;
+					readUnsigned(next, last, 4, sum);
+					if(sum != checksum(payload, payload + payloadLength))
+						break;
+
+					const Byte* q = payload;
+					const Byte type = *q++;
+					std::array<std::uint64_t, 4> values;
+					BOOST_FOREACH(std::uint64_t& value, values)
+						readUnsigned(q, last, 8, value);
+					String text;
+					text.reserve((payload + payloadLength - q) / 2);
+					for(; q != payload + payloadLength; q += 2)
+						text.push_back(static_cast<Char>(q[0] | (q[1] << 8)));
+					if(type == CONTENT_RECORD)
+						document_.replace(document_.region(), text);
+					else if(type == REPLACEMENT_RECORD) {
+						try {
+							document_.replace(Region(
+								Position(static_cast<Index>(values[0]), static_cast<Index>(values[1])),
+								Position(static_cast<Index>(values[2]), static_cast<Index>(values[3]))), text);
+						} catch(const BadRegionException&) {
+							break;
+						}
+					} else
+						break;
+					p = next;
+				}
+				return p - bytes.data();
+			}
+
+			/**
+			 * Discards the records and restarts the journal for the current version of the file. If the document
+			 * has been modified from the file, the whole content is recorded.
+			 * @throw boost#filesystem#filesystem_error
+			 */
+			void TextFileDocumentInput::Journal::restart() {
+				open(0);
+			}
+
+			/// Stops keeping the records @c #mark started.
+			void TextFileDocumentInput::Journal::unmark() BOOST_NOEXCEPT {
+				markedRevision_ = boost::none;
+				std::vector<Byte>().swap(recordsSinceMark_);
+			}
+
+
+			// TextFileDocumentInput.BackgroundWriting ////////////////////////////////////////////////////////////////
+
+			/// The writing started by @c TextFileDocumentInput#beginWrite.
+			struct TextFileDocumentInput::BackgroundWriting {
+				std::shared_ptr<const DocumentSnapshot> snapshot;
+				boost::filesystem::path tempFileName;
+				WritingFormat format;
+				FileIOProgressMonitor* monitor;
+				std::atomic<bool> cancelled;
+				std::future<void> result;	// of the worker thread
+			};
+
+
+			// TextFileDocumentInput.Following ////////////////////////////////////////////////////////////////////////
+
+			/// The state of @c TextFileDocumentInput#follow between the calls.
+			struct TextFileDocumentInput::Following {
+				std::unique_ptr<encoding::Encoder> encoder;
+				encoding::Encoder::State decodingState;	// after the decoded bytes
+				std::uintmax_t decodedBytes;	// the length of the decoded prefix of the file
+				std::vector<Byte> tail;	// the last bytes of the decoded prefix, to detect the file was rewritten
+				std::size_t documentRevision;	// the revision number of the document after the last call
+#if ASCENSION_OS_POSIX
+				dev_t device;	// to detect the file was replaced (rotated)
+				ino_t inode;
+#endif
+				static const std::size_t MAXIMUM_TAIL_LENGTH = 64;
+
+				/// Remembers the decoded prefix [begin, end) of @a input.
+				void decoded(const boost::iterator_range<const Byte*>& input, const Byte* end) {
+					decodedBytes = end - boost::const_begin(input);
+					tail.assign(end - std::min<std::size_t>(decodedBytes, MAXIMUM_TAIL_LENGTH), end);
+				}
+				/// Returns @c true if @a input still begins with the decoded prefix.
+				bool isPrefixOf(const boost::iterator_range<const Byte*>& input) const BOOST_NOEXCEPT {
+					return static_cast<std::uintmax_t>(boost::size(input)) >= decodedBytes
+						&& std::equal(tail.cbegin(), tail.cend(), boost::const_begin(input) + decodedBytes - tail.size());
+				}
+#if ASCENSION_OS_POSIX
+				/// Returns @c true if @a fileName names the same file, and sets the identity of it if @a update is @c true.
+				bool identify(const boost::filesystem::path& fileName, bool update) BOOST_NOEXCEPT {
+					struct stat s;
+					if(::stat(fileName.c_str(), &s) == -1)
+						return false;
+					const bool same = s.st_dev == device && s.st_ino == inode;
+					if(update)
+						device = s.st_dev, inode = s.st_ino;
+					return same;
+				}
+#endif
+			};
+
+
+			// TextFileDocumentInput.FileChangeMonitor ///////////////////////////////////////////////////////////////
+
+			/*
+			 * Watches the directories of the bound files by one inotify instance shared by all the
+			 * TextFileDocumentInputs, and calls TextFileDocumentInput.fileChanged in the worker thread when a file
+			 * may have been changed. The directories are watched instead of the files, because many applications
+			 * save a file by renaming a temporary file, which replaces the inode of the file. If inotify is not
+			 * available, TextFileDocumentInput polls the time stamp of the file.
+			 */
+			class TextFileDocumentInput::FileChangeMonitor : private boost::noncopyable {
+			public:
+				static FileChangeMonitor* instance() BOOST_NOEXCEPT;
+				bool watch(TextFileDocumentInput& input, const boost::filesystem::path& fileName) BOOST_NOEXCEPT;
+				void unwatch(TextFileDocumentInput& input) BOOST_NOEXCEPT;
+			private:
+				FileChangeMonitor() BOOST_NOEXCEPT;
+				~FileChangeMonitor() BOOST_NOEXCEPT;
+#if BOOST_OS_LINUX
+				void dispatch(const inotify_event& event);
+				void run() BOOST_NOEXCEPT;
+				int inotify_, wakeUp_[2];
+				std::thread thread_;
+				std::recursive_mutex mutex_;	// the slots of FileChangedSignal may unwatch
+				std::map<int, std::multimap<boost::filesystem::path, TextFileDocumentInput*>> directories_;	// by the watch descriptor
+				std::map<TextFileDocumentInput*, std::pair<int, boost::filesystem::path>> watches_;
+				static const std::uint32_t EVENTS = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+#endif
+			};
+
+			/// Constructor starts the worker thread. If failed, @c #instance returns @c null.
+			TextFileDocumentInput::FileChangeMonitor::FileChangeMonitor() BOOST_NOEXCEPT {
+#if BOOST_OS_LINUX
+				wakeUp_[0] = wakeUp_[1] = -1;
+				inotify_ = ::inotify_init1(IN_CLOEXEC);
+				if(inotify_ != -1 && ::pipe2(wakeUp_, O_CLOEXEC) == 0) {
+					try {
+						thread_ = std::thread(&FileChangeMonitor::run, this);
+						return;
+					} catch(const std::system_error&) {
+					}
+				}
+				for(int fd : {inotify_, wakeUp_[0], wakeUp_[1]}) {
+					if(fd != -1)
+						::close(fd);
+				}
+				inotify_ = -1;
+#endif
+			}
+
+			/// Destructor stops the worker thread.
+			TextFileDocumentInput::FileChangeMonitor::~FileChangeMonitor() BOOST_NOEXCEPT {
+#if BOOST_OS_LINUX
+				if(inotify_ != -1) {
+					const char c = 0;
+					while(::write(wakeUp_[1], &c, 1) < 0 && errno == EINTR);
+					thread_.join();
+					::close(inotify_);
+					::close(wakeUp_[0]);
+					::close(wakeUp_[1]);
+				}
+#endif
+			}
+
+#if BOOST_OS_LINUX
+			/// Notifies the inputs concerned with @a event. This is called by the worker thread.
+			void TextFileDocumentInput::FileChangeMonitor::dispatch(const inotify_event& event) {
+				std::lock_guard<std::recursive_mutex> lock(mutex_);
+				std::vector<TextFileDocumentInput*> inputs;
+				if((event.mask & IN_Q_OVERFLOW) != 0) {	// some events were lost
+					BOOST_FOREACH(const auto& watch, watches_)
+						inputs.push_back(watch.first);
+				} else {
+					const auto directory(directories_.find(event.wd));
+					if(directory == std::end(directories_))
+						return;
+					else if((event.mask & IN_IGNORED) != 0) {
+						BOOST_FOREACH(const auto& file, directory->second)
+							inputs.push_back(file.second);
+					} else if(event.len != 0) {
+						const auto files(directory->second.equal_range(boost::filesystem::path(event.name)));
+						for(auto file(files.first); file != files.second; ++file)
+							inputs.push_back(file->second);
+					}
+				}
+
+				BOOST_FOREACH(TextFileDocumentInput* input, inputs) {
+					if(watches_.find(input) != std::end(watches_))	// a slot may have unbound the other inputs
+						input->fileChanged();
+				}
+
+				if((event.mask & IN_IGNORED) != 0) {	// the directory was removed. fall back to polling
+					const auto directory(directories_.find(event.wd));
+					if(directory != std::end(directories_)) {
+						BOOST_FOREACH(const auto& file, directory->second) {
+							file.second->watchedByMonitor_ = false;
+							watches_.erase(file.second);
+						}
+						directories_.erase(directory);
+					}
+				}
+			}
+#endif
+
+			/**
+			 * Returns the shared instance, or @c null if the file change notification is not available on this
+			 * platform.
+			 */
+			TextFileDocumentInput::FileChangeMonitor* TextFileDocumentInput::FileChangeMonitor::instance() BOOST_NOEXCEPT {
+#if BOOST_OS_LINUX
+				static FileChangeMonitor singleton;
+				return (singleton.inotify_ != -1) ? &singleton : nullptr;
+#else
+				return nullptr;
+#endif
+			}
+
+#if BOOST_OS_LINUX
+			/// The worker thread reads the events until the destructor wakes it up.
+			void TextFileDocumentInput::FileChangeMonitor::run() BOOST_NOEXCEPT {
+				alignas(inotify_event) char buffer[0x1000];
+				pollfd fds[2] = {{inotify_, POLLIN, 0}, {wakeUp_[0], POLLIN, 0}};
+				while(true) {
+					if(::poll(fds, 2, -1) < 0) {
+						if(errno == EINTR)
+							continue;
+						break;
+					} else if(fds[1].revents != 0)
+						break;
+					const ssize_t n = ::read(inotify_, buffer, sizeof(buffer));
+					if(n < 0) {
+						if(errno == EINTR)
+							continue;
+						break;
+					}
+					for(const char* p = buffer; p < buffer + n; ) {
+						const inotify_event& event = *reinterpret_cast<const inotify_event*>(p);
+						try {
+							dispatch(event);
+						} catch(...) {
+							// ignore. the time stamp is checked by the next call of checkTimeStamp
+						}
+						p += sizeof(inotify_event) + event.len;
+					}
+				}
+			}
+#endif
+
+			/// Stops watching the file of @a input. This does nothing if the file is not watched.
+			void TextFileDocumentInput::FileChangeMonitor::unwatch(TextFileDocumentInput& input) BOOST_NOEXCEPT {
+#if BOOST_OS_LINUX
+				std::lock_guard<std::recursive_mutex> lock(mutex_);
+				const auto watch(watches_.find(&input));
+				if(watch == std::end(watches_))
+					return;
+				const auto directory(directories_.find(watch->second.first));
+				if(directory != std::end(directories_)) {
+					const auto files(directory->second.equal_range(watch->second.second));
+					for(auto file(files.first); file != files.second; ++file) {
+						if(file->second == &input) {
+							directory->second.erase(file);
+							break;
+						}
+					}
+					if(directory->second.empty()) {
+						::inotify_rm_watch(inotify_, directory->first);
+						directories_.erase(directory);
+					}
+				}
+				watches_.erase(watch);
+#endif
+			}
+
+			/**
+			 * Starts watching the file.
+			 * @param input The input
+			 * @param fileName The canonical name of the file
+			 * @return @c false if failed to watch the file
+			 */
+			bool TextFileDocumentInput::FileChangeMonitor::watch(TextFileDocumentInput& input, const boost::filesystem::path& fileName) BOOST_NOEXCEPT {
+#if BOOST_OS_LINUX
+				std::lock_guard<std::recursive_mutex> lock(mutex_);
+				assert(watches_.find(&input) == std::end(watches_));
+				try {
+					const int wd = ::inotify_add_watch(inotify_, fileName.parent_path().c_str(), EVENTS);
+					if(wd == -1)
+						return false;	// for example, the number of the watches reached the limit
+					const auto name(fileName.filename());
+					watches_.insert(std::make_pair(&input, std::make_pair(wd, name)));
+					directories_[wd].insert(std::make_pair(name, &input));	// inotify returns the same descriptor for a directory
+					return true;
+				} catch(const std::bad_alloc&) {
+					unwatch(input);
+				}
+#endif
+				return false;
+			}
+
+
+			// TextFileDocumentInput //////////////////////////////////////////////////////////////////////////////////
+
+			/**
+			 * @class ascension::kernel::fileio::TextFileDocumentInput
+			 * @c DocumentInput implementation which initializes a document with the content of the text file.
+			 *
+			 * @note This class is not intended to be subclassed.
+			 *
+			 * @c TextFileDocumentInput uses @c TextFileStreamBuffer class to read/write the text file. @c #bind opens
+			 * a text file and binds the document to the file. @c #write writes the content of the document into the
+			 * specified file.
+			 *
+			 * @code
+			 * extern Document d;
+			 * TextFileDocumentInput in(d);
+			 * in.bind(...);  // bind the document to a file
+			 * in.revert(...);
+			 *
+			 * // .. edit the document ..
+			 *
+			 * in.save(...);  // write the file
+			 * in.unbind();
+			 * @endcode
+			 *
+			 * <h3>Encoding and newline of the file</h3>
+			 *
+			 * The encoding and newline of the opened file can be obtained by @c #encoding and @c #newline methods.
+			 *
+			 * <h3>Locking the opened file</h3>
+			 *
+			 * You can lock the opened file to guard from other processes' changing. @c LockMode parameter of @c #bind
+			 * method specifies the mode of locking.
+			 *
+			 * <h3>When the other process modified the opened file</h3>
+			 *
+			 * You can detect any modification by other process using @c IUnexpectedFileTimeStampDirector. @c #reload
+			 * reads the modified file and replaces only the changed lines of the document. For the files which grow
+			 * only at the end, such as logs, @c #follow decodes only the appended bytes and appends them to the
+			 * document.
+			 *
+			 * On Linux, the directories of the bound files are watched by one inotify instance shared by all the
+			 * inputs. @c #checkTimeStamp and the check before the first modification read the time stamp of the file
+			 * only if a change of the file was reported since the last check, so they cost no system call for the
+			 * files not changed. Because the notification is asynchronous, a change made just before the check may be
+			 * detected at the next check. @c #fileChangedSignal is invoked by the worker thread as soon as a change is
+			 * reported. The slots should not block on the thread which owns the document, but post a message to it to call
+			 * @c #checkTimeStamp or @c #reload. On the other platforms, or if inotify is not available, the time stamp
+			 * is read at every check.
+			 *
+			 * <h3>Writing in background</h3>
+			 *
+			 * @c #write blocks until the whole document is encoded and written. @c #beginWrite makes a
+			 * @c DocumentSnapshot and writes it into a temporary file in a worker thread, so the document can be
+			 * edited during that. @c #endWrite, called by the thread owns the document, replaces the file with the
+			 * written one. If the document was changed after @c #beginWrite, it remains modified.
+			 *
+			 * <h3>Change journal</h3>
+			 *
+			 * If @c #writeJournal was called, the changes of the document are appended to the journal file next to
+			 * the bound file ("<i>file-name</i>.journal"), instead of rewriting the whole file. The records are
+			 * buffered and flushed to the disk in batches, when the buffer grows or @c #flushJournal is called (for
+			 * example, by an idle timer of the application). The journal is removed when the document is unbound,
+			 * and restarted by @c #write. If the application crashed, @c #revert replays the remaining journal on
+			 * the content of the file, as long as the file was not changed since the journal was started.
+			 */
+
+			/**
+			 * Constructor.
+			 * @param document The document
+			 */
+			TextFileDocumentInput::TextFileDocumentInput(Document& document) :
+					fileLocker_(new FileLocker), watchedByMonitor_(false), numberOfFileChanges_(0),
+					numberOfInternallyVerifiedFileChanges_(0), numberOfUserVerifiedFileChanges_(0), writesJournal_(false),
+					contentFromFile_(false), document_(document), encoding_(encoding::Encoder::defaultInstance().properties().name()),
+					unicodeByteOrderMark_(false), newline_(ASCENSION_DEFAULT_NEWLINE),
+					savedDocumentRevision_(0), timeStampDirector_(nullptr) {
+				desiredLockMode_.type = NO_LOCK;
+				desiredLockMode_.onlyAsEditing = false;
+				documentModificationSignChangedConnection_ =
+					document_.modificationSignChangedSignal().connect(
+						std::bind(&TextFileDocumentInput::documentModificationSignChanged, this, std::placeholders::_1));
+				document.setProperty(Document::TITLE_PROPERTY, String());
+			}
+
+			/// Destructor.
+			TextFileDocumentInput::~TextFileDocumentInput() BOOST_NOEXCEPT {
+				unbind();
+			}
+
+			/**
+			 * Registers the file property listener.
+			 * @param listener The listener to be registered
+			 * @throw std#invalid_argument @a listener is already registered
+			 */
+			void TextFileDocumentInput::addListener(FilePropertyListener& listener) {
+				listeners_.add(listener);
+			}
+
+			/**
+			 * Starts writing the content of the document into the bound file in a worker thread. The content is
+			 * taken as a @c DocumentSnapshot, and the document can be changed while writing. Call @c #endWrite to
+			 * complete the writing. If the previous writing has not been completed, it is cancelled.
+			 * @param format The character encoding and the newlines
+			 * @param monitor The progress monitor, or @c null. This is called by the worker thread
+			 * @retval true The writing started
+			 * @retval false The writing was not needed or was aborted by @c UnexpectedFileTimeStampDirector. In this
+			 *               case, @a monitor is not called
+			 * @throw IllegalStateException The object is not bound to a file
+			 * @throw ... Any exceptions @c #write throws before writing
+			 * @see #endWrite, #isWriting, #write
+			 */
+			bool TextFileDocumentInput::beginWrite(const WritingFormat& format, FileIOProgressMonitor* monitor /* = nullptr */) {
+				cancelWrite();
+				if(!prepareWrite(format))
+					return false;
+
+				std::unique_ptr<BackgroundWriting> writing(new BackgroundWriting);
+				writing->snapshot = std::make_shared<const DocumentSnapshot>(document());
+				if(journal_.get() != nullptr)
+					journal_->mark();	// for written() to keep only the changes made while writing
+				writing->tempFileName = makeTemporaryFileName(fileName());
+				writing->format = format;
+				if(writing->format.newline == text::Newline::USE_DOCUMENT_INPUT)
+					writing->format.newline = newline();
+				writing->monitor = monitor;
+				writing->cancelled = false;
+				BackgroundWriting& w = *writing;
+				writing->result = std::async(std::launch::async, [&w]() {
+					try {
+						writeSnapshot(w);
+					} catch(...) {
+						if(w.monitor != nullptr)
+							w.monitor->release();
+						throw;
+					}
+					if(w.monitor != nullptr)
+						w.monitor->release();
+				});
+				backgroundWriting_ = std::move(writing);
+				return true;
+			}
+
+			/**
+			 *
+			 * @param fileName
+			 */
+			void TextFileDocumentInput::bind(const boost::filesystem::path& fileName) {
+//				sanityCheckPathName(fileName, "fileName");
+				if(fileName.empty())
+					return unbind();
+				cancelWrite();
+
+				const boost::filesystem::path realName(canonicalizePathName(fileName));
+				if(!boost::filesystem::exists(realName))
+					throw detail::makeGenericFileSystemError("ascension.fileio.TextFileDocumentInput.bind", fileName, boost::system::errc::no_such_file_or_directory);
+				if(fileLocker_->hasLock()) {
+					assert(fileLocker_->type() == desiredLockMode_.type);
+					if(desiredLockMode_.onlyAsEditing)
+						assert(!document().isModified());
+//						assert(savedDocumentRevision_ != document().revisionNumber());
+					fileLocker_->lock(realName, fileLocker_->type() == SHARED_LOCK);
+				}
+
+				journal_.reset();	// restarted by revert or write
+				contentFromFile_ = false;
+				if(weakSelf_.get() == nullptr)
+					weakSelf_.reset(this, boost::null_deleter());
+				document_.setInput(std::weak_ptr<DocumentInput>(weakSelf_));
+				fileName_ = realName;
+				following_.reset();
+				if(FileChangeMonitor* const monitor = FileChangeMonitor::instance()) {
+					monitor->unwatch(*this);
+					watchedByMonitor_ = monitor->watch(*this, fileName_);
+				}
+				++numberOfFileChanges_;	// verify the time stamps at the next time
+				listeners_.notify<const TextFileDocumentInput&>(&FilePropertyListener::fileNameChanged, *this);
+				document_.setModified();
+			}
+
+			/// Cancels the writing started by @c #beginWrite and waits for the worker thread.
+			void TextFileDocumentInput::cancelWrite() BOOST_NOEXCEPT {
+				if(backgroundWriting_.get() != nullptr) {
+					backgroundWriting_->cancelled = true;
+					backgroundWriting_->result.wait();
+					boost::system::error_code ignored;
+					boost::filesystem::remove(backgroundWriting_->tempFileName, ignored);
+					backgroundWriting_.reset();
+					if(journal_.get() != nullptr)
+						journal_->unmark();
+				}
+			}
+
+			/**
+			 * Checks the last modified date/time of the bound file and verifies if the other modified the
+			 * file. If the file is modified, the listener's
+			 * @c IUnexpectedFileTimeStampDerector#queryAboutUnexpectedDocumentFileTimeStamp will be called.
+			 * @return The value which the listener returned or @c true if the listener is not set
+			 * @see #reload
+			 */
+			bool TextFileDocumentInput::checkTimeStamp() {
+				std::time_t newTimeStamp;
+				if(!verifyTimeStamp(false, newTimeStamp)) {
+					const boost::optional<std::time_t> original(userLastWriteTime_);
+					userLastWriteTime_ = boost::none;
+					if(timeStampDirector_ == nullptr
+							|| timeStampDirector_->queryAboutUnexpectedDocumentFileTimeStamp(
+								document_, UnexpectedFileTimeStampDirector::CLIENT_INVOCATION)) {
+						userLastWriteTime_ = newTimeStamp;
+						return true;
+					}
+					userLastWriteTime_ = original;
+					return false;
+				}
+				return true;
+			}
+
+			/// @see Document#ModificationSignChangedSignal
+			void TextFileDocumentInput::documentModificationSignChanged(const Document&) {
+				if(isBoundToFile() && desiredLockMode_.onlyAsEditing) {
+					if(!document().isModified())
 						fileLocker_->unlock();
 					else if(desiredLockMode_.type != NO_LOCK)
 						fileLocker_->lock(fileName(), desiredLockMode_.type == SHARED_LOCK);
 				}
 			}
 
+			/**
+			 * Completes the writing started by @c #beginWrite. If the worker thread finished, this replaces the
+			 * bound file with the written one and updates the status as @c #write does. This should be called by the
+			 * thread owns the document.
+			 * @param wait Set @c true to wait for the worker thread
+			 * @return @c false if @a wait is @c false and the worker thread is still writing, otherwise @c true
+			 * @throw ... Any exceptions the worker thread threw, or @c #write throws to replace the file
+			 * @see #beginWrite, #isWriting
+			 */
+			bool TextFileDocumentInput::endWrite(bool wait /* = true */) {
+				if(backgroundWriting_.get() == nullptr)
+					return true;
+				else if(!wait && backgroundWriting_->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+					return false;
+
+				const std::unique_ptr<BackgroundWriting> writing(std::move(backgroundWriting_));
+				try {
+					writing->result.get();
+				} catch(...) {
+					boost::system::error_code ignored;
+					boost::filesystem::remove(writing->tempFileName, ignored);
+					if(journal_.get() != nullptr)
+						journal_->unmark();
+					throw;
+				}
+				replaceFile(writing->tempFileName);
+				written(writing->snapshot->revisionNumber());
+				return true;
+			}
+
+			/// Called by @c FileChangeMonitor in the worker thread when the bound file may have been changed.
+			void TextFileDocumentInput::fileChanged() BOOST_NOEXCEPT {
+				++numberOfFileChanges_;
+				try {
+					fileChangedSignal_(*this);
+				} catch(...) {
+					// ignore
+				}
+			}
+
+			/// Returns the @c FileChangedSignal signal connector.
+			SignalConnector<TextFileDocumentInput::FileChangedSignal> TextFileDocumentInput::fileChangedSignal() BOOST_NOEXCEPT {
+				return makeSignalConnector(fileChangedSignal_);
+			}
+
+			/**
+			 * Writes the buffered records of the journal into the disk. This does nothing if the journal is not
+			 * written.
+			 * @throw boost#filesystem#filesystem_error
+			 * @see #writeJournal
+			 */
+			void TextFileDocumentInput::flushJournal() {
+				if(journal_.get() != nullptr)
+					journal_->flush();
+			}
+
+			/**
+			 * Brings the document up to date with the bound file which grows only at the end, such as a log file.
+			 *
+			 * The first call reads the whole file as @c #reload does, and starts following the file. The following
+			 * calls decode only the bytes appended to the file since the last call, with the encoder and the
+			 * conversion state kept from the last call, and append the decoded text to the document by one
+			 * insertion. The bytes at the end of the file which do not complete a character are decoded by the next
+			 * call. If the last call appended CR and the appended text begins with LF, they are joined into CRLF, as
+			 * when the whole file is read. The undo buffer is cleared and the document becomes unmodified as @c #reload does. If the
+			 * document was read only, it remains read only.
+			 *
+			 * If the file was truncated, rewritten or replaced by the other file (rotated), or the document was
+			 * changed by the other than this method, this method reads the whole file again.
+			 * @param encoding The file encoding or auto detection name. This is used only when the whole file is read
+			 * @param encodingSubstitutionPolicy The substitution policy used in encoding conversion
+			 * @param unexpectedTimeStampDirector
+			 * @return @c true if the document was changed
+			 * @throw IllegalStateException The object was not bound to a file
+			 * @throw IOException Any I/O error occurred. In this case, the document is not changed
+			 * @throw ... Any exceptions @c TextFileStreamBuffer#TextFileStreamBuffer and @c Document#replace throw
+			 * @see #isFollowing
+			 */
+			bool TextFileDocumentInput::follow(
+					const std::string& encoding, encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy,
+					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector /* = nullptr */) {
+				if(!isBoundToFile())
+					throw IllegalStateException("the object is not bound to a file.");
+
+				if(following_.get() != nullptr && following_->documentRevision == document().revisionNumber()
+#if ASCENSION_OS_POSIX
+						&& following_->identify(fileName(), false)
+#endif
+						) {
+					TextFileStreamBuffer sb(fileName(), std::ios_base::in,
+						following_->encoder->properties().name(), encodingSubstitutionPolicy, false);
+					const boost::iterator_range<const Byte*>& input = sb.mappedInput();
+					if(following_->isPrefixOf(input)) {
+						if(static_cast<std::uintmax_t>(boost::size(input)) == following_->decodedBytes)
+							return false;
+
+						// decode the appended bytes
+						const auto appended(boost::make_iterator_range(boost::const_begin(input) + following_->decodedBytes, boost::const_end(input)));
+						encoding::Encoder::State state(following_->decodingState);
+						const Byte* decodedEnd;
+						following_->encoder->setSubstitutionPolicy(encodingSubstitutionPolicy);
+						const std::shared_ptr<const String> text(
+							decodeCompleteCharacters(*following_->encoder, state, appended, decodedEnd, &decodeChunk));
+
+						// append to the document. the time stamp is not checked because the file was read just now
+						if(!text->empty()) {
+							UnexpectedFileTimeStampDirector* const director = timeStampDirector_;
+							const bool readOnly = document().isReadOnly();
+							timeStampDirector_ = nullptr;
+							document_.setReadOnly(false);
+							try {
+								// join CR at the end of the document and LF at the beginning of the text into CRLF
+								const Position end(*boost::const_end(document().region()));
+								if(text->front() == text::LINE_FEED && end.line > 0 && end.offsetInLine == 0
+										&& document().lineContent(end.line - 1).newline() == text::Newline::CARRIAGE_RETURN)
+									document_.replace(Region(Position(end.line - 1, document().lineLength(end.line - 1)), end),
+										StringPiece(String(1, text::CARRIAGE_RETURN) + *text));
+								else
+									insert(document_, end, StringPiece(*text));
+							} catch(...) {
+								document_.setReadOnly(readOnly);
+								timeStampDirector_ = director;
+								throw;
+							}
+							document_.setReadOnly(readOnly);
+							timeStampDirector_ = director;
+							document_.clearUndoBuffer();
+							document_.markUnmodified();
+							savedDocumentRevision_ = document().revisionNumber();
+							try {
+								internalLastWriteTime_ = boost::filesystem::last_write_time(fileName());
+								userLastWriteTime_ = internalLastWriteTime_;
+							} catch(const boost::filesystem::filesystem_error&) {
+								// ignore...
+							}
+							if(journal_.get() != nullptr)
+								journal_->restart();
+						}
+						following_->decodingState = std::move(state);
+						following_->decoded(input, decodedEnd);
+						following_->documentRevision = document().revisionNumber();
+						return !text->empty();
+					}
+				}
+
+				// read the whole file with the encoder kept for the following calls
+				TextFileStreamBuffer sb(fileName(), std::ios_base::in, encoding, encodingSubstitutionPolicy, false);
+				std::unique_ptr<Following> following(new Following);
+				following->encoder = encoding::EncoderRegistry::instance().forName(sb.encoding());
+				if(following->encoder.get() == nullptr)
+					throw encoding::UnsupportedEncodingException(sb.encoding());
+				following->encoder->setSubstitutionPolicy(encodingSubstitutionPolicy);
+#if ASCENSION_OS_POSIX
+				following->identify(fileName(), true);
+#endif
+				const boost::iterator_range<const Byte*>& input = sb.mappedInput();
+				const Byte* decodedEnd;
+				const DecodedLines decoded(
+					decodeCompleteCharacters(*following->encoder, following->decodingState, input, decodedEnd, &decodeLines));
+				following->decoded(input, decodedEnd);
+				const std::string newEncoding(sb.encoding());
+				const bool unicodeByteOrderMark = following->encoder->isByteOrderMarkEncountered(following->decodingState);
+				sb.close();
+
+				if(document_.isLazy())
+					document_.resetContent();
+				replaceContent(decoded.lines, newEncoding, unicodeByteOrderMark, unexpectedTimeStampDirector);
+				following->documentRevision = document().revisionNumber();
+				following_ = std::move(following);
+				return true;
+			}
+
 			/// @see DocumentInput#isChangeable
 			bool TextFileDocumentInput::isChangeable(const Document&) const BOOST_NOEXCEPT {
 				if(isBoundToFile()) {
@@ -564,6 +2155,11 @@ private:
 				return true;
 			}
 
+			/// Returns @c true if the writing started by @c #beginWrite has not been completed by @c #endWrite.
+			bool TextFileDocumentInput::isWriting() const BOOST_NOEXCEPT {
+				return backgroundWriting_.get() != nullptr;
+			}
+
 			/// @see DocumentInput#location
 			DocumentInput::LocationType TextFileDocumentInput::location() const BOOST_NOEXCEPT {
 #ifndef ASCENSION_ABANDONED_AT_VERSION_08
@@ -613,6 +2209,67 @@ private:
 					fileLocker_->unlock();
 			}
 
+			/**
+			 * Checks before writing the document into the bound file.
+			 * @param format The character encoding and the newlines
+			 * @return @c false if the writing is not needed or was aborted by @c UnexpectedFileTimeStampDirector
+			 * @throw IllegalStateException The object is not bound to a file
+			 * @throw ... Any exceptions @c verifyNewline throws
+			 */
+			bool TextFileDocumentInput::prepareWrite(const WritingFormat& format) {
+				if(!document().isModified())
+					return false;
+				if(!isBoundToFile())
+					throw IllegalStateException("no file name.");
+				verifyNewline(format.encoding, format.newline);
+
+				// TODO: check if the input had been truncated.
+
+				// check if the disk file had changed
+				if(timeStampDirector_ != nullptr) {
+					std::time_t realTimeStamp;
+					if(!verifyTimeStamp(true, realTimeStamp)) {
+						if(!timeStampDirector_->queryAboutUnexpectedDocumentFileTimeStamp(
+								document_, UnexpectedFileTimeStampDirector::OVERWRITE_FILE))
+							return false;
+					}
+				}
+				return true;
+			}
+
+			/**
+			 * Replaces the document's content with the text of the bound file on disk, like @c #revert. Unlike
+			 * @c #revert, this method compares the lines of the document and the file, and replaces only the
+			 * different lines by one change. So the points, the bookmarks and the caches of the layouts and the
+			 * partitions on the unchanged lines survive. This is suitable for the files changed by the other
+			 * processes frequently, such as logs and generated files.
+			 *
+			 * The modifications of the document are discarded, and the undo history is cleared as @c #revert does.
+			 * If the document was loaded by @c #revertLazily, this method calls @c #revert.
+			 * @param encoding The file encoding or auto detection name
+			 * @param encodingSubstitutionPolicy The substitution policy used in encoding conversion
+			 * @param unexpectedTimeStampDirector
+			 * @throw IllegalStateException The object was not bound to a file
+			 * @throw IOException Any I/O error occurred. In this case, the document is not changed
+			 * @throw ... Any exceptions @c insertFileContents and @c Document#replace throw
+			 * @see #checkTimeStamp, #revert
+			 */
+			void TextFileDocumentInput::reload(
+					const std::string& encoding, encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy,
+					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector /* = nullptr */) {
+				if(!isBoundToFile())
+					throw IllegalStateException("the object is not bound to a file.");
+				else if(document_.isLazy())
+					return revert(encoding, encodingSubstitutionPolicy, unexpectedTimeStampDirector);
+
+				// read from the file before touching the document
+				DecodedLines decoded;
+				std::string newEncoding;
+				bool unicodeByteOrderMark;
+				std::tie(decoded, newEncoding, unicodeByteOrderMark) = readFileContents(fileName(), encoding, encodingSubstitutionPolicy);
+				replaceContent(decoded.lines, newEncoding, unicodeByteOrderMark, unexpectedTimeStampDirector);
+			}
+
 			/**
 			 * Removes the file property listener.
 			 * @param listener The listener to be removed
@@ -622,6 +2279,92 @@ private:
 				listeners_.remove(listener);
 			}
 
+			/**
+			 * Replaces the content of the document with the text read from the bound file, by replacing only the
+			 * changed lines. This is used by @c #reload and @c #follow.
+			 * @param lines The lines read from the file
+			 * @param encoding The encoding of the file
+			 * @param unicodeByteOrderMark @c true if the file contained Unicode byte order mark
+			 * @param unexpectedTimeStampDirector
+			 * @throw ... Any exceptions @c Document#replace throws
+			 */
+			void TextFileDocumentInput::replaceContent(const std::vector<DocumentContentLine>& lines, const std::string& encoding,
+					bool unicodeByteOrderMark, UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector) {
+				cancelWrite();
+				journal_.reset();
+				timeStampDirector_ = nullptr;
+				document_.setReadOnly(false);
+				replaceChangedLines(document_, lines);
+				encoding_ = encoding;
+				unicodeByteOrderMark_ = unicodeByteOrderMark;
+				reverted(unexpectedTimeStampDirector);
+
+				if(writesJournal())
+					journal_.reset(new Journal(document_, fileName(), false));
+			}
+
+			/**
+			 * Replaces the bound file with the written temporary file, keeping the file attributes.
+			 * @param tempFileName The name of the temporary file
+			 * @throw ...
+			 */
+			void TextFileDocumentInput::replaceFile(const boost::filesystem::path& tempFileName) {
+				// TODO: backup the file.
+				const bool makeBackup = false;
+
+				// copy file attributes (file mode) and delete the old file
+				try {
+					if(fileLocker_->type() != NO_LOCK)
+						unlockFile();
+
+					bool fileMayLost = false;
+					boost::system::error_code ignored;
+#if BOOST_OS_WINDOWS
+					const DWORD attributes = ::GetFileAttributesW(fileName().c_str());
+					if(attributes != INVALID_FILE_ATTRIBUTES) {
+						::SetFileAttributesW(tempFileName.c_str(), attributes);
+#else // ASCENSION_OS_POSIX
+					struct stat s;
+					bool fileLost = false;
+					if(::stat(fileName().c_str(), &s) != -1) {
+						::chmod(tempFileName.c_str(), s.st_mode);
+#endif
+						fileMayLost = true;
+
+						if(makeBackup) {
+						} else {
+							try {
+								boost::filesystem::remove(fileName());
+							} catch(const boost::filesystem::filesystem_error& e) {
+#ifndef _DEBUG
+								boost::ignore_unused(e);
+#endif
+								assert(e.code().value() != boost::system::errc::no_such_file_or_directory);
+								boost::filesystem::remove(tempFileName, ignored);	// ignore the result
+								throw;
+							}
+						}
+					}
+					try {
+						boost::filesystem::rename(tempFileName, fileName());
+					} catch(const boost::filesystem::filesystem_error&) {
+						if(fileMayLost)
+							throw std::ios_base::failure("lost the disk file.");
+						boost::filesystem::remove(fileName(), ignored);	// ignore the result
+						throw;
+					}
+				} catch(...) {
+					try {
+						lockFile(desiredLockMode_);
+					} catch(...) {
+						throw;
+					}
+				}
+
+				// relock the file
+				lockFile(desiredLockMode_);
+			}
+
 			/**
 			 * Replaces the document's content with the text of the bound file on disk.
 			 * @param encoding The file encoding or auto detection name
@@ -629,32 +2372,102 @@ private:
 			 * @param unexpectedTimeStampDirector
 			 * @throw IllegalStateException The object was not bound to a file
 			 * @throw IOException Any I/O error occurred. in this case, the document's content will be lost
+			 * @throw boost#filesystem#filesystem_error Failed to open the journal. In this case, the content has been
+			 *                                          read
 			 * @throw ... Any exceptions @c insertFileContents throws
+			 * @see #writeJournal
 			 */
 			void TextFileDocumentInput::revert(
 					const std::string& encoding, encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy,
 					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector /* = nullptr */) {
 				if(!isBoundToFile())
 					throw IllegalStateException("the object is not bound to a file.");
+				cancelWrite();
+				journal_.reset();
+				document_.resetContent();
+				timeStampDirector_ = nullptr;
+
+				// read from the file. the document shares the read text without copying
+				try {
+					DecodedLines decoded;
+					std::tie(decoded, encoding_, unicodeByteOrderMark_) = readFileContents(fileName(), encoding, encodingSubstitutionPolicy);
+					document_.loadContent(decoded.batches, decoded.lines);
+				} catch(...) {
+					document_.resetContent();
+					throw;
+				}
+
+				reverted(unexpectedTimeStampDirector);
+
+				// replay the journal left by the crash
+				if(writesJournal())
+					journal_.reset(new Journal(document_, fileName(), true));
+			}
+
+			/**
+			 * Replaces the document's content with the text of the bound file on disk, for read-only viewing. Unlike
+			 * @c #revert, this method does not decode the whole file. The file is memory-mapped, the line breaks in
+			 * it are scanned once, and the document decodes each line when it is accessed (see
+			 * @c Document#loadContent). So the time to open and the memory usage scale with the lines actually
+			 * viewed, which is suitable for huge files such as logs.
+			 *
+			 * The document becomes read only until the content is reset. The file is kept open and mapped during
+			 * that, so the file should not be truncated by the other processes. Malformed input and unmappable
+			 * bytes are replaced with U+FFFD. Only CR, LF and CRLF are recognized as line breaks.
+			 *
+			 * If CR or LF is not a single byte in the encoding of the file (UTF-16 for example), or the encoding is
+			 * stateful (ISO-2022 and UTF-7), this method reads the whole file as @c #revert does, and the document
+			 * becomes read only as well.
+			 *
+			 * No journal is written for the read only content, even if @c #writesJournal returns @c true. The
+			 * journal file left by a crash is kept for @c #revert to replay, instead of being recreated.
+			 * @param encoding The file encoding or auto detection name
+			 * @param numberOfCachedLines The maximum number of the decoded lines the document caches
+			 * @param unexpectedTimeStampDirector
+			 * @throw IllegalStateException The object was not bound to a file
+			 * @throw std#invalid_argument @a numberOfCachedLines is zero
+			 * @throw IOException Any I/O error occurred. in this case, the document's content will be lost
+			 * @throw ... Any exceptions @c TextFileStreamBuffer#TextFileStreamBuffer throws
+			 */
+			void TextFileDocumentInput::revertLazily(const std::string& encoding, std::size_t numberOfCachedLines /* = 4096 */,
+					UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector /* = nullptr */) {
+				if(!isBoundToFile())
+					throw IllegalStateException("the object is not bound to a file.");
+				else if(numberOfCachedLines == 0)
+					throw std::invalid_argument("numberOfCachedLines");
+				cancelWrite();
+				journal_.reset();
 				document_.resetContent();
 				timeStampDirector_ = nullptr;
 
-				// read from the file
-				const bool recorded = document().isRecordingChanges();
-				document_.recordChanges(false);
 				try {
-					std::tie(encoding_, unicodeByteOrderMark_, std::ignore) =
-						insertFileContents(document_, *boost::const_begin(document().region()), fileName(), encoding, encodingSubstitutionPolicy);
+					if(const std::shared_ptr<const MappedTextFileLineSource> source = MappedTextFileLineSource::open(fileName(), encoding)) {
+						encoding_ = source->encoding();
+						unicodeByteOrderMark_ = source->unicodeByteOrderMark();
+						document_.loadContent(source, numberOfCachedLines);
+					} else {
+						DecodedLines decoded;
+						std::tie(decoded, encoding_, unicodeByteOrderMark_) =
+							readFileContents(fileName(), encoding, encoding::Encoder::REPLACE_UNMAPPABLE_CHARACTERS);
+						document_.loadContent(decoded.batches, decoded.lines);
+						document_.setReadOnly();
+					}
 				} catch(...) {
 					document_.resetContent();
-					document_.recordChanges(recorded);
 					throw;
 				}
-				document_.recordChanges(recorded);
+
+				reverted(unexpectedTimeStampDirector);
+			}
+
+			/// Updates the properties after @c #reload, @c #revert or @c #revertLazily loaded the content of the file.
+			void TextFileDocumentInput::reverted(UnexpectedFileTimeStampDirector* unexpectedTimeStampDirector) {
+				following_.reset();
 
 				// set the new properties of the document
 				savedDocumentRevision_ = document().revisionNumber();
 				timeStampDirector_ = unexpectedTimeStampDirector;
+				contentFromFile_ = true;
 				{
 					String titleString;
 #if BOOST_OS_WINDOWS
@@ -737,13 +2550,20 @@ private:
 			 * @note This method does NOT reset the content of the document.
 			 */
 			void TextFileDocumentInput::unbind() BOOST_NOEXCEPT {
+				cancelWrite();
 				if(isBoundToFile()) {
+					journal_.reset();
 					fileLocker_->unlock();	// this may return false
 					if(const std::shared_ptr<DocumentInput> input = document().input().lock()) {
 						if(input.get() == static_cast<const DocumentInput*>(this))
 							document_.setInput(std::weak_ptr<DocumentInput>());
 					}
+					if(FileChangeMonitor* const monitor = FileChangeMonitor::instance())
+						monitor->unwatch(*this);
+					watchedByMonitor_ = false;
 					fileName_.clear();
+					contentFromFile_ = false;
+					following_.reset();
 					listeners_.notify<const TextFileDocumentInput&>(&FilePropertyListener::fileNameChanged, *this);
 					setEncoding(encoding::Encoder::defaultInstance().properties().name());
 					userLastWriteTime_ = internalLastWriteTime_ = boost::none;
@@ -765,12 +2585,21 @@ private:
 				if(!isBoundToFile() || about == boost::none || fileLocker_->hasLock())
 					return true;	// not managed
 
+				// if the file is watched, stat only when FileChangeMonitor reported a change after the last verification
+				std::size_t& verifiedChanges = internal ? numberOfInternallyVerifiedFileChanges_ : numberOfUserVerifiedFileChanges_;
+				const std::size_t changes = numberOfFileChanges_;
+				if(watchedByMonitor_ && changes == verifiedChanges)
+					return true;
+
 				try {
 					newTimeStamp = boost::filesystem::last_write_time(fileName());
 				} catch(const boost::filesystem::filesystem_error&) {
 					return true;
 				}
-				return std::difftime(*about, newTimeStamp) >= 0;
+				if(std::difftime(*about, newTimeStamp) < 0)
+					return false;	// verify again at the next time
+				verifiedChanges = changes;
+				return true;
 			}
 
 			/*
@@ -791,92 +2620,110 @@ private:
 			*/
 
 			/**
-			 * Writes the content of the document into the bound file.
+			 * Writes the content of the document into the bound file. This blocks until the whole document is written.
+			 * If the writing started by @c #beginWrite has not been completed, it is cancelled.
 			 * @param format The character encoding and the newlines
 			 * @param options The other options
 			 * @throw ...
+			 * @see #beginWrite
 			 */
 			void TextFileDocumentInput::write(const WritingFormat& format, const WritingOption* options /* = nullptr */) {
-				if(!document().isModified())
+				cancelWrite();
+				if(!prepareWrite(format))
 					return;
-				if(!isBoundToFile())
-					throw IllegalStateException("no file name.");
-				verifyNewline(format.encoding, format.newline);
-
-				// TODO: check if the input had been truncated.
-
-				// check if the disk file had changed
-				if(timeStampDirector_ != nullptr) {
-					std::time_t realTimeStamp;
-					if(!verifyTimeStamp(true, realTimeStamp)) {
-						if(!timeStampDirector_->queryAboutUnexpectedDocumentFileTimeStamp(
-								document_, UnexpectedFileTimeStampDirector::OVERWRITE_FILE))
-							return;
-					}
-				}
-
-				// TODO: backup the file.
-				const bool makeBackup = false;
 
 				// create a temporary file and write into
 				const boost::filesystem::path tempFileName(makeTemporaryFileName(fileName()));
 				writeRegion(document(), document().region(), tempFileName, format, false);
 
-				// copy file attributes (file mode) and delete the old file
-				try {
-					if(fileLocker_->type() != NO_LOCK)
-						unlockFile();
+				replaceFile(tempFileName);
+				written(document().revisionNumber());
+			}
 
-					bool fileMayLost = false;
-					boost::system::error_code ignored;
-#if BOOST_OS_WINDOWS
-					const DWORD attributes = ::GetFileAttributesW(fileName().c_str());
-					if(attributes != INVALID_FILE_ATTRIBUTES) {
-						::SetFileAttributesW(tempFileName.c_str(), attributes);
-#else // ASCENSION_OS_POSIX
-					struct stat s;
-					bool fileLost = false;
-					if(::stat(fileName().c_str(), &s) != -1) {
-						::chmod(tempFileName.c_str(), s.st_mode);
-#endif
-						fileMayLost = true;
+			/**
+			 * Starts or stops recording the changes of the document in the journal file.
+			 *
+			 * When started, the journal is created for the current version of the bound file. If the document has
+			 * not been modified since it was read, the journal left by a crash is replayed first (see @c #revert).
+			 * If the document has been modified, the old journal can not be applied and the whole content is
+			 * recorded instead. If the object is not bound to a file, the content has not been read from the file
+			 * yet, or the document is loaded lazily by @c #revertLazily, only the flag is set and the journal is
+			 * created by the next @c #revert or @c #write. So the journal left by a crash survives until then.
+			 * @param write Set @c true to write the journal
+			 * @return This object
+			 * @throw boost#filesystem#filesystem_error Failed to create the journal
+			 * @see #flushJournal, #writesJournal
+			 */
+			TextFileDocumentInput& TextFileDocumentInput::writeJournal(bool write /* = true */) {
+				if(!write)
+					journal_.reset();
+				else if(journal_.get() == nullptr && isBoundToFile() && contentFromFile_ && !document().isLazy())
+					journal_.reset(new Journal(document_, fileName(), !document().isModified()));
+				writesJournal_ = write;
+				return *this;
+			}
 
-						if(makeBackup) {
-						} else {
-							try {
-								boost::filesystem::remove(fileName());
-							} catch(const boost::filesystem::filesystem_error& e) {
-#ifndef _DEBUG
-								boost::ignore_unused(e);
-#endif
-								assert(e.code().value() != boost::system::errc::no_such_file_or_directory);
-								boost::filesystem::remove(tempFileName, ignored);	// ignore the result
-								throw;
-							}
+			/**
+			 * Writes the snapshot into the temporary file. This is called by the worker thread @c #beginWrite
+			 * started, and returns without writing if the writing was cancelled.
+			 * @param writing The writing
+			 * @throw ... Any exceptions @c TextFileStreamBuffer throws
+			 */
+			void TextFileDocumentInput::writeSnapshot(BackgroundWriting& writing) {
+				const DocumentSnapshot& snapshot = *writing.snapshot;
+				const WritingFormat& format = writing.format;
+				const Index numberOfLines = snapshot.numberOfLines();
+				const Index interval = (writing.monitor != nullptr) ? std::max<Index>(writing.monitor->queryIntervalLineCount(), 1) : numberOfLines;
+				const String eol(format.newline.isLiteral() ? format.newline.asString() : String());
+				assert(!eol.empty() || format.newline == text::Newline::USE_INTRINSIC_VALUE);
+
+				TextFileStreamBuffer sb(writing.tempFileName, std::ios_base::out,
+					format.encoding, format.encodingSubstitutionPolicy, format.unicodeByteOrderMark);
+				try {
+					sb.setOutputOverlapped(true).setSyncPolicy(format.syncPolicy);
+					std::basic_ostream<Char> out(&sb);
+					out.exceptions(std::ios_base::badbit);
+					String text;
+					text::Newline newline;
+					for(Index line = 0; line < numberOfLines; ++line) {
+						if(writing.cancelled) {
+							sb.closeAndDiscard();
+							return;
 						}
+						snapshot.readLine(line, text, newline);
+						out.write(text.data(), static_cast<std::streamsize>(text.length()));
+						if(line + 1 < numberOfLines) {
+							if(format.newline == text::Newline::USE_INTRINSIC_VALUE) {
+								const String intrinsicEol(newline.asString());
+								out.write(intrinsicEol.data(), static_cast<std::streamsize>(intrinsicEol.length()));
+							} else
+								out.write(eol.data(), static_cast<std::streamsize>(eol.length()));
+						}
+						if(writing.monitor != nullptr && (line + 1) % interval == 0)
+							writing.monitor->onProgress(FileIOProgressMonitor::WRITING, line + 1, numberOfLines);
 					}
-					try {
-						boost::filesystem::rename(tempFileName, fileName());
-					} catch(const boost::filesystem::filesystem_error&) {
-						if(fileMayLost)
-							throw std::ios_base::failure("lost the disk file.");
-						boost::filesystem::remove(fileName(), ignored);	// ignore the result
-						throw;
-					}
+					out.flush();
 				} catch(...) {
-					try {
-						lockFile(desiredLockMode_);
-					} catch(...) {
-						throw;
-					}
+					sb.closeAndDiscard();
+					throw;
 				}
+				sb.close();
+				if(writing.monitor != nullptr && numberOfLines % interval != 0)
+					writing.monitor->onProgress(FileIOProgressMonitor::WRITING, numberOfLines, numberOfLines);
+			}
 
-				// relock the file
-				lockFile(desiredLockMode_);
-
-				// update internal status
-				savedDocumentRevision_ = document().revisionNumber();
-				document_.markUnmodified();
+			/**
+			 * Updates the status after the document was written into the bound file.
+			 * @param revisionNumber The revision number of the written document. If the document has been changed
+			 *                       from this revision, the document remains modified
+			 * @throw boost#filesystem#filesystem_error Failed to open the journal. In this case, the status has been
+			 *                                          updated
+			 */
+			void TextFileDocumentInput::written(std::size_t revisionNumber) {
+				following_.reset();
+				savedDocumentRevision_ = revisionNumber;
+				if(document().revisionNumber() == revisionNumber)
+					document_.markUnmodified();
 				document_.setReadOnly(false);
 
 				// update the internal time stamp
@@ -886,6 +2733,14 @@ private:
 					internalLastWriteTime_ = boost::none;
 				}
 				userLastWriteTime_ = internalLastWriteTime_;
+				contentFromFile_ = true;
+
+				// the journal applies to the written file. only the changes made during the writing are kept. the
+				// journal is created if bind() discarded it because the document was written into another file
+				if(journal_.get() != nullptr)
+					journal_->rebase(revisionNumber);
+				else if(writesJournal())
+					journal_.reset(new Journal(document_, fileName(), false));
 			}
 		}
 	}
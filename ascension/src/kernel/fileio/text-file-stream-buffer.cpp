@@ -9,13 +9,17 @@
 #include <ascension/corelib/encoding/encoder-factory.hpp>
 #include <ascension/corelib/encoding/encoding-detector.hpp>
 #include <ascension/kernel/fileio/text-file-stream-buffer.hpp>
-#if ASCENSION_OS_POSIX
-#	include <sys/mman.h>	// mmap, munmap, ...
-#endif // !ASCENSION_OS_POSIX
+#include <algorithm>	// std.min
 #if BOOST_OS_WINDOWS
 #	include <ascension/win32/windows.hpp>
 #	include <cwctype>
 #	include <limits>	// std.numeric_limits
+#else // ASCENSION_OS_POSIX
+#	include <cerrno>		// errno
+#	include <fcntl.h>		// open
+#	include <sys/mman.h>	// mmap, munmap, ...
+#	include <sys/uio.h>	// writev
+#	include <unistd.h>		// close, fsync, lseek
 #endif
 
 
@@ -32,6 +36,9 @@ namespace ascension {
 			// TextFileStreamBuffer ///////////////////////////////////////////////////////////////////////////////////
 
 			namespace {
+				const std::size_t OUTPUT_SEGMENT_BYTES = 0x100000;
+				const std::size_t OUTPUT_SEGMENTS_PER_BATCH = 4;	// written by one writev(2) call
+
 				class SystemErrorSaver {
 				public:
 					SystemErrorSaver() BOOST_NOEXCEPT : code_(makePlatformError().code().value()) {}
@@ -71,7 +78,7 @@ namespace ascension {
 			 */
 			TextFileStreamBuffer::TextFileStreamBuffer(const boost::filesystem::path& fileName, std::ios_base::openmode mode,
 					const std::string& encoding, encoding::Encoder::SubstitutionPolicy encodingSubstitutionPolicy,
-					bool writeUnicodeByteOrderMark) : fileName_(fileName), mode_(mode) {
+					bool writeUnicodeByteOrderMark) : fileName_(fileName), mode_(mode), outputOverlapped_(false), syncPolicy_(DONT_SYNC) {
 //				sanityCheckPathName(fileName, "fileName");
 				if(mode == std::ios_base::in)
 					openForReading(encoding);
@@ -146,19 +153,35 @@ namespace ascension {
 					}
 				}
 				if(!succeeded)
-					throw detail::makeGenericFileSystemError("lseek(2) returned -1.", fileName());
+					throw detail::makeFileSystemError("lseek(2) returned -1.", fileName());
 #endif
 				inputMapping_.buffer = boost::make_iterator_range(std::begin(inputMapping_.buffer), std::begin(inputMapping_.buffer) + fileSize);
 				inputMapping_.current = std::begin(inputMapping_.buffer);
 			}
 
 			/**
-			 * Closes the file.
+			 * Closes the file. If the file is open for writing, the written data is flushed to the storage device
+			 * according to @c #syncPolicy.
 			 * @return This or @c null if the file is not open
 			 * @throw ... Any exceptions @c #sync throws
 			 */
 			TextFileStreamBuffer* TextFileStreamBuffer::close() {
 				sync();
+				if(isOpen() && mode() != std::ios_base::in && syncPolicy() != DONT_SYNC) {
+#if BOOST_OS_WINDOWS
+					if(!win32::boole(::FlushFileBuffers(fileHandle_)))
+						throw detail::makeFileSystemError("FlushFileBuffers() returned FALSE.", fileName());
+#elif BOOST_OS_MACOS
+					if(::fsync(fileDescriptor_) == -1)
+						throw detail::makeFileSystemError("fsync(2) returned -1.", fileName());
+#else // ASCENSION_OS_POSIX
+					if(syncPolicy() == SYNC_DATA) {
+						if(::fdatasync(fileDescriptor_) == -1)
+							throw detail::makeFileSystemError("fdatasync(2) returned -1.", fileName());
+					} else if(::fsync(fileDescriptor_) == -1)
+						throw detail::makeFileSystemError("fsync(2) returned -1.", fileName());
+#endif
+				}
 				return closeFile();
 			}
 
@@ -190,6 +213,10 @@ namespace ascension {
 			}
 
 			TextFileStreamBuffer* TextFileStreamBuffer::closeFile() BOOST_NOEXCEPT {
+				if(outputWriting_.valid())
+					outputWriting_.wait();	// the error is discarded with the output
+				outputWriting_ = std::future<void>();
+				outputBatches_.front().numberOfSegments = outputBatches_.back().numberOfSegments = 0;
 #if BOOST_OS_WINDOWS
 				if(fileMapping_ != nullptr) {
 					::UnmapViewOfFile(const_cast<Byte*>(std::begin(inputMapping_.buffer)));
@@ -203,11 +230,11 @@ namespace ascension {
 					return this;
 				}
 #else // ASCENSION_OS_POSIX
-				if(inputMapping_.first != nullptr) {
-					::munmap(const_cast<Byte*>(inputMapping_.first), inputMapping_.last - inputMapping_.first);
-					inputMapping_.first = nullptr;
+				if(std::begin(inputMapping_.buffer) != nullptr) {
+					::munmap(const_cast<Byte*>(std::begin(inputMapping_.buffer)), boost::size(inputMapping_.buffer));
+					inputMapping_.buffer = boost::make_iterator_range<const Byte*>(nullptr, nullptr);
 				}
-				if(fileDescriptor_ == -1) {
+				if(fileDescriptor_ != -1) {
 					::close(fileDescriptor_);
 					fileDescriptor_ = -1;
 					return this;
@@ -218,6 +245,46 @@ namespace ascension {
 				return nullptr;	// didn't close the file actually
 			}
 
+			/**
+			 * Encodes the specified characters into the output segments. The full batch of the segments is submitted.
+			 * @param first The beginning of the characters
+			 * @param last The end of the characters
+			 * @throw UnmappableCharacterException
+			 * @throw text#MalformedInputException&lt;Char&gt;
+			 * @throw ... Any exceptions @c #submitOutput throws
+			 */
+			void TextFileStreamBuffer::encodeOutput(const Char* first, const Char* last) {
+				if(first == last)
+					return;
+				if(outputBatches_.front().numberOfSegments == 0)
+					nextOutputSegment();
+				while(true) {
+					OutputBatch& batch = outputBatches_.front();
+					OutputSegment& segment = batch.segments[batch.numberOfSegments - 1];
+					Byte* toNext;
+					const Char* fromNext;
+					const auto encodingResult = encoder_->fromUnicode(encodingState_,
+						boost::make_iterator_range(segment.bytes.get() + segment.length, segment.bytes.get() + OUTPUT_SEGMENT_BYTES), toNext,
+						boost::make_iterator_range(first, last), fromNext);
+					segment.length = toNext - segment.bytes.get();
+					if(encodingResult == encoding::Encoder::UNMAPPABLE_CHARACTER)
+						throw UnmappableCharacterException();
+					else if(encodingResult == encoding::Encoder::MALFORMED_INPUT)
+						throw text::MalformedInputException<Char>(*fromNext);
+					first = fromNext;
+					if(encodingResult != encoding::Encoder::INSUFFICIENT_BUFFER)
+						break;
+					assert(segment.length != 0);	// or the next segment can not hold the character either
+					nextOutputSegment();	// the segment is full
+				}
+			}
+
+			/// Encodes the characters in the put area and empties the put area.
+			inline void TextFileStreamBuffer::encodePutArea() {
+				encodeOutput(pbase(), pptr());
+				setp(ucsBuffer_.data(), ucsBuffer_.data() + ucsBuffer_.size());
+			}
+
 			/**
 			 * Returns the character encoding. If the encoding name passed to the constructor was detection
 			 * name, returns the detected encoding.
@@ -235,6 +302,19 @@ namespace ascension {
 #endif
 			}
 
+			/// Begins the next output segment. If the batch is full, submits it first.
+			void TextFileStreamBuffer::nextOutputSegment() {
+				if(outputBatches_.front().numberOfSegments == OUTPUT_SEGMENTS_PER_BATCH)
+					submitOutput();
+				OutputBatch& batch = outputBatches_.front();
+				if(batch.numberOfSegments == batch.segments.size()) {
+					OutputSegment segment;
+					segment.bytes.reset(new Byte[OUTPUT_SEGMENT_BYTES]);
+					batch.segments.push_back(std::move(segment));
+				}
+				batch.segments[batch.numberOfSegments++].length = 0;
+			}
+
 			// called by only the constructor
 			void TextFileStreamBuffer::openForReading(const std::string& encoding) {
 				// open the file
@@ -285,7 +365,7 @@ namespace ascension {
 							throw detail::makeFileSystemError("lseek(2) returned -1.", fileName());
 					} else {
 						if(errno == ENOENT)
-							mode_ &= ~ios_base::app;
+							mode_ &= ~std::ios_base::app;
 						else
 							throw detail::makeFileSystemError("open(2) returned -1.", fileName());
 					}
@@ -298,7 +378,7 @@ namespace ascension {
 					if(fileHandle_ == INVALID_HANDLE_VALUE)
 						throw detail::makeFileSystemError("CreateFileW() returned INVALID_HANDLE_VALUE.", fileName());
 #else // ASCENSION_OS_POSIX
-					fileDescriptor_ = ::open(fileName().c_str(), O_WRONLY | O_CREAT);
+					fileDescriptor_ = ::open(fileName().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
 					if(fileDescriptor_ == -1)
 						throw detail::makeFileSystemError("open(2) returned -1", fileName());
 #endif
@@ -322,11 +402,14 @@ namespace ascension {
 
 			/// @see std#basic_streambuf#overflow
 			TextFileStreamBuffer::int_type TextFileStreamBuffer::overflow(int_type c) {
-				if(std::begin(inputMapping_.buffer) != nullptr || sync() == -1)
-					return traits_type::eof();	// not output mode or can't synchronize
+				if(!isOpen() || std::begin(inputMapping_.buffer) != nullptr)
+					return traits_type::eof();	// not output mode
 
-				*pptr() = traits_type::to_char_type(c);
-				pbump(+1);
+				encodePutArea();
+				if(!traits_type::eq_int_type(c, traits_type::eof())) {
+					*pptr() = traits_type::to_char_type(c);
+					pbump(+1);
+				}
 				return traits_type::not_eof(c);
 			}
 
@@ -341,45 +424,60 @@ namespace ascension {
 				return traits_type::eof();
 			}
 
+			/**
+			 * Sets whether the output is written by another thread while the following output is encoded. This
+			 * overlaps the encoding with the I/O at the cost of the memory for another batch of the segments.
+			 * @param overlap Set @c true to overlap
+			 * @return This object
+			 * @throw ... Any I/O error of the overlapped writing, if @a overlap is @c false
+			 * @see #isOutputOverlapped
+			 */
+			TextFileStreamBuffer& TextFileStreamBuffer::setOutputOverlapped(bool overlap) {
+				if(!overlap)
+					waitForOutput();
+				outputOverlapped_ = overlap;
+				return *this;
+			}
+
+			/**
+			 * Sets how @c #close flushes the written data to the storage device. The default is @c DONT_SYNC.
+			 * @param policy The new policy
+			 * @return This object
+			 * @throw UnknownValueException @a policy is invalid
+			 * @see #syncPolicy
+			 */
+			TextFileStreamBuffer& TextFileStreamBuffer::setSyncPolicy(SyncPolicy policy) {
+				if(policy < DONT_SYNC || policy > SYNC_ALL)
+					throw UnknownValueException("policy");
+				syncPolicy_ = policy;
+				return *this;
+			}
+
+			/**
+			 * Submits the batch of the output segments to be written. If the output is overlapped, this returns
+			 * without waiting for the writing.
+			 * @throw ... Any I/O error of the previous writing or of this writing if not overlapped
+			 */
+			void TextFileStreamBuffer::submitOutput() {
+				waitForOutput();
+				if(outputBatches_.front().numberOfSegments == 0)
+					return;
+				std::swap(outputBatches_.front(), outputBatches_.back());
+				if(isOutputOverlapped())
+					outputWriting_ = std::async(std::launch::async, [this]() {
+						writeOutputBatch(outputBatches_.back());
+					});
+				else
+					writeOutputBatch(outputBatches_.back());
+			}
+
 			/// std#basic_streambuf#sync
 			int TextFileStreamBuffer::sync() {
-				// this method converts ucsBuffer_ into the native encoding and writes
-				if(isOpen() && std::begin(inputMapping_.buffer) == nullptr && pptr() > pbase()) {
-					Byte* toNext;
-					const Char* fromNext;
-					std::array<Byte, std::tuple_size<decltype(ucsBuffer_)>::value> nativeBuffer;
-					while(true) {
-						const Char* const fromEnd = pptr();
-
-						// conversion
-						const auto encodingResult = encoder_->fromUnicode(encodingState_,
-							boost::make_iterator_range_n(nativeBuffer.data(), nativeBuffer.size()), toNext,
-							boost::make_iterator_range<const Char*>(pbase(), fromEnd), fromNext);
-						if(encodingResult == encoding::Encoder::UNMAPPABLE_CHARACTER)
-							throw UnmappableCharacterException();
-						else if(encodingResult == encoding::Encoder::MALFORMED_INPUT)
-							throw text::MalformedInputException<Char>(*fromNext);
-
-						// write into the file
-#if BOOST_OS_WINDOWS
-						DWORD writtenBytes;
-						assert(static_cast<std::size_t>(toNext - nativeBuffer.data()) <= std::numeric_limits<DWORD>::max());
-						const DWORD bytes = static_cast<DWORD>(toNext - nativeBuffer.data());
-						if(::WriteFile(fileHandle_, nativeBuffer.data(), bytes, &writtenBytes, 0) == 0 || writtenBytes != bytes)
-							throw detail::makeFileSystemError("WriteFile() failed.", fileName());
-#else // ASCENSION_OS_POSIX
-						const std::size_t bytes = toNext - nativeBuffer;
-						const ssize_t writtenBytes = ::write(fileDescriptor_, nativeBuffer, bytes);
-						if(writtenBytes == -1 || static_cast<std::size_t>(writtenBytes) != bytes)
-							throw detail::makeFileSystemError("write(2) failed.", fileName());
-#endif
-
-						setp(ucsBuffer_.data() + (fromNext - ucsBuffer_.data()), epptr());
-						pbump(static_cast<int>(fromEnd - pbase()));	// TODO: this cast may be danger.
-						if(encodingResult == encoding::Encoder::COMPLETED)
-							break;
-					}
-					setp(ucsBuffer_.data(), ucsBuffer_.data() + ucsBuffer_.size());
+				// this method converts the put area into the native encoding and writes all the encoded bytes
+				if(isOpen() && std::begin(inputMapping_.buffer) == nullptr) {
+					encodePutArea();
+					submitOutput();
+					waitForOutput();
 				}
 				return 0;
 			}
@@ -415,6 +513,76 @@ namespace ascension {
 				return encoder_->isByteOrderMarkEncountered(decodingState_);
 			}
 
+			/**
+			 * Waits for the overlapped writing.
+			 * @throw ... Any I/O error of the writing
+			 */
+			void TextFileStreamBuffer::waitForOutput() {
+				if(outputWriting_.valid())
+					outputWriting_.get();
+			}
+
+			/**
+			 * Writes the output segments into the file and empties the batch.
+			 * @param batch The batch to write
+			 * @throw boost#filesystem#filesystem_error
+			 */
+			void TextFileStreamBuffer::writeOutputBatch(OutputBatch& batch) const {
+#if BOOST_OS_WINDOWS
+				// WriteFileGather requires FILE_FLAG_NO_BUFFERING and the page-aligned segments
+				for(std::size_t i = 0; i < batch.numberOfSegments; ++i) {
+					const OutputSegment& segment = batch.segments[i];
+					DWORD writtenBytes;
+					const DWORD bytes = static_cast<DWORD>(segment.length);
+					if(::WriteFile(fileHandle_, segment.bytes.get(), bytes, &writtenBytes, 0) == 0 || writtenBytes != bytes)
+						throw detail::makeFileSystemError("WriteFile() failed.", fileName());
+				}
+#else // ASCENSION_OS_POSIX
+				std::array<iovec, OUTPUT_SEGMENTS_PER_BATCH> vectors;
+				for(std::size_t i = 0; i < batch.numberOfSegments; ++i) {
+					vectors[i].iov_base = batch.segments[i].bytes.get();
+					vectors[i].iov_len = batch.segments[i].length;
+				}
+				for(iovec* next = vectors.data(), * const end = next + batch.numberOfSegments; ; ) {
+					while(next < end && next->iov_len == 0)
+						++next;
+					if(next == end)
+						break;
+					const ssize_t writtenBytes = ::writev(fileDescriptor_, next, static_cast<int>(end - next));
+					if(writtenBytes == -1) {
+						if(errno == EINTR)
+							continue;
+						throw detail::makeFileSystemError("writev(2) failed.", fileName());
+					}
+					// writev(2) may return after writing a part
+					for(std::size_t n = static_cast<std::size_t>(writtenBytes); n > 0; ) {
+						const std::size_t bytes = std::min(n, next->iov_len);
+						next->iov_base = static_cast<Byte*>(next->iov_base) + bytes;
+						next->iov_len -= bytes;
+						n -= bytes;
+						if(next->iov_len == 0)
+							++next;
+					}
+				}
+#endif
+				batch.numberOfSegments = 0;
+			}
+
+			/// @see std#basic_streambuf#xsputn
+			std::streamsize TextFileStreamBuffer::xsputn(const char_type* s, std::streamsize n) {
+				if(!isOpen() || std::begin(inputMapping_.buffer) != nullptr)
+					return 0;	// not output mode
+
+				if(n <= epptr() - pptr()) {	// a short span is buffered to be encoded with the following
+					traits_type::copy(pptr(), s, static_cast<std::size_t>(n));
+					pbump(static_cast<int>(n));
+				} else {	// a long span is encoded without the copy
+					encodePutArea();
+					encodeOutput(s, s + n);
+				}
+				return n;
+			}
+
 			namespace detail {
 				boost::filesystem::filesystem_error makeGenericFileSystemError(const std::string& what,
 						const boost::filesystem::path& path, boost::system::errc::errc_t value) {
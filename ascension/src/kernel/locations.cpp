@@ -17,6 +17,7 @@
 #include <ascension/kernel/locations.hpp>
 #include <ascension/kernel/point-proxy.hpp>
 #include <boost/core/ignore_unused.hpp>
+#include <algorithm>	// std.upper_bound
 
 
 namespace ascension {
@@ -374,6 +375,9 @@ namespace ascension {
 			 *   <tr><td>(D-3b)</td><td>Any</td><td><code>a b c D E F g|h i</code></td><td><code>a b c g|h i</code></td></tr>
 			 * </table>
 			 *
+			 * If @a change has the individual replacements (see @c DocumentChange#replacements), the position is moved
+			 * by the replacement just before the position, as if each replacement was performed separately.
+			 *
 			 * @param position The original position
 			 * @param change The content of the document change
 			 * @param gravity The gravity which determines the direction to which the position should move if a text
@@ -384,6 +388,29 @@ namespace ascension {
 			 * @see viewer#locations#updateTextHit
 			 */
 			Position updatePosition(const Position& position, const DocumentChange& change, Direction gravity) BOOST_NOEXCEPT {
+				const auto& replacements = change.replacements();
+				if(!replacements.empty()) {
+					// find the last replacement begins at or before the position
+					auto i(std::upper_bound(std::begin(replacements), std::end(replacements), position,
+						[](const Position& p, const std::pair<Region, Region>& replacement) {
+							return p < *boost::const_begin(replacement.first);
+						}));
+					if(i == std::begin(replacements))
+						return position;	// before all replacements
+					--i;
+					const auto& e = *boost::const_end(i->first);
+					if(position > e) {	// after the replacement
+						const auto& insertedEnd = *boost::const_end(i->second);
+						if(line(position) == line(e))
+							return Position(line(insertedEnd), offsetInLine(insertedEnd) + offsetInLine(position) - offsetInLine(e));
+						return Position(line(position) - line(e) + line(insertedEnd), offsetInLine(position));
+					} else if(gravity == Direction::forward())
+						return *boost::const_end(i->second);
+					// the position moves to the beginning of the replacement, and then may be erased by the previous one
+					while(i != std::begin(replacements) && *boost::const_end(std::prev(i)->first) == *boost::const_begin(i->first))
+						--i;
+					return *boost::const_begin(i->second);
+				}
 				return detail::updatePositionForInsertion(
 					detail::updatePositionForDeletion(
 						position, change.erasedRegion(), gravity), change.insertedRegion(), gravity);
@@ -401,7 +428,8 @@ namespace ascension {
 							if(p <= e)	// (D-2)
 								p = b;
 							else {	// (D-3)
-								p.offsetInLine -= (line(position) == line(e) ? offsetInLine(e) : 0) - (line(position) == line(b) ? offsetInLine(b) : 0);
+								if(line(p) == line(e))
+									p.offsetInLine = p.offsetInLine - offsetInLine(e) + offsetInLine(b);
 								p.line -= boost::size(region.lines()) - 1;
 							}
 						}
@@ -415,9 +443,10 @@ namespace ascension {
 					Position p(position);
 					if(!boost::empty(region)) {
 						const auto& b = *boost::const_begin(region), e = *boost::const_end(region);
-						if(gravity == Direction::forward())	// (I-2a)
-							p = e;
-						else if(p > b) {	// (I-3) & !(I-1) & !(I-2b)
+						if(p == b) {	// (I-2)
+							if(gravity == Direction::forward())	// (I-2a)
+								p = e;
+						} else if(p > b) {	// (I-3)
 							if(line(p) == line(b))
 								p.offsetInLine += offsetInLine(e) - offsetInLine(b);
 							p.line += boost::size(region.lines()) - 1;
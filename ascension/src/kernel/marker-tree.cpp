@@ -0,0 +1,395 @@
+/**
+ * @file marker-tree.cpp
+ * Implements @c MarkerTree class.
+ * @author agent
+ * @date 2026-10-16 Created.
+ */
+
+#include <ascension/corelib/basic-exceptions.hpp>
+#include <ascension/corelib/numeric-range-algorithm/encompasses.hpp>
+#include <ascension/kernel/document.hpp>
+#include <ascension/kernel/marker-tree.hpp>
+#include <algorithm>
+#include <initializer_list>
+
+
+namespace ascension {
+	namespace kernel {
+		// the markers are kept in a treap ordered by the beginnings. each node has the maximum end of its subtree
+		// to find the overlapping markers, and the line shift which is not applied to its subtree yet to move the
+		// markers after the changed lines at once
+
+		namespace {
+			inline Position shiftLine(const Position& p, std::ptrdiff_t lineShift) BOOST_NOEXCEPT {
+				return Position(line(p) + lineShift, offsetInLine(p));
+			}
+		}
+
+		/**
+		 * Constructor.
+		 * @param document The document to mark
+		 */
+		MarkerTree::MarkerTree(Document& document) : document_(document), root_(nullptr) {
+			document_.addPrenotifiedListener(*this);	// the markers are moved before the listeners are notified
+		}
+
+		/// Destructor.
+		MarkerTree::~MarkerTree() BOOST_NOEXCEPT {
+			document_.removePrenotifiedListener(*this);
+			destroy(root_);
+		}
+
+		/**
+		 * Adds a new marker.
+		 * @param region The region of the marker
+		 * @param kind The kind of the marker
+		 * @param payload The payload of the marker
+		 * @return The added marker
+		 * @throw BadRegionException @a region intersects outside of the document
+		 * @throw std#bad_alloc
+		 */
+		const MarkerTree::Marker& MarkerTree::add(const Region& region, Kind kind /* = 0 */, std::uintptr_t payload /* = 0 */) {
+			if(!encompasses(document_.region(), region))
+				throw BadRegionException(region);
+			Marker* const marker = new Marker(region, kind, payload, static_cast<std::uint32_t>(priorityGenerator_()));
+			Marker *left, *right;
+			split(root_, *boost::const_begin(region), left, right);
+			root_ = merge(merge(left, marker), right);
+			root_->parent_ = nullptr;
+			return *marker;
+		}
+
+		/// @internal Applies the line shift of @a marker to itself and passes it to the children.
+		inline void MarkerTree::applyLineShift(Marker& marker) BOOST_NOEXCEPT {
+			if(marker.lineShift_ != 0) {
+				marker.beginning_ = shiftLine(marker.beginning_, marker.lineShift_);
+				marker.end_ = shiftLine(marker.end_, marker.lineShift_);
+				marker.maximumEnd_ = shiftLine(marker.maximumEnd_, marker.lineShift_);
+				if(marker.left_ != nullptr)
+					marker.left_->lineShift_ += marker.lineShift_;
+				if(marker.right_ != nullptr)
+					marker.right_->lineShift_ += marker.lineShift_;
+				marker.lineShift_ = 0;
+			}
+		}
+
+		/**
+		 * Returns the marker at the specified index in the order of the beginnings.
+		 * @param index The index
+		 * @return The marker
+		 * @throw IndexOutOfBoundsException @a index is greater than or equal to @c #size()
+		 * @see #lowerBound
+		 */
+		const MarkerTree::Marker& MarkerTree::at(std::size_t index) const {
+			if(index >= size())
+				throw IndexOutOfBoundsException("index");
+			for(const Marker* marker = root_; ; ) {
+				const std::size_t n = (marker->left_ != nullptr) ? marker->left_->size_ : 0;
+				if(index < n)
+					marker = marker->left_;
+				else if(index == n)
+					return *marker;
+				else {
+					index -= n + 1;
+					marker = marker->right_;
+				}
+			}
+		}
+
+		/// Returns an iterator addresses the first marker.
+		MarkerTree::Iterator MarkerTree::begin() const BOOST_NOEXCEPT {
+			const Marker* marker = root_;
+			if(marker != nullptr) {
+				while(marker->left_ != nullptr)
+					marker = marker->left_;
+			}
+			return Iterator(*this, marker);
+		}
+
+		/// Removes all the markers.
+		void MarkerTree::clear() BOOST_NOEXCEPT {
+			destroy(root_);
+			root_ = nullptr;
+		}
+
+		/// @internal Deletes @a marker and its subtree.
+		void MarkerTree::destroy(Marker* marker) BOOST_NOEXCEPT {
+			if(marker != nullptr) {
+				destroy(marker->left_);
+				destroy(marker->right_);
+				delete marker;
+			}
+		}
+
+		/// @see DocumentListener#documentAboutToBeChanged
+		void MarkerTree::documentAboutToBeChanged(const Document&, const DocumentChange&) {
+			// do nothing
+		}
+
+		/// @see DocumentListener#documentChanged
+		void MarkerTree::documentChanged(const Document& document, const DocumentChange& change) {
+			if(&document != &document_ || empty())
+				return;
+			const auto& replacements = change.replacements();
+			if(replacements.empty())
+				return updateMarkers(change.erasedRegion(), change.insertedRegion());
+
+			// move the markers by each replacement from the last, as if the replacements were performed separately
+			for(auto i(replacements.crbegin()), e(replacements.crend()); i != e; ++i) {
+				const Position& beginning = *boost::const_begin(i->first);
+				const Position& insertedBeginning = *boost::const_begin(i->second);
+				const Position& insertedEnd = *boost::const_end(i->second);
+				const Position end((line(insertedEnd) == line(insertedBeginning)) ?
+					Position(line(beginning), offsetInLine(beginning) + offsetInLine(insertedEnd) - offsetInLine(insertedBeginning))
+					: Position(line(beginning) + line(insertedEnd) - line(insertedBeginning), offsetInLine(insertedEnd)));
+				updateMarkers(i->first, Region(beginning, end));
+			}
+		}
+
+		/// Returns an iterator addresses just beyond the last marker.
+		MarkerTree::Iterator MarkerTree::end() const BOOST_NOEXCEPT {
+			return Iterator(*this, nullptr);
+		}
+
+		/**
+		 * Returns the markers overlapping the specified lines. A marker overlaps the lines if the marker begins
+		 * before the end of the lines and ends at or after the beginning of the lines.
+		 * @param lines The lines
+		 * @param[out] markers The found markers are appended to this, in the order of the beginnings
+		 * @throw std#bad_alloc
+		 */
+		void MarkerTree::find(const boost::integer_range<Index>& lines, std::vector<const Marker*>& markers) const {
+			find(root_, 0, lines, markers);
+		}
+
+		/// @internal Implements @c #find.
+		void MarkerTree::find(const Marker* marker, std::ptrdiff_t lineShift,
+				const boost::integer_range<Index>& lines, std::vector<const Marker*>& markers) {
+			if(marker == nullptr)
+				return;
+			lineShift += marker->lineShift_;
+			if(line(marker->maximumEnd_) + lineShift < *boost::const_begin(lines))
+				return;	// all the markers in this subtree end before the lines
+			find(marker->left_, lineShift, lines, markers);
+			if(line(marker->beginning_) + lineShift >= *boost::const_end(lines))
+				return;	// the markers in the right subtree begin after the lines
+			if(line(marker->end_) + lineShift >= *boost::const_begin(lines))
+				markers.push_back(marker);
+			find(marker->right_, lineShift, lines, markers);
+		}
+
+		/**
+		 * Returns the index of the first marker which begins at or after the specified position.
+		 * @param position The position
+		 * @return The index, or @c #size() if there is no such marker
+		 * @see #at
+		 */
+		std::size_t MarkerTree::lowerBound(const Position& position) const BOOST_NOEXCEPT {
+			std::size_t index = 0;
+			std::ptrdiff_t lineShift = 0;
+			for(const Marker* marker = root_; marker != nullptr; ) {
+				lineShift += marker->lineShift_;
+				if(shiftLine(marker->beginning_, lineShift) < position) {
+					index += ((marker->left_ != nullptr) ? marker->left_->size_ : 0) + 1;
+					marker = marker->right_;
+				} else
+					marker = marker->left_;
+			}
+			return index;
+		}
+
+		/// @internal Merges the two trees. All the markers in @a left should begin before the ones in @a right.
+		MarkerTree::Marker* MarkerTree::merge(Marker* left, Marker* right) BOOST_NOEXCEPT {
+			if(left == nullptr)
+				return right;
+			else if(right == nullptr)
+				return left;
+			else if(left->priority_ > right->priority_) {
+				applyLineShift(*left);
+				left->right_ = merge(left->right_, right);
+				left->right_->parent_ = left;
+				update(*left);
+				return left;
+			} else {
+				applyLineShift(*right);
+				right->left_ = merge(left, right->left_);
+				right->left_->parent_ = right;
+				update(*right);
+				return right;
+			}
+		}
+
+		/**
+		 * Removes the specified marker.
+		 * @param marker The marker to remove. This should be in this tree
+		 */
+		void MarkerTree::remove(const Marker& marker) BOOST_NOEXCEPT {
+			Marker& self = const_cast<Marker&>(marker);
+
+			// apply the line shifts from the root to the marker
+			std::vector<Marker*> path;
+			for(Marker* p = &self; p != nullptr; p = p->parent_)
+				path.push_back(p);
+			assert(path.back() == root_);
+			std::for_each(path.rbegin(), path.rend(), [](Marker* p) {applyLineShift(*p);});
+
+			Marker* const children = merge(self.left_, self.right_);
+			if(children != nullptr)
+				children->parent_ = self.parent_;
+			if(self.parent_ == nullptr)
+				root_ = children;
+			else {
+				(self.parent_->left_ == &self ? self.parent_->left_ : self.parent_->right_) = children;
+				for(Marker* p = self.parent_; p != nullptr; p = p->parent_)
+					update(*p);
+			}
+			delete &self;
+		}
+
+		/// @internal Splits the tree into the markers begin before @a at and the others.
+		void MarkerTree::split(Marker* marker, const Position& at, Marker*& left, Marker*& right) BOOST_NOEXCEPT {
+			if(marker == nullptr) {
+				left = right = nullptr;
+				return;
+			}
+			applyLineShift(*marker);
+			if(marker->beginning_ < at) {
+				split(marker->right_, at, marker->right_, right);
+				if(marker->right_ != nullptr)
+					marker->right_->parent_ = marker;
+				left = marker;
+			} else {
+				split(marker->left_, at, left, marker->left_);
+				if(marker->left_ != nullptr)
+					marker->left_->parent_ = marker;
+				right = marker;
+			}
+			update(*marker);
+		}
+
+		/// @internal Recomputes the size and the maximum end of the subtree of @a marker.
+		inline void MarkerTree::update(Marker& marker) BOOST_NOEXCEPT {
+			marker.size_ = 1;
+			marker.maximumEnd_ = marker.end_;
+			for(const Marker* child : {marker.left_, marker.right_}) {
+				if(child != nullptr) {
+					marker.size_ += child->size_;
+					marker.maximumEnd_ = std::max(shiftLine(child->maximumEnd_, child->lineShift_), marker.maximumEnd_);
+				}
+			}
+		}
+
+		/**
+		 * @internal Moves the markers for the replacement of @a erasedRegion with @a insertedRegion.
+		 * @param erasedRegion The erased region
+		 * @param insertedRegion The inserted region which begins at the beginning of @a erasedRegion
+		 */
+		void MarkerTree::updateMarkers(const Region& erasedRegion, const Region& insertedRegion) BOOST_NOEXCEPT {
+			struct Mover {
+				const Position beginning, end, insertedEnd;
+				// moves a position. 'forward' is the gravity
+				Position move(const Position& p, bool forward) const BOOST_NOEXCEPT {
+					if(p < beginning)
+						return p;
+					else if(p <= end)
+						return forward ? insertedEnd : beginning;
+					else if(line(p) == line(end))
+						return Position(line(insertedEnd), offsetInLine(insertedEnd) + offsetInLine(p) - offsetInLine(end));
+					return Position(line(p) - line(end) + line(insertedEnd), offsetInLine(p));
+				}
+				// moves the ends of the markers in the subtree which end at or after the beginning
+				void moveEnds(Marker* marker) const BOOST_NOEXCEPT {
+					if(marker == nullptr)
+						return;
+					applyLineShift(*marker);
+					if(marker->maximumEnd_ < beginning)
+						return;
+					moveEnds(marker->left_);
+					moveEnds(marker->right_);
+					marker->end_ = move(marker->end_, false);
+					update(*marker);
+				}
+				// moves all the markers in the subtree. the order is not changed
+				void moveAll(Marker* marker) const BOOST_NOEXCEPT {
+					if(marker == nullptr)
+						return;
+					applyLineShift(*marker);
+					moveAll(marker->left_);
+					moveAll(marker->right_);
+					marker->beginning_ = move(marker->beginning_, true);
+					marker->end_ = std::max(move(marker->end_, false), marker->beginning_);
+					update(*marker);
+				}
+			};
+			const Mover mover = {*boost::const_begin(erasedRegion), *boost::const_end(erasedRegion), *boost::const_end(insertedRegion)};
+
+			// split the markers into: (a) begin before the erased region, (b) begin in the changed lines and
+			// (c) begin after the changed lines
+			Marker *a, *b, *c;
+			split(root_, mover.beginning, a, c);
+			split(c, Position::bol(line(mover.end) + 1), b, c);
+
+			mover.moveEnds(a);
+			mover.moveAll(b);
+			if(c != nullptr)	// (c) moves only by lines
+				c->lineShift_ += static_cast<std::ptrdiff_t>(line(mover.insertedEnd)) - static_cast<std::ptrdiff_t>(line(mover.end));
+			root_ = merge(a, merge(b, c));
+			if(root_ != nullptr)
+				root_->parent_ = nullptr;
+		}
+
+
+		// MarkerTree.Iterator ////////////////////////////////////////////////////////////////////////////////////////
+
+		/// Moves to the previous marker. The iterator should not address the first marker.
+		void MarkerTree::Iterator::decrement() BOOST_NOEXCEPT {
+			if(current_ == nullptr) {
+				current_ = tree_->root_;
+				while(current_->right_ != nullptr)
+					current_ = current_->right_;
+			} else if(current_->left_ != nullptr) {
+				current_ = current_->left_;
+				while(current_->right_ != nullptr)
+					current_ = current_->right_;
+			} else {
+				const Marker* child;
+				do {
+					child = current_;
+					current_ = current_->parent_;
+				} while(current_->left_ == child);
+			}
+		}
+
+		/// Moves to the next marker. The iterator should not be at the end.
+		void MarkerTree::Iterator::increment() BOOST_NOEXCEPT {
+			if(current_->right_ != nullptr) {
+				current_ = current_->right_;
+				while(current_->left_ != nullptr)
+					current_ = current_->left_;
+			} else {
+				const Marker* child;
+				do {
+					child = current_;
+					current_ = current_->parent_;
+				} while(current_ != nullptr && current_->right_ == child);
+			}
+		}
+
+
+		// MarkerTree.Marker //////////////////////////////////////////////////////////////////////////////////////////
+
+		/// @internal Private constructor.
+		MarkerTree::Marker::Marker(const Region& region, Kind kind, std::uintptr_t payload, std::uint32_t priority) BOOST_NOEXCEPT
+				: beginning_(*boost::const_begin(region)), end_(*boost::const_end(region)), maximumEnd_(end_), lineShift_(0), size_(1),
+				priority_(priority), parent_(nullptr), left_(nullptr), right_(nullptr), kind_(kind), payload_(payload) {
+		}
+
+		/// Returns the region of the marker.
+		Region MarkerTree::Marker::region() const BOOST_NOEXCEPT {
+			std::ptrdiff_t lineShift = 0;
+			for(const Marker* p = this; p != nullptr; p = p->parent_)
+				lineShift += p->lineShift_;
+			return Region(shiftLine(beginning_, lineShift), shiftLine(end_, lineShift));
+		}
+	}
+}
@@ -75,6 +75,7 @@ namespace ascension {
 		Point::Point(Document& document, const Position& position /* = kernel::Position::zero() */) : AbstractPoint(document), position_(position) {
 			if(!encompasses(document.region(), position))
 				throw BadPositionException(position);
+			positionChanged();
 		}
 
 		/**
@@ -84,6 +85,7 @@ namespace ascension {
 		 * @post position() == other.position()
 		 */
 		Point::Point(const Point& other) : AbstractPoint(other), position_(other.position_) {
+			positionChanged();
 		}
 
 		/// Destructor does nothing.
@@ -136,10 +138,15 @@ namespace ascension {
 				const auto newPosition(boost::get(destination_));
 				destination_ = boost::none;
 				if(newPosition != position())
-					moveTo(boost::get(destination_));	// TODO: this may throw...
+					moveTo(newPosition);	// TODO: this may throw...
 			}
 		}
 
+		/// @see AbstractPoint#indexedLine
+		Index Point::indexedLine() const BOOST_NOEXCEPT {
+			return kernel::line(position());
+		}
+
 		/**
 		 * This overridable method is called by @c #moveTo to notify the motion was finished.
 		 * If you override this, call @c #moved method of the super class with the same parameter. And don't throw any
@@ -171,6 +178,7 @@ namespace ascension {
 			destination = locations::shrinkToDocumentRegion(locations::PointProxy(document(), destination));
 			const Position from(position());
 			position_ = destination;
+			positionChanged();
 			moved(from);
 			if(destination != from)
 				motionSignal_(*this, from);
@@ -16,6 +16,7 @@
 #include <ascension/kernel/searcher.hpp>
 #include <ascension/corelib/text/break-iterator.hpp>
 #include <boost/range/algorithm/find.hpp>
+#include <deque>
 
 
 namespace ascension {
@@ -385,6 +386,11 @@ namespace ascension {
 		 *
 		 * If the stored replacements list is empty, an empty is used as the replacement string.
 		 *
+		 * The occurences replaced without the interaction (all of them if @a callback is @c null, or the rest after
+		 * the callback returned @c InteractiveReplacementCallback#REPLACE_ALL) are collected and replaced by one
+		 * @c Document#replace(const std::vector&lt;std::pair&lt;Region, StringPiece&gt;&gt;&amp;) call at the end. So
+		 * the document listeners are notified only once for them, and they are undone at once.
+		 *
 		 * This method does not begin and terminate an <em>compound change</em>.
 		 * @param document The document
 		 * @param scope The region to search and replace
@@ -413,6 +419,8 @@ namespace ascension {
 			std::size_t numberOfMatches = 0, numberOfReplacements = 0;
 			std::stack<std::pair<kernel::Position, kernel::Position>> history;	// for undo (ouch, Region does not support placement new)
 			std::size_t documentRevision = document.revisionNumber();	// to detect other interruptions
+			std::vector<std::pair<kernel::Region, StringPiece>> batch;	// the replacements performed at the end
+			std::deque<String> batchTexts;	// the replaced texts referred by 'batch'
 
 			InteractiveReplacementCallback::Action action;	// the action the callback returns
 			InteractiveReplacementCallback* const storedCallback = callback;
@@ -459,7 +467,11 @@ namespace ascension {
 						// replace? -- yes
 						if(action == InteractiveReplacementCallback::REPLACE_ALL)
 							callback = nullptr;
-						if(!boost::empty(matchedRegion) || !replacement.empty()) {
+						if(callback == nullptr) {
+							// the rest are replaced at once
+							batch.push_back(std::make_pair(matchedRegion, StringPiece(replacement)));
+							i.seek(*boost::const_end(matchedRegion));
+						} else if(!boost::empty(matchedRegion) || !replacement.empty()) {
 							kernel::Position e;
 							try {
 								e = document.replace(matchedRegion, replacement);
@@ -535,21 +547,32 @@ namespace ascension {
 								callback = nullptr;
 							history.push(std::make_pair(*boost::const_begin(matchedRegion), *boost::const_end(matchedRegion)));
 							assert(!boost::empty(matchedRegion) || !replacement.empty());
-							try {
-								document.replace(matchedRegion, matcher->replaceInplace(replacement));
-							} catch(const kernel::DocumentInput::ChangeRejectedException&) {
-								throw ReplacementInterruptedException<kernel::DocumentInput::ChangeRejectedException>(numberOfReplacements);
-							} catch(const std::bad_alloc&) {
-								throw ReplacementInterruptedException<std::bad_alloc>(numberOfReplacements);
-							}
-							if(!boost::empty(matchedRegion))
-								next = *boost::const_begin(matchedRegion);
-							if(!replacement.empty()) {
+							if(callback == nullptr) {
+								// the rest are replaced at once. the matcher continues on the unchanged document
+								const kernel::DocumentCharacterIterator matchedEnd(matcher->end());
+								batchTexts.push_back(matcher->replaceInplace(replacement));
+								batch.push_back(std::make_pair(matchedRegion, StringPiece(batchTexts.back())));
 								matcher->endInplaceReplacement(beginningOfDocument(document), endOfDocument(document),
 									kernel::DocumentCharacterIterator(document, *boost::const_begin(scope)), kernel::DocumentCharacterIterator(document, endOfScope.position()),
-									kernel::DocumentCharacterIterator(document, next));
-								documentRevision = document.revisionNumber();
+									matchedEnd);
+							} else {
+								try {
+									document.replace(matchedRegion, matcher->replaceInplace(replacement));
+								} catch(const kernel::DocumentInput::ChangeRejectedException&) {
+									throw ReplacementInterruptedException<kernel::DocumentInput::ChangeRejectedException>(numberOfReplacements);
+								} catch(const std::bad_alloc&) {
+									throw ReplacementInterruptedException<std::bad_alloc>(numberOfReplacements);
+								}
+								if(!boost::empty(matchedRegion))
+									next = *boost::const_begin(matchedRegion);
+								if(!replacement.empty()) {
+									matcher->endInplaceReplacement(beginningOfDocument(document), endOfDocument(document),
+										kernel::DocumentCharacterIterator(document, *boost::const_begin(scope)), kernel::DocumentCharacterIterator(document, endOfScope.position()),
+										kernel::DocumentCharacterIterator(document, next));
+									documentRevision = document.revisionNumber();
+								}
 							}
+							++numberOfReplacements;
 						} else if(action == InteractiveReplacementCallback::SKIP)
 							next = *boost::const_end(matchedRegion);
 						if(action == InteractiveReplacementCallback::REPLACE_AND_EXIT || action == InteractiveReplacementCallback::EXIT)
@@ -569,6 +592,16 @@ namespace ascension {
 			}
 #endif // !ASCENSION_NO_REGEX
 
+			if(!batch.empty()) {
+				try {
+					document.replace(batch);
+				} catch(const kernel::DocumentInput::ChangeRejectedException&) {
+					throw ReplacementInterruptedException<kernel::DocumentInput::ChangeRejectedException>(numberOfReplacements - batch.size());
+				} catch(const std::bad_alloc&) {
+					throw ReplacementInterruptedException<std::bad_alloc>(numberOfReplacements - batch.size());
+				}
+			}
+
 			if(storedCallback != nullptr)
 				storedCallback->replacementEnded(numberOfMatches, numberOfReplacements);
 			pushHistory(replacement, true);	// only this call make this method not-const...
@@ -12,9 +12,8 @@
 #include <ascension/kernel/document-input.hpp>
 #include <ascension/kernel/point.hpp>
 #include <boost/foreach.hpp>
-#include <boost/range/algorithm/find_first_of.hpp>
-#include <stack>
-#include <tuple>
+#include <deque>
+#include <limits>
 #include <vector>
 
 
@@ -29,235 +28,246 @@ namespace ascension {
 			// delete      no      yes     no
 			// replace     yes     no      no
 
-			class AtomicChange;
-
-			/// @internal An abstract edit operation.
-			class UndoableChange {
-			public:
-				/// @internal Result of @c UndoableChange#perform method.
-				struct Result {
-					bool completed;				// true if the change was *completely* performed
-					std::size_t numberOfRevisions;	// the number of the performed changes
-					Position endOfChange;		// the end position of the change
-					void reset() BOOST_NOEXCEPT {
-						completed = false;
-						numberOfRevisions = 0;
-//						endOfChange = Position();
-					}
-				};
-			public:
-				/// Destructor.
-				virtual ~UndoableChange() BOOST_NOEXCEPT {}
-				/// Returns @c true if the change can perform.
-				virtual bool canPerform(const Document& document) const = 0;
-				/// Tries to append @a postChange to this change and returns @c true, or returns @c false.
-				virtual bool merge(std::unique_ptr<AtomicChange>& postChange, const Document& document) = 0;
-				/// Performs the change. This method may fail.
-				virtual void perform(Document& document, Result& result) = 0;
+			/// @internal An atomic edit operation to undo or redo.
+			struct AtomicChange {
+				enum Type {
+					INSERTION,	///< Inserts @c #text at @c #beginning.
+					DELETION,	///< Deletes the region from @c #beginning to @c #end.
+					REPLACEMENT	///< Replaces the region from @c #beginning to @c #end with @c #text.
+				} type;
+				Position beginning, end;	// 'end' is same as 'beginning' for INSERTION
+				std::size_t revisions;	// the number of the merged changes
+				StringPiece text;	// empty for DELETION
+				AtomicChange() BOOST_NOEXCEPT {}
+				AtomicChange(Type type, const Region& region, const StringPiece& text = StringPiece()) BOOST_NOEXCEPT
+					: type(type), beginning(*boost::const_begin(region)), end(*boost::const_end(region)), revisions(1), text(text) {}
 			};
 
-			/// @internal Base interface of @c InsertionChange and @c DeletionChange.
-			class AtomicChange : public UndoableChange {
-			public:
-				virtual ~AtomicChange() BOOST_NOEXCEPT {}
-				bool merge(std::unique_ptr<AtomicChange>& postChange, const Document& document) override {
-					if(doMerge(postChange, document))
-						return ++revisions_, true;
-					return false;
-				}
-				void perform(Document& document, Result& result) override {
-					std::tie(result.completed, result.endOfChange) = doPerform(document);
-					result.numberOfRevisions = revisions_;
+			/// @internal Result of @c Document#UndoManager#undo and @c Document#UndoManager#redo methods.
+			struct RollbackResult {
+				bool completed;				// true if the change was *completely* performed
+				std::size_t numberOfRevisions;	// the number of the performed changes
+				Position endOfChange;		// the end position of the change
+				void reset() BOOST_NOEXCEPT {
+					completed = false;
+					numberOfRevisions = 0;
+//					endOfChange = Position();
 				}
-				virtual Position begin() const BOOST_NOEXCEPT = 0;
-				virtual boost::optional<Position> end() const BOOST_NOEXCEPT = 0;
-				virtual const String* text() const BOOST_NOEXCEPT = 0;
-			protected:
-				AtomicChange() : revisions_(1) {}
-				virtual bool doMerge(std::unique_ptr<AtomicChange>& postChange, const Document& document) = 0;
-				virtual std::pair<bool, Position> doPerform(Document& document) = 0;
-			private:
-				std::size_t revisions_;
 			};
 
-			/// @internal An atomic insertion change
-			class InsertionChange : public AtomicChange, public FastArenaObject<InsertionChange> {
+			/**
+			 * @internal An append-only log of @c AtomicChange records, grouped into units of undo.
+			 *
+			 * The records are stored contiguously in a buffer of @c Char, instead of allocating an object and a string
+			 * for each change. A record consists of the text, the header and the length of the header. The header is
+			 * the type followed by the variable-length encoded numbers, so a typical change in a line takes a few units.
+			 * Because the length of the header is at the end, the records are read from the last one, which is what
+			 * undo/redo and merging need. The oldest groups can be dropped from the front to save the memory.
+			 */
+			class ChangeLog : private boost::noncopyable {
 			public:
-				InsertionChange(const Position& position, const String& text) : position_(position), text_(text) {}
-				bool canPerform(const Document& document) const BOOST_NOEXCEPT override {
-					return !document.isNarrowed() || encompasses(document.region(), position_);
+				ChangeLog() BOOST_NOEXCEPT : first_(0) {}
+				/// Returns @c true if the log has no record.
+				bool empty() const BOOST_NOEXCEPT {return groups_.empty();}
+				/// Returns the number of the groups.
+				std::size_t numberOfGroups() const BOOST_NOEXCEPT {return groups_.size();}
+				/// Returns the size of the records in bytes.
+				std::size_t size() const BOOST_NOEXCEPT {
+					return (units_.size() - first_) * sizeof(Char) + groups_.size() * sizeof(std::size_t);
 				}
+				void append(const AtomicChange& change, bool newGroup);
+				void clear() BOOST_NOEXCEPT;
+				void dropFirstGroup() BOOST_NOEXCEPT;
+				AtomicChange last() const BOOST_NOEXCEPT;
+				bool mergeIntoLast(const AtomicChange& postChange);
+				void popLast() BOOST_NOEXCEPT;
 			private:
-				Position begin() const BOOST_NOEXCEPT override {return position_;}
-				bool doMerge(std::unique_ptr<AtomicChange>& postChange, const Document& document) BOOST_NOEXCEPT override;
-				std::pair<bool, Position> doPerform(Document& document) override;
-				boost::optional<Position> end() const BOOST_NOEXCEPT override {return boost::none;}
-				const String* text() const BOOST_NOEXCEPT override {return &text_;}
+				static Index decode(const Char*& p) BOOST_NOEXCEPT;
+				static void encode(Index value, std::vector<Char>& out) BOOST_NOEXCEPT;
+				AtomicChange last(std::size_t& header) const BOOST_NOEXCEPT;
+				void writeHeader(const AtomicChange& change) BOOST_NOEXCEPT;
 			private:
-				Position position_;
-				String text_;
+				static const std::size_t MAXIMUM_HEADER_LENGTH = 1 + 6 * ((std::numeric_limits<Index>::digits + 14) / 15) + 1;
+				std::vector<Char> units_;
+				std::size_t first_;	// the beginning of the first record in units_
+				std::deque<std::size_t> groups_;	// the beginnings of the first records of the groups
 			};
 
-			/// @internal An atomic deletion change.
-			class DeletionChange : public AtomicChange, public FastArenaObject<DeletionChange> {
-			public:
-				explicit DeletionChange(const Region& region) BOOST_NOEXCEPT : region_(region) {}
-				bool canPerform(const Document& document) const BOOST_NOEXCEPT override {
-					return !document.isNarrowed() || encompasses(document.region(), region_);
-				}
-			private:
-				Position begin() const BOOST_NOEXCEPT override {return *boost::const_begin(region_);}
-				bool doMerge(std::unique_ptr<AtomicChange>& postChange, const Document& document) BOOST_NOEXCEPT override;
-				std::pair<bool, Position> doPerform(Document& document) override;
-				boost::optional<Position> end() const BOOST_NOEXCEPT override {return *boost::const_end(region_);}
-				const String* text() const BOOST_NOEXCEPT override {return nullptr;}
-			private:
-				Region region_;
-			};
+			/**
+			 * @internal Appends the given change as the last record.
+			 * @param change The change to append
+			 * @param newGroup Set @c true to begin a new group with the change, or @c false to add it to the last group
+			 * @throw std#bad_alloc
+			 */
+			void ChangeLog::append(const AtomicChange& change, bool newGroup) {
+				assert(newGroup || !empty());
+				units_.reserve(units_.size() + change.text.length() + MAXIMUM_HEADER_LENGTH);	// writeHeader can't throw
+				if(newGroup)
+					groups_.push_back(units_.size());
+				units_.insert(std::end(units_), change.text.cbegin(), change.text.cend());
+				writeHeader(change);
+			}
 
-			/// @internal An atomic replacement change.
-			class ReplacementChange : public AtomicChange, public FastArenaObject<ReplacementChange> {
-			public:
-				explicit ReplacementChange(const Region& region, const String& text) : region_(region), text_(text) {}
-				bool canPerform(const Document& document) const BOOST_NOEXCEPT override {
-					return !document.isNarrowed() || encompasses(document.region(), region_);
-				}
-			private:
-				Position begin() const BOOST_NOEXCEPT override {return *boost::const_begin(region_);}
-				bool doMerge(std::unique_ptr<AtomicChange>& postChange, const Document& document) BOOST_NOEXCEPT override;
-				std::pair<bool, Position> doPerform(Document& document) override;
-				boost::optional<Position> end() const BOOST_NOEXCEPT override {return *boost::const_end(region_);}
-				const String* text() const BOOST_NOEXCEPT override {return &text_;}
-			private:
-				Region region_;
-				const String text_;
-			};
+			/// @internal Removes all the records and releases the memory.
+			void ChangeLog::clear() BOOST_NOEXCEPT {
+				std::vector<Char>().swap(units_);
+				first_ = 0;
+				groups_.clear();
+			}
 
-			/// @internal A compound change
-			class CompoundChange : public UndoableChange {
-			public:
-				~CompoundChange() BOOST_NOEXCEPT;
-				bool canPerform(const Document& document) const BOOST_NOEXCEPT override {
-					return !changes_.empty() && changes_.back()->canPerform(document);
+			/// @internal Decodes a variable-length number, 15 bits in a unit, at @a p and advances @a p.
+			inline Index ChangeLog::decode(const Char*& p) BOOST_NOEXCEPT {
+				Index value = 0;
+				for(int shift = 0; ; shift += 15) {
+					const Char c = *p++;
+					value |= static_cast<Index>(c & 0x7fffu) << shift;
+					if((c & 0x8000u) == 0)
+						return value;
 				}
-				bool merge(std::unique_ptr<AtomicChange>& postChange, const Document& document) override;
-				void perform(Document& document, Result& result) override;
-			private:
-				std::vector<std::unique_ptr<AtomicChange>> changes_;
-			};
+			}
 
-			/// @internal Implements @c AtomicChange#doMerge.
-			inline bool InsertionChange::doMerge(std::unique_ptr<AtomicChange>& postChange, const Document&) BOOST_NOEXCEPT {
-				if(postChange->end() != boost::none)
-					return false;
-				const auto postPosition(postChange->begin());
-				if(line(postPosition) != line(position_) || offsetInLine(postPosition) > offsetInLine(position_))
-					return false;
-				else if(offsetInLine(postPosition) == offsetInLine(position_))
-					text_ += *postChange->text();
-				else {
-					const String* const postString = postChange->text();
-					if((boost::find_first_of(*postString, text::NEWLINE_CHARACTERS) != boost::const_end(*postString))
-							|| (offsetInLine(postPosition) + postString->length() != offsetInLine(position_)))
-						return false;
-					position_ = postPosition;
-					text_ = *postString + text_;
+			/// @internal Removes the oldest group. The memory is reused after the half of the buffer was dropped.
+			void ChangeLog::dropFirstGroup() BOOST_NOEXCEPT {
+				assert(!empty());
+				groups_.pop_front();
+				if(groups_.empty())
+					return clear();
+				first_ = groups_.front();
+				if(first_ > units_.size() / 2) {	// compact the buffer
+					units_.erase(std::begin(units_), std::next(std::begin(units_), first_));
+					BOOST_FOREACH(std::size_t& group, groups_)
+						group -= first_;
+					first_ = 0;
 				}
-				postChange.reset();
-				return true;
 			}
 
-			/// @internal Implements @c AtomicChange#doPerform.
-			inline std::pair<bool, Position> InsertionChange::doPerform(Document& document) {
-				try {
-					return std::make_pair(true, insert(document, position_, text_));
-				} catch(DocumentAccessViolationException&) {
-					return std::make_pair(false, position_);	// the position was inaccessible
-				}	// std.bad_alloc is ignored...
+			/// @internal Encodes @a value as a variable-length number into @a out.
+			inline void ChangeLog::encode(Index value, std::vector<Char>& out) BOOST_NOEXCEPT {
+				for(; value > 0x7fffu; value >>= 15)
+					out.push_back(static_cast<Char>((value & 0x7fffu) | 0x8000u));
+				out.push_back(static_cast<Char>(value));
 			}
 
-			/// @internal Implements @c AtomicChange#doMerge.
-			inline bool DeletionChange::doMerge(std::unique_ptr<AtomicChange>& postChange, const Document&) BOOST_NOEXCEPT {
-				if(postChange->text() != nullptr)
-					return false;
-				const Region postChangeRegion(postChange->begin(), boost::get(postChange->end()));
-				if(boost::size(postChangeRegion.lines()) > 1
-//						|| offsetInLine(*boost::const_end(region_)) == 0
-						|| *boost::const_begin(postChangeRegion) != *boost::const_end(region_))
-					return false;
-				else {
-					region_ = Region(*boost::const_begin(region_), *boost::const_end(postChangeRegion));
-					postChange.reset();
-					return true;
-				}
+			/// @internal Decodes the last record. The returned text refers to the log.
+			inline AtomicChange ChangeLog::last() const BOOST_NOEXCEPT {
+				std::size_t header;
+				return last(header);
 			}
 
-			/// @internal Implements @c AtomicChange#doPerform.
-			inline std::pair<bool, Position> DeletionChange::doPerform(Document& document) {
-				try {
-					erase(document, region_);
-				} catch(DocumentAccessViolationException&) {
-					return std::make_pair(false, *boost::const_end(region_));	// the region was inaccessible
-				}	// std.bad_alloc is ignored...
-				return std::make_pair(true, *boost::const_begin(region_));
+			/// @internal Decodes the last record and returns the beginning of the header in @a header.
+			AtomicChange ChangeLog::last(std::size_t& header) const BOOST_NOEXCEPT {
+				assert(!empty());
+				header = units_.size() - 1 - units_.back();
+				const Char* p = units_.data() + header;
+				AtomicChange change;
+				change.type = static_cast<AtomicChange::Type>(*p++);
+				change.revisions = decode(p);
+				change.beginning.line = decode(p);
+				change.beginning.offsetInLine = decode(p);
+				change.end = change.beginning;
+				if(change.type != AtomicChange::INSERTION) {
+					change.end.line += decode(p);
+					change.end.offsetInLine = decode(p);
+				}
+				const Index textLength = (change.type != AtomicChange::DELETION) ? decode(p) : 0;
+				change.text = StringPiece(units_.data() + header - textLength, textLength);
+				return change;
 			}
 
-			/// @internal Implements @c AtomicChange#doMerge.
-			inline bool ReplacementChange::doMerge(std::unique_ptr<AtomicChange>& postChange, const Document&) BOOST_NOEXCEPT {
-				if(postChange->text() != nullptr)
-					return false;
-				const Region postChangeRegion(postChange->begin(), boost::get(postChange->end()));
-				if(boost::size(postChangeRegion.lines()) > 1
-//						|| offsetInLine(*boost::const_end(region_)) == 0
-						|| *boost::const_begin(postChangeRegion) != *boost::const_end(region_))
+			/**
+			 * @internal Tries to merge @a postChange into the last record.
+			 * @param postChange The change performed after the last record
+			 * @return @c true if merged
+			 * @throw std#bad_alloc
+			 */
+			bool ChangeLog::mergeIntoLast(const AtomicChange& postChange) {
+				if(empty())
 					return false;
-				region_ = Region(*boost::const_begin(region_), *boost::const_end(postChangeRegion));
-				postChange.reset();
+				std::size_t header;
+				AtomicChange change(last(header));
+				bool prepend = false;
+				switch(change.type) {
+					case AtomicChange::INSERTION:
+						if(postChange.type != AtomicChange::INSERTION
+								|| line(postChange.beginning) != line(change.beginning) || offsetInLine(postChange.beginning) > offsetInLine(change.beginning))
+							return false;
+						else if(offsetInLine(postChange.beginning) != offsetInLine(change.beginning)) {
+							if((text::findNewline(postChange.text.cbegin(), postChange.text.cend()) != postChange.text.cend())
+									|| (offsetInLine(postChange.beginning) + postChange.text.length() != offsetInLine(change.beginning)))
+								return false;
+							change.beginning = change.end = postChange.beginning;
+							prepend = true;
+						}
+						break;
+					case AtomicChange::DELETION:
+					case AtomicChange::REPLACEMENT:
+						if(postChange.type != AtomicChange::DELETION
+								|| line(postChange.beginning) != line(postChange.end) || postChange.beginning != change.end)
+							return false;
+						change.end = postChange.end;
+						break;
+				}
+				++change.revisions;
+
+				// rewrite the last record
+				units_.reserve(units_.size() + postChange.text.length() + MAXIMUM_HEADER_LENGTH);	// the followings can't throw
+				const std::size_t textBeginning = header - change.text.length();
+				units_.resize(header);	// erase the header
+				units_.insert(prepend ? std::next(std::begin(units_), textBeginning) : std::end(units_), postChange.text.cbegin(), postChange.text.cend());
+				change.text = StringPiece(units_.data() + textBeginning, change.text.length() + postChange.text.length());
+				writeHeader(change);
 				return true;
 			}
 
-			/// @internal Implements @c AtomicChange#doPerform.
-			inline std::pair<bool, Position> ReplacementChange::doPerform(Document& document) {
-				try {
-					return std::make_pair(true, document.replace(region_, text_));
-				} catch(DocumentAccessViolationException&) {
-					return std::make_pair(false, *boost::const_end(region_));	// the region was inaccessible
-				}	// std.bad_alloc is ignored...
-			}
-
-			CompoundChange::~CompoundChange() BOOST_NOEXCEPT {
-//				BOOST_FOREACH(AtomicChange* change, changes_)
-//					delete change;
+			/// @internal Removes the last record, and the last group if the record was the first in the group.
+			void ChangeLog::popLast() BOOST_NOEXCEPT {
+				std::size_t header;
+				const AtomicChange change(last(header));
+				units_.resize(header - change.text.length());
+				if(units_.size() == groups_.back()) {
+					groups_.pop_back();
+					if(groups_.empty())
+						clear();
+				}
 			}
 
-			/// @internal Implements @c UndoableChange#merge.
-			inline bool CompoundChange::merge(std::unique_ptr<AtomicChange>& postChange, const Document& document) {
-				if(changes_.empty() || !changes_.back()->merge(postChange, document))
-					changes_.push_back(std::move(postChange));
-				return true;
+			/// @internal Writes the header of @a change. The text should have been written. The capacity should be enough.
+			void ChangeLog::writeHeader(const AtomicChange& change) BOOST_NOEXCEPT {
+				const std::size_t header = units_.size();
+				units_.push_back(static_cast<Char>(change.type));
+				encode(change.revisions, units_);
+				encode(line(change.beginning), units_);
+				encode(offsetInLine(change.beginning), units_);
+				if(change.type != AtomicChange::INSERTION) {
+					encode(line(change.end) - line(change.beginning), units_);
+					encode(offsetInLine(change.end), units_);
+				}
+				if(change.type != AtomicChange::DELETION)
+					encode(change.text.length(), units_);
+				units_.push_back(static_cast<Char>(units_.size() - header));
 			}
 
-			/// @internal Implements @c UndoableChange#perform.
-			void CompoundChange::perform(Document& document, Result& result) {
-				assert(!changes_.empty());
-				result.reset();
-				Result delta;
-				const auto e(std::begin(changes_));
-				for(auto i(std::prev(std::end(changes_))); ; --i) {
-					(*i)->perform(document, delta);
-					result.numberOfRevisions += delta.numberOfRevisions;
-					if(!delta.completed) {
-						if(i != --std::end(changes_))
-							// partially completed
-							changes_.erase(++i, std::end(changes_));
-						result.endOfChange = delta.endOfChange;
-						break;
-					} else if(i == e) {	// completed
-						result.completed = true;
-						result.endOfChange = delta.endOfChange;
-						break;
+			/**
+			 * @internal Performs the change.
+			 * @param document The document
+			 * @param change The change to perform
+			 * @return A pair of @c true if performed, and the end position of the change
+			 */
+			std::pair<bool, Position> perform(Document& document, const AtomicChange& change) {
+				try {
+					switch(change.type) {
+						case AtomicChange::INSERTION:
+							return std::make_pair(true, insert(document, change.beginning, change.text));
+						case AtomicChange::DELETION:
+							erase(document, Region(change.beginning, change.end));
+							return std::make_pair(true, change.beginning);
+						case AtomicChange::REPLACEMENT:
+						default:
+							return std::make_pair(true, document.replace(Region(change.beginning, change.end), change.text));
 					}
-				}
+				} catch(DocumentAccessViolationException&) {
+					return std::make_pair(false, change.end);	// the region was inaccessible
+				}	// std.bad_alloc is ignored...
 			}
 		} // namespace @0
 
@@ -269,72 +279,64 @@ namespace ascension {
 		public:
 			// constructors
 			explicit UndoManager(Document& document) BOOST_NOEXCEPT;
-			virtual ~UndoManager() BOOST_NOEXCEPT {clear();}
 			// attributes
+			String& erasedText() BOOST_NOEXCEPT {return erasedText_;}
+			const boost::optional<std::size_t>& limit() const BOOST_NOEXCEPT {return limit_;}
 			std::size_t numberOfRedoableChanges() const BOOST_NOEXCEPT {
-				return redoableChanges_.size();
+				return redoableChanges_.numberOfGroups();
 			}
 			std::size_t numberOfUndoableChanges() const BOOST_NOEXCEPT {
-				return undoableChanges_.size() + ((pendingAtomicChange_.get() != nullptr) ? 1 : 0);
+				return undoableChanges_.numberOfGroups();
 			}
 			bool isStackingCompoundOperation() const BOOST_NOEXCEPT {return compoundChangeDepth_ > 0;}
+			void setLimit(const boost::optional<std::size_t>& limit) BOOST_NOEXCEPT;
+			std::size_t size() const BOOST_NOEXCEPT {
+				return undoableChanges_.size() + redoableChanges_.size();
+			}
 			// rollbacks
-			void redo(UndoableChange::Result& result);
-			void undo(UndoableChange::Result& result);
+			void redo(RollbackResult& result);
+			void undo(RollbackResult& result);
 			// recordings
-			void addUndoableChange(std::unique_ptr<AtomicChange> c);
+			void addUndoableChange(const AtomicChange& c);
 			void beginCompoundChange() BOOST_NOEXCEPT;
 			void clear() BOOST_NOEXCEPT;
 			void endCompoundChange() BOOST_NOEXCEPT;
 			void insertBoundary() BOOST_NOEXCEPT;
 		private:
-			void commitPendingChange();
+			void rollback(ChangeLog& changes, ChangeLog& rollbackedChanges, RollbackResult& result);
+			void shrinkToLimit() BOOST_NOEXCEPT;
 			Document& document_;
-			std::stack<std::unique_ptr<UndoableChange>> undoableChanges_, redoableChanges_;
-			std::unique_ptr<AtomicChange> pendingAtomicChange_;	// automatic composition is applied to only this
+			ChangeLog undoableChanges_, redoableChanges_;
+			bool lastChangeOpen_;	// true if the last group of undoableChanges_ accepts the next change
 			std::size_t compoundChangeDepth_;
-			bool rollbacking_;
-			std::unique_ptr<CompoundChange> rollbackingChange_;
-			CompoundChange* currentCompoundChange_;
+			ChangeLog* rollbackedChanges_;	// the log records the rollbacking changes, or null
+			bool rollbackingChangeOpen_;
+			boost::optional<std::size_t> limit_;
+			String erasedText_;	// the buffer Document.replace uses to build the erased text
 		};
 
 		// constructor takes the target document
 		Document::UndoManager::UndoManager(Document& document) BOOST_NOEXCEPT : document_(document),
-				compoundChangeDepth_(0), rollbacking_(false), rollbackingChange_(nullptr), currentCompoundChange_(nullptr) {
+				lastChangeOpen_(false), compoundChangeDepth_(0), rollbackedChanges_(nullptr), rollbackingChangeOpen_(false) {
 		}
 
 		// pushes the operation into the undo stack
-		void Document::UndoManager::addUndoableChange(std::unique_ptr<AtomicChange> c) {
-			if(!rollbacking_) {
-				if(isStackingCompoundOperation()) {
-					if(currentCompoundChange_ == nullptr) {
-						commitPendingChange();
-						std::unique_ptr<CompoundChange> newCompound(new CompoundChange());
-						currentCompoundChange_ = newCompound.get();
-						undoableChanges_.push(std::move(newCompound));
-					}
-					currentCompoundChange_->merge(c, document_);	// CompoundChange.merge always returns true
-				} else {
-					bool merged = false;
-					if(pendingAtomicChange_.get() != nullptr) {
-						merged = pendingAtomicChange_->merge(c, document_);
-						if(!merged)
-							commitPendingChange();
-					}
-					if(!merged) {
-						assert(pendingAtomicChange_.get() == nullptr);
-						pendingAtomicChange_ = std::move(c);
-					}
-				}
+		void Document::UndoManager::addUndoableChange(const AtomicChange& c) {
+			if(rollbackedChanges_ == nullptr) {
+				// merge with the pending change, or add to the current compound change
+				if(!lastChangeOpen_ || !undoableChanges_.mergeIntoLast(c))
+					undoableChanges_.append(c, !lastChangeOpen_ || !isStackingCompoundOperation());
+				lastChangeOpen_ = true;
 
 				// make the redo stack empty
-				while(!redoableChanges_.empty())
-					redoableChanges_.pop();
+				if(!redoableChanges_.empty())
+					redoableChanges_.clear();
+				shrinkToLimit();
 			} else {
-				// delay pushing to the stack when rollbacking
-				if(rollbackingChange_.get() == nullptr)
-					rollbackingChange_.reset(new CompoundChange());
-				rollbackingChange_->merge(c, document_);	// CompoundChange.merge always returns true
+				// the rollbacked change(s) make a compound change in the opposite stack
+				if(!rollbackingChangeOpen_ || !rollbackedChanges_->mergeIntoLast(c))
+					rollbackedChanges_->append(c, !rollbackingChangeOpen_);
+				rollbackingChangeOpen_ = true;
 			}
 		}
 
@@ -346,24 +348,10 @@ namespace ascension {
 
 		// clears the stacks
 		inline void Document::UndoManager::clear() BOOST_NOEXCEPT {
-			while(!undoableChanges_.empty())
-				undoableChanges_.pop();
-			while(!redoableChanges_.empty())
-				redoableChanges_.pop();
-			pendingAtomicChange_.reset();
+			undoableChanges_.clear();
+			redoableChanges_.clear();
+			lastChangeOpen_ = false;
 			compoundChangeDepth_ = 0;
-			currentCompoundChange_ = nullptr;
-		}
-
-		// commits the pending undoable change
-		inline void Document::UndoManager::commitPendingChange() {
-			if(pendingAtomicChange_.get() != nullptr) {
-				if(currentCompoundChange_ == nullptr || !currentCompoundChange_->merge(pendingAtomicChange_, document_)) {
-					undoableChanges_.push(std::move(pendingAtomicChange_));
-					currentCompoundChange_ = nullptr;
-				}
-				assert(pendingAtomicChange_.get() == nullptr);
-			}
 		}
 
 		// ends the compound change
@@ -373,54 +361,68 @@ namespace ascension {
 				// and redo() reset the counter to zero.
 				//		throw IllegalStateException("there is no compound change in this document.");
 				return;
-			if(--compoundChangeDepth_ == 0) {
-				assert(pendingAtomicChange_.get() == nullptr);
-				currentCompoundChange_ = nullptr;
-			}
+			if(--compoundChangeDepth_ == 0)
+				lastChangeOpen_ = false;
 		}
 
 		// stops the current compound chaining
 		inline void Document::UndoManager::insertBoundary() BOOST_NOEXCEPT {
 			if(!isStackingCompoundOperation())
-				commitPendingChange();
+				lastChangeOpen_ = false;
 		}
 
 		// redoes one change
-		void Document::UndoManager::redo(UndoableChange::Result& result) {
-			commitPendingChange();
-			if(redoableChanges_.empty()) {
-				result.reset();
+		inline void Document::UndoManager::redo(RollbackResult& result) {
+			rollback(redoableChanges_, undoableChanges_, result);
+		}
+
+		// performs the last group of 'changes' in reverse order, and records the rollbacking changes in 'rollbackedChanges'
+		void Document::UndoManager::rollback(ChangeLog& changes, ChangeLog& rollbackedChanges, RollbackResult& result) {
+			lastChangeOpen_ = false;
+			result.reset();
+			if(changes.empty())
 				return;
+			{
+				ascension::detail::ValueSaver<ChangeLog*> rollbacking(rollbackedChanges_);
+				rollbackedChanges_ = &rollbackedChanges;
+				rollbackingChangeOpen_ = false;
+				const std::size_t numberOfGroups = changes.numberOfGroups();
+				do {
+					const AtomicChange change(changes.last());
+					const auto performed(perform(document_, change));
+					result.numberOfRevisions += change.revisions;
+					result.endOfChange = performed.second;
+					if(!performed.first)
+						break;
+					changes.popLast();
+				} while(changes.numberOfGroups() == numberOfGroups);
+				result.completed = changes.numberOfGroups() != numberOfGroups;
 			}
-			rollbacking_ = true;
-			redoableChanges_.top()->perform(document_, result);
-			if(result.completed)
-				redoableChanges_.pop();
-			if(rollbackingChange_ != nullptr)
-				undoableChanges_.push(std::move(rollbackingChange_));	// move the rollbcked change(s) into the undo stack
-			rollbackingChange_.reset();
-			currentCompoundChange_ = nullptr;
-			rollbacking_ = false;
 			compoundChangeDepth_ = 0;
+			shrinkToLimit();
 		}
 
-		// undoes one change
-		void Document::UndoManager::undo(UndoableChange::Result& result) {
-			commitPendingChange();
-			if(undoableChanges_.empty()) {
-				result.reset();
-				return;
+		/**
+		 * Sets the maximum size of the undoable changes in bytes, and drops the oldest changes if exceeded.
+		 * @param limit The limit, or @c boost#none to unlimit
+		 */
+		void Document::UndoManager::setLimit(const boost::optional<std::size_t>& limit) BOOST_NOEXCEPT {
+			limit_ = limit;
+			shrinkToLimit();
+		}
+
+		// drops the oldest undoable changes until the size fits in the limit
+		void Document::UndoManager::shrinkToLimit() BOOST_NOEXCEPT {
+			if(limit_ != boost::none) {
+				// the last group is never dropped because it may be being built
+				while(undoableChanges_.size() > boost::get(limit_) && undoableChanges_.numberOfGroups() > 1)
+					undoableChanges_.dropFirstGroup();
 			}
-			rollbacking_ = true;
-			undoableChanges_.top()->perform(document_, result);
-			if(result.completed)
-				undoableChanges_.pop();
-			if(rollbackingChange_ != nullptr)
-				redoableChanges_.push(std::move(rollbackingChange_));	// move the rollbacked change(s) into the redo stack
-			rollbackingChange_.reset();
-			currentCompoundChange_ = nullptr;
-			rollbacking_ = false;
-			compoundChangeDepth_ = 0;
+		}
+
+		// undoes one change
+		inline void Document::UndoManager::undo(RollbackResult& result) {
+			rollback(undoableChanges_, redoableChanges_, result);
 		}
 
 
@@ -429,7 +431,7 @@ namespace ascension {
 		/// Constructor.
 		Document::Document() : session_(nullptr), partitioner_(),
 				contentTypeInformationProvider_(new DefaultContentTypeInformationProvider),
-				readOnly_(false), length_(0), revisionNumber_(0), lastUnmodifiedRevisionNumber_(0),
+				readOnly_(false), revisionNumber_(0), lastUnmodifiedRevisionNumber_(0), numberOfPoints_(0),
 				onceUndoBufferCleared_(false), recordingChanges_(true), changing_(false), rollbacking_(false)/*, locker_(nullptr)*/ {
 			bookmarker_.reset(new Bookmarker(*this));
 			undoManager_.reset(new UndoManager(*this));
@@ -438,12 +440,16 @@ namespace ascension {
 
 		/// Destructor.
 		Document::~Document() {
-			BOOST_FOREACH(AbstractPoint* p, points_)
-				p->documentDisposed();
+			BOOST_FOREACH(const auto& bucket, points_) {
+				BOOST_FOREACH(AbstractPoint* p, bucket.second)
+					p->documentDisposed();
+			}
 			accessibleRegion_.reset();
 			bookmarker_.reset();	// Bookmarker.~Bookmarker() calls Document...
 			for(std::size_t i = 0, c = lines_.size(); i < c; ++i)
 				delete lines_[i];
+			lazyLines_.reset();
+			FastArenaObject<Line>::releaseUnusedMemory();
 		}
 
 		/**
@@ -569,7 +575,7 @@ namespace ascension {
 			ASCENSION_PREPARE_FIRST_CHANGE(false);
 
 			const bool modified = isModified();
-			UndoableChange::Result result;
+			RollbackResult result;
 			result.completed = true;
 			rollbackListeners_.notify<const Document&>(&DocumentRollbackListener::documentUndoSequenceStarted, *this);
 
@@ -636,9 +642,12 @@ namespace ascension {
 			// change the content
 			const Position& beginning = *boost::const_begin(region);
 			const Position& end = *boost::const_end(region);
-			StringPiece::const_iterator nextNewline((text.cbegin() != nullptr) ? boost::find_first_of(text, text::NEWLINE_CHARACTERS) : text.cend());
-			std::basic_stringbuf<Char> erasedString;
-			Index erasedStringLength = 0, insertedStringLength = 0;
+			std::vector<StringPiece::const_iterator> newlines;	// all newlines in the inserted string
+			if(text.cbegin() != nullptr)
+				text::findNewlines(text.cbegin(), text.cend(), newlines);
+			StringPiece::const_iterator nextNewline(!newlines.empty() ? newlines.front() : text.cend());
+			String& erasedString = undoManager_->erasedText();	// reuses the buffer
+			erasedString.clear();
 			Region insertedRegion;
 			try {
 				// simple cases: both erased region and inserted string are single line
@@ -646,22 +655,24 @@ namespace ascension {
 					insertedRegion = Region::makeEmpty(beginning);
 					fireDocumentAboutToBeChanged(DocumentChange(region, insertedRegion));
 					Line& line = *lines_[beginning.line];
-					erasedString.sputn(line.text().data() + offsetInLine(beginning), static_cast<std::streamsize>(offsetInLine(end) - offsetInLine(beginning)));
-					line.text_.erase(offsetInLine(beginning), offsetInLine(end) - offsetInLine(beginning));
-					erasedStringLength += offsetInLine(end) - offsetInLine(beginning);
+					if(isRecordingChanges())
+						line.appendText(erasedString, offsetInLine(beginning), offsetInLine(end));
+					line.replace(offsetInLine(beginning), offsetInLine(end), StringPiece());
+					lineIndex_.set(kernel::line(beginning), LineLength(line));
 				} else if(boost::empty(region) && nextNewline == text.cend()) {	// insert single line
 					insertedRegion = Region::makeSingleLine(kernel::line(beginning), boost::irange(offsetInLine(beginning), offsetInLine(beginning) + text.length()));
 					fireDocumentAboutToBeChanged(DocumentChange(region, insertedRegion));
-					lines_[kernel::line(beginning)]->text_.insert(offsetInLine(beginning), text.cbegin(), text.length());
-					insertedStringLength += text.length();
+					Line& line = *lines_[kernel::line(beginning)];
+					line.replace(offsetInLine(beginning), offsetInLine(beginning), text);
+					lineIndex_.set(kernel::line(beginning), LineLength(line));
 				} else if(kernel::line(beginning) == kernel::line(end) && nextNewline == text.cend()) {	// replace in single line
 					insertedRegion = Region::makeSingleLine(kernel::line(beginning), boost::irange(offsetInLine(beginning), offsetInLine(beginning) + text.length()));
 					fireDocumentAboutToBeChanged(DocumentChange(region, insertedRegion));
 					Line& line = *lines_[beginning.line];
-					erasedString.sputn(line.text().data() + offsetInLine(beginning), static_cast<std::streamsize>(offsetInLine(end) - offsetInLine(beginning)));
-					line.text_.replace(offsetInLine(beginning), offsetInLine(end) - offsetInLine(beginning), text.cbegin(), text.length());
-					erasedStringLength += offsetInLine(end) - offsetInLine(beginning);
-					insertedStringLength += text.length();
+					if(isRecordingChanges())
+						line.appendText(erasedString, offsetInLine(beginning), offsetInLine(end));
+					line.replace(offsetInLine(beginning), offsetInLine(end), text);
+					lineIndex_.set(kernel::line(beginning), LineLength(line));
 				}
 				// complex case: erased region and/or inserted string are/is multi-line
 				else {
@@ -670,46 +681,43 @@ namespace ascension {
 						for(Position p(beginning); ; ++p.line, p.offsetInLine = 0) {
 							const Line& line = *lines_[p.line];
 							const bool last = p.line == end.line;
-							const Index e = !last ? line.text().length() : offsetInLine(end);
+							const Index e = !last ? line.length() : offsetInLine(end);
 							if(isRecordingChanges()) {
-								erasedString.sputn(line.text().data() + offsetInLine(p), static_cast<std::streamsize>(e - offsetInLine(p)));
-								if(!last) {
-									const String eol(line.newline().asString());
-									erasedString.sputn(eol.data(), static_cast<std::streamsize>(eol.length()));
-								}
+								line.appendText(erasedString, offsetInLine(p), e);
+								if(!last)
+									erasedString.append(line.newline().asString());
 							}
-//							erasedStringLength += e - offsetInLine(p);
 							if(last)
 								break;
 						}
 					}
 
 					// 2. allocate strings (lines except first) to insert newly. only when inserted string was multiline
+					const StringPiece::const_iterator firstNewline(nextNewline);
 					std::vector<Line*> allocatedLines;
 					insertedRegion = Region::makeEmpty(beginning);
 					if(text.cbegin() != nullptr && nextNewline != text.cend()) {
 						try {
 							StringPiece::const_iterator p(std::next(nextNewline, text::eatNewline(nextNewline, text.cend())->asString().length()));
-							while(true) {
-								nextNewline = boost::find_first_of(boost::make_iterator_range(p, text.cend()), text::NEWLINE_CHARACTERS);
+							for(std::size_t i = 1; ; ++i) {
+								nextNewline = (i < newlines.size()) ? newlines[i] : text.cend();
 								std::unique_ptr<Line> temp(
 									(nextNewline != text.cend()) ?
 										new Line(revisionNumber_ + 1, String(p, nextNewline), *text::eatNewline(nextNewline, text.cend()))
 										: new Line(revisionNumber_ + 1, String(p, nextNewline)));
 								allocatedLines.push_back(temp.get());
 								temp.release();
-								insertedStringLength += allocatedLines.back()->text().length();
 								if(nextNewline == text.cend())
 									break;
 								p = std::next(nextNewline, allocatedLines.back()->newline().asString().length());
 							}
 							// merge last line
 							Line& lastAllocatedLine = *allocatedLines.back();
-							insertedRegion = Region(*boost::const_begin(insertedRegion), Position(kernel::line(beginning) + allocatedLines.size(), lastAllocatedLine.text().length()));
+							insertedRegion = Region(*boost::const_begin(insertedRegion), Position(kernel::line(beginning) + allocatedLines.size(), lastAllocatedLine.length()));
 							const Line& lastLine = *lines_[kernel::line(end)];
-							const auto n = lastLine.text().length() - offsetInLine(end);
-							lastAllocatedLine.text_.append(lastLine.text(), offsetInLine(end), n);
-							insertedStringLength += n;
+							String buffer;
+							const StringPiece rest(lastLine.textPiece(buffer).substr(offsetInLine(end)));
+							lastAllocatedLine.replace(lastAllocatedLine.length(), lastAllocatedLine.length(), rest);
 							lastAllocatedLine.newline_ = lastLine.newline();
 						} catch(...) {
 							BOOST_FOREACH(Line* line, allocatedLines)
@@ -717,7 +725,6 @@ namespace ascension {
 							throw;
 						}
 					}
-					const StringPiece::const_iterator firstNewline(nextNewline);
 					const Index insertedLength = firstNewline - text.cbegin();
 					if(allocatedLines.empty()) {
 						auto temp(*boost::end(insertedRegion));
@@ -728,21 +735,22 @@ namespace ascension {
 
 					try {
 						// 3. insert allocated strings
+						lineIndex_.reserve(lineIndex_.size() + allocatedLines.size());	// updateLineIndex below can't throw
 						if(!allocatedLines.empty())
 							lines_.insert(std::begin(lines_) + kernel::line(end) + 1, std::begin(allocatedLines), std::end(allocatedLines));
 
 						// 4. replace first line
 						Line& firstLine = *lines_[kernel::line(beginning)];
-						const Index erasedLength = firstLine.text().length() - offsetInLine(beginning);
+						const Index erasedLength = firstLine.length() - offsetInLine(beginning);
 						try {
 							if(!allocatedLines.empty())
-								firstLine.text_.replace(offsetInLine(beginning), erasedLength, text.cbegin(), insertedLength);
+								firstLine.replace(offsetInLine(beginning), offsetInLine(beginning) + erasedLength, text.substr(0, insertedLength));
 							else {
 								// join the first line, inserted string and the last line
 								String temp(text.cbegin(), insertedLength);
 								const Line& lastLine = *lines_[kernel::line(end)];
-								temp.append(lastLine.text(), offsetInLine(end), lastLine.text().length() - offsetInLine(end));
-								firstLine.text_.replace(offsetInLine(beginning), erasedLength, temp);
+								lastLine.appendText(temp, offsetInLine(end), lastLine.length());
+								firstLine.replace(offsetInLine(beginning), offsetInLine(beginning) + erasedLength, temp);
 							}
 						} catch(...) {
 							const auto b(std::next(std::begin(lines_), kernel::line(end) + 1));
@@ -753,8 +761,6 @@ namespace ascension {
 						}
 						firstLine.newline_ = (firstNewline != text.cend()) ?
 							*text::eatNewline(firstNewline, text.cend()) : lines_[kernel::line(end)]->newline();
-						erasedStringLength += erasedLength;
-						insertedStringLength += insertedLength;
 					} catch(...) {
 						BOOST_FOREACH(Line* line, allocatedLines)
 							delete line;
@@ -767,6 +773,7 @@ namespace ascension {
 						std::for_each(b, e, std::default_delete<Line>());
 						lines_.erase(b, e);
 					}
+					updateLineIndex(kernel::line(beginning), kernel::line(end) - kernel::line(beginning) + 1, allocatedLines.size() + 1);
 				}
 			} catch(...) {
 				// fire event even if change failed
@@ -776,19 +783,17 @@ namespace ascension {
 			}
 
 			if(isRecordingChanges()) {
-				std::unique_ptr<AtomicChange> c;
 				if(boost::empty(region))
-					c.reset(new DeletionChange(insertedRegion));
+					undoManager_->addUndoableChange(AtomicChange(AtomicChange::DELETION, insertedRegion));
 				else if(text.cbegin() == nullptr || text.empty())
-					c.reset(new InsertionChange(beginning, erasedString.str()));
+					undoManager_->addUndoableChange(AtomicChange(AtomicChange::INSERTION, Region::makeEmpty(beginning), erasedString));
 				else
-					c.reset(new ReplacementChange(insertedRegion, erasedString.str()));
-				undoManager_->addUndoableChange(std::move(c));
+					undoManager_->addUndoableChange(AtomicChange(AtomicChange::REPLACEMENT, insertedRegion, erasedString));
+				if(erasedString.capacity() > 0x10000u)
+					String().swap(erasedString);	// do not keep the large buffer
 			}
 			const bool modified = isModified();
 			++revisionNumber_;
-			length_ += insertedStringLength;
-			length_ -= erasedStringLength;
 
 			const DocumentChange change(region, insertedRegion);
 			fireDocumentChanged(change);
@@ -798,6 +803,223 @@ namespace ascension {
 			return *boost::const_end(insertedRegion);
 		}
 
+		/**
+		 * Substitutes the given texts for the specified regions in the document at once.
+		 *
+		 * This is equivalent to calling @c #replace(const Region&, const StringPiece&) for each element from the last
+		 * to the first, but the lines are rebuilt in one pass and the listeners are notified only once. The
+		 * @c DocumentChange passed to the listeners spans from the first replacement to the last, and
+		 * @c DocumentChange#replacements returns the individual replacements. The points are moved as if each
+		 * replacement was performed separately. The change is recorded as one compound change for undo.
+		 *
+		 * The regions are given in the positions before the change, in any order. They must not overlap each other,
+		 * but may touch. The empty regions at the same position are performed in the given order.
+		 * @param replacements The pairs of the region to erase and the text to insert
+		 * @throw ReadOnlyDocumentException The document is read only
+		 * @throw BadRegionException Any region intersects with outside of the document
+		 * @throw DocumentAccessViolationException Any region intersects the inaccesible region
+		 * @throw std#invalid_argument The regions overlap each other
+		 * @throw IllegalStateException The method was called in @c{IDocumentListener}s' notification
+		 * @throw IDocumentInput#ChangeRejectedException The input of the document rejected this change
+		 * @throw std#bad_alloc The internal memory allocation failed
+		 */
+		void Document::replace(const std::vector<std::pair<Region, StringPiece>>& replacements) {
+			if(changing_)
+				throw IllegalStateException("called in DocumentListeners' notification.");
+			else if(isReadOnly())
+				throw ReadOnlyDocumentException();
+
+			// validate and sort the replacements, and drop the ones which do nothing
+			std::vector<std::pair<Region, StringPiece>> edits;
+			edits.reserve(replacements.size());
+			BOOST_FOREACH(const auto& replacement, replacements) {
+				const Region& region = replacement.first;
+				if(kernel::line(*boost::const_end(region)) >= numberOfLines()
+						|| kernel::offsetInLine(*boost::const_begin(region)) > lineLength(kernel::line(*boost::const_begin(region)))
+						|| kernel::offsetInLine(*boost::const_end(region)) > lineLength(kernel::line(*boost::const_end(region))))
+					throw BadRegionException(region);
+				else if(isNarrowed() && !encompasses(accessibleRegion(), region))
+					throw DocumentAccessViolationException();
+				else if(!boost::empty(region) || (replacement.second.cbegin() != nullptr && !replacement.second.empty()))
+					edits.push_back(replacement);
+			}
+			std::stable_sort(std::begin(edits), std::end(edits),
+				[](const std::pair<Region, StringPiece>& lhs, const std::pair<Region, StringPiece>& rhs) {
+					return std::make_pair(*boost::const_begin(lhs.first), *boost::const_end(lhs.first))
+						< std::make_pair(*boost::const_begin(rhs.first), *boost::const_end(rhs.first));
+				});
+			for(std::size_t i = 1; i < edits.size(); ++i) {
+				if(*boost::const_end(edits[i - 1].first) > *boost::const_begin(edits[i].first))
+					throw std::invalid_argument("replacements");
+			}
+			if(edits.empty())
+				return;	// nothing to do
+			else if(edits.size() == 1) {
+				replace(edits.front().first, edits.front().second);
+				return;
+			}
+			ASCENSION_PREPARE_FIRST_CHANGE(rollbacking_);
+
+			// preprocess. these can't throw
+			ascension::detail::ValueSaver<bool> writeLock(changing_);
+			changing_ = true;
+
+			// 1. build the new lines. the replacements sharing lines make a cluster, and the lines of a cluster are
+			// replaced with the new lines. the lines between the clusters are not touched
+			struct Cluster {
+				Index firstLine, numberOfErasedLines, numberOfInsertedLines;
+			};
+			std::vector<Cluster> clusters;
+			std::vector<Line*> allocatedLines;	// the new lines of all clusters in order
+			std::vector<std::pair<Region, Region>> changes;	// see DocumentChange.replacements
+			changes.reserve(edits.size());
+			String erasedStrings;	// the erased texts of all replacements
+			std::vector<Index> erasedStringEnds;
+			Index numberOfErasedLines = 0, maximumNumberOfLines = lines_.size();
+			try {
+				std::vector<StringPiece::const_iterator> newlines;
+				String current;
+				for(std::size_t i = 0; i < edits.size(); ) {
+					Cluster cluster = {kernel::line(*boost::const_begin(edits[i].first)), 0, 0};
+					const Index firstNewLine = cluster.firstLine - numberOfErasedLines + allocatedLines.size();
+					const std::size_t firstAllocatedLine = allocatedLines.size();
+					current.clear();
+					lines_[cluster.firstLine]->appendText(current, 0, kernel::offsetInLine(*boost::const_begin(edits[i].first)));
+					for(Index lastLine = cluster.firstLine; ; ++i) {
+						const Position& beginning = *boost::const_begin(edits[i].first);
+						const Position& end = *boost::const_end(edits[i].first);
+						const StringPiece& text = edits[i].second;
+
+						// save undo information
+						if(isRecordingChanges()) {
+							for(Position p(beginning); ; ++p.line, p.offsetInLine = 0) {
+								const Line& line = *lines_[kernel::line(p)];
+								const bool last = kernel::line(p) == kernel::line(end);
+								line.appendText(erasedStrings, kernel::offsetInLine(p), !last ? line.length() : kernel::offsetInLine(end));
+								if(last)
+									break;
+								erasedStrings.append(line.newline().asString());
+							}
+							erasedStringEnds.push_back(erasedStrings.length());
+						}
+
+						// append the inserted text
+						const Position insertedBeginning(firstNewLine + allocatedLines.size() - firstAllocatedLine, current.length());
+						newlines.clear();
+						if(text.cbegin() != nullptr)
+							text::findNewlines(text.cbegin(), text.cend(), newlines);
+						StringPiece::const_iterator p(text.cbegin());
+						BOOST_FOREACH(StringPiece::const_iterator newline, newlines) {
+							current.append(p, newline);
+							const text::Newline nlf(*text::eatNewline(newline, text.cend()));
+							std::unique_ptr<Line> temp(new Line(revisionNumber_ + 1, current, nlf));
+							allocatedLines.push_back(temp.get());
+							temp.release();
+							current.clear();
+							p = std::next(newline, nlf.asString().length());
+						}
+						current.append(p, text.cend());
+						changes.push_back(std::make_pair(edits[i].first,
+							Region(insertedBeginning, Position(firstNewLine + allocatedLines.size() - firstAllocatedLine, current.length()))));
+
+						// append the text until the next replacement or the end of the cluster
+						lastLine = kernel::line(end);
+						const Line& line = *lines_[lastLine];
+						if(i + 1 < edits.size() && kernel::line(*boost::const_begin(edits[i + 1].first)) == lastLine)
+							line.appendText(current, kernel::offsetInLine(end), kernel::offsetInLine(*boost::const_begin(edits[i + 1].first)));
+						else {
+							line.appendText(current, kernel::offsetInLine(end), line.length());
+							std::unique_ptr<Line> temp(new Line(revisionNumber_ + 1, current, line.newline()));
+							allocatedLines.push_back(temp.get());
+							temp.release();
+							cluster.numberOfErasedLines = lastLine - cluster.firstLine + 1;
+							cluster.numberOfInsertedLines = allocatedLines.size() - firstAllocatedLine;
+							++i;
+							break;
+						}
+					}
+					clusters.push_back(cluster);
+					numberOfErasedLines += cluster.numberOfErasedLines;
+					if(cluster.numberOfInsertedLines > cluster.numberOfErasedLines)
+						maximumNumberOfLines += cluster.numberOfInsertedLines - cluster.numberOfErasedLines;
+				}
+				if(lines_.capacity() < maximumNumberOfLines)
+					lines_.reserve(maximumNumberOfLines);
+				lineIndex_.reserve(maximumNumberOfLines);	// updateLineIndex below can't throw
+			} catch(...) {
+				BOOST_FOREACH(Line* line, allocatedLines)
+					delete line;
+				throw;
+			}
+
+			const Region erasedRegion(*boost::const_begin(changes.front().first), *boost::const_end(changes.back().first));
+			const Region insertedRegion(*boost::const_begin(changes.front().second), *boost::const_end(changes.back().second));
+			fireDocumentAboutToBeChanged(DocumentChange(erasedRegion, insertedRegion, &changes));
+
+			// 2. replace the lines of the clusters from the last. these can't throw
+			std::size_t nextAllocatedLine = allocatedLines.size();
+			for(auto cluster(clusters.crbegin()); cluster != clusters.crend(); ++cluster) {
+				nextAllocatedLine -= cluster->numberOfInsertedLines;
+				const auto newLines(std::next(std::begin(allocatedLines), nextAllocatedLine));
+				const Index n = std::min(cluster->numberOfErasedLines, cluster->numberOfInsertedLines);
+				for(Index i = 0; i < n; ++i) {
+					delete lines_[cluster->firstLine + i];
+					lines_[cluster->firstLine + i] = newLines[i];
+				}
+				const auto b(std::next(std::begin(lines_), cluster->firstLine + n));
+				if(cluster->numberOfErasedLines > n) {
+					const auto e(std::next(b, cluster->numberOfErasedLines - n));
+					std::for_each(b, e, std::default_delete<Line>());
+					lines_.erase(b, e);
+				} else if(cluster->numberOfInsertedLines > n)
+					lines_.insert(b, std::next(newLines, n), std::next(newLines, cluster->numberOfInsertedLines));
+				updateLineIndex(cluster->firstLine, cluster->numberOfErasedLines, cluster->numberOfInsertedLines);
+			}
+
+			// 3. record the replacements as if performed from the last
+			if(isRecordingChanges()) {
+				undoManager_->beginCompoundChange();
+				for(std::size_t i = changes.size(); i > 0; --i) {
+					const Region& erased = changes[i - 1].first;
+					const Region& inserted = changes[i - 1].second;
+					const Position& beginning = *boost::const_begin(erased);
+					const StringPiece erasedString(erasedStrings.data() + ((i > 1) ? erasedStringEnds[i - 2] : 0),
+						erasedStringEnds[i - 1] - ((i > 1) ? erasedStringEnds[i - 2] : 0));
+					Position end(beginning);	// the end of the inserted text in this case
+					if(kernel::line(*boost::const_end(inserted)) == kernel::line(*boost::const_begin(inserted)))
+						end.offsetInLine += kernel::offsetInLine(*boost::const_end(inserted)) - kernel::offsetInLine(*boost::const_begin(inserted));
+					else {
+						end.line += kernel::line(*boost::const_end(inserted)) - kernel::line(*boost::const_begin(inserted));
+						end.offsetInLine = kernel::offsetInLine(*boost::const_end(inserted));
+					}
+					if(boost::empty(erased))
+						undoManager_->addUndoableChange(AtomicChange(AtomicChange::DELETION, Region(beginning, end)));
+					else if(boost::empty(inserted))
+						undoManager_->addUndoableChange(AtomicChange(AtomicChange::INSERTION, Region::makeEmpty(beginning), erasedString));
+					else
+						undoManager_->addUndoableChange(AtomicChange(AtomicChange::REPLACEMENT, Region(beginning, end), erasedString));
+				}
+				undoManager_->endCompoundChange();
+			}
+			const bool modified = isModified();
+			++revisionNumber_;
+
+			fireDocumentChanged(DocumentChange(erasedRegion, insertedRegion, &changes));
+			if(!rollbacking_ && !modified)
+				modificationSignChangedSignal_(*this);
+		}
+
+		/**
+		 * Limits the memory the undo history uses. When the size of the undoable changes exceeds @a limit, the oldest
+		 * ones are discarded. The last undoable change is always kept. The redoable changes are not limited because
+		 * they are made by undoing. The history is unlimited to start with.
+		 * @param limit The maximum size in bytes, or @c boost#none to unlimit
+		 * @see #undoBufferLimit, #undoBufferSize
+		 */
+		void Document::setUndoBufferLimit(const boost::optional<std::size_t>& limit) BOOST_NOEXCEPT {
+			undoManager_->setLimit(limit);
+		}
+
 		/**
 		 * Performs the undo. Does nothing if the target region is inaccessible.
 		 * @param n The repeat count
@@ -818,7 +1040,7 @@ namespace ascension {
 
 			const bool modified = isModified();
 			const std::size_t oldRevisionNumber = revisionNumber_;
-			UndoableChange::Result result;
+			RollbackResult result;
 			result.completed = true;
 			rollbackListeners_.notify<const Document&>(&DocumentRollbackListener::documentUndoSequenceStarted, *this);
 
@@ -838,5 +1060,21 @@ namespace ascension {
 				modificationSignChangedSignal_(*this);
 			return result.completed;
 		}
+
+		/**
+		 * Returns the maximum size of the undoable changes in bytes, or @c boost#none if unlimited.
+		 * @see #setUndoBufferLimit
+		 */
+		boost::optional<std::size_t> Document::undoBufferLimit() const BOOST_NOEXCEPT {
+			return undoManager_->limit();
+		}
+
+		/**
+		 * Returns the size of the memory the undo/redo history uses, in bytes.
+		 * @see #setUndoBufferLimit
+		 */
+		std::size_t Document::undoBufferSize() const BOOST_NOEXCEPT {
+			return undoManager_->size();
+		}
 	}
 }
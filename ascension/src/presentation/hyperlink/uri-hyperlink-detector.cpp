@@ -60,7 +60,8 @@ namespace ascension {
 			/// @see HyperlinkDetector#nextHyperlink
 			std::unique_ptr<Hyperlink> URIHyperlinkDetector::nextHyperlink(
 					const kernel::Document& document, Index line, const boost::integer_range<Index>& range) const {
-				const String& s = document.lineString(line);
+				String buffer;
+				const StringPiece s(document.lineContent(line).textPiece(buffer));	// don't widen the line
 				if(*boost::const_end(range) > s.length())
 					throw std::out_of_range("range");
 				const Char* bol = s.data();
@@ -98,9 +98,11 @@ namespace ascension {
 					*boost::const_end(doc.region())));
 			kernel::ContentType contentType((kernel::line(i.tell()) == 0) ? kernel::ContentType::DEFAULT_CONTENT
 				: (*partitionAt(kernel::Position(kernel::line(i.tell()), doc.lineLength(kernel::line(i.tell()) - 1))))->contentType);
-			for(const String* line = &doc.lineString(kernel::line(i.tell())); ; ) {	// scan and tokenize into partitions...
-				const bool atEOL = kernel::offsetInLine(i.tell()) == line->length();
-				const auto transition(tryTransition(*line, kernel::offsetInLine(i.tell()), contentType));
+			String buffer;	// does not widen the lines stored in Latin-1
+			std::shared_ptr<const kernel::Document::Line> lineContent(doc.pinLine(kernel::line(i.tell())));	// not evicted in lazy mode
+			for(StringPiece line(lineContent->textPiece(buffer)); ; ) {	// scan and tokenize into partitions...
+				const bool atEOL = kernel::offsetInLine(i.tell()) == line.length();
+				const auto transition(tryTransition(line, kernel::offsetInLine(i.tell()), contentType));
 				if(transition != boost::none) {	// a transition token was found
 					Index tokenLength;
 					kernel::ContentType newPartitionContentType = kernel::ContentType::DEFAULT_CONTENT;
@@ -129,8 +131,10 @@ namespace ascension {
 				// go to the next character if no transition occurred
 				if(transition != boost::none) {
 					++i;
-					if(kernel::offsetInLine(i.tell()) == 0)	// entered the next line
-						line = &doc.lineString(kernel::line(i.tell()));
+					if(kernel::offsetInLine(i.tell()) == 0) {	// entered the next line
+						lineContent = doc.pinLine(kernel::line(i.tell()));
+						line = lineContent->textPiece(buffer);
+					}
 				}
 			}
 		
@@ -58,6 +58,25 @@ namespace ascension {
 				throw std::invalid_argument("The rule is already registered.");
 			wordRules_.push_front(std::move(rule));
 		}
+
+		/**
+		 * Returns the text of the line the scanner is at, without widening the line stored in one byte per
+		 * character. Such a line is widened into the buffer only once.
+		 */
+		StringPiece LexicalTokenScanner::currentLine() {
+			const kernel::Document& document = current_.document();
+			const Index line = kernel::line(current_.tell());
+			lineContent_ = document.pinLine(line);
+			if(!lineContent_->isLatin1())
+				return lineContent_->textPiece(lineBuffer_);
+			const std::pair<std::size_t, Index> key(document.revisionNumber(), line);
+			if(bufferedLine_ != key) {
+				bufferedLine_ = boost::none;
+				lineContent_->textPiece(lineBuffer_);
+				bufferedLine_ = key;
+			}
+			return lineBuffer_;
+		}
 		
 		/// @see TokenScanner#hasNext
 		bool LexicalTokenScanner::hasNext() const BOOST_NOEXCEPT {
@@ -73,11 +92,11 @@ namespace ascension {
 		std::unique_ptr<Token> LexicalTokenScanner::nextToken() {
 			// TODO: This code is not exception-safe.
 			const text::IdentifierSyntax& ids = identifierSyntax();
-			StringPiece line(current_.lineString());
+			StringPiece line(currentLine());
 			while(current_.hasNext()) {
 				if(*current_ == text::LINE_SEPARATOR) {
 					++current_;
-					line = current_.lineString();
+					line = currentLine();
 					if(!current_.hasNext())
 						break;
 				}
@@ -113,6 +132,8 @@ namespace ascension {
 		/// @see TokenScanner#parse
 		void LexicalTokenScanner::parse(const kernel::Document& document, const kernel::Region& region) {
 			current_ = kernel::DocumentCharacterIterator(document, region);
+			lineContent_.reset();
+			bufferedLine_ = boost::none;
 		}
 		
 		/// @see TokenScanner#position
@@ -47,10 +47,11 @@ namespace ascension {
 
 			if(inheritIndent) {	// simple auto-indent
 				const auto ip(insertionPosition(caret));
-				const String& currentLine = caret.document().lineString(kernel::line(ip));
+				String buffer;
+				const StringPiece currentLine(caret.document().lineContent(kernel::line(ip)).textPiece(buffer));
 				const Index len = kernel::detail::identifierSyntax(caret).eatWhiteSpaces(
 					currentLine.data(), currentLine.data() + kernel::offsetInLine(ip), true) - currentLine.data();
-				s += currentLine.substr(0, len);
+				s.append(currentLine.data(), len);
 			}
 
 			if(newlines > 1) {
@@ -82,7 +83,6 @@ namespace ascension {
 			 * @deprecated 0.8
 			 */
 			void indent(Caret& caret, Char character, bool rectangle, long level) {
-				// TODO: this code is not exception-safe.
 				if(level == 0)
 					return;
 				const String indent(abs(level), character);
@@ -94,9 +94,6 @@ namespace ascension {
 					return;
 				}
 
-				kernel::Position otherResult(region.anchor());
-				Index line = kernel::line(*boost::const_begin(region));
-
 				struct AdvanceOffsetInLine {
 					explicit AdvanceOffsetInLine(SignedIndex offset) BOOST_NOEXCEPT : offset(offset) {}
 					kernel::Position operator()(const kernel::Position& p) const BOOST_NOEXCEPT {
@@ -105,17 +102,22 @@ namespace ascension {
 					SignedIndex offset;
 				};
 
-				// indent/unindent the first line
+				// collect the indents/unindents of the selected lines, and perform them by one change
 				kernel::Document& document = caret.document();
+				std::vector<std::pair<kernel::Region, StringPiece>> replacements;
+				const Index caretLine = kernel::line(insertionPosition(caret));
+				boost::optional<SignedIndex> caretOffset;	// the distance to move the caret
+				Index line = kernel::line(*boost::const_begin(region));
+				String buffer;	// for the lines stored in one byte per character
+
+				// indent/unindent the first line
 				if(level > 0) {
-					insert(document, kernel::Position(line, rectangle ? kernel::offsetInLine(*boost::const_begin(region)) : 0), indent);
-					if(line == kernel::line(otherResult) && kernel::offsetInLine(otherResult) != 0)
-						otherResult.offsetInLine += level;
-					const auto ip(insertionPosition(caret));
-					if(line == kernel::line(ip) && kernel::offsetInLine(ip) != 0)
-						caret.moveTo(caret.hit().offsetHit(AdvanceOffsetInLine(level)));
+					replacements.push_back(std::make_pair(kernel::Region::makeEmpty(
+						kernel::Position(line, rectangle ? kernel::offsetInLine(*boost::const_begin(region)) : 0)), StringPiece(indent)));
+					if(line == caretLine)
+						caretOffset = level;
 				} else {
-					const String& s = document.lineString(line);
+					const StringPiece s(document.lineContent(line).textPiece(buffer));
 					Index indentLength;
 					for(indentLength = 0; indentLength < s.length(); ++indentLength) {
 						// this assumes that all white space characters belong to BMP
@@ -124,12 +126,9 @@ namespace ascension {
 					}
 					if(indentLength > 0) {
 						const Index deleteLength = std::min<Index>(-level, indentLength);
-						kernel::erase(document, kernel::Region(kernel::Position::bol(line), kernel::Position(line, deleteLength)));
-						if(line == kernel::line(otherResult) && kernel::offsetInLine(otherResult) != 0)
-							otherResult.offsetInLine -= deleteLength;
-						const auto ip(insertionPosition(caret));
-						if(line == kernel::line(ip) && kernel::offsetInLine(ip) != 0)
-							caret.moveTo(caret.hit().offsetHit(AdvanceOffsetInLine(deleteLength)));
+						replacements.push_back(std::make_pair(kernel::Region(kernel::Position::bol(line), kernel::Position(line, deleteLength)), StringPiece()));
+						if(line == caretLine)
+							caretOffset = deleteLength;
 					}
 				}
 
@@ -147,17 +146,14 @@ namespace ascension {
 									insertPosition = boost::none;
 							}
 							if(insertPosition)
-								insert(document, kernel::Position(line, *insertPosition), indent);
-							if(line == kernel::line(otherResult) && kernel::offsetInLine(otherResult) != 0)
-								otherResult.offsetInLine += level;
-							const auto ip(insertionPosition(caret));
-							if(line == kernel::line(ip) && kernel::offsetInLine(ip) != 0)
-								caret.moveTo(caret.hit().offsetHit(AdvanceOffsetInLine(level)));
+								replacements.push_back(std::make_pair(kernel::Region::makeEmpty(kernel::Position(line, *insertPosition)), StringPiece(indent)));
+							if(line == caretLine)
+								caretOffset = level;
 						}
 					}
 				} else {
 					for(++line; line <= kernel::line(*boost::const_end(region)); ++line) {
-						const String& s = document.lineString(line);
+						const StringPiece s(document.lineContent(line).textPiece(buffer));
 						Index indentLength;
 						for(indentLength = 0; indentLength < s.length(); ++indentLength) {
 						// this assumes that all white space characters belong to BMP
@@ -166,15 +162,16 @@ namespace ascension {
 						}
 						if(indentLength > 0) {
 							const Index deleteLength = std::min<Index>(-level, indentLength);
-							kernel::erase(document, kernel::Region(kernel::Position::bol(line), kernel::Position(line, deleteLength)));
-							if(line == kernel::line(otherResult) && kernel::offsetInLine(otherResult) != 0)
-								otherResult.offsetInLine -= deleteLength;
-							const auto ip(insertionPosition(caret));
-							if(line == kernel::line(ip) && kernel::offsetInLine(ip) != 0)
-								caret.moveTo(caret.hit().offsetHit(AdvanceOffsetInLine(deleteLength)));
+							replacements.push_back(std::make_pair(kernel::Region(kernel::Position::bol(line), kernel::Position(line, deleteLength)), StringPiece()));
+							if(line == caretLine)
+								caretOffset = deleteLength;
 						}
 					}
 				}
+
+				document.replace(replacements);
+				if(caretOffset && kernel::offsetInLine(insertionPosition(caret)) != 0)
+					caret.moveTo(caret.hit().offsetHit(AdvanceOffsetInLine(*caretOffset)));
 			}
 		} // namespace @0
 
@@ -28,6 +28,7 @@
 #include <ascension/viewer/virtual-box.hpp>
 #include <ascension/viewer/visual-locations.hpp>
 #include <boost/range/algorithm/binary_search.hpp>
+#include <algorithm>
 
 namespace ascension {
 	namespace viewer {
@@ -437,6 +438,13 @@ namespace ascension {
 				painter_->hide();
 		}
 
+		/// @see kernel#AbstractPoint#indexedLine
+		Index Caret::indexedLine() const BOOST_NOEXCEPT {
+			// the anchor also should be updated by the change
+			const Index caretLine = VisualPoint::indexedLine();
+			return (anchor_ != boost::none) ? std::min(kernel::line(boost::get(anchor_).characterIndex()), caretLine) : caretLine;
+		}
+
 		namespace {
 			/**
 			 * @internal Deletes the forward one character and inserts the specified text.
@@ -500,7 +508,8 @@ namespace ascension {
 				if(const texteditor::Session* const session = doc.session()) {
 					if(const std::shared_ptr<const texteditor::InputSequenceCheckers> checker = session->inputSequenceCheckers()) {
 						const auto ip(insertionPosition(document(), beginning()));
-						const Char* const lineString = doc.lineString(kernel::line(ip)).data();
+						String buffer;
+						const Char* const lineString = doc.lineContent(kernel::line(ip)).textPiece(buffer).data();
 						if(!checker->check(StringPiece(lineString, kernel::offsetInLine(ip)), character)) {
 							eraseSelection(*this);
 							return false;	// invalid sequence
@@ -617,7 +626,8 @@ namespace ascension {
 
 		// @see detail#InputMethodQueryEvent#querySurroundingText
 		std::pair<const StringPiece, StringPiece::const_iterator> Caret::querySurroundingText() const BOOST_NOEXCEPT {
-			const StringPiece lineString(document().lineString(kernel::line(hit().characterIndex())));
+			surroundingText_ = document().lineString(kernel::line(hit().characterIndex()));	// kept for the caller
+			const StringPiece lineString(surroundingText_);
 			StringPiece::const_iterator position(lineString.cbegin());
 			if(boost::size(selectedRegion().lines()) == 1)
 				position += kernel::offsetInLine(insertionPosition(document(), beginning()));
@@ -171,7 +171,8 @@ namespace ascension {
 			 */
 			TextHit firstPrintableCharacterOfLine(const PointProxy& p) {
 				kernel::Position np(normalPosition(p));
-				const Char* const s = document(p).lineString(kernel::line(np)).data();
+				String buffer;
+				const Char* const s = document(p).lineContent(kernel::line(np)).textPiece(buffer).data();
 				np.offsetInLine = kernel::detail::identifierSyntax(kernelProxy(p)).eatWhiteSpaces(s, s + document(p).lineLength(kernel::line(np)), true) - s;
 				return TextHit::leading(np);
 			}
@@ -185,13 +186,14 @@ namespace ascension {
 			 */
 			TextHit firstPrintableCharacterOfVisualLine(const PointProxy& p) {
 				kernel::Position np(normalPosition(p));
-				const String& s = document(p).lineString(kernel::line(np));
+				String buffer;
+				const StringPiece s(document(p).lineContent(kernel::line(np)).textPiece(buffer));
 				if(const graphics::font::TextLayout* const layout = p.textArea.textRenderer()->layouts().at(kernel::line(np))) {
 					const Index subline = layout->lineAt(graphics::font::makeLeadingTextHit(kernel::offsetInLine(np)));
 					np.offsetInLine = kernel::detail::identifierSyntax(kernelProxy(p)).eatWhiteSpaces(
-						s.begin() + layout->lineOffset(subline),
-						s.begin() + ((subline < layout->numberOfLines() - 1) ?
-							layout->lineOffset(subline + 1) : s.length()), true) - s.begin();
+						s.cbegin() + layout->lineOffset(subline),
+						s.cbegin() + ((subline < layout->numberOfLines() - 1) ?
+							layout->lineOffset(subline + 1) : s.length()), true) - s.cbegin();
 					return TextHit::leading(np);
 				}
 				return firstPrintableCharacterOfLine(p);
@@ -279,7 +281,8 @@ namespace ascension {
 			bool isFirstPrintableCharacterOfLine(const PointProxy& p) {
 				const kernel::Position np(normalPosition(p)), bob(*boost::const_begin(document(p).accessibleRegion()));
 				const Index offset = (kernel::line(bob) == kernel::line(np)) ? kernel::offsetInLine(bob) : 0;
-				const String& line = document(p).lineString(kernel::line(np));
+				String buffer;
+				const StringPiece line(document(p).lineContent(kernel::line(np)).textPiece(buffer));
 				return line.data() + kernel::offsetInLine(np) - offset
 					== kernel::detail::identifierSyntax(kernelProxy(p)).eatWhiteSpaces(line.data() + offset, line.data() + line.length(), true);
 			}
@@ -293,7 +296,8 @@ namespace ascension {
 			/// Returns @c true if the given position is the last printable character in the line.
 			bool isLastPrintableCharacterOfLine(const PointProxy& p) {
 				const kernel::Position np(normalPosition(p)), eob(*boost::const_end(document(p).accessibleRegion()));
-				const String& line = document(p).lineString(kernel::line(np));
+				String buffer;
+				const StringPiece line(document(p).lineContent(kernel::line(np)).textPiece(buffer));
 				const Index lineLength = (kernel::line(eob) == kernel::line(np)) ? kernel::offsetInLine(eob) : line.length();
 				return line.data() + lineLength - kernel::offsetInLine(np)
 					== kernel::detail::identifierSyntax(kernelProxy(p)).eatWhiteSpaces(line.data() + kernel::offsetInLine(np), line.data() + lineLength, true);
@@ -312,7 +316,8 @@ namespace ascension {
 			 */
 			TextHit lastPrintableCharacterOfLine(const PointProxy& p) {
 				kernel::Position np(normalPosition(p));
-				const String& s(document(p).lineString(kernel::line(np)));
+				String buffer;
+				const StringPiece s(document(p).lineContent(kernel::line(np)).textPiece(buffer));
 				const text::IdentifierSyntax& syntax = kernel::detail::identifierSyntax(kernelProxy(p));
 				for(Index spaceLength = 0; spaceLength < s.length(); ++spaceLength) {
 					if(syntax.isWhiteSpace(s[s.length() - spaceLength - 1], true))
@@ -561,6 +566,10 @@ namespace ascension {
 			 * @see kernel#locations#updatePosition
 			 */
 			TextHit updateTextHit(const TextHit& hit, const kernel::Document& document, const kernel::DocumentChange& change, Direction gravity) {
+				if(!change.replacements().empty()) {	// multiple replacements. keep the edge
+					const auto p(kernel::locations::updatePosition(hit.characterIndex(), change, gravity));
+					return hit.isLeadingEdge() ? TextHit::leading(p) : TextHit::trailing(p);
+				}
 				TextHit h(hit);
 				if(!boost::empty(change.erasedRegion())) {	// deletion
 					assert(*boost::const_begin(change.erasedRegion()) <= *boost::const_end(change.erasedRegion()));
@@ -194,6 +194,7 @@ namespace ascension {
 		VisualPoint::VisualPoint(kernel::Document& document,
 				const TextHit& position /* = TextHit::leading(kernel::Position::zero()) */)
 				: AbstractPoint(document), hit_(position), crossingLines_(false) {
+			positionChanged();
 		}
 
 		/**
@@ -208,6 +209,7 @@ namespace ascension {
 		VisualPoint::VisualPoint(TextArea& textArea,
 				const TextHit& position /* = TextHit::leading(kernel::Position::zero()) */)
 				: AbstractPoint(*viewer::document(textArea.textViewer())), hit_(position), crossingLines_(false) {
+			positionChanged();
 			install(textArea);
 		}
 
@@ -224,6 +226,7 @@ namespace ascension {
 				hit_(other.isLeadingEdge() ?
 					TextHit::leading(other.characterIndex().position()) : TextHit::trailing(other.characterIndex().position())),
 				crossingLines_(false) {
+			positionChanged();
 		}
 
 		/**
@@ -233,6 +236,7 @@ namespace ascension {
 		 * @throw TextAreaDisposedException @c other.isTextAreaDisposed() returned @c true
 		 */
 		VisualPoint::VisualPoint(const VisualPoint& other) : AbstractPoint(other), hit_(other.hit_), crossingLines_(false) {
+			positionChanged();
 			if(other.isInstalled()) {
 				if(other.isTextAreaDisposed())
 					throw TextAreaDisposedException();
@@ -306,6 +310,11 @@ namespace ascension {
 			}
 		}
 
+		/// @see kernel#AbstractPoint#indexedLine
+		Index VisualPoint::indexedLine() const BOOST_NOEXCEPT {
+			return kernel::line(hit().characterIndex());
+		}
+
 		/**
 		 * Installs this @c VisualPoint on the specified @c TextArea.
 		 * @param textArea The @c TextArea by which this point is installed
@@ -437,6 +446,7 @@ namespace ascension {
 			const TextHit from(hit());
 			hit_ = destination;
 			moved(from);
+			positionChanged();	// after moved, which can change the line Caret returns by indexedLine
 			if(destination != from)
 				motionSignal_(*this, from);
 			return *this;
@@ -193,6 +193,53 @@ BOOST_AUTO_TEST_CASE(surrogate_test) {
 	BOOST_TEST(*i == SPOT16_IN_UTF16[1]);
 }
 
+BOOST_AUTO_TEST_CASE(chunk_test) {
+	k::Document d;
+	k::insert(d, k::Position::zero(), fromLatin1("abc\ndef\n"));
+	k::insert(d, k::Position::bol(2u), std::begin(SPOT16_IN_UTF16), std::end(SPOT16_IN_UTF16));
+	k::insert(d, k::Position::bol(2u), fromLatin1("x"));
+	k::DocumentCharacterIterator i(d, k::Region(k::Position(0u, 1u), k::Position(2u, 3u)));
+	ascension::String buffer;
+
+	BOOST_TEST(i.chunk(buffer) == fromLatin1("bc"));
+	i.advanceInChunk(1u);
+	BOOST_TEST(i.tell() == k::Position(0u, 2u));
+	BOOST_TEST(i.offset() == 1);
+	BOOST_CHECK_THROW(i.advanceInChunk(2u), ascension::NoSuchElementException);
+	i.advanceInChunk(1u);
+	BOOST_TEST(i.chunk(buffer) == ascension::String(1, ascension::text::LINE_SEPARATOR));
+	i.advanceInChunk(1u);
+	BOOST_TEST(i.tell() == k::Position::bol(1u));
+	BOOST_TEST(i.chunk(buffer) == fromLatin1("def"));
+	i.advanceInChunk(3u).advanceInChunk(1u);
+
+	// the last chunk ends at the end of the region, and the offset counts a surrogate pair as one
+	BOOST_TEST(i.chunk(buffer).length() == 3u);
+	i.advanceInChunk(3u);
+	BOOST_TEST(i.tell() == k::Position(2u, 3u));
+	BOOST_TEST(i.offset() == 9);
+	BOOST_TEST(!i.hasNext());
+	BOOST_TEST(i.chunk(buffer).empty());
+
+	// a chunk begins in the surrogate pair
+	i.seekInChunks(8u);
+	BOOST_TEST(i.tell() == k::Position(2u, 1u));
+	const std::ptrdiff_t offset = i.offset();
+	i.advanceInChunk(1u);
+	BOOST_TEST(i.offset() == offset + 1);
+	BOOST_TEST(i.chunk(buffer) == ascension::String(1, SPOT16_IN_UTF16[1]));
+	i.advanceInChunk(1u);
+	BOOST_TEST(i.offset() == offset + 1);
+
+	i.seekInChunks(0u);
+	BOOST_TEST(i.tell() == k::Position(0u, 1u));
+	i.seekInChunks(2u);
+	BOOST_TEST(i.chunk(buffer) == ascension::String(1, ascension::text::LINE_SEPARATOR));
+	i.seekInChunks(3u);
+	BOOST_TEST(i.tell() == k::Position::bol(1u));
+	BOOST_CHECK_THROW(i.seekInChunks(11u), ascension::IndexOutOfBoundsException);
+}
+
 BOOST_AUTO_TEST_CASE(copy_construction_test) {
 	k::Document d;
 	k::insert(d, k::Position::zero(), fromLatin1("abc"));
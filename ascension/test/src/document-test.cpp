@@ -2,6 +2,8 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include <ascension/kernel/document.hpp>
+#include <ascension/kernel/document-snapshot.hpp>
+#include <ascension/kernel/point.hpp>
 #include <boost/range/irange.hpp>
 #include "from-latin1.hpp"
 
@@ -182,6 +184,44 @@ BOOST_AUTO_TEST_SUITE(modifications)
 		BOOST_TEST(d.numberOfLines() == 1u);
 	}
 
+	BOOST_AUTO_TEST_CASE(line_offset_test) {
+		k::Document d;
+		k::insert(d, k::Position::zero(), fromLatin1("abcde\nfghij\r\nklmno\rpqrst"));
+		BOOST_TEST(d.length() == 24u);
+		BOOST_TEST(d.length(ascension::text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED) == 26u);
+		BOOST_TEST(d.lineOffset(1u) == 6u);
+		BOOST_TEST(d.lineOffset(2u) == 13u);
+		BOOST_TEST(d.lineOffset(3u) == 19u);
+		BOOST_TEST(d.lineOffset(3u, ascension::text::Newline::LINE_FEED) == 18u);
+		BOOST_CHECK_THROW(d.lineOffset(4u), k::BadPositionException);
+
+		// inverse
+		BOOST_TEST(d.lineAt(0u) == 0u);
+		BOOST_TEST(d.lineAt(5u) == 0u);
+		BOOST_TEST(d.lineAt(6u) == 1u);
+		BOOST_TEST(d.lineAt(12u) == 1u);	// between CR and LF
+		BOOST_TEST(d.lineAt(13u) == 2u);
+		BOOST_TEST(d.lineAt(24u) == 3u);
+		BOOST_TEST(d.lineAt(17u, ascension::text::Newline::LINE_FEED) == 2u);
+		BOOST_TEST(d.lineAt(18u, ascension::text::Newline::LINE_FEED) == 3u);
+		BOOST_CHECK_THROW(d.lineAt(25u), ascension::IndexOutOfBoundsException);
+
+		// the index follows the changes
+		k::insert(d, k::Position(1u, 2u), fromLatin1("xy\r\nz"));
+		BOOST_TEST(d.length() == 29u);
+		BOOST_TEST(d.lineOffset(2u) == 12u);
+		BOOST_TEST(d.lineOffset(4u) == 24u);
+		BOOST_TEST(d.lineAt(23u) == 3u);
+		k::erase(d, k::Region(k::Position(0u, 3u), k::Position(2u, 1u)));
+		BOOST_TEST(contents(d) == fromLatin1("abchij\r\nklmno\rpqrst"));
+		BOOST_TEST(d.length() == 19u);
+		BOOST_TEST(d.lineOffset(2u) == 14u);
+		BOOST_TEST(d.lineAt(14u) == 2u);
+		d.undo();
+		BOOST_TEST(d.length() == 29u);
+		BOOST_TEST(d.lineOffset(4u) == 24u);
+	}
+
 	BOOST_AUTO_TEST_CASE(modified_mark_test) {
 		k::Document d;
 		BOOST_TEST(!d.isModified());
@@ -192,6 +232,75 @@ BOOST_AUTO_TEST_SUITE(modifications)
 		d.markUnmodified();
 		BOOST_TEST(!d.isModified());
 	}
+
+	BOOST_AUTO_TEST_CASE(latin1_line_test) {
+		k::Document d;
+		ascension::String text(fromLatin1("abc\nde"));
+		text += 0x00e9u;	// LATIN SMALL LETTER E WITH ACUTE
+		text += fromLatin1("\nxy");
+		text += 0x3042u;	// HIRAGANA LETTER A
+		k::insert(d, k::Position::zero(), text);
+		BOOST_TEST(d.lineContent(0u).isLatin1());
+		BOOST_TEST(d.lineContent(0u).latin1Text() == "abc");
+		BOOST_TEST(d.lineContent(1u).isLatin1());
+		BOOST_TEST(d.lineContent(1u).latin1Text().length() == 3u);
+		BOOST_TEST(!d.lineContent(2u).isLatin1());
+		BOOST_TEST(contents(d) == text);
+
+		// a non-Latin-1 character widens the line, and removing it narrows the line again
+		k::insert(d, k::Position(0u, 1u), ascension::String(1, 0x3042u));
+		BOOST_TEST(!d.lineContent(0u).isLatin1());
+		k::erase(d, k::Region::makeSingleLine(0u, boost::irange(1u, 2u)));
+		BOOST_TEST(d.lineContent(0u).isLatin1());
+		k::insert(d, k::Position(0u, 3u), fromLatin1("def"));
+		BOOST_TEST(d.lineContent(0u).latin1Text() == "abcdef");
+		k::erase(d, k::Region(k::Position(1u, 3u), k::Position(2u, 2u)));
+		BOOST_TEST(!d.lineContent(1u).isLatin1());
+		BOOST_TEST(d.lineContent(1u).length() == 4u);
+
+		// textPiece(String&) widens only into the buffer
+		const ascension::String abcdef(fromLatin1("abcdef"));
+		ascension::String buffer;
+		BOOST_TEST((d.lineContent(0u).textPiece(buffer) == ascension::StringPiece(abcdef)));
+		BOOST_TEST(d.lineContent(0u).isLatin1());
+
+		// text() returns a widened copy and does not change the line
+		BOOST_TEST(d.lineString(0u) == fromLatin1("abcdef"));
+		BOOST_TEST(d.lineContent(0u).isLatin1());
+		BOOST_TEST(d.lineContent(0u).length() == 6u);
+	}
+
+	BOOST_AUTO_TEST_CASE(multiple_replacements_test) {
+		k::Document d;
+		k::insert(d, k::Position::zero(), fromLatin1("abcdef\nghi\njkl"));
+		const k::Point p(d, k::Position(1u, 2u));
+		d.clearUndoBuffer();
+
+		std::vector<std::pair<k::Region, ascension::StringPiece>> replacements;
+		const ascension::String xyz(fromLatin1("XYZ")), newline(fromLatin1("\n")), empty;
+		replacements.push_back(std::make_pair(k::Region(k::Position(2u, 1u), k::Position(2u, 2u)), ascension::StringPiece(xyz)));
+		replacements.push_back(std::make_pair(k::Region::makeSingleLine(0u, boost::irange(1u, 2u)), ascension::StringPiece(newline)));
+		replacements.push_back(std::make_pair(k::Region::makeSingleLine(0u, boost::irange(4u, 6u)), ascension::StringPiece(empty)));
+		replacements.push_back(std::make_pair(k::Region(k::Position(0u, 6u), k::Position(1u, 0u)), ascension::StringPiece(xyz)));
+		d.replace(replacements);
+		BOOST_TEST(contents(d) == fromLatin1("a\ncdXYZghi\njXYZl"));
+		BOOST_TEST(d.numberOfLines() == 3u);
+		BOOST_TEST(p.position() == k::Position(1u, 7u));	// moved by the replacements before it
+		BOOST_TEST(d.numberOfUndoableChanges() == 1u);
+
+		d.undo();
+		BOOST_TEST(contents(d) == fromLatin1("abcdef\nghi\njkl"));
+		BOOST_TEST(p.position() == k::Position(1u, 2u));
+		d.redo();
+		BOOST_TEST(contents(d) == fromLatin1("a\ncdXYZghi\njXYZl"));
+
+		// overlapping regions are rejected
+		replacements.clear();
+		replacements.push_back(std::make_pair(k::Region::makeSingleLine(0u, boost::irange(0u, 2u)), ascension::StringPiece(xyz)));
+		replacements.push_back(std::make_pair(k::Region::makeSingleLine(0u, boost::irange(1u, 1u)), ascension::StringPiece(xyz)));
+		BOOST_CHECK_THROW(d.replace(replacements), std::invalid_argument);
+		BOOST_TEST(contents(d) == fromLatin1("a\ncdXYZghi\njXYZl"));
+	}
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(undo_redo)
@@ -417,6 +526,32 @@ BOOST_AUTO_TEST_SUITE(undo_redo)
 		d.undo(1);
 		BOOST_TEST(!d.isCompoundChanging());
 	}
+
+	BOOST_AUTO_TEST_CASE(limit_test) {
+		k::Document d;
+		BOOST_TEST((d.undoBufferLimit() == boost::none));
+		BOOST_TEST(d.undoBufferSize() == 0u);
+
+		for(int i = 0; i < 100; ++i)
+			k::insert(d, k::Position::zero(), fromLatin1("abc"));	// does not merge with the previous
+		BOOST_REQUIRE(d.numberOfUndoableChanges() == 100u);
+		const std::size_t size = d.undoBufferSize();
+		BOOST_TEST(size > 0u);
+
+		d.setUndoBufferLimit(size / 2);
+		BOOST_TEST(d.undoBufferSize() <= size / 2);
+		const std::size_t n = d.numberOfUndoableChanges();
+		BOOST_TEST(n > 0u);
+		BOOST_TEST(n < 100u);
+		for(std::size_t i = 0; i < n; ++i)
+			d.undo(1);
+		BOOST_TEST(d.length() == (100u - n) * 3u);
+		BOOST_TEST(d.numberOfRedoableChanges() == n);
+
+		d.setUndoBufferLimit(boost::none);
+		d.clearUndoBuffer();
+		BOOST_TEST(d.undoBufferSize() == 0u);
+	}
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(narrowing)
@@ -457,6 +592,207 @@ BOOST_AUTO_TEST_SUITE(narrowing)
 	}
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(loading)
+	BOOST_AUTO_TEST_CASE(load_content_test) {
+		k::Document d;
+		k::insert(d, k::Position::zero(), fromLatin1("old content"));
+		BOOST_REQUIRE(d.numberOfUndoableChanges() == 1u);
+		const auto revision = d.revisionNumber();
+
+		const std::shared_ptr<const ascension::String> content(std::make_shared<ascension::String>(fromLatin1("abcde\nfghij\r\n\rklmno")));
+		d.loadContent(content);
+		BOOST_TEST(d.revisionNumber() == revision + 1);
+		BOOST_TEST(d.numberOfUndoableChanges() == 0u);
+		BOOST_REQUIRE(d.numberOfLines() == 4u);
+		BOOST_TEST(d.lineLength(0u) == 5u);
+		BOOST_TEST(d.lineLength(2u) == 0u);
+		BOOST_TEST((d.lineContent(0u).newline() == ascension::text::Newline::LINE_FEED));
+		BOOST_TEST((d.lineContent(1u).newline() == ascension::text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED));
+		BOOST_TEST((d.lineContent(2u).newline() == ascension::text::Newline::CARRIAGE_RETURN));
+		BOOST_TEST(d.lineContent(3u).textPiece().data() == content->data() + 14);	// not copied
+		BOOST_TEST(contents(d) == *content);
+
+		// edit a line, the others still refer to the content
+		k::insert(d, k::Position(1u, 5u), fromLatin1("!"));
+		BOOST_TEST(d.lineString(1u) == fromLatin1("fghij!"));
+		BOOST_TEST(d.lineContent(0u).textPiece().data() == content->data());
+		BOOST_TEST(d.lineString(0u) == fromLatin1("abcde"));
+		BOOST_TEST(d.lineContent(0u).textPiece().data() == content->data());	// Line.text returns a copy
+
+		// multi-line edit over the lines refer to the content
+		k::erase(d, k::Region(k::Position(0u, 3u), k::Position(3u, 2u)));
+		BOOST_REQUIRE(d.numberOfLines() == 1u);
+		BOOST_TEST(d.lineString(0u) == fromLatin1("abcmno"));
+		d.undo();
+		BOOST_TEST(contents(d) == fromLatin1("abcde\nfghij!\r\n\rklmno"));
+		BOOST_TEST(d.length() == 20u);
+
+		d.resetContent();
+		BOOST_TEST(d.numberOfLines() == 1u);
+		BOOST_TEST(d.length() == 0u);
+	}
+
+	BOOST_AUTO_TEST_CASE(load_empty_content_test) {
+		k::Document d;
+		d.loadContent(std::make_shared<ascension::String>());
+		BOOST_TEST(d.numberOfLines() == 1u);
+		BOOST_TEST(d.lineString(0u).empty());
+		d.setReadOnly(true);
+		BOOST_CHECK_THROW(d.loadContent(std::make_shared<ascension::String>()), k::ReadOnlyDocumentException);
+	}
+
+	BOOST_AUTO_TEST_CASE(load_batches_test) {
+		std::vector<std::shared_ptr<const ascension::String>> batches;
+		batches.push_back(std::make_shared<ascension::String>(fromLatin1("abc\nde")));
+		batches.push_back(std::make_shared<ascension::String>(fromLatin1("fg\r")));
+		batches.push_back(std::make_shared<ascension::String>());
+		batches.push_back(std::make_shared<ascension::String>(fromLatin1("\nhij\r")));
+		batches.push_back(std::make_shared<ascension::String>(fromLatin1("klm")));
+		k::Document d;
+		d.loadContent(batches);
+		BOOST_REQUIRE(d.numberOfLines() == 4u);
+		BOOST_TEST(contents(d) == fromLatin1("abc\ndefg\r\nhij\rklm"));
+		BOOST_TEST(d.lineContent(0u).textPiece().data() == batches[0]->data());	// not copied
+		BOOST_TEST(d.lineString(1u) == fromLatin1("defg"));	// straddles the batches
+		BOOST_TEST((d.lineContent(1u).newline() == ascension::text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED));
+		BOOST_TEST(d.lineContent(2u).textPiece().data() == batches[3]->data() + 1);
+		BOOST_TEST((d.lineContent(2u).newline() == ascension::text::Newline::CARRIAGE_RETURN));
+		BOOST_TEST(d.lineContent(3u).textPiece().data() == batches[4]->data());
+		BOOST_TEST(d.length() == 17u);
+
+		batches.push_back(std::shared_ptr<const ascension::String>());
+		BOOST_CHECK_THROW(d.loadContent(batches), ascension::NullPointerException);
+		BOOST_TEST(d.numberOfLines() == 4u);
+		d.loadContent(std::vector<std::shared_ptr<const ascension::String>>());
+		BOOST_TEST(d.numberOfLines() == 1u);
+		BOOST_TEST(d.length() == 0u);
+	}
+
+	BOOST_AUTO_TEST_CASE(load_split_lines_test) {
+		std::vector<std::shared_ptr<const ascension::String>> batches;
+		batches.push_back(std::make_shared<ascension::String>(fromLatin1("abc\r\nde")));
+		batches.push_back(std::make_shared<ascension::String>(fromLatin1("fghi")));
+		std::vector<k::DocumentContentLine> lines(3);
+		lines[0].text = ascension::StringPiece(batches[0]->data(), 3);
+		lines[0].newline = ascension::text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED;
+		lines[1].text = ascension::StringPiece(batches[0]->data() + 5, 2);
+		lines[1].newline = ascension::text::Newline::LINE_FEED;	// does not have to be in the batches
+		lines[2].text = ascension::StringPiece(batches[1]->data(), 4);
+		lines[2].newline = ascension::text::Newline::CARRIAGE_RETURN;	// ignored
+		k::Document d;
+		d.loadContent(batches, lines);
+		BOOST_REQUIRE(d.numberOfLines() == 3u);
+		BOOST_TEST(contents(d) == fromLatin1("abc\r\nde\nfghi"));
+		BOOST_TEST(d.lineContent(1u).textPiece().data() == batches[0]->data() + 5);	// not copied
+		BOOST_TEST(d.lineContent(2u).textPiece().data() == batches[1]->data());
+		BOOST_TEST(d.length() == 12u);
+		BOOST_TEST(d.numberOfUndoableChanges() == 0u);
+
+		BOOST_CHECK_THROW(d.loadContent(batches, std::vector<k::DocumentContentLine>()), std::invalid_argument);
+		lines.resize(1);
+		lines[0].text = ascension::StringPiece();
+		d.loadContent(std::vector<std::shared_ptr<const ascension::String>>(), lines);
+		BOOST_TEST(d.numberOfLines() == 1u);
+		BOOST_TEST(d.length() == 0u);
+	}
+
+	BOOST_AUTO_TEST_CASE(lazy_load_test) {
+		class LineSource : public k::DocumentLineSource {
+		public:
+			LineSource() : reads(0), measures(0) {}
+			ascension::Index lineLength(ascension::Index line, ascension::text::Newline& newline) const override {
+				++measures;
+				newline = ascension::text::Newline::LINE_FEED;
+				return line % 10;
+			}
+			ascension::Index numberOfLines() const BOOST_NOEXCEPT override {return 100u;}
+			void readLine(ascension::Index line, ascension::String& text, ascension::text::Newline& newline) const override {
+				++reads;
+				text.assign(line % 10, 'x');
+				newline = ascension::text::Newline::LINE_FEED;
+			}
+			mutable std::size_t reads, measures;
+		};
+		const std::shared_ptr<LineSource> source(std::make_shared<LineSource>());
+		k::Document d;
+		d.loadContent(source, 2u);
+		BOOST_TEST(d.isLazy());
+		BOOST_TEST(d.isReadOnly());
+		BOOST_TEST(d.numberOfLines() == 100u);
+		BOOST_TEST(d.numberOfUndoableChanges() == 0u);
+		BOOST_TEST(source->reads == 1u);	// only the last line to notify the change
+
+		// decoded on demand and cached
+		BOOST_TEST(d.lineLength(3u) == 3u);
+		BOOST_TEST(d.lineString(3u) == fromLatin1("xxx"));
+		BOOST_TEST(source->reads == 2u);
+		BOOST_TEST(d.lineLength(5u) == 5u);
+		BOOST_TEST(d.lineLength(3u) == 3u);
+		BOOST_TEST(source->reads == 3u);
+		BOOST_TEST(d.lineLength(7u) == 7u);	// evicts the line 5
+		BOOST_TEST(d.lineLength(3u) == 3u);
+		BOOST_TEST(source->reads == 4u);
+		BOOST_TEST(d.lineLength(5u) == 5u);
+		BOOST_TEST(source->reads == 5u);
+
+		// region() does not read the last line, and a pinned line survives the eviction
+		BOOST_TEST((d.region() == k::Region(k::Position::zero(), k::Position(99u, 9u))));
+		const std::shared_ptr<const k::Document::Line> pinned(d.pinLine(5u));
+		BOOST_TEST(d.lineLength(1u) == 1u);
+		BOOST_TEST(d.lineLength(2u) == 2u);	// evicts the line 5
+		BOOST_TEST(pinned->length() == 5u);
+		BOOST_TEST(source->reads == 7u);
+
+		// the line index measures all the lines without reading them
+		BOOST_TEST(d.lineOffset(11u) == 45u + 11u);
+		BOOST_TEST(d.length() == 450u + 99u);
+		BOOST_TEST(d.lineAt(57u) == 11u);
+		BOOST_TEST(source->reads == 7u);
+		BOOST_TEST(source->measures == 100u);
+
+		BOOST_CHECK_THROW(k::insert(d, k::Position::zero(), fromLatin1("a")), k::ReadOnlyDocumentException);
+		d.setReadOnly(false);
+		BOOST_TEST(d.isReadOnly());
+		BOOST_CHECK_THROW(d.loadContent(source, 0u), std::invalid_argument);
+
+		d.resetContent();
+		BOOST_TEST(!d.isLazy());
+		BOOST_TEST(!d.isReadOnly());
+		BOOST_TEST(d.numberOfLines() == 1u);
+		BOOST_TEST(d.length() == 0u);
+	}
+
+	BOOST_AUTO_TEST_CASE(snapshot_test) {
+		const std::shared_ptr<const ascension::String> content(std::make_shared<ascension::String>(fromLatin1("abc\ndef\r\nghi")));
+		k::Document d;
+		d.loadContent(content);
+		k::insert(d, k::Position(1u, 3u), fromLatin1("!"));
+		const k::DocumentSnapshot snapshot(d);
+		BOOST_TEST(snapshot.revisionNumber() == d.revisionNumber());
+		BOOST_REQUIRE(snapshot.numberOfLines() == 3u);
+
+		// the snapshot is not affected by the changes
+		k::erase(d, d.region());
+		k::insert(d, k::Position::zero(), fromLatin1("xyz"));
+		ascension::String text;
+		ascension::text::Newline newline;
+		snapshot.readLine(0u, text, newline);
+		BOOST_TEST(text == fromLatin1("abc"));
+		BOOST_TEST((newline == ascension::text::Newline::LINE_FEED));
+		snapshot.readLine(1u, text, newline);
+		BOOST_TEST(text == fromLatin1("def!"));
+		BOOST_TEST((newline == ascension::text::Newline::CARRIAGE_RETURN_FOLLOWED_BY_LINE_FEED));
+		snapshot.readLine(2u, text, newline);
+		BOOST_TEST(text == fromLatin1("ghi"));
+		BOOST_CHECK_THROW(snapshot.readLine(3u, text, newline), k::BadPositionException);
+
+		// a snapshot can be loaded into the other document
+		k::Document other;
+		other.loadContent(std::make_shared<k::DocumentSnapshot>(d), 4u);
+		BOOST_TEST(contents(other) == fromLatin1("xyz"));
+	}
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_CASE(reset_test) {
 	k::Document d;
 	k::insert(d, k::Position::zero(), fromLatin1("abcde\nfghij"));
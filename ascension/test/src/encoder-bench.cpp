@@ -0,0 +1,408 @@
+/**
+ * @file encoder-bench.cpp
+ * Measures the throughput of all the registered encoders in the both directions.
+ *
+ * Usage: encoder-bench [--characters=N] [--seconds=S] [--encoding=NAME] [FILE...]
+ *
+ * - --characters : The number of the characters in each generated corpus. Default is 1048576
+ * - --seconds : The minimum time to repeat each measurement. Default is 0.2
+ * - --encoding : Measures only the encodings contain @c NAME in their names. Can be repeated
+ * - FILE : UTF-8 text files used as the additional realistic corpora
+ *
+ * The result is written into the standard output in CSV with a header line. A row is a measurement and has the
+ * following columns:
+ *
+ * - encoding, mib : The name and the MIBenum value of the encoding
+ * - corpus : "ascii" (only printable ASCII), "repertoire" (random characters in the repertoire of the encoding),
+ *   "text" (lines of the words mixed ASCII and non-ASCII), "text+unmappable" (the former with the unmappable
+ *   characters or byte sequences every 64 characters) or the file name
+ * - policy : "none", "replace" or "ignore". See @c Encoder#SubstitutionPolicy
+ * - direction : "decode" (native to UTF-16) or "encode" (UTF-16 to native)
+ * - result : The result of the last conversion. The throughput is meaningful only if "completed"
+ * - bytes, characters : The lengths of the input or output in the native bytes and in UTF-16 code units
+ * - runs : The number of the repeated conversions
+ * - best_mbps, median_mbps : The throughput in 10^6 native bytes per second
+ *
+ * The progress and the skipped measurements are reported into the standard error.
+ * @author agent
+ * @date 2026-10-17 Created.
+ */
+
+#include <ascension/corelib/encoding/encoder.hpp>
+#include <ascension/corelib/encoding/encoder-factory.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+	namespace e = ascension::encoding;
+	using ascension::Byte;
+	using ascension::Char;
+	using ascension::String;
+
+	struct Options {
+		Options() : numberOfCharacters(1 << 20), seconds(0.2) {}
+		std::size_t numberOfCharacters;
+		double seconds;
+		std::vector<std::string> encodings, files;
+	};
+
+	struct Corpus {
+		std::string name;
+		String characters;	// the input of encoding
+		std::string bytes;	// the input of decoding, encoded 'characters'
+	};
+
+	struct Measurement {
+		e::Encoder::Result result;
+		std::size_t numberOfBytes, numberOfCharacters, runs;
+		double best, median;	// in seconds
+	};
+
+	const char* policyName(e::Encoder::SubstitutionPolicy policy) {
+		switch(policy) {
+			case e::Encoder::DONT_SUBSTITUTE:
+				return "none";
+			case e::Encoder::REPLACE_UNMAPPABLE_CHARACTERS:
+				return "replace";
+			case e::Encoder::IGNORE_UNMAPPABLE_CHARACTERS:
+				return "ignore";
+			default:
+				return "?";
+		}
+	}
+
+	const char* resultName(e::Encoder::Result result) {
+		switch(result) {
+			case e::Encoder::COMPLETED:
+				return "completed";
+			case e::Encoder::INSUFFICIENT_BUFFER:
+				return "insufficient-buffer";
+			case e::Encoder::UNMAPPABLE_CHARACTER:
+				return "unmappable";
+			case e::Encoder::MALFORMED_INPUT:
+				return "malformed";
+			default:
+				return "?";
+		}
+	}
+
+	/// Converts the whole of @a from into @a to by @a encoder. @a to is grown if insufficient.
+	e::Encoder::Result encode(e::Encoder& encoder, const String& from, std::vector<Byte>& to, std::size_t& encoded, std::size_t& consumed) {
+		while(true) {
+			e::Encoder::State state;
+			Byte* toNext;
+			const Char* fromNext;
+			const auto result = encoder.fromUnicode(state,
+				boost::make_iterator_range(to.data(), to.data() + to.size()), toNext,
+				boost::make_iterator_range(from.data(), from.data() + from.length()), fromNext);
+			encoded = toNext - to.data();
+			consumed = fromNext - from.data();
+			if(result != e::Encoder::INSUFFICIENT_BUFFER || to.size() > (from.length() + 1) * 64)
+				return result;
+			to.resize(to.size() * 2);
+		}
+	}
+
+	/// Converts the whole of @a from into @a to by @a encoder. @a to is grown if insufficient.
+	e::Encoder::Result decode(e::Encoder& encoder, const std::string& from, std::vector<Char>& to, std::size_t& decoded, std::size_t& consumed) {
+		const Byte* const first = reinterpret_cast<const Byte*>(from.data());
+		while(true) {
+			e::Encoder::State state;
+			Char* toNext;
+			const Byte* fromNext;
+			const auto result = encoder.toUnicode(state,
+				boost::make_iterator_range(to.data(), to.data() + to.size()), toNext,
+				boost::make_iterator_range(first, first + from.length()), fromNext);
+			decoded = toNext - to.data();
+			consumed = fromNext - first;
+			if(result != e::Encoder::INSUFFICIENT_BUFFER || to.size() > (from.length() + 1) * 4)
+				return result;
+			to.resize(to.size() * 2);
+		}
+	}
+
+	/// Repeats @a convert at least 3 times and for at least @a seconds, and returns the best and the median times.
+	template<typename Convert>
+	Measurement measure(Convert convert, double seconds) {
+		typedef std::chrono::steady_clock Clock;
+		Measurement measurement;
+		measurement.result = convert(measurement.numberOfBytes, measurement.numberOfCharacters);	// warm up
+		std::vector<double> times;
+		double total = 0;
+		do {
+			const auto start(Clock::now());
+			convert(measurement.numberOfBytes, measurement.numberOfCharacters);
+			times.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+			total += times.back();
+		} while(times.size() < 3 || total < seconds);
+		std::sort(std::begin(times), std::end(times));
+		measurement.runs = times.size();
+		measurement.best = times.front();
+		measurement.median = times[times.size() / 2];
+		return measurement;
+	}
+
+	/// Returns the characters in the repertoire of @a encoder except ASCII, C0 and C1.
+	std::vector<String> findRepertoire(e::Encoder& encoder) {
+		std::vector<String> characters;
+		for(Char c = 0xa0; c != 0x0000; ++c) {
+			if(c < 0xd800 || c > 0xdfff) {
+				const String s(1, c);
+				if(encoder.canEncode(s))
+					characters.push_back(s);
+			}
+		}
+		static const Char SUPPLEMENTALS[][2] = {
+			{0xd842, 0xdf9f},	// U+20B9F (JIS X 0213)
+			{0xd83d, 0xde00},	// U+1F600
+			{0xd840, 0xdc0b}	// U+2000B (HKSCS)
+		};
+		for(const auto& pair : SUPPLEMENTALS) {
+			const String s(pair, 2);
+			if(encoder.canEncode(s))
+				characters.push_back(s);
+		}
+		return characters;
+	}
+
+	/// Returns the first non-ASCII character which @a encoder can't encode, or an empty string.
+	String findUnmappableCharacter(e::Encoder& encoder) {
+		for(Char c = 0x80; c < 0xfffe; ++c) {
+			if(c < 0xd800 || c > 0xdfff) {
+				const String s(1, c);
+				if(!encoder.canEncode(s))
+					return s;
+			}
+		}
+		return String();
+	}
+
+	/// Returns the shortest byte sequence which @a encoder decodes as an unmappable character, or an empty string.
+	std::string findUnmappableBytes(e::Encoder& encoder) {
+		std::vector<Char> buffer(8);
+		std::size_t decoded, consumed;
+		for(int length = 1; length <= 2; ++length) {
+			for(int b = 0; b < (1 << (8 * length)); ++b) {
+				std::string bytes(1, static_cast<char>(b & 0xff));
+				if(length == 2)
+					bytes.insert(std::begin(bytes), static_cast<char>((b >> 8) ^ 0x80));	// try the leading bytes first
+				if(decode(encoder, bytes, buffer, decoded, consumed) == e::Encoder::UNMAPPABLE_CHARACTER)
+					return bytes;
+			}
+		}
+		return std::string();
+	}
+
+	/// Makes @a corpus from @a characters. The characters @a encoder can't encode are dropped.
+	bool makeCorpus(e::Encoder& encoder, const std::string& name, const String& characters, Corpus& corpus) {
+		encoder.setSubstitutionPolicy(e::Encoder::IGNORE_UNMAPPABLE_CHARACTERS);
+		std::vector<Byte> bytes(characters.length() * encoder.properties().maximumNativeBytes() + 16);
+		std::size_t encoded, consumed;
+		const auto encodingResult = encode(encoder, characters, bytes, encoded, consumed);
+		if(encodingResult != e::Encoder::COMPLETED) {
+			std::cerr << encoder.properties().name() << ": can't encode the corpus '" << name << "' (" << resultName(encodingResult) << "), skipped" << std::endl;
+			return false;
+		}
+		corpus.name = name;
+		corpus.bytes.assign(bytes.data(), bytes.data() + encoded);
+		std::vector<Char> decodedCharacters(corpus.bytes.length() * encoder.properties().maximumUCSLength() + 16);
+		std::size_t decoded;
+		const auto decodingResult = decode(encoder, corpus.bytes, decodedCharacters, decoded, consumed);
+		if(decodingResult != e::Encoder::COMPLETED) {
+			std::cerr << encoder.properties().name() << ": can't decode the corpus '" << name << "' (" << resultName(decodingResult) << "), skipped" << std::endl;
+			return false;
+		}
+		corpus.characters.assign(decodedCharacters.data(), decodedCharacters.data() + decoded);
+		return true;
+	}
+
+	/// Generates the lines of the words. A word is ASCII letters or the characters in @a characters.
+	String generateText(const std::vector<String>& characters, std::size_t length, std::minstd_rand& random) {
+		String text;
+		text.reserve(length + 128);
+		std::uniform_int_distribution<int> percent(0, 99), letter('a', 'z'), wordLength(1, 8), lineLength(30, 100);
+		std::size_t lineEnd = lineLength(random);
+		while(text.length() < length) {
+			const int n = wordLength(random);
+			if(characters.empty() || percent(random) < 50) {
+				for(int i = 0; i < n; ++i)
+					text += static_cast<Char>(letter(random));
+			} else {
+				std::uniform_int_distribution<std::size_t> index(0, characters.size() - 1);
+				for(int i = 0; i < n; ++i)
+					text += characters[index(random)];
+			}
+			if(text.length() < lineEnd)
+				text += (percent(random) < 10) ? u", " : u" ";
+			else {
+				text += (percent(random) < 20) ? u".\r\n" : u".\n";
+				lineEnd = text.length() + lineLength(random);
+			}
+		}
+		return text;
+	}
+
+	/// Generates the random characters in printable ASCII and @a characters.
+	String generateRepertoire(const std::vector<String>& characters, std::size_t length, std::minstd_rand& random) {
+		String text;
+		text.reserve(length + 2);
+		std::uniform_int_distribution<std::size_t> index(0, characters.size() + 0x5f - 1);
+		while(text.length() < length) {
+			const std::size_t i = index(random);
+			if(i < 0x5f)
+				text += static_cast<Char>(0x20 + i);
+			else
+				text += characters[i - 0x5f];
+		}
+		return text;
+	}
+
+	/// Reads the whole of the UTF-8 file.
+	bool readFile(const std::string& fileName, String& text) {
+		std::ifstream file(fileName, std::ios_base::binary);
+		if(!file)
+			return false;
+		std::ostringstream bytes;
+		bytes << file.rdbuf();
+		auto utf8(e::EncoderRegistry::instance().forMIB(e::fundamental::UTF_8));
+		text = utf8->toUnicode(bytes.str());
+		return !text.empty() || bytes.str().empty();
+	}
+
+	void report(const e::EncodingProperties& properties, const std::string& corpus,
+			e::Encoder::SubstitutionPolicy policy, const char* direction, const Measurement& measurement) {
+		const auto mbps = [&measurement](double seconds) {
+			return (seconds > 0) ? measurement.numberOfBytes / seconds / 1e6 : 0.0;
+		};
+		std::cout << properties.name() << ',' << properties.mibEnum() << ',' << corpus << ','
+			<< policyName(policy) << ',' << direction << ',' << resultName(measurement.result) << ','
+			<< measurement.numberOfBytes << ',' << measurement.numberOfCharacters << ',' << measurement.runs << ','
+			<< mbps(measurement.best) << ',' << mbps(measurement.median) << std::endl;
+	}
+
+	void run(e::Encoder& encoder, const Corpus& corpus, e::Encoder::SubstitutionPolicy policy, const Options& options) {
+		encoder.setSubstitutionPolicy(policy);
+
+		std::vector<Char> characters(corpus.bytes.length() * encoder.properties().maximumUCSLength() + 16);
+		report(encoder.properties(), corpus.name, policy, "decode", measure([&](std::size_t& nbytes, std::size_t& nchars) {
+			return decode(encoder, corpus.bytes, characters, nchars, nbytes);
+		}, options.seconds));
+
+		std::vector<Byte> bytes(corpus.characters.length() * encoder.properties().maximumNativeBytes() + 16);
+		report(encoder.properties(), corpus.name, policy, "encode", measure([&](std::size_t& nbytes, std::size_t& nchars) {
+			return encode(encoder, corpus.characters, bytes, nbytes, nchars);
+		}, options.seconds));
+	}
+
+	void run(e::Encoder& encoder, const Options& options, const std::vector<std::pair<std::string, String>>& files) {
+		const std::vector<String> characters(findRepertoire(encoder));
+		std::minstd_rand random(encoder.properties().mibEnum());
+		Corpus corpus;
+
+		// clean corpora
+		const String ascii(generateText(std::vector<String>(), options.numberOfCharacters, random));
+		const String text(generateText(characters, options.numberOfCharacters, random));
+		if(makeCorpus(encoder, "ascii", ascii, corpus))
+			run(encoder, corpus, e::Encoder::DONT_SUBSTITUTE, options);
+		if(makeCorpus(encoder, "repertoire", generateRepertoire(characters, options.numberOfCharacters, random), corpus))
+			run(encoder, corpus, e::Encoder::DONT_SUBSTITUTE, options);
+		if(makeCorpus(encoder, "text", text, corpus))
+			run(encoder, corpus, e::Encoder::DONT_SUBSTITUTE, options);
+		for(const auto& file : files) {
+			if(makeCorpus(encoder, file.first, file.second, corpus))
+				run(encoder, corpus, e::Encoder::DONT_SUBSTITUTE, options);
+		}
+
+		// dirty corpora. the unmappable sequences are put at the character boundaries
+		encoder.setSubstitutionPolicy(e::Encoder::DONT_SUBSTITUTE);
+		const String unmappableCharacter(findUnmappableCharacter(encoder));
+		const std::string unmappableBytes(findUnmappableBytes(encoder));
+		if(unmappableCharacter.empty() && unmappableBytes.empty()) {
+			std::cerr << encoder.properties().name() << ": no unmappable character, skipped the substitution policies" << std::endl;
+			return;
+		}
+		if(!makeCorpus(encoder, "text+unmappable", text, corpus))
+			return;
+		Corpus segment, dirty;
+		dirty.name = corpus.name;
+		for(std::size_t i = 0; i < corpus.characters.length(); i += 64) {
+			if(makeCorpus(encoder, dirty.name, corpus.characters.substr(i, 64), segment)) {
+				dirty.bytes += segment.bytes;
+				dirty.bytes += unmappableBytes;
+			}
+			dirty.characters += corpus.characters.substr(i, 64);
+			dirty.characters += unmappableCharacter;
+		}
+		if(unmappableBytes.empty())
+			std::cerr << encoder.properties().name() << ": no unmappable byte sequence, decoding a clean corpus" << std::endl;
+		if(unmappableCharacter.empty())
+			std::cerr << encoder.properties().name() << ": no unmappable character, encoding a clean corpus" << std::endl;
+		run(encoder, dirty, e::Encoder::REPLACE_UNMAPPABLE_CHARACTERS, options);
+		run(encoder, dirty, e::Encoder::IGNORE_UNMAPPABLE_CHARACTERS, options);
+	}
+
+	bool parseArguments(int argc, char* argv[], Options& options) {
+		for(int i = 1; i < argc; ++i) {
+			const std::string argument(argv[i]);
+			const auto value = [&argument](const char* name) -> const char* {
+				const std::string prefix(std::string("--") + name + "=");
+				return (argument.compare(0, prefix.length(), prefix) == 0) ? argument.c_str() + prefix.length() : nullptr;
+			};
+			if(const char* s = value("characters"))
+				options.numberOfCharacters = std::stoul(s);
+			else if(const char* s = value("seconds"))
+				options.seconds = std::stod(s);
+			else if(const char* s = value("encoding"))
+				options.encodings.push_back(s);
+			else if(argument.compare(0, 2, "--") != 0)
+				options.files.push_back(argument);
+			else
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Options options;
+	try {
+		if(!parseArguments(argc, argv, options)) {
+			std::cerr << "usage: " << argv[0] << " [--characters=N] [--seconds=S] [--encoding=NAME] [FILE...]" << std::endl;
+			return 2;
+		}
+	} catch(const std::logic_error&) {
+		std::cerr << argv[0] << ": invalid number" << std::endl;
+		return 2;
+	}
+
+	std::vector<std::pair<std::string, String>> files;
+	for(const auto& fileName : options.files) {
+		String text;
+		if(!readFile(fileName, text)) {
+			std::cerr << fileName << ": can't read as UTF-8" << std::endl;
+			return 1;
+		}
+		files.push_back(std::make_pair(fileName.substr(fileName.find_last_of("/\\") + 1), text));
+	}
+
+	std::vector<std::pair<std::size_t, std::shared_ptr<const e::EncoderFactory>>> factories;
+	e::EncoderRegistry::instance().availableEncodings(std::back_inserter(factories));
+	std::cout << "encoding,mib,corpus,policy,direction,result,bytes,characters,runs,best_mbps,median_mbps" << std::endl;
+	for(const auto& factory : factories) {
+		const std::string name(factory.second->name());
+		if(!options.encodings.empty() && std::none_of(std::begin(options.encodings), std::end(options.encodings),
+				[&name](const std::string& s) {return name.find(s) != std::string::npos;}))
+			continue;
+		std::cerr << name << std::endl;
+		if(auto encoder = e::EncoderRegistry::instance().forID(factory.first))
+			run(*encoder, options, files);
+	}
+	return 0;
+}
@@ -35,3 +35,375 @@ BOOST_AUTO_TEST_CASE(minimum_factory_test) {
 	BOOST_REQUIRE(encoder.get() != nullptr);
 	BOOST_TEST(encoder->properties().mibEnum() == e::fundamental::US_ASCII);
 }
+
+BOOST_AUTO_TEST_CASE(utf8_long_input_test) {
+	namespace e = ascension::encoding;
+	auto encoder(e::EncoderRegistry::instance().forMIB(e::fundamental::UTF_8));
+	BOOST_REQUIRE(encoder.get() != nullptr);
+
+	// ASCII runs longer than a vector, and multibyte sequences across the blocks
+	std::string native;
+	ascension::String ucs;
+	for(int i = 0; i < 20; ++i) {
+		native += "The quick brown fox jumps over the lazy dog. \xc3\xa9\xe3\x81\x82\xf0\x9f\x98\x80";
+		ucs += ascension::String(u"The quick brown fox jumps over the lazy dog. \u00e9\u3042\U0001f600");
+	}
+	BOOST_TEST((encoder->toUnicode(native) == ucs));
+	BOOST_TEST((encoder->fromUnicode(ucs) == native));
+
+	// malformed input after a well-formed block
+	native.insert(108, "\xed\xa0\x80");	// surrogate, at the beginning of the third repetition (54 bytes each)
+	e::Encoder::State state;
+	std::vector<ascension::Char> buffer(native.length());
+	ascension::Char* toNext;
+	const ascension::Byte* fromNext;
+	const ascension::Byte* const first = reinterpret_cast<const ascension::Byte*>(native.data());
+	BOOST_TEST(encoder->toUnicode(state,
+		boost::make_iterator_range(buffer.data(), buffer.data() + buffer.size()), toNext,
+		boost::make_iterator_range(first, first + native.length()), fromNext) == e::Encoder::MALFORMED_INPUT);
+	BOOST_TEST(fromNext - first == 108);
+}
+
+namespace {
+	// supplies the buffers of the given length, and collects the decoded characters
+	class TestSink : public ascension::encoding::Encoder::UnicodeSink {
+	public:
+		explicit TestSink(std::size_t length) : numberOfCommits(0), buffer_(length) {}
+		boost::iterator_range<ascension::Char*> buffer(std::size_t minimumLength) override {
+			if(buffer_.size() < minimumLength)
+				buffer_.resize(minimumLength);
+			return boost::make_iterator_range(buffer_.data(), buffer_.data() + buffer_.size());
+		}
+		void commit(const boost::iterator_range<const ascension::Char*>& written) override {
+			BOOST_TEST((boost::const_begin(written) == buffer_.data()));
+			decoded.append(boost::const_begin(written), boost::const_end(written));
+			++numberOfCommits;
+		}
+		ascension::String decoded;
+		std::size_t numberOfCommits;
+	private:
+		std::vector<ascension::Char> buffer_;
+	};
+
+	// never writes any character, as if a character did not fit in any buffer
+	class StuckEncoder : public ascension::encoding::Encoder {
+	public:
+		explicit StuckEncoder(std::unique_ptr<ascension::encoding::Encoder> base) : base_(std::move(base)) {}
+		const ascension::encoding::EncodingProperties& properties() const BOOST_NOEXCEPT override {return base_->properties();}
+	private:
+		Result doFromUnicode(State&, const boost::iterator_range<ascension::Byte*>& to, ascension::Byte*& toNext,
+				const boost::iterator_range<const ascension::Char*>& from, const ascension::Char*& fromNext) override {
+			toNext = boost::begin(to);
+			fromNext = boost::const_begin(from);
+			return INSUFFICIENT_BUFFER;
+		}
+		Result doToUnicode(State&, const boost::iterator_range<ascension::Char*>& to, ascension::Char*& toNext,
+				const boost::iterator_range<const ascension::Byte*>& from, const ascension::Byte*& fromNext) override {
+			toNext = boost::begin(to);
+			fromNext = boost::const_begin(from);
+			return INSUFFICIENT_BUFFER;
+		}
+		const std::unique_ptr<ascension::encoding::Encoder> base_;
+	};
+}
+
+BOOST_AUTO_TEST_CASE(unicode_sink_test) {
+	namespace e = ascension::encoding;
+	auto encoder(e::EncoderRegistry::instance().forMIB(e::fundamental::UTF_8));
+	BOOST_REQUIRE(encoder.get() != nullptr);
+	const std::string native("abc\xe3\x81\x82\xf0\x9f\x98\x80xyz");
+	const ascension::Byte* const first = reinterpret_cast<const ascension::Byte*>(native.data());
+	const ascension::Byte* fromNext;
+
+	// a short buffer holds only a character at a time
+	e::Encoder::State state;
+	TestSink sink(1);
+	BOOST_TEST(encoder->toUnicode(state, sink, boost::make_iterator_range(first, first + native.length()), fromNext) == e::Encoder::COMPLETED);
+	BOOST_TEST(fromNext == first + native.length());
+	BOOST_TEST((sink.decoded == ascension::String(u"abc\u3042\U0001f600xyz")));
+	BOOST_TEST(sink.numberOfCommits > 1u);
+
+	// the characters decoded before the malformed input are committed
+	const std::string malformed("abc\xff");
+	const ascension::Byte* const malformedFirst = reinterpret_cast<const ascension::Byte*>(malformed.data());
+	e::Encoder::State malformedState;
+	TestSink malformedSink(64);
+	BOOST_TEST(encoder->toUnicode(malformedState, malformedSink,
+		boost::make_iterator_range(malformedFirst, malformedFirst + malformed.length()), fromNext) == e::Encoder::MALFORMED_INPUT);
+	BOOST_TEST(fromNext == malformedFirst + 3);
+	BOOST_TEST((malformedSink.decoded == ascension::String(u"abc")));
+
+	// the buffer requested for a character which never fits is bounded
+	StuckEncoder stuck(e::EncoderRegistry::instance().forMIB(e::fundamental::UTF_8));
+	e::Encoder::State stuckState;
+	TestSink stuckSink(1);
+	BOOST_TEST(stuck.toUnicode(stuckState, stuckSink, boost::make_iterator_range(first, first + native.length()), fromNext) == e::Encoder::MALFORMED_INPUT);
+	BOOST_TEST(fromNext == first);
+	BOOST_TEST(stuckSink.decoded.empty());
+}
+
+BOOST_AUTO_TEST_CASE(utf16_test) {
+	namespace e = ascension::encoding;
+	const ascension::String ucs(u"a\u3042\U0001f600");
+	auto encoder(e::EncoderRegistry::instance().forName("UTF-16BE"));
+	BOOST_REQUIRE(encoder.get() != nullptr);
+	const std::string bigEndian("\0a\x30\x42\xd8\x3d\xde\0", 8);
+	BOOST_TEST((encoder->toUnicode(bigEndian) == ucs));
+	BOOST_TEST((encoder->fromUnicode(ucs) == bigEndian));
+	encoder = e::EncoderRegistry::instance().forName("UTF-16LE");
+	BOOST_REQUIRE(encoder.get() != nullptr);
+	const std::string littleEndian("a\0\x42\x30\x3d\xd8\0\xde", 8);
+	BOOST_TEST((encoder->toUnicode(littleEndian) == ucs));
+	BOOST_TEST((encoder->fromUnicode(ucs) == littleEndian));
+}
+
+BOOST_AUTO_TEST_CASE(utf32_test) {
+	namespace e = ascension::encoding;
+	auto encoder(e::EncoderRegistry::instance().forName("UTF-32LE"));
+	BOOST_REQUIRE(encoder.get() != nullptr);
+	const std::string native("a\0\0\0\x42\x30\0\0\0\xf6\x01\0", 12);
+	const ascension::String ucs(u"a\u3042\U0001f600");
+	BOOST_TEST((encoder->toUnicode(native) == ucs));
+	BOOST_TEST((encoder->fromUnicode(ucs) == native));
+}
+
+BOOST_AUTO_TEST_CASE(utf7_test) {
+	namespace e = ascension::encoding;
+	auto encoder(e::EncoderRegistry::instance().forName("UTF-7"));
+	BOOST_REQUIRE(encoder.get() != nullptr);
+	BOOST_TEST((encoder->toUnicode("a+MEI-b") == ascension::String(u"a\u3042b")));
+	BOOST_TEST(encoder->fromUnicode(ascension::String(u"a\u3042b")) == "a+MEI-b");
+	BOOST_TEST((encoder->toUnicode("Hi Mom -+Jjo--!") == ascension::String(u"Hi Mom -\u263a-!")));	// RFC 2152
+	const ascension::String ucs(u"1 + 1 = (2) \u3042\u3044\u3046\u3048.");
+	BOOST_TEST((encoder->toUnicode(encoder->fromUnicode(ucs)) == ucs));
+
+	// a non-ASCII byte or a short run in a modified BASE64 sequence
+	BOOST_TEST(encoder->toUnicode("a+MEI\xe9z").empty());
+	BOOST_TEST(encoder->toUnicode("a+M-").empty());
+}
+
+BOOST_AUTO_TEST_CASE(utf5_test) {
+	namespace e = ascension::encoding;
+	auto encoder(e::EncoderRegistry::instance().forName("UTF-5"));
+	BOOST_REQUIRE(encoder.get() != nullptr);
+	BOOST_TEST((encoder->toUnicode("M1J042") == ascension::String(u"a\u3042")));
+	BOOST_TEST(encoder->fromUnicode(ascension::String(u"a\u3042")) == "M1J042");
+
+	// a sequence does not begin with a lead character
+	BOOST_TEST(encoder->toUnicode("0!").empty());
+	BOOST_TEST(encoder->toUnicode("M1z").empty());
+}
+
+BOOST_AUTO_TEST_CASE(single_byte_charset_test) {
+	namespace e = ascension::encoding;
+	auto encoder(e::EncoderRegistry::instance().forName("ISO-8859-7"));
+	BOOST_REQUIRE(encoder.get() != nullptr);
+
+	// all the mapped bytes round trip
+	std::string bytes;
+	for(int c = 0x00; c <= 0xff; ++c)
+		bytes += static_cast<char>(c);
+	encoder->setSubstitutionPolicy(e::Encoder::IGNORE_UNMAPPABLE_CHARACTERS);
+	const ascension::String ucs(encoder->toUnicode(bytes));
+	BOOST_TEST(ucs.length() == 0x100 - 3);	// 0xAE, 0xD2 and 0xFF are unmapped
+	BOOST_TEST((ucs[0x39] == u'9'));
+	BOOST_TEST((ucs[0xc1 - 1] == u'\u0391'));
+	BOOST_TEST(encoder->fromUnicode(ucs).length() == ucs.length());
+
+	// ASCII runs longer than a vector between the Greek letters
+	std::string native;
+	ascension::String expected;
+	for(int i = 0; i < 20; ++i) {
+		native += "The quick brown fox jumps over the lazy dog. \xe1\xe2\xe3";
+		expected += ascension::String(u"The quick brown fox jumps over the lazy dog. \u03b1\u03b2\u03b3");
+	}
+	BOOST_TEST((encoder->toUnicode(native) == expected));
+	BOOST_TEST((encoder->fromUnicode(expected) == native));
+
+	// an unmappable character
+	encoder->setSubstitutionPolicy(e::Encoder::REPLACE_UNMAPPABLE_CHARACTERS);
+	BOOST_TEST(encoder->fromUnicode(ascension::String(u"a\u3042b")) == "a\x1a" "b");
+	BOOST_TEST(encoder->fromUnicode(ascension::String(u"a\ufffdb")) == "a\x1a" "b");
+}
+
+BOOST_AUTO_TEST_CASE(armscii_test) {
+	namespace e = ascension::encoding;
+	auto armscii8(e::EncoderRegistry::instance().forName("ARMSCII-8"));
+	auto armscii7(e::EncoderRegistry::instance().forName("ARMSCII-7"));
+	auto armscii8a(e::EncoderRegistry::instance().forName("ARMSCII-8A"));
+	BOOST_REQUIRE(armscii8.get() != nullptr);
+	BOOST_REQUIRE(armscii7.get() != nullptr);
+	BOOST_REQUIRE(armscii8a.get() != nullptr);
+
+	// all the Armenian letters round trip
+	ascension::String letters;
+	for(ascension::Char c = 0x0531; c <= 0x0556; ++c)
+		letters += c;
+	for(ascension::Char c = 0x0561; c <= 0x0586; ++c)
+		letters += c;
+	for(auto* const encoder : {armscii8.get(), armscii7.get(), armscii8a.get()}) {
+		const std::string native(encoder->fromUnicode(letters));
+		BOOST_TEST(native.length() == letters.length());
+		BOOST_TEST((encoder->toUnicode(native) == letters));
+	}
+
+	// every character which can be encoded into a byte comes back. ARMSCII-7 maps U+00A0 to the space
+	for(auto* const encoder : {armscii8.get(), armscii7.get(), armscii8a.get()}) {
+		for(ascension::Char c = 0x0001; c < 0xd800; ++c) {
+			const ascension::String s(1, c);
+			const std::string native(encoder->fromUnicode(s));
+			if(native.length() == 1 && !(encoder == armscii7.get() && c == 0x00a0))
+				BOOST_TEST((encoder->toUnicode(native) == s), encoder->properties().name() << " U+" << std::hex << c);
+		}
+	}
+	BOOST_TEST(armscii8a->canEncode('a'));
+	BOOST_TEST(armscii8a->fromUnicode(ascension::String(u"abc-*+/")) == "abc_*+/");
+	BOOST_TEST((armscii8a->toUnicode("*+/_") == ascension::String(u"*+/-")));
+	BOOST_TEST(!armscii8a->canEncode(':'));
+	BOOST_TEST(!armscii7->canEncode('"'));
+	BOOST_TEST(!armscii7->canEncode('a'));
+
+	// ASCII passes through ARMSCII-8, and the punctuations are mapped
+	BOOST_TEST(armscii8->fromUnicode(ascension::String(u"a(\u0531\u2014z")) == "a\xa5\xb2\xa8z");
+	BOOST_TEST((armscii8->toUnicode("a\xa5\xb2\xa8z") == ascension::String(u"a(\u0531\u2014z")));
+	BOOST_TEST(armscii7->fromUnicode(ascension::String(u"\u0531(\u0561")) == "\x32\x25\x33");
+
+	// a ligature is decomposed
+	BOOST_TEST(armscii8->fromUnicode(ascension::String(u"\ufb13")) == "\xd9\xdd");
+	BOOST_TEST(armscii7->fromUnicode(ascension::String(u"\ufb13")) == "\x59\x5d");
+	BOOST_TEST(armscii8a->fromUnicode(ascension::String(u"\ufb13")) == "\xa7\xab");
+	BOOST_TEST(armscii8a->fromUnicode(ascension::String(u"\u0587\u0589")) == "\x89\xf5\x3a");
+
+	// characters just below the mapping tables are unmappable
+	const ascension::String unmappables(u"\u0531\u052f\u2000\u0561");
+	BOOST_TEST(armscii8->fromUnicode(unmappables).empty());
+	armscii8->setSubstitutionPolicy(e::Encoder::REPLACE_UNMAPPABLE_CHARACTERS);
+	BOOST_TEST(armscii8->fromUnicode(unmappables) == "\xb2\x1a\x1a\xb3");
+	BOOST_TEST((armscii8->toUnicode("a\xa1z") == ascension::String(u"a\ufffdz")));
+	for(auto* const encoder : {armscii8.get(), armscii7.get(), armscii8a.get()})
+		encoder->setSubstitutionPolicy(e::Encoder::IGNORE_UNMAPPABLE_CHARACTERS);
+	BOOST_TEST(armscii8->fromUnicode(unmappables) == "\xb2\xb3");
+	BOOST_TEST(armscii7->fromUnicode(unmappables) == "\x32\x33");
+	BOOST_TEST(armscii8a->fromUnicode(unmappables) == "\x80\x81");
+	BOOST_TEST((armscii8a->toUnicode("\x80\xb0\xd7\xe0") == ascension::String(u"\u0531\u0548")));
+}
+
+BOOST_AUTO_TEST_CASE(double_byte_charset_test) {
+	namespace e = ascension::encoding;
+	auto sjis(e::EncoderRegistry::instance().forName("Shift_JIS"));
+	auto euckr(e::EncoderRegistry::instance().forName("EUC-KR"));
+	BOOST_REQUIRE(sjis.get() != nullptr);
+	BOOST_REQUIRE(euckr.get() != nullptr);
+
+	// ASCII runs longer than a vector between the double byte and the half-width kana characters
+	std::string native;
+	ascension::String expected;
+	for(int i = 0; i < 20; ++i) {
+		native += "The quick brown fox jumps over the lazy dog. \x93\xfa\x96\x7b\x8c\xea\xb1\xb2";
+		expected += ascension::String(u"The quick brown fox jumps over the lazy dog. \u65e5\u672c\u8a9e\uff71\uff72");
+	}
+	BOOST_TEST((sjis->toUnicode(native) == expected));
+	BOOST_TEST((sjis->fromUnicode(expected) == native));
+	BOOST_TEST((euckr->toUnicode("a\xc7\xd1\xb1\xb9\xbe\xeez") == ascension::String(u"a\ud55c\uad6d\uc5b4z")));
+	BOOST_TEST((euckr->fromUnicode(ascension::String(u"a\ud55c\uad6d\uc5b4z")) == "a\xc7\xd1\xb1\xb9\xbe\xeez"));
+	BOOST_TEST(euckr->fromUnicode(ascension::String(u"\uc8a5")).empty());	// only in UHC
+	BOOST_TEST(e::EncoderRegistry::instance().forName("UHC")->fromUnicode(ascension::String(u"\u0100")).empty());
+
+	// ISO-2022-KR designates KS X 1001 once, and shifts in and out around the double byte characters
+	auto iso2022kr(e::EncoderRegistry::instance().forName("ISO-2022-KR"));
+	BOOST_REQUIRE(iso2022kr.get() != nullptr);
+	BOOST_TEST(iso2022kr->fromUnicode(ascension::String(u"a\ud55cb")) == "\x1b$)Ca\x0eGQ\x0f" "b");
+	BOOST_TEST((iso2022kr->toUnicode("\x1b$)Ca\x0eGQ\x0f" "b") == ascension::String(u"a\ud55cb")));
+	BOOST_TEST(iso2022kr->fromUnicode(ascension::String(u"\uc8a5")).empty());	// only in UHC
+
+	// Shift_JIS-2004 separates the adjacent tone letters which would form a ligature by ZWNJ
+	auto sjis2004(e::EncoderRegistry::instance().forName("Shift_JIS-2004"));
+	BOOST_REQUIRE(sjis2004.get() != nullptr);
+	BOOST_TEST((sjis2004->toUnicode("\x86\x84") == ascension::String(u"\u02e9")));
+	BOOST_TEST((sjis2004->toUnicode("\x86\x80\x86\x84") == ascension::String(u"\u02e5\u200c\u02e9")));
+	BOOST_TEST((sjis2004->toUnicode("\x86\x85") == ascension::String(u"\u02e9\u02e5")));
+	BOOST_TEST(sjis2004->fromUnicode(ascension::String(u"\u02e5\u200c\u02e9")) == "\x86\x80\x86\x84");
+	BOOST_TEST(sjis2004->fromUnicode(ascension::String(u"\u02e9\u02e5")) == "\x86\x85");
+
+	// a malformed trail byte, and an unmappable character
+	BOOST_TEST(sjis->toUnicode("a\x93\x20").empty());
+	sjis->setSubstitutionPolicy(e::Encoder::REPLACE_UNMAPPABLE_CHARACTERS);
+	BOOST_TEST(sjis->fromUnicode(ascension::String(u"a\uac00\u65e5b")) == "a?\x93\xfa" "b");
+	sjis->setSubstitutionPolicy(e::Encoder::IGNORE_UNMAPPABLE_CHARACTERS);
+	BOOST_TEST(sjis->fromUnicode(ascension::String(u"a\uac00\u65e5b")) == "a\x93\xfa" "b");
+}
+
+namespace {
+	/// Accepts the bytes less than the given limit, and counts the bytes not less than 0x80 as significant.
+	class LimitedProber : public ascension::encoding::EncodingProber {
+	public:
+		LimitedProber(ascension::encoding::MIBenum mib, ascension::Byte limit) : mib_(mib), limit_(limit), numberOfSignificantCharacters_(0), numberOfReadBytes_(0) {}
+		ascension::encoding::MIBenum mibEnum() const BOOST_NOEXCEPT override {return mib_;}
+		std::string name() const override {return std::to_string(mib_);}
+		std::size_t numberOfSignificantCharacters() const BOOST_NOEXCEPT override {return numberOfSignificantCharacters_;}
+		std::size_t numberOfReadBytes() const BOOST_NOEXCEPT {return numberOfReadBytes_;}
+		const ascension::Byte* read(const ascension::Byte* first, const ascension::Byte* last, const ascension::Byte*) BOOST_NOEXCEPT override {
+			for(; first < last && *first < limit_; ++first, ++numberOfReadBytes_) {
+				if(*first >= 0x80)
+					++numberOfSignificantCharacters_;
+			}
+			return first;
+		}
+	private:
+		const ascension::encoding::MIBenum mib_;
+		const ascension::Byte limit_;
+		std::size_t numberOfSignificantCharacters_, numberOfReadBytes_;
+	};
+
+	class ProbingDetector : public ascension::encoding::EncodingDetector {
+	public:
+		ProbingDetector() : ascension::encoding::EncodingDetector("ProbingAutoDetect"), first(1, 0xc0), second(2, 0xff) {}
+		mutable LimitedProber first, second;
+	private:
+		std::tuple<ascension::encoding::MIBenum, std::string, std::size_t> doDetect(const boost::iterator_range<const ascension::Byte*>&) const BOOST_NOEXCEPT override {
+			return std::make_tuple(ascension::encoding::MIB_OTHER, std::string(), static_cast<std::size_t>(0));
+		}
+		void doDetectCandidates(const boost::iterator_range<const ascension::Byte*>& bytes, std::vector<Candidate>& candidates) const override {
+			std::vector<ascension::encoding::EncodingProber*> probers;
+			probers.push_back(&first);
+			probers.push_back(&second);
+			probe(bytes, probers, candidates);
+		}
+	};
+}
+
+BOOST_AUTO_TEST_CASE(probing_detector_test) {
+	namespace e = ascension::encoding;
+	std::vector<e::EncodingDetector::Candidate> candidates;
+
+	// ASCII: the ties are broken by the order of the probers
+	const std::string ascii(100, 'a');
+	const auto asciiBytes(boost::make_iterator_range(
+		reinterpret_cast<const ascension::Byte*>(ascii.data()), reinterpret_cast<const ascension::Byte*>(ascii.data() + ascii.length())));
+	BOOST_TEST(std::get<0>(ProbingDetector().detect(asciiBytes, 1000, candidates)) == 1);
+	BOOST_REQUIRE(candidates.size() == 2u);
+	BOOST_TEST(candidates[0].convertibleBytes == 100u);
+	BOOST_TEST(candidates[0].confidence == 0.0);
+
+	// the first prober rejects 0xc0. the second one is decisively ahead and the rest are not read
+	std::string text(0x3000, '\x80');
+	text[10] = '\xc0';
+	const auto bytes(boost::make_iterator_range(
+		reinterpret_cast<const ascension::Byte*>(text.data()), reinterpret_cast<const ascension::Byte*>(text.data() + text.length())));
+	ProbingDetector detector;
+	const auto result(detector.detect(bytes, 0x10000, candidates));
+	BOOST_TEST(std::get<0>(result) == 2);
+	BOOST_TEST(std::get<2>(result) == text.length());
+	BOOST_TEST(detector.first.numberOfReadBytes() == 10u);
+	BOOST_TEST(detector.second.numberOfReadBytes() < text.length());
+	BOOST_REQUIRE(candidates.size() == 2u);
+	BOOST_TEST(candidates[0].confidence > 0.99);
+	BOOST_TEST(candidates[1].mibEnum == 1);
+	BOOST_TEST(candidates[1].convertibleBytes == 10u);
+
+	// only the initial bytes are sampled
+	ProbingDetector sampling;
+	sampling.detect(bytes, 5, candidates);
+	BOOST_TEST(candidates[0].mibEnum == 1);
+	BOOST_TEST(candidates[0].convertibleBytes == 5u);
+}
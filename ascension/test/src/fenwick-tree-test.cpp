@@ -0,0 +1,98 @@
+#define BOOST_TEST_MODULE fenwick_tree_test
+#include <boost/test/included/unit_test.hpp>
+
+#include <ascension/corelib/detail/fenwick-tree.hpp>
+#include <array>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+namespace {
+	typedef ascension::detail::FenwickTree<std::size_t> Tree;
+
+	std::size_t naivePrefixSum(const std::vector<std::size_t>& values, std::size_t n) {
+		return std::accumulate(values.cbegin(), values.cbegin() + n, static_cast<std::size_t>(0));
+	}
+
+	void checkPrefixSums(const Tree& tree, const std::vector<std::size_t>& values) {
+		BOOST_REQUIRE_EQUAL(tree.size(), values.size());
+		for(std::size_t n = 0; n <= values.size(); ++n)
+			BOOST_TEST(tree.prefixSum(n) == naivePrefixSum(values, n));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(construction_test) {
+	const Tree empty;
+	BOOST_TEST(empty.empty());
+	BOOST_TEST(empty.size() == 0u);
+	BOOST_TEST(empty.sum() == 0u);
+
+	const std::array<std::size_t, 8> a = {{12, 23, 34, 45, 56, 67, 78, 89}};
+	const Tree tree(a.cbegin(), a.cend());
+	BOOST_TEST(tree.size() == a.size());
+	BOOST_TEST(tree[3] == 45u);
+	BOOST_TEST(tree.sum() == 404u);
+	checkPrefixSums(tree, std::vector<std::size_t>(a.cbegin(), a.cend()));
+	BOOST_CHECK_THROW(tree.at(8), std::out_of_range);
+	BOOST_CHECK_THROW(tree.prefixSum(9), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(set_test) {
+	std::vector<std::size_t> values(37);
+	std::iota(values.begin(), values.end(), 1);
+	Tree tree(values.cbegin(), values.cend());
+	checkPrefixSums(tree, values);
+
+	for(std::size_t i = 0; i < values.size(); i += 3) {
+		tree.set(i, values[i] = i * 7 % 5);
+		checkPrefixSums(tree, values);
+	}
+	BOOST_CHECK_THROW(tree.set(37, 0), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(insert_and_erase_test) {
+	std::vector<std::size_t> values;
+	Tree tree;
+	for(std::size_t i = 0; i < 50; ++i) {
+		const std::size_t position = i * 13 % (values.size() + 1);
+		values.insert(values.begin() + position, i);
+		tree.insert(position, i);
+		if(i % 4 == 0)
+			checkPrefixSums(tree, values);
+		if(i % 5 == 0) {	// a point update before the rebuild
+			tree.set(i / 2, values[i / 2] = 100);
+		}
+	}
+	checkPrefixSums(tree, values);
+
+	const std::array<std::size_t, 3> a = {{5, 0, 9}};
+	values.insert(values.begin() + 10, a.cbegin(), a.cend());
+	tree.insert(10, a.cbegin(), a.cend());
+	checkPrefixSums(tree, values);
+
+	values.erase(values.begin() + 3, values.begin() + 20);
+	tree.erase(3, 20);
+	checkPrefixSums(tree, values);
+	values.erase(values.begin() + 30, values.end());
+	tree.erase(30, tree.size());
+	checkPrefixSums(tree, values);
+	BOOST_CHECK_THROW(tree.erase(20, 31), std::out_of_range);
+	BOOST_CHECK_THROW(tree.insert(31, 0), std::out_of_range);
+
+	tree.clear();
+	BOOST_TEST(tree.empty());
+	BOOST_TEST(tree.sum() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(partition_point_test) {
+	const std::array<std::size_t, 6> a = {{3, 0, 4, 1, 5, 9}};
+	Tree tree(a.cbegin(), a.cend());
+	for(std::size_t x = 0; x < 25; ++x) {
+		std::size_t expected = 0;
+		while(expected < a.size() && naivePrefixSum(std::vector<std::size_t>(a.cbegin(), a.cend()), expected + 1) <= x)
+			++expected;
+		BOOST_TEST(tree.partitionPoint([x](std::size_t sum, std::size_t) {return sum <= x;}) == expected);
+	}
+	BOOST_TEST(tree.partitionPoint([](std::size_t, std::size_t n) {return n <= 4;}) == 4u);
+	BOOST_TEST(Tree().partitionPoint([](std::size_t, std::size_t) {return true;}) == 0u);
+}
@@ -92,6 +92,29 @@ BOOST_FIXTURE_TEST_CASE(adaption_test, Fixture) {
 	BOOST_TEST(p.position() == k::Position::zero());
 }
 
+BOOST_FIXTURE_TEST_CASE(indexed_points_test, Fixture) {
+	k::Point p0(d, k::Position(0u, 1u)), p1(d, k::Position(1u, 1u)), p2(d, k::Position(2u, 1u));
+
+	k::erase(d, k::Region(k::Position(0u, 3u), k::Position::bol(2u)));	// join all lines. 'p1' and 'p2' move to line 0
+	BOOST_TEST(p0.position() == k::Position(0u, 1u));
+	BOOST_TEST(p1.position() == k::Position(0u, 3u));
+	BOOST_TEST(p2.position() == k::Position(0u, 4u));
+
+	{
+		const k::Point p3(p2);
+	}
+	k::insert(d, k::Position(0u, 2u), fromLatin1("\n"));	// split the line between 'p0' and 'p1'
+	BOOST_TEST(p0.position() == k::Position(0u, 1u));
+	BOOST_TEST(p1.position() == k::Position(1u, 1u));
+	BOOST_TEST(p2.position() == k::Position(1u, 2u));
+
+	p0.moveTo(k::Position::bol(1u));
+	k::insert(d, k::Position::bol(1u), fromLatin1("x"));	// insert a character at 'p0'
+	BOOST_TEST(p0.position() == k::Position(1u, 1u));
+	BOOST_TEST(p1.position() == k::Position(1u, 2u));
+	BOOST_TEST(p2.position() == k::Position(1u, 3u));
+}
+
 BOOST_FIXTURE_TEST_CASE(motion_test, Fixture) {
 	k::Point p(d);
 
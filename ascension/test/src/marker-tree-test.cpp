@@ -0,0 +1,92 @@
+#define BOOST_TEST_MODULE marker_tree_test
+#include <boost/test/included/unit_test.hpp>
+
+#include <ascension/kernel/document.hpp>
+#include <ascension/kernel/marker-tree.hpp>
+#include "from-latin1.hpp"
+
+namespace k = ascension::kernel;
+
+BOOST_AUTO_TEST_CASE(query_test) {
+	k::Document d;
+	k::insert(d, k::Position::zero(), fromLatin1(
+		"0123\n"
+		"abcd\n"
+		"ABCD\n"
+		"xyz"
+	));
+	k::MarkerTree markers(d);
+	BOOST_TEST(markers.empty());
+
+	const auto& m3 = markers.add(k::Region(k::Position(3u, 0u), k::Position(3u, 3u)), 3u);
+	const auto& m1 = markers.add(k::Region(k::Position(0u, 1u), k::Position(1u, 2u)), 1u, 10u);
+	const auto& m2 = markers.add(k::Region::makeSingleLine(1u, boost::irange(0u, 4u)), 2u);
+	BOOST_CHECK_THROW(markers.add(k::Region(k::Position::zero(), k::Position(9u, 0u))), k::BadRegionException);
+	BOOST_TEST(markers.size() == 3u);
+	BOOST_TEST(m1.kind() == 1u);
+	BOOST_TEST(m1.payload() == 10u);
+
+	BOOST_TEST(&markers.at(0u) == &m1);
+	BOOST_TEST(&markers.at(1u) == &m2);
+	BOOST_TEST(&markers.at(2u) == &m3);
+	BOOST_CHECK_THROW(markers.at(3u), ascension::IndexOutOfBoundsException);
+	BOOST_TEST(markers.lowerBound(k::Position(1u, 0u)) == 1u);
+	BOOST_TEST(markers.lowerBound(k::Position(1u, 1u)) == 2u);
+	BOOST_TEST(markers.lowerBound(k::Position(3u, 3u)) == 3u);
+
+	auto i(markers.begin());
+	BOOST_TEST(&*i == &m1);
+	BOOST_TEST(&*++i == &m2);
+	BOOST_TEST(&*++i == &m3);
+	BOOST_TEST((++i == markers.end()));
+	BOOST_TEST(&*--i == &m3);
+
+	std::vector<const k::MarkerTree::Marker*> found;
+	markers.find(boost::irange<ascension::Index>(2u, 3u), found);
+	BOOST_TEST(found.empty());
+	markers.find(boost::irange<ascension::Index>(1u, 2u), found);
+	BOOST_REQUIRE(found.size() == 2u);
+	BOOST_TEST(found[0] == &m1);
+	BOOST_TEST(found[1] == &m2);
+	found.clear();
+	markers.find(boost::irange<ascension::Index>(0u, 4u), found);
+	BOOST_TEST(found.size() == 3u);
+
+	markers.clear();
+	BOOST_TEST(markers.empty());
+}
+
+BOOST_AUTO_TEST_CASE(document_modification_test) {
+	k::Document d;
+	k::insert(d, k::Position::zero(), fromLatin1(
+		"0123\n"
+		"abcd\n"
+		"ABCD\n"
+		"xyz"
+	));
+	k::MarkerTree markers(d);
+	const auto& m1 = markers.add(k::Region(k::Position(0u, 1u), k::Position(1u, 2u)));
+	const auto& m2 = markers.add(k::Region::makeSingleLine(1u, boost::irange(0u, 4u)));
+	const auto& m3 = markers.add(k::Region::makeSingleLine(3u, boost::irange(0u, 3u)));
+
+	// the text inserted at the beginning of a marker is not included
+	k::insert(d, k::Position(1u, 0u), fromLatin1("new\n"));
+	BOOST_TEST(m1.region().equal(k::Region(k::Position(0u, 1u), k::Position(2u, 2u))));
+	BOOST_TEST(m2.region().equal(k::Region::makeSingleLine(2u, boost::irange(0u, 4u))));
+	BOOST_TEST(m3.region().equal(k::Region::makeSingleLine(4u, boost::irange(0u, 3u))));
+
+	// the text inserted at the end of a marker is not included
+	k::insert(d, k::Position(2u, 4u), fromLatin1("!!"));
+	BOOST_TEST(m2.region().equal(k::Region::makeSingleLine(2u, boost::irange(0u, 4u))));
+
+	// a marker whose text was erased becomes empty
+	k::erase(d, k::Region(k::Position(1u, 0u), k::Position(3u, 0u)));
+	BOOST_TEST(markers.size() == 3u);
+	BOOST_TEST(m1.region().equal(k::Region(k::Position(0u, 1u), k::Position(1u, 0u))));
+	BOOST_TEST(m2.region().equal(k::Region::makeEmpty(k::Position(1u, 0u))));
+	BOOST_TEST(m3.region().equal(k::Region::makeSingleLine(2u, boost::irange(0u, 3u))));
+
+	markers.remove(m2);
+	BOOST_TEST(markers.size() == 2u);
+	BOOST_TEST(&markers.at(1u) == &m3);
+}
@@ -0,0 +1,87 @@
+#define BOOST_TEST_MODULE memory_test
+#include <boost/test/included/unit_test.hpp>
+
+#include <ascension/corelib/memory.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace {
+	struct Small : ascension::FastArenaObject<Small> {
+		explicit Small(int v) : value(v) {}
+		int value;
+	};
+	struct Large : Small {
+		explicit Large(int v) : Small(v) {std::fill(std::begin(padding), std::end(padding), static_cast<char>(v));}
+		char padding[100];
+	};
+}
+
+BOOST_AUTO_TEST_CASE(pool_test) {
+	ascension::MemoryPool pool(3);
+	auto s(pool.statistics());
+	BOOST_TEST(s.chunkSize >= sizeof(void*));
+	BOOST_TEST(s.chunkSize % sizeof(void*) == 0u);
+	BOOST_TEST(s.numberOfSlabs == 0u);
+	BOOST_TEST(s.numberOfUsedChunks == 0u);
+
+	void* const p = pool.allocate();
+	void* const q = pool.allocate();
+	BOOST_TEST(p != q);
+	s = pool.statistics();
+	BOOST_TEST(s.numberOfSlabs == 1u);
+	BOOST_TEST(s.capacity > 2u);
+	BOOST_TEST(s.numberOfUsedChunks == 2u);
+
+	pool.deallocate(p);
+	pool.release();
+	BOOST_TEST(pool.statistics().numberOfSlabs == 1u);	// q is still in use
+	pool.deallocate(q);
+	pool.deallocate(nullptr);
+	pool.release();
+	s = pool.statistics();
+	BOOST_TEST(s.numberOfSlabs == 0u);
+	BOOST_TEST(s.numberOfUsedChunks == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(thread_cache_test) {
+	ascension::MemoryPool pool(sizeof(int));
+	std::vector<void*> chunks;
+	{
+		ascension::MemoryPool::ThreadCache cache(pool);
+		for(int i = 0; i < 100; ++i)
+			chunks.push_back(cache.allocate(std::nothrow));
+		BOOST_TEST(std::count(std::begin(chunks), std::end(chunks), nullptr) == 0);
+		BOOST_TEST(pool.statistics().numberOfUsedChunks == 100u);
+		while(chunks.size() > 50) {
+			cache.deallocate(chunks.back());
+			chunks.pop_back();
+		}
+		BOOST_TEST(pool.statistics().numberOfUsedChunks == 50u);
+	}
+	BOOST_TEST(pool.statistics().numberOfUsedChunks == 50u);
+	for(auto i(std::begin(chunks)), e(std::end(chunks)); i != e; ++i)
+		pool.deallocate(*i);
+	pool.release();
+	BOOST_TEST(pool.statistics().numberOfSlabs == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(arena_object_test) {
+	std::vector<Small*> objects;
+	for(int i = 0; i < 10000; ++i)
+		objects.push_back(new Small(i));
+	auto s(Small::memoryStatistics());
+	BOOST_TEST(s.numberOfUsedChunks == 10000u);
+	BOOST_TEST(s.capacity >= 10000u);
+	for(int i = 0; i < 10000; ++i)
+		BOOST_TEST(objects[i]->value == i);
+
+	Small* const large = new Large(42);	// allocated by the global operator new
+	BOOST_TEST(Small::memoryStatistics().numberOfUsedChunks == 10000u);
+	delete static_cast<Large*>(large);
+
+	for(auto i(std::begin(objects)), e(std::end(objects)); i != e; ++i)
+		delete *i;
+	BOOST_TEST(Small::memoryStatistics().numberOfUsedChunks == 0u);
+	Small::releaseUnusedMemory();
+	BOOST_TEST(Small::memoryStatistics().numberOfSlabs == 0u);
+}
@@ -103,3 +103,36 @@ BOOST_AUTO_TEST_CASE(scan_test) {
 	BOOST_REQUIRE(newline != boost::none);
 	BOOST_TEST(boost::get(newline) == ascension::text::Newline::LINE_FEED);
 }
+
+BOOST_AUTO_TEST_CASE(find_newlines_test) {
+	// longer than a vector register, and CR+LF across the registers
+	ascension::String text(fromLatin1("0123456789abcdefghijklmn\r\nopqrstu\rvwxyz0123456789\n"));
+	text += 0x2028u;
+	text += fromLatin1("ABCDEF");
+	text += 0x2029u;
+	text += 0x0085u;
+	text += 0x2027u;	// not a newline
+	const ascension::Char* const first = text.data();
+	const ascension::Char* const last = first + text.length();
+	BOOST_TEST(ascension::text::findNewline(first, last) - first == 24);
+	BOOST_TEST(ascension::text::findNewline(first, first + 24) == first + 24);
+
+	std::vector<const ascension::Char*> newlines;
+	ascension::text::findNewlines(first, last, newlines);
+	BOOST_REQUIRE(newlines.size() == 6u);
+	BOOST_TEST(newlines[0] - first == 24);	// CR+LF
+	BOOST_TEST(newlines[1] - first == 33);	// CR
+	BOOST_TEST(newlines[2] - first == 49);	// LF
+	BOOST_TEST(newlines[3] - first == 50);	// LS
+	BOOST_TEST(newlines[4] - first == 57);	// PS
+	BOOST_TEST(newlines[5] - first == 58);	// NEL
+
+	const std::string bytes("0123456789abcdefghijklmnopqrstuvwxyz\r\n\r\r\n\x8a");
+	const ascension::Byte* const b = reinterpret_cast<const ascension::Byte*>(bytes.data());
+	std::vector<const ascension::Byte*> newlineBytes;
+	ascension::text::findNewlineBytes(b, b + bytes.length(), newlineBytes);
+	BOOST_REQUIRE(newlineBytes.size() == 3u);
+	BOOST_TEST(newlineBytes[0] - b == 36);
+	BOOST_TEST(newlineBytes[1] - b == 38);
+	BOOST_TEST(newlineBytes[2] - b == 39);
+}
@@ -0,0 +1,58 @@
+#define BOOST_TEST_MODULE sequence_diff_test
+#include <boost/test/included/unit_test.hpp>
+
+#include <ascension/corelib/detail/sequence-diff.hpp>
+#include <string>
+
+namespace {
+	std::vector<ascension::detail::DiffHunk> diff(const std::string& a, const std::string& b, std::size_t maximumDistance = 100) {
+		return ascension::detail::diffSequences(a.length(), b.length(),
+			[&a, &b](std::size_t i, std::size_t j) {return a[i] == b[j];}, maximumDistance);
+	}
+
+	std::string apply(const std::string& a, const std::string& b, const std::vector<ascension::detail::DiffHunk>& hunks) {
+		std::string result;
+		std::size_t i = 0;
+		for(const auto& hunk : hunks) {
+			result.append(a, i, hunk.first - i);
+			result.append(b, hunk.newFirst, hunk.newLast - hunk.newFirst);
+			i = hunk.last;
+		}
+		return result.append(a, i, std::string::npos);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(trivial_test) {
+	BOOST_TEST(diff("", "").empty());
+	BOOST_TEST(diff("abc", "abc").empty());
+
+	const auto hunks(diff("abc", "abxc"));
+	BOOST_REQUIRE(hunks.size() == 1u);
+	BOOST_TEST(hunks[0].first == 2u);
+	BOOST_TEST(hunks[0].last == 2u);
+	BOOST_TEST(hunks[0].newFirst == 2u);
+	BOOST_TEST(hunks[0].newLast == 3u);
+}
+
+BOOST_AUTO_TEST_CASE(shortest_edit_test) {
+	const std::string a("abcabba"), b("cbabac");
+	const auto hunks(diff(a, b));
+	BOOST_TEST(apply(a, b, hunks) == b);
+	std::size_t distance = 0;
+	for(const auto& hunk : hunks)
+		distance += (hunk.last - hunk.first) + (hunk.newLast - hunk.newFirst);
+	BOOST_TEST(distance == 5u);
+
+	const std::string c("the quick brown fox"), d("a quick brown dog");
+	BOOST_TEST(apply(c, d, diff(c, d)) == d);
+}
+
+BOOST_AUTO_TEST_CASE(maximum_distance_test) {
+	const std::string a("xaaaay"), b("xbbbby");
+	const auto hunks(diff(a, b, 2));
+	BOOST_REQUIRE(hunks.size() == 1u);	// gave up
+	BOOST_TEST(hunks[0].first == 1u);
+	BOOST_TEST(hunks[0].last == 5u);
+	BOOST_TEST(hunks[0].newFirst == 1u);
+	BOOST_TEST(hunks[0].newLast == 5u);
+}
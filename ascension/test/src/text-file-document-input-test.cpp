@@ -0,0 +1,174 @@
+#define BOOST_TEST_MODULE text_file_document_input_test
+#include <boost/test/included/unit_test.hpp>
+
+#include <ascension/kernel/document.hpp>
+#include <ascension/kernel/fileio/text-file-document-input.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <sstream>
+#include <string>
+
+namespace e = ascension::encoding;
+namespace f = ascension::kernel::fileio;
+namespace k = ascension::kernel;
+
+namespace {
+	class TemporaryFile {
+	public:
+		TemporaryFile() : name_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {}
+		~TemporaryFile() {
+			boost::system::error_code ignored;
+			boost::filesystem::remove(name_, ignored);
+			boost::filesystem::remove(journalName(), ignored);
+		}
+		boost::filesystem::path journalName() const {
+			boost::filesystem::path result(name_);
+			return result += ".journal";
+		}
+		const boost::filesystem::path& name() const {return name_;}
+	private:
+		const boost::filesystem::path name_;
+	};
+
+	void writeFile(const boost::filesystem::path& fileName, const std::string& bytes) {
+		boost::filesystem::ofstream out(fileName, std::ios_base::binary | std::ios_base::trunc);
+		out.write(bytes.data(), static_cast<std::streamsize>(bytes.length()));
+	}
+
+	std::string readFile(const boost::filesystem::path& fileName) {
+		boost::filesystem::ifstream in(fileName, std::ios_base::binary);
+		std::ostringstream s;
+		s << in.rdbuf();
+		return s.str();
+	}
+
+	ascension::String contents(const k::Document& d) {
+		std::basic_ostringstream<ascension::Char> s;
+		k::writeDocumentToStream(s, d, d.region());
+		return s.str();
+	}
+
+	// edits the bound file with the journal, and returns the journal as the crash would leave it
+	std::string editWithJournal(const TemporaryFile& file) {
+		k::Document d;
+		std::string journal;
+		{
+			f::TextFileDocumentInput input(d);
+			input.bind(file.name());
+			input.writeJournal(true);
+			input.revert("UTF-8", e::Encoder::DONT_SUBSTITUTE);
+			BOOST_REQUIRE(boost::filesystem::exists(file.journalName()));
+			k::insert(d, k::Position(0, 5u), u",");
+			input.flushJournal();
+			k::insert(d, k::Position(1, 0u), u"new ");
+			k::erase(d, k::Region(k::Position(1, 4u), k::Position(1, 8u)));
+			input.flushJournal();
+			BOOST_TEST((contents(d) == u"hello, world\nnew line\nlast"));
+			journal = readFile(file.journalName());
+		}
+		// the journal is removed when the input is destroyed normally
+		BOOST_TEST(!boost::filesystem::exists(file.journalName()));
+		return journal;
+	}
+
+	ascension::String revertWithJournal(const TemporaryFile& file) {
+		k::Document d;
+		f::TextFileDocumentInput input(d);
+		input.bind(file.name());
+		input.writeJournal(true);
+		input.revert("UTF-8", e::Encoder::DONT_SUBSTITUTE);
+		return contents(d);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(journal_replay_test) {
+	const TemporaryFile file;
+	writeFile(file.name(), "hello world\nthe line\nlast");
+	const std::string journal(editWithJournal(file));
+
+	writeFile(file.journalName(), journal);
+	BOOST_TEST((revertWithJournal(file) == u"hello, world\nnew line\nlast"));
+
+	// the journal is not replayed unless the input writes the journal
+	writeFile(file.journalName(), journal);
+	k::Document d;
+	f::TextFileDocumentInput input(d);
+	input.bind(file.name());
+	input.revert("UTF-8", e::Encoder::DONT_SUBSTITUTE);
+	BOOST_TEST((contents(d) == u"hello world\nthe line\nlast"));
+	BOOST_TEST(!d.isModified());
+
+	// the journal is replayed when the input starts writing the journal after reading the file
+	input.writeJournal(true);
+	BOOST_TEST((contents(d) == u"hello, world\nnew line\nlast"));
+}
+
+BOOST_AUTO_TEST_CASE(truncated_journal_test) {
+	const TemporaryFile file;
+	writeFile(file.name(), "hello world\nthe line\nlast");
+	const std::string journal(editWithJournal(file));
+
+	// the last record lacks its checksum
+	writeFile(file.journalName(), journal.substr(0, journal.length() - 2));
+	BOOST_TEST((revertWithJournal(file) == u"hello, world\nnew the line\nlast"));
+}
+
+BOOST_AUTO_TEST_CASE(journal_version_test) {
+	const TemporaryFile file;
+	writeFile(file.name(), "hello world\nthe line\nlast");
+	const std::string journal(editWithJournal(file));
+
+	// the file was changed after the journal was written
+	writeFile(file.name(), "hello world\nthe other line\nlast");
+	writeFile(file.journalName(), journal);
+	BOOST_TEST((revertWithJournal(file) == u"hello world\nthe other line\nlast"));
+}
+
+BOOST_AUTO_TEST_CASE(lazy_journal_test) {
+	const TemporaryFile file;
+	writeFile(file.name(), "hello world\nthe line\nlast");
+	const std::string journal(editWithJournal(file));
+
+	// revertLazily keeps the journal for the next revert
+	writeFile(file.journalName(), journal);
+	{
+		k::Document d;
+		f::TextFileDocumentInput input(d);
+		input.bind(file.name());
+		input.writeJournal(true);
+		input.revertLazily("UTF-8");
+		BOOST_TEST((contents(d) == u"hello world\nthe line\nlast"));
+		BOOST_TEST(!d.isModified());
+	}
+	BOOST_TEST(readFile(file.journalName()) == journal);
+	BOOST_TEST((revertWithJournal(file) == u"hello, world\nnew line\nlast"));
+}
+
+BOOST_AUTO_TEST_CASE(journal_after_write_test) {
+	const TemporaryFile file;
+	writeFile(file.name(), "hello world\nthe line\nlast");
+	std::string journal;
+	{
+		k::Document d;
+		f::TextFileDocumentInput input(d);
+		input.bind(file.name());
+		input.writeJournal(true);
+		input.revert("UTF-8", e::Encoder::DONT_SUBSTITUTE);
+		k::insert(d, k::Position(0, 5u), u",");
+		f::WritingFormat format;
+		format.encoding = "UTF-8";
+		format.newline = ascension::text::Newline::USE_INTRINSIC_VALUE;
+		BOOST_REQUIRE(input.beginWrite(format));
+		k::insert(d, k::Position(1, 0u), u"new ");	// changed during the writing
+		input.endWrite();
+		BOOST_TEST(readFile(file.name()) == "hello, world\nthe line\nlast");
+		BOOST_TEST(d.isModified());
+		input.flushJournal();
+		journal = readFile(file.journalName());
+	}
+
+	// the journal records only the change made during the writing, and applies to the written file
+	BOOST_TEST(journal.find(std::string("h\0e\0l\0l\0o\0", 10)) == std::string::npos);
+	writeFile(file.journalName(), journal);
+	BOOST_TEST((revertWithJournal(file) == u"hello, world\nnew the line\nlast"));
+}
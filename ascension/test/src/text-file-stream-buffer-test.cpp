@@ -0,0 +1,118 @@
+#define BOOST_TEST_MODULE text_file_stream_buffer_test
+#include <boost/test/included/unit_test.hpp>
+
+#include <ascension/corelib/basic-exceptions.hpp>
+#include <ascension/corelib/encoding/encoder-factory.hpp>
+#include <ascension/kernel/fileio/text-file-stream-buffer.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <iterator>
+#include <istream>
+#include <ostream>
+
+namespace e = ascension::encoding;
+namespace f = ascension::kernel::fileio;
+
+namespace {
+	class TemporaryFile {
+	public:
+		TemporaryFile() : name_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {}
+		~TemporaryFile() {
+			boost::system::error_code ignored;
+			boost::filesystem::remove(name_, ignored);
+		}
+		const boost::filesystem::path& name() const {return name_;}
+	private:
+		const boost::filesystem::path name_;
+	};
+
+	// more than a batch of the output segments, with a line longer than the put area
+	ascension::String makeText() {
+		ascension::String text;
+		for(std::size_t i = 0; text.length() < 0x300000; ++i) {
+			const std::size_t length = (i % 100 == 99) ? 20000 : i % 80;
+			for(std::size_t j = 0; j < length; ++j)
+				text.push_back(static_cast<ascension::Char>((j % 7 == 6) ? 0x3042 + j % 80 : 'a' + j % 26));
+			text.append(u"\r\n");
+		}
+		return text;
+	}
+
+	void write(const boost::filesystem::path& fileName, const std::string& encoding, const ascension::String& text, bool overlap) {
+		f::TextFileStreamBuffer sb(fileName, std::ios_base::out, encoding, e::Encoder::DONT_SUBSTITUTE, false);
+		sb.setOutputOverlapped(overlap);
+		std::basic_ostream<ascension::Char> out(&sb);
+		out.exceptions(std::ios_base::badbit);
+		for(ascension::String::size_type i = 0; i < text.length(); ) {
+			const ascension::String::size_type next = text.find(u'\n', i);
+			const ascension::String::size_type last = (next != ascension::String::npos) ? next + 1 : text.length();
+			out.write(text.data() + i, static_cast<std::streamsize>(last - i));
+			i = last;
+		}
+		out.put(u'!');
+		out.flush();
+		sb.close();
+	}
+
+	ascension::String read(const boost::filesystem::path& fileName, const std::string& encoding) {
+		f::TextFileStreamBuffer sb(fileName, std::ios_base::in, encoding, e::Encoder::DONT_SUBSTITUTE, false);
+		std::basic_istream<ascension::Char> in(&sb);
+		return ascension::String(std::istreambuf_iterator<ascension::Char>(in), std::istreambuf_iterator<ascension::Char>());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(round_trip_test) {
+	const ascension::String text(makeText());
+	const char* const encodings[] = {"UTF-8", "UTF-16LE", "Shift_JIS"};
+	for(std::size_t i = 0; i < std::extent<decltype(encodings)>::value; ++i) {
+		for(int overlap = 0; overlap < 2; ++overlap) {
+			const TemporaryFile file;
+			write(file.name(), encodings[i], text, overlap != 0);
+			BOOST_TEST((read(file.name(), encodings[i]) == text + u"!"));
+			const auto encoder(e::EncoderRegistry::instance().forName(encodings[i]));
+			BOOST_REQUIRE(encoder.get() != nullptr);
+			BOOST_TEST(boost::filesystem::file_size(file.name()) == encoder->fromUnicode(text + u"!").length());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(truncation_test) {
+	const TemporaryFile file;
+	write(file.name(), "UTF-8", makeText(), true);
+	write(file.name(), "UTF-8", u"short", true);
+	BOOST_TEST(boost::filesystem::file_size(file.name()) == 6u);
+	BOOST_TEST((read(file.name(), "UTF-8") == u"short!"));
+}
+
+BOOST_AUTO_TEST_CASE(unmappable_character_test) {
+	const TemporaryFile file;
+	f::TextFileStreamBuffer sb(file.name(), std::ios_base::out, "ISO-8859-1", e::Encoder::DONT_SUBSTITUTE, false);
+	sb.setOutputOverlapped(true);
+	std::basic_ostream<ascension::Char> out(&sb);
+	out.exceptions(std::ios_base::badbit);
+	// the error is thrown while the preceding batch is being written
+	const ascension::String text(0x500000, u'a'), unmappable(u"\u3042");
+	BOOST_CHECK_THROW(out.write(text.data(), text.length()).write(unmappable.data(), 1).flush(), f::UnmappableCharacterException);
+	sb.closeAndDiscard();
+	BOOST_TEST(!sb.isOpen());
+	BOOST_TEST(!boost::filesystem::exists(file.name()));
+}
+
+BOOST_AUTO_TEST_CASE(sync_policy_test) {
+	const f::SyncPolicy policies[] = {f::DONT_SYNC, f::SYNC_DATA, f::SYNC_ALL};
+	for(std::size_t i = 0; i < std::extent<decltype(policies)>::value; ++i) {
+		const TemporaryFile file;
+		f::TextFileStreamBuffer sb(file.name(), std::ios_base::out, "UTF-8", e::Encoder::DONT_SUBSTITUTE, false);
+		BOOST_TEST(sb.syncPolicy() == f::DONT_SYNC);
+		BOOST_TEST(&sb.setSyncPolicy(policies[i]) == &sb);
+		BOOST_TEST(sb.syncPolicy() == policies[i]);
+		std::basic_ostream<ascension::Char> out(&sb);
+		out.write(u"abc", 3);
+		BOOST_TEST((sb.close() == &sb));
+		BOOST_TEST(!sb.isOpen());
+		BOOST_TEST(boost::filesystem::file_size(file.name()) == 3u);
+	}
+
+	const TemporaryFile file;
+	f::TextFileStreamBuffer sb(file.name(), std::ios_base::out, "UTF-8", e::Encoder::DONT_SUBSTITUTE, false);
+	BOOST_CHECK_THROW(sb.setSyncPolicy(static_cast<f::SyncPolicy>(3)), ascension::UnknownValueException);
+}